@@ -1,68 +1,214 @@
 #ifndef TEST_BUILD
 
-#include "rendering/renderer.h"
+#include "rendering/batch.h"
+#include "rendering/live.h"
+#include "rendering/render-job.h"
 #include <fstream>
+#include <filesystem>
 #include "midi/midi.h"
+#include "midi/notes-cache.h"
+#include "midi/parse.h"
 #include <algorithm>
+#include <iostream>
 #include "shell/command-line-parser.h"
+#include "util/thread-pool.h"
+#include "util/trace.h"
+#include "logging.h"
 
 int main(int argc, char** argv)
 {
     //params
-    unsigned frame_width = 0;
-    unsigned note_height = 16;
-    unsigned horizontal_step = 1;
-    unsigned horizontal_scale = 1;
+    rendering::RENDER_OPTIONS options;
+    options.thread_count = ThreadPool::default_thread_count();
+    options.scratch_directory = std::filesystem::temp_directory_path().string();
     std::string file_path;
     std::string pattern;
+    std::string output;
+    unsigned memory_budget = 0;
+    std::string trace_path;
+    std::string batch_path;
+    std::string output_root = ".";
+    std::string summary_path;
+    unsigned jobs = 0;
+    std::string notes_cache_path;
+    unsigned notes_cache_size = 1024;
+    std::string live_path;
+    unsigned live_window = 5000;
+    unsigned latency_budget = 100;
+    std::string latency_report_path;
+    unsigned live_duration = 0;
 
     //read command line arguments
     shell::CommandLineParser parser;
 
-    parser.add_argument("-w", &frame_width);
-    parser.add_argument("-d", &horizontal_step);
-    parser.add_argument("-s", &horizontal_scale);
-    parser.add_argument("-h", &note_height);
+    parser.add_argument("-w", &options.frame_width);
+    parser.add_argument("-d", &options.horizontal_step);
+    parser.add_argument("-s", &options.horizontal_scale);
+    parser.add_argument("-h", &options.note_height);
+    parser.add_argument("-j", &options.thread_count);
+    parser.add_argument("--raster-threads", &options.pipeline_settings.raster_threads);
+    parser.add_argument("--encode-threads", &options.pipeline_settings.encode_threads);
+    parser.add_argument("--write-threads", &options.pipeline_settings.write_threads);
+    parser.add_argument("--queue-capacity", &options.pipeline_settings.queue_capacity);
+    parser.add_argument("--format", &options.format);
+    parser.add_argument("--theme", &options.theme);
+    parser.add_argument("--output", &output);
+    parser.add_argument("--pixel-format", &options.pixel_format);
+    parser.add_argument("--fps", &options.frames_per_second);
+    parser.add_argument("--band-threads", &options.band_threads);
+    parser.add_argument("--compression-level", &options.compression_level);
+    parser.add_argument("--bmp-encoding", &options.bmp_encoding);
+    parser.add_argument("--dedup-window", &options.deduplication_window);
+    parser.add_argument("--dedup-manifest", &options.deduplication_manifest);
+    parser.add_argument("--key-frame-interval", &options.key_frame_interval);
+    parser.add_argument("--quality", &options.quality);
+    parser.add_argument("--scratch-directory", &options.scratch_directory);
+    parser.add_argument("--memory-budget", &memory_budget);
+    parser.add_argument("--trace", &trace_path);
+    parser.add_argument("--batch", &batch_path);
+    parser.add_argument("--output-root", &output_root);
+    parser.add_argument("--summary", &summary_path);
+    parser.add_argument("--jobs", &jobs);
+    parser.add_argument("--notes-cache", &notes_cache_path);
+    parser.add_argument("--notes-cache-size", &notes_cache_size);
+    parser.add_argument("--live", &live_path);
+    parser.add_argument("--live-window", &live_window);
+    parser.add_argument("--latency-budget", &latency_budget);
+    parser.add_argument("--latency-report", &latency_report_path);
+    parser.add_argument("--live-duration", &live_duration);
     parser.process(argc, argv);
 
-    if(parser.positional_arguments().size() < 2)
+    options.memory_budget = uint64_t(memory_budget) << 20;
+    if(!rendering::is_known_format(options.format))
     {
-        std::cout << "\nPlease provide all needed arguments!";
+        std::cerr << "\nUnknown format " << options.format << "!";
+        exit(EXIT_FAILURE);
+    }
+    if(!rendering::is_known_theme(options.theme))
+    {
+        std::cerr << "\nUnknown theme " << options.theme << "!";
+        exit(EXIT_FAILURE);
+    }
+
+    //the trace file is opened up front, so a bad path does not cost a whole render
+    std::ofstream trace_file_stream;
+    if(!trace_path.empty())
+    {
+        trace_file_stream.open(trace_path);
+        CHECK(trace_file_stream.is_open()) << "Could not open " << trace_path;
+
+        tracing::enable();
+        tracing::name_thread("main");
+    }
+
+    //a performance arriving as raw midi bytes is drawn as it happens, the newest moment at the right edge
+    if(!live_path.empty())
+    {
+        CHECK(options.format == "raw" || options.format == "y4m") << "--live writes a stream, use --format raw or y4m";
+        CHECK(live_window != 0) << "--live-window has to be at least 1 millisecond";
+
+        rendering::LIVE_SETTINGS settings;
+        if(options.frame_width != 0) settings.frame_width = options.frame_width;
+        settings.note_height = options.note_height;
+        settings.frames_per_second = options.frames_per_second;
+        settings.window = uint64_t(live_window) * 1000;
+        settings.latency_budget = uint64_t(latency_budget) * 1000;
+        settings.duration = uint64_t(live_duration) * 1000000;
+        settings.theme = options.theme;
+        if(settings.latency_budget * settings.frames_per_second < 1000000)
+        {
+            std::cerr << "The latency budget is shorter than a frame at " << settings.frames_per_second << " fps, most events will exceed it" << std::endl;
+        }
+
+        std::ofstream latency_report_stream;
+        if(!latency_report_path.empty())
+        {
+            latency_report_stream.open(latency_report_path);
+            CHECK(latency_report_stream.is_open()) << "Could not open " << latency_report_path;
+        }
+
+        std::ofstream output_file_stream;
+        if(!output.empty() && output != "-")
+        {
+            output_file_stream.open(output, std::ios_base::binary);
+            CHECK(output_file_stream.is_open()) << "Could not open " << output;
+        }
+        auto& out = output_file_stream.is_open() ? static_cast<std::ostream&>(output_file_stream) : std::cout;
+
+        //a live frame has to be ready within its own interval, so it is converted with every thread
+        const auto frame_sink = rendering::make_stream_sink(options, out, options.band_threads != 0 ? options.band_threads : options.thread_count);
+        const auto report = rendering::run_live(rendering::open_live_input(live_path), *frame_sink, settings);
+        rendering::print_live_report(std::cerr, report, settings);
+        if(latency_report_stream.is_open()) rendering::write_live_report(latency_report_stream, report, settings);
+
+        if(trace_file_stream.is_open()) tracing::write_chrome_trace(trace_file_stream);
+        return EXIT_SUCCESS;
+    }
+
+    //parsed notes are kept by the hash of the midi file, so rendering the same file again skips parsing
+    std::unique_ptr<midi::NotesCache> notes_cache;
+    if(!notes_cache_path.empty()) notes_cache = std::make_unique<midi::NotesCache>(notes_cache_path, uint64_t(notes_cache_size) << 20);
+
+    //every midi file of a manifest or directory is rendered into the output root, by default one file per thread at a time
+    if(!batch_path.empty())
+    {
+        pattern = parser.positional_arguments().empty() ? "frame%d" : parser.positional_arguments()[0];
+        if(summary_path.empty()) summary_path = (std::filesystem::path(output_root) / "batch-summary.json").string();
+
+        std::filesystem::create_directories(output_root);
+        std::ofstream summary_file_stream(summary_path);
+        CHECK(summary_file_stream.is_open()) << "Could not open " << summary_path;
+
+        const auto inputs = rendering::collect_batch_inputs(batch_path);
+        const auto summary = rendering::render_batch(inputs, options, output_root, pattern, jobs == 0 ? options.thread_count : jobs, notes_cache.get());
+        rendering::write_batch_summary(summary_file_stream, summary);
+        rendering::print_batch_summary(std::cerr, summary);
+
+        if(trace_file_stream.is_open()) tracing::write_chrome_trace(trace_file_stream);
+
+        const bool all_rendered = std::all_of(summary.results.begin(), summary.results.end(), [](const rendering::BATCH_RESULT& result) { return result.ok(); });
+        return all_rendered ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    //streamed formats write to --output (stdout by default) and need no file name pattern, neither does an avi file
+    const bool single_file = rendering::is_single_file_format(options.format);
+    if(parser.positional_arguments().size() < (single_file ? 1 : 2))
+    {
+        std::cerr << "\nPlease provide all needed arguments!";
         exit(EXIT_FAILURE);
     }
 
     file_path = parser.positional_arguments()[0];
-    pattern = parser.positional_arguments()[1];
+    if(!single_file) pattern = parser.positional_arguments()[1];
 
     //open file
     std::ifstream input_file_stream(file_path, std::ios_base::binary);
 
+    //a type 2 file holds independent sequences, which are rendered side by side to outputs of their own
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(input_file_stream)), std::istreambuf_iterator<char>());
+    const bool has_sequences = midi::holds_sequences(data.data(), data.size());
+
     //read the notes
-    const auto notes = midi::read_notes(input_file_stream);
-
-    //calculate the width needed for the renderer
-    const auto ending_note = std::max_element(notes.begin(),notes.end(),
-            [](const midi::NOTE& note_l, const midi::NOTE& note_r)
-            {
-                return (value(note_l.start) + value(note_l.duration)) < (value(note_r.start) + value(note_r.duration));
-            });
-
-    //get the lowest and highest note
-    const auto [lowest_note,highest_note] = std::minmax_element(notes.begin(),notes.end(),
-            [](const midi::NOTE& note_l, const midi::NOTE& note_r)
-            {
-                return value(note_l.note_number) < value(note_r.note_number);
-            });
-
-    //init renderer
-    const auto note_rendering_data = rendering::NOTE_RENDERING_DATA(note_height,value(lowest_note->note_number), value(highest_note->note_number), value(ending_note->start + ending_note->duration));
-    auto renderer = rendering::Renderer(frame_width,horizontal_step,horizontal_scale, note_rendering_data);
-
-    for(auto& note: notes) {
-        renderer.draw_note(note);
+    std::vector<std::vector<midi::NOTE>> sequences(has_sequences ? 0 : 1);
+    const auto result = has_sequences ? midi::parse_sequences(data.data(), data.size(), &sequences)
+                      : notes_cache ? notes_cache->read_notes(data.data(), data.size(), &sequences[0])
+                      : midi::parse_notes(data.data(), data.size(), &sequences[0]);
+    CHECK(result.ok()) << "Invalid midi file at byte " << result.offset << ": " << midi::describe(result.status);
+
+    //frame files go to the current directory unless --output names another one
+    if(has_sequences)
+    {
+        const auto results = rendering::render_sequences(sequences, options, output, pattern, &std::cerr);
+        const auto failed = std::count_if(results.begin(), results.end(), [](const rendering::SEQUENCE_RESULT& r) { return !r.error.empty(); });
+        CHECK(failed == 0) << failed << " of the " << results.size() << " sequences could not be rendered";
+    }
+    else
+    {
+        const auto rendered = rendering::render_notes(sequences[0], options, output, pattern, &std::cerr);
+        CHECK(rendered.ok()) << "Cannot render: " << rendered.error;
     }
 
-    renderer.render_frames("/home/indy/Documents/midi-finished-build/frames/", pattern);
+    if(trace_file_stream.is_open()) tracing::write_chrome_trace(trace_file_stream);
 }
 
 #endif
\ No newline at end of file
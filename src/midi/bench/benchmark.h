@@ -0,0 +1,131 @@
+#ifndef MIDI_PROJECT_BENCHMARK_H
+#define MIDI_PROJECT_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    struct MEASUREMENT
+    {
+        std::string name;
+        std::string unit;               //what one item is, e.g. "events" or "MB"
+        double items;                   //items processed by one repetition
+        std::vector<double> seconds;    //one per repetition, sorted
+
+        //nearest rank percentile, so p95 of a handful of repetitions is simply the slowest one
+        double percentile(double p) const
+        {
+            if(seconds.empty()) return 0;
+
+            const auto rank = static_cast<size_t>(std::ceil(p / 100 * seconds.size()));
+            return seconds[std::min(std::max<size_t>(rank, 1), seconds.size()) - 1];
+        }
+
+        double median() const { return percentile(50); }
+        double p95() const { return percentile(95); }
+
+        //throughput at the median time
+        double rate() const { return median() == 0 ? 0 : items / median(); }
+    };
+
+    //keeps the compiler from optimizing away a result that is otherwise unused
+    template<typename T>
+    void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    //times a function a number of times after some untimed warmup runs, the warmup fills caches and lets allocators settle
+    class Harness
+    {
+        unsigned warmup;
+        unsigned repetitions;
+        std::vector<MEASUREMENT> measurements;
+
+    public:
+        Harness(unsigned warmup, unsigned repetitions) : warmup(warmup), repetitions(std::max(repetitions, 1U)) {};
+
+        const MEASUREMENT& measure(const std::string& name, const std::string& unit, double items, const std::function<void()>& function)
+        {
+            for(unsigned i = 0; i != warmup; ++i) function();
+
+            MEASUREMENT measurement{name, unit, items, {}};
+            for(unsigned i = 0; i != repetitions; ++i)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                function();
+                measurement.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::sort(measurement.seconds.begin(), measurement.seconds.end());
+
+            measurements.push_back(std::move(measurement));
+            return measurements.back();
+        }
+
+        void print_table(std::ostream& out) const
+        {
+            out << std::left << std::setw(18) << "benchmark" << std::right << std::setw(16) << "rate" << "  " << std::left << std::setw(12) << "unit"
+                << std::right << std::setw(12) << "median ms" << std::setw(12) << "p95 ms" << "\n";
+
+            for(const auto& measurement : measurements)
+            {
+                out << std::left << std::setw(18) << measurement.name << std::right << std::fixed << std::setprecision(1)
+                    << std::setw(16) << measurement.rate() << "  " << std::left << std::setw(12) << (measurement.unit + "/s") << std::right << std::setprecision(3)
+                    << std::setw(12) << measurement.median() * 1000 << std::setw(12) << measurement.p95() * 1000 << "\n";
+            }
+        }
+
+        //one object per run: the context (compiler, build, ...) and every measurement with its raw timings,
+        //so runs of different versions can be compared by name
+        void write_json(std::ostream& out, const std::map<std::string, std::string>& context) const
+        {
+            out << "{\n  \"context\": {";
+            for(auto it = context.begin(); it != context.end(); ++it)
+            {
+                out << (it == context.begin() ? "\n" : ",\n") << "    " << quoted(it->first) << ": " << quoted(it->second);
+            }
+            out << "\n  },\n  \"warmup\": " << warmup << ",\n  \"repetitions\": " << repetitions << ",\n  \"benchmarks\": [";
+
+            out << std::setprecision(9) << std::defaultfloat;
+            for(size_t i = 0; i != measurements.size(); ++i)
+            {
+                const auto& measurement = measurements[i];
+                out << (i == 0 ? "\n" : ",\n") << "    {\n"
+                    << "      \"name\": " << quoted(measurement.name) << ",\n"
+                    << "      \"unit\": " << quoted(measurement.unit) << ",\n"
+                    << "      \"items\": " << measurement.items << ",\n"
+                    << "      \"rate\": " << measurement.rate() << ",\n"
+                    << "      \"median_seconds\": " << measurement.median() << ",\n"
+                    << "      \"p95_seconds\": " << measurement.p95() << ",\n"
+                    << "      \"seconds\": [";
+                for(size_t j = 0; j != measurement.seconds.size(); ++j) out << (j == 0 ? "" : ", ") << measurement.seconds[j];
+                out << "]\n    }";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+    private:
+        static std::string quoted(const std::string& text)
+        {
+            std::string result = "\"";
+            for(auto c : text)
+            {
+                if(c == '"' || c == '\\') result += '\\';
+                if(static_cast<unsigned char>(c) < 0x20) result += ' ';
+                else result += c;
+            }
+
+            return result + "\"";
+        }
+    };
+}
+
+#endif //MIDI_PROJECT_BENCHMARK_H
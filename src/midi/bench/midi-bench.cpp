@@ -0,0 +1,322 @@
+#include "bench/benchmark.h"
+#include "imaging/bmp-format.h"
+#include "imaging/frame.h"
+#include "imaging/png-format.h"
+#include "io/vli.h"
+#include "midi/events.h"
+#include "midi/midi.h"
+#include "midi/notes-cache.h"
+#include "midi/parse.h"
+#include "midi/synthetic.h"
+#include "midi/timeline.h"
+#include "rendering/renderer.h"
+#include "shell/command-line-parser.h"
+#include "util/thread-pool.h"
+#include "logging.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+//measures the throughput of every step from reading a midi file to exporting frames
+//  midi-bench [--warmup n] [--repetitions n] [--notes n] [--label text] [--output results.json]
+//the input is a synthetic midi file with --notes notes, so results only depend on the build and the machine
+//a table is printed on stderr, the json results go to --output or stdout
+namespace
+{
+    //a single track with note_count notes on all 16 channels, with some program and control changes,
+    //using running status like most real files
+    std::string synthetic_midi(unsigned note_count)
+    {
+        midi::SYNTHETIC_SETTINGS settings;
+        settings.seed = 1234;
+        settings.format = 0;
+        settings.tracks = 1;
+        settings.division = 96;
+        settings.chord_size = 1;
+        settings.control_changes = 3;
+        settings.pitch_wheel_changes = 0;
+        settings.pressure_events = 0;
+        settings.program_changes = 2;
+
+        //every note is a note on and a note off, the control and program changes come on top
+        settings.events = uint64_t(note_count) * 2 * 100 / 95;
+
+        std::ostringstream out;
+        midi::write_synthetic_midi(out, settings);
+        return out.str();
+    }
+
+    struct CountingReceiver : midi::EventReceiver
+    {
+        uint64_t events = 0;
+
+        void note_on(midi::Duration, midi::Channel, midi::NoteNumber, uint8_t) override { ++events; }
+        void note_off(midi::Duration, midi::Channel, midi::NoteNumber, uint8_t) override { ++events; }
+        void polyphonic_key_pressure(midi::Duration, midi::Channel, midi::NoteNumber, uint8_t) override { ++events; }
+        void control_change(midi::Duration, midi::Channel, uint8_t, uint8_t) override { ++events; }
+        void program_change(midi::Duration, midi::Channel, midi::Instrument) override { ++events; }
+        void channel_pressure(midi::Duration, midi::Channel, uint8_t) override { ++events; }
+        void pitch_wheel_change(midi::Duration, midi::Channel, uint16_t) override { ++events; }
+        void meta(midi::Duration, uint8_t, std::unique_ptr<uint8_t[]>, uint64_t) override { ++events; }
+        void sysex(midi::Duration, std::unique_ptr<uint8_t[]>, uint64_t) override { ++events; }
+    };
+
+    //encodes every frame as a bmp like a real export, but keeps nothing
+    struct DiscardingSink : rendering::FrameSink
+    {
+        std::vector<uint8_t> encode(unsigned, const imaging::Frame& frame) override { return imaging::encode_bmp(frame); }
+        void write(unsigned, const std::vector<uint8_t>& data) override { bench::do_not_optimize(data.data()); }
+        bool ordered() const override { return false; }
+    };
+
+    double megabytes(size_t bytes)
+    {
+        return static_cast<double>(bytes) / (1000 * 1000);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned warmup = 1;
+    unsigned repetitions = 10;
+    unsigned note_count = 20000;
+    std::string label;
+    std::string output;
+
+    shell::CommandLineParser parser;
+    parser.add_argument("--warmup", &warmup);
+    parser.add_argument("--repetitions", &repetitions);
+    parser.add_argument("--notes", &note_count);
+    parser.add_argument("--label", &label);
+    parser.add_argument("--output", &output);
+    parser.process(argc, argv);
+
+    bench::Harness harness(warmup, repetitions);
+
+    //variable length integers of every length from 1 to 4 bytes, like delta times and lengths
+    {
+        std::mt19937 random(42);
+        std::string data;
+        const unsigned value_count = 1000000;
+        for(unsigned i = 0; i != value_count; ++i)
+        {
+            uint8_t buffer[io::MAX_VARIABLE_LENGTH_INTEGER_SIZE];
+            const auto size = io::encode_variable_length_integer(random() >> (4 + 7 * (random() % 4)), buffer);
+            data.append(reinterpret_cast<const char*>(buffer), size);
+        }
+
+        harness.measure("vli.decode", "values", value_count, [&]()
+        {
+            std::istringstream in(data);
+            uint64_t sum = 0;
+            for(unsigned i = 0; i != value_count; ++i) sum += io::read_variable_length_integer(in);
+            bench::do_not_optimize(sum);
+        });
+    }
+
+    const auto midi_file = synthetic_midi(note_count);
+
+    //the only track follows the 14 bytes of the MThd chunk
+    const auto mtrk = midi_file.substr(sizeof(midi::MTHD));
+
+    {
+        CountingReceiver counter;
+        std::istringstream in(mtrk);
+        midi::read_mtrk(in, counter);
+
+        harness.measure("mtrk.read", "events", static_cast<double>(counter.events), [&]()
+        {
+            CountingReceiver receiver;
+            std::istringstream track(mtrk);
+            midi::read_mtrk(track, receiver);
+            bench::do_not_optimize(receiver.events);
+        });
+
+        //the same without a stream or checks that stop the program, on the track in memory
+        harness.measure("mtrk.parse", "events", static_cast<double>(counter.events), [&]()
+        {
+            CountingReceiver receiver;
+            bench::do_not_optimize(midi::parse_mtrk(reinterpret_cast<const uint8_t*>(mtrk.data()), mtrk.size(), receiver).offset);
+            bench::do_not_optimize(receiver.events);
+        });
+    }
+
+    harness.measure("notes.read", "MB", megabytes(midi_file.size()), [&]()
+    {
+        std::istringstream in(midi_file);
+        bench::do_not_optimize(midi::read_notes(in).size());
+    });
+
+    harness.measure("notes.parse", "MB", megabytes(midi_file.size()), [&]()
+    {
+        std::vector<midi::NOTE> notes;
+        bench::do_not_optimize(midi::parse_notes(reinterpret_cast<const uint8_t*>(midi_file.data()), midi_file.size(), &notes).offset);
+        bench::do_not_optimize(notes.size());
+    });
+
+    //the same fed in pieces of the size of a pipe buffer, like an upload that is still arriving
+    harness.measure("notes.push", "MB", megabytes(midi_file.size()), [&]()
+    {
+        std::vector<midi::NOTE> notes;
+        midi::NoteCollector note_collector([&notes](const midi::NOTE& note) { notes.push_back(note); });
+        midi::PushParser parser(note_collector);
+        for(size_t i = 0; i < midi_file.size(); i += 4096)
+        {
+            parser.feed(reinterpret_cast<const uint8_t*>(midi_file.data()) + i, std::min<size_t>(4096, midi_file.size() - i));
+        }
+        bench::do_not_optimize(parser.finish().offset);
+        bench::do_not_optimize(notes.size());
+    });
+
+    {
+        //decoding once into event records, and the notes taken from records that were decoded already
+        midi::DECODED_EVENTS events;
+        midi::decode_events(reinterpret_cast<const uint8_t*>(midi_file.data()), midi_file.size(), &events);
+
+        harness.measure("events.decode", "MB", megabytes(midi_file.size()), [&]()
+        {
+            midi::DECODED_EVENTS decoded;
+            bench::do_not_optimize(midi::decode_events(reinterpret_cast<const uint8_t*>(midi_file.data()), midi_file.size(), &decoded).offset);
+            bench::do_not_optimize(decoded.tracks.size());
+        });
+
+        harness.measure("notes.from-events", "events", static_cast<double>(events.tracks[0].records.size()), [&]()
+        {
+            std::vector<midi::NOTE> notes;
+            midi::collect_notes(events, &notes);
+            bench::do_not_optimize(notes.size());
+        });
+    }
+
+    {
+        //the same number of events spread over 16 tracks, merged into one timeline
+        midi::SYNTHETIC_SETTINGS settings;
+        settings.seed = 1234;
+        settings.events = uint64_t(note_count) * 2;
+        settings.tempo_interval = 100;
+        std::ostringstream out;
+        midi::write_synthetic_midi(out, settings);
+        const auto multi_track_file = out.str();
+
+        midi::DECODED_EVENTS events;
+        midi::decode_events(reinterpret_cast<const uint8_t*>(multi_track_file.data()), multi_track_file.size(), &events);
+        uint64_t records = 0;
+        for(const auto& track : events.tracks) records += track.records.size();
+
+        harness.measure("events.merge", "events", static_cast<double>(records), [&]()
+        {
+            midi::MergedTimeline timeline(events);
+            midi::TIMELINE_EVENT event{};
+            uint64_t time = 0;
+            while(timeline.next(&event)) time += event.record->time;
+            bench::do_not_optimize(time);
+        });
+    }
+
+    {
+        //the notes of the same file from a warm notes cache: hashing the file and loading the columns instead of parsing
+        const auto cache_directory = std::filesystem::temp_directory_path() / ("midi-bench-notes-" + std::to_string(getpid()));
+        midi::NotesCache cache(cache_directory.string(), uint64_t(1) << 30);
+        std::vector<midi::NOTE> warm;
+        cache.read_notes(reinterpret_cast<const uint8_t*>(midi_file.data()), midi_file.size(), &warm);
+
+        harness.measure("notes.cached", "MB", megabytes(midi_file.size()), [&]()
+        {
+            std::vector<midi::NOTE> notes;
+            bench::do_not_optimize(cache.read_notes(reinterpret_cast<const uint8_t*>(midi_file.data()), midi_file.size(), &notes).offset);
+            bench::do_not_optimize(notes.size());
+        });
+        std::filesystem::remove_all(cache_directory);
+    }
+
+    std::istringstream midi_stream(midi_file);
+    const auto notes = midi::read_notes(midi_stream);
+    const auto ending_note = std::max_element(notes.begin(), notes.end(), [](const midi::NOTE& l, const midi::NOTE& r) { return value(l.start) + value(l.duration) < value(r.start) + value(r.duration); });
+    const auto [lowest_note, highest_note] = std::minmax_element(notes.begin(), notes.end(), [](const midi::NOTE& l, const midi::NOTE& r) { return value(l.note_number) < value(r.note_number); });
+    const auto note_rendering_data = rendering::NOTE_RENDERING_DATA(16, value(lowest_note->note_number), value(highest_note->note_number), value(ending_note->start + ending_note->duration));
+
+    //frames as the renderer produces them: a 1000 pixel wide window on a canvas with every note drawn on it
+    const unsigned frame_width = 1000;
+    const unsigned frame_height = note_rendering_data.note_height * (note_rendering_data.highest_note_number_value - note_rendering_data.lowest_note_number_value + 1);
+    imaging::Bitmap canvas(frame_width * 4, frame_height);
+    for(const auto& note : notes)
+    {
+        const auto x = value(note.start) / 20;
+        if(x >= canvas.width()) break;
+
+        const auto y = (note_rendering_data.highest_note_number_value - value(note.note_number)) * note_rendering_data.note_height;
+        const auto width = std::min(value(note.duration) / 20, canvas.width() - x);
+        for(unsigned i = 0; i != note_rendering_data.note_height; ++i)
+        {
+            for(unsigned j = 0; j != width; ++j) canvas[Position(x + j, y + i)] = imaging::Color(0.2 + value(note.instrument) / 160.0, note.velocity / 127.0, 0.5);
+        }
+    }
+
+    const auto slice = canvas.slice(frame_width, 0, frame_width, frame_height);
+    harness.measure("frame.rasterize", "pixels", double(frame_width) * frame_height, [&]()
+    {
+        bench::do_not_optimize(imaging::rasterize(*slice).pixels.data());
+    });
+
+    //the renderer's canvas holds packed pixels, a frame is copied out of it without converting colours
+    const ConcreteGrid<uint32_t> packed_canvas(canvas.width(), canvas.height(), [&](const Position& p) { return imaging::to_argb(canvas[p]); });
+    harness.measure("frame.copy", "pixels", double(frame_width) * frame_height, [&]()
+    {
+        bench::do_not_optimize(imaging::copy_frame(packed_canvas, Position(frame_width, 0), frame_width, frame_height).pixels.data());
+    });
+
+    const auto frame = imaging::rasterize(*slice);
+    const auto frame_bytes = frame.pixels.size() * sizeof(uint32_t);
+    harness.measure("bmp.encode", "MB", megabytes(frame_bytes), [&]() { bench::do_not_optimize(imaging::encode_bmp(frame).data()); });
+    harness.measure("png.encode", "MB", megabytes(frame_bytes), [&]() { bench::do_not_optimize(imaging::encode_png(frame).data()); });
+
+    //everything after parsing: drawing the notes, slicing, rasterizing and encoding with the default pipeline
+    {
+        //a step that spreads 50 frames over the whole piece, so the time per run does not grow with --notes
+        const auto canvas_width = note_rendering_data.ending_note_time_value / 20;
+        const unsigned horizontal_step = canvas_width < frame_width ? 1 : std::max((canvas_width - frame_width) / 49, 1U);
+        const unsigned frame_count = canvas_width < frame_width ? 0 : (canvas_width - frame_width) / horizontal_step + 1;
+        auto renderer = rendering::Renderer(frame_width, horizontal_step, 1, note_rendering_data, std::filesystem::temp_directory_path().string(), 0);
+        for(const auto& note : notes) renderer.draw_note(note);
+
+        const auto settings = rendering::PIPELINE_SETTINGS::for_threads(ThreadPool::default_thread_count());
+
+        //the renderer reports on stderr, which would drown the table
+        std::ostringstream discarded;
+        harness.measure("render.frames", "frames", frame_count, [&]()
+        {
+            DiscardingSink sink;
+            auto previous = std::cerr.rdbuf(discarded.rdbuf());
+            renderer.render_frames(sink, settings);
+            std::cerr.rdbuf(previous);
+            discarded.str("");
+        });
+    }
+
+    harness.print_table(std::cerr);
+
+    std::map<std::string, std::string> context {
+        {"label", label},
+        {"compiler", __VERSION__},
+#ifdef __OPTIMIZE__
+        {"optimized", "true"},
+#else
+        {"optimized", "false"},
+#endif
+        {"hardware_threads", std::to_string(std::thread::hardware_concurrency())},
+        {"notes", std::to_string(note_count)}
+    };
+
+    std::ofstream output_file_stream;
+    if(!output.empty() && output != "-")
+    {
+        output_file_stream.open(output);
+        CHECK(output_file_stream.is_open()) << "Could not open " << output;
+    }
+    harness.write_json(output_file_stream.is_open() ? output_file_stream : std::cout, context);
+}
@@ -0,0 +1,183 @@
+#include "imaging/avi-format.h"
+#include <algorithm>
+
+
+using namespace imaging;
+
+namespace
+{
+    // Offsets within the headers written by the constructor
+    const uint64_t RIFF_SIZE_OFFSET = 4;
+    const uint64_t MAX_BYTES_PER_SECOND_OFFSET = 36;
+    const uint64_t TOTAL_FRAMES_OFFSET = 48;
+    const uint64_t AVIH_BUFFER_SIZE_OFFSET = 60;
+    const uint64_t STREAM_LENGTH_OFFSET = 140;
+    const uint64_t STRH_BUFFER_SIZE_OFFSET = 144;
+    const uint64_t MOVI_SIZE_OFFSET = 216;
+    const uint64_t MOVI_START = 220;
+
+    const uint32_t AVIF_HASINDEX = 0x10;
+    const uint32_t AVIIF_KEYFRAME = 0x10;
+
+    class ChunkWriter
+    {
+    private:
+        std::vector<uint8_t>& out;
+
+    public:
+        explicit ChunkWriter(std::vector<uint8_t>& out) : out(out) { }
+
+        void fourcc(const char* code)
+        {
+            out.insert(out.end(), code, code + 4);
+        }
+
+        void u16(uint16_t value)
+        {
+            out.push_back(uint8_t(value));
+            out.push_back(uint8_t(value >> 8));
+        }
+
+        void u32(uint32_t value)
+        {
+            u16(uint16_t(value));
+            u16(uint16_t(value >> 16));
+        }
+    };
+}
+
+AviWriter::AviWriter(std::ostream& out, unsigned width, unsigned height, unsigned frames_per_second, const char (&codec)[5])
+    : out(out), frames_per_second(std::max(frames_per_second, 1U)), start(out.tellp()), size(0), largest_frame(0), index()
+{
+    std::vector<uint8_t> header;
+    ChunkWriter writer(header);
+
+    writer.fourcc("RIFF");
+    writer.u32(0);                              // patched by finish
+    writer.fourcc("AVI ");
+
+    writer.fourcc("LIST");
+    writer.u32(192);
+    writer.fourcc("hdrl");
+
+    writer.fourcc("avih");
+    writer.u32(56);
+    writer.u32(1000000 / this->frames_per_second);
+    writer.u32(0);                              // max bytes per second, patched by finish
+    writer.u32(0);
+    writer.u32(AVIF_HASINDEX);
+    writer.u32(0);                              // total frames, patched by finish
+    writer.u32(0);
+    writer.u32(1);
+    writer.u32(0);                              // suggested buffer size, patched by finish
+    writer.u32(width);
+    writer.u32(height);
+    for (unsigned i = 0; i != 4; ++i) writer.u32(0);
+
+    writer.fourcc("LIST");
+    writer.u32(116);
+    writer.fourcc("strl");
+
+    writer.fourcc("strh");
+    writer.u32(56);
+    writer.fourcc("vids");
+    writer.fourcc(codec);
+    writer.u32(0);
+    writer.u16(0);
+    writer.u16(0);
+    writer.u32(0);
+    writer.u32(1);                              // scale
+    writer.u32(this->frames_per_second);        // rate, frames per second is rate / scale
+    writer.u32(0);
+    writer.u32(0);                              // length, patched by finish
+    writer.u32(0);                              // suggested buffer size, patched by finish
+    writer.u32(UINT32_MAX);
+    writer.u32(0);
+    writer.u16(0);
+    writer.u16(0);
+    writer.u16(uint16_t(width));
+    writer.u16(uint16_t(height));
+
+    writer.fourcc("strf");
+    writer.u32(40);
+    writer.u32(40);
+    writer.u32(width);
+    writer.u32(height);
+    writer.u16(1);
+    writer.u16(24);
+    writer.fourcc(codec);
+    writer.u32(width * height * 3);
+    for (unsigned i = 0; i != 4; ++i) writer.u32(0);
+
+    writer.fourcc("LIST");
+    writer.u32(0);                              // patched by finish
+    writer.fourcc("movi");
+
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    size = header.size();
+}
+
+void AviWriter::add_frame(const uint8_t* data, size_t frame_size)
+{
+    std::vector<uint8_t> chunk_header;
+    ChunkWriter writer(chunk_header);
+    writer.fourcc("00dc");
+    writer.u32(uint32_t(frame_size));
+
+    // idx1 offsets are relative to the "movi" four character code
+    index.push_back(INDEX_ENTRY{ uint32_t(size - MOVI_START), uint32_t(frame_size) });
+    largest_frame = std::max(largest_frame, uint32_t(frame_size));
+
+    out.write(reinterpret_cast<const char*>(chunk_header.data()), chunk_header.size());
+    out.write(reinterpret_cast<const char*>(data), frame_size);
+    size += chunk_header.size() + frame_size;
+
+    // Chunks are aligned to 2 bytes
+    if (frame_size % 2 == 1)
+    {
+        out.put(0);
+        ++size;
+    }
+}
+
+void AviWriter::finish()
+{
+    const auto movi_size = size - MOVI_START;
+
+    std::vector<uint8_t> trailer;
+    ChunkWriter writer(trailer);
+    writer.fourcc("idx1");
+    writer.u32(uint32_t(16 * index.size()));
+    for (const auto& entry : index)
+    {
+        writer.fourcc("00dc");
+        writer.u32(AVIIF_KEYFRAME);
+        writer.u32(entry.offset);
+        writer.u32(entry.size);
+    }
+
+    out.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    size += trailer.size();
+
+    const auto frame_count = uint32_t(index.size());
+    const auto bytes_per_second = frame_count == 0 ? 0 : uint32_t(movi_size * frames_per_second / frame_count);
+
+    patch(RIFF_SIZE_OFFSET, uint32_t(size - 8));
+    patch(MAX_BYTES_PER_SECOND_OFFSET, bytes_per_second);
+    patch(TOTAL_FRAMES_OFFSET, frame_count);
+    patch(AVIH_BUFFER_SIZE_OFFSET, largest_frame + 8);
+    patch(STREAM_LENGTH_OFFSET, frame_count);
+    patch(STRH_BUFFER_SIZE_OFFSET, largest_frame + 8);
+    patch(MOVI_SIZE_OFFSET, uint32_t(movi_size));
+
+    out.seekp(start + std::streamoff(size));
+    out.flush();
+}
+
+void AviWriter::patch(uint64_t position, uint32_t value)
+{
+    const uint8_t bytes[] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16), uint8_t(value >> 24) };
+
+    out.seekp(start + std::streamoff(position));
+    out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
@@ -0,0 +1,47 @@
+#ifndef AVI_FORMAT_H
+#define AVI_FORMAT_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Writes a single video stream to an AVI (RIFF) file, e.g. Motion JPEG frames.
+    /// The headers are written up front with placeholder sizes which <see cref="finish" /> fills in
+    /// together with the idx1 index, so the output stream has to be seekable.
+    /// Plain AVI 1.0 is limited to files of 1 GB, which is plenty for previews.
+    /// </summary>
+    class AviWriter final
+    {
+    public:
+        /// <summary>
+        /// <paramref name="codec" /> is the four character code of the frames, e.g. "MJPG".
+        /// </summary>
+        AviWriter(std::ostream& out, unsigned width, unsigned height, unsigned frames_per_second, const char (&codec)[5]);
+
+        void add_frame(const uint8_t* data, size_t size);
+
+        void finish();
+
+    private:
+        struct INDEX_ENTRY
+        {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        void patch(uint64_t position, uint32_t value);
+
+        std::ostream& out;
+        unsigned frames_per_second;
+        std::streampos start;
+        uint64_t size;
+        uint32_t largest_frame;
+        std::vector<INDEX_ENTRY> index;
+    };
+}
+
+#endif
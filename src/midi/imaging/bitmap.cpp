@@ -56,7 +56,7 @@ const Color& Bitmap::operator[](const Position& p) const
 {
     assert(is_inside(p));
 
-    return (*m_pixels)[p];
+    return static_cast<const Grid<Color>&>(*m_pixels)[p];
 }
 
 void Bitmap::clear(const Color& Color)
@@ -64,82 +64,246 @@ namespace
         BITMAP_HEADER_V5 bitmap_header;
     };
 
-    struct ARGB
+#   pragma pack(pop, r1)
+
+    const uint32_t BI_RGB = 0;
+    const uint32_t BI_RLE8 = 1;
+    const unsigned MAX_PALETTE_SIZE = 256;
+
+    BITMAP_FILE_V5 create_header(const Frame& frame, uint16_t bits_per_pixel, uint32_t compression, uint32_t colors_used, uint32_t image_size)
     {
-        uint8_t b;
-        uint8_t g;
-        uint8_t r;
-        uint8_t a;
-    };
+        BITMAP_FILE_V5 header;
+        memset(&header, 0, sizeof(header));
+
+        const uint32_t palette_size = sizeof(uint32_t) * colors_used;
+
+        header.file_header.FileType = 0x4D42;
+        header.file_header.FileSize = sizeof(BITMAP_FILE_V5) + palette_size + image_size;
+        header.file_header.Reserved1 = 0;
+        header.file_header.Reserved2 = 0;
+        header.file_header.BitmapOffset = sizeof(BITMAP_FILE_V5) + palette_size;
+
+        header.bitmap_header.Size = sizeof(BITMAP_HEADER_V5);
+        header.bitmap_header.Width = frame.width;
+        header.bitmap_header.Height = frame.height;
+        header.bitmap_header.Planes = 1;
+        header.bitmap_header.BitsPerPixel = bits_per_pixel;
+        header.bitmap_header.Compression = compression;
+        header.bitmap_header.SizeOfBitmap = compression == BI_RGB ? 0 : image_size;
+        header.bitmap_header.HorzResolution = 3779;
+        header.bitmap_header.VertResolution = 3779;
+        header.bitmap_header.ColorsUsed = colors_used;
+        header.bitmap_header.ColorsImportant = 0;
+        if (compression == BI_RGB)
+        {
+            header.bitmap_header.RedMask = 0x00FF0000;
+            header.bitmap_header.GreenMask = 0x0000FF00;
+            header.bitmap_header.BlueMask = 0x000000FF;
+            header.bitmap_header.AlphaMask = 0xFF000000;
+        }
+        header.bitmap_header.CSType = 0x73524742;
+        header.bitmap_header.Intent = 4;
+
+        return header;
+    }
 
-    struct RGB
+    std::vector<uint8_t> encode_rgb32(const Frame& frame)
     {
-        uint8_t b;
-        uint8_t g;
-        uint8_t r;
+        const size_t scanline_size = sizeof(uint32_t) * frame.width;
+        const auto header = create_header(frame, 32, BI_RGB, 0, uint32_t(scanline_size * frame.height));
+
+        std::vector<uint8_t> data(sizeof(header) + scanline_size * frame.height);
+        memcpy(data.data(), &header, sizeof(header));
+
+        // Frame pixels are already laid out as BGRA scanlines, BMP only wants them bottom-up
+        auto target = data.data() + sizeof(header);
+        for (int y = frame.height - 1; y >= 0; --y)
+        {
+            memcpy(target, frame.row(y), scanline_size);
+            target += scanline_size;
+        }
+
+        return data;
+    }
+
+    /// <summary>
+    /// Maps the colors of a frame to palette indices, in order of first appearance.
+    /// Uses a small open addressing table, frames rarely have more than a few dozen colors.
+    /// </summary>
+    class PaletteBuilder
+    {
+    private:
+        static const unsigned TABLE_SIZE = 1024;
+
+        uint32_t colors[TABLE_SIZE];
+        int16_t indices[TABLE_SIZE];
+
+    public:
+        std::vector<uint32_t> palette;
+
+        PaletteBuilder()
+        {
+            std::fill(std::begin(indices), std::end(indices), int16_t(-1));
+            palette.reserve(MAX_PALETTE_SIZE);
+        }
+
+        /// <summary>
+        /// Returns the palette index of <paramref name="color" />, or -1 when the palette is full.
+        /// </summary>
+        int index_of(uint32_t color)
+        {
+            // Alpha is not stored in the palette
+            color &= 0x00FFFFFF;
+
+            unsigned slot = (color * 2654435761U) >> 22;
+            while (indices[slot] != -1)
+            {
+                if (colors[slot] == color) return indices[slot];
+                slot = (slot + 1) % TABLE_SIZE;
+            }
+
+            if (palette.size() == MAX_PALETTE_SIZE) return -1;
+
+            colors[slot] = color;
+            indices[slot] = int16_t(palette.size());
+            palette.push_back(color);
+
+            return indices[slot];
+        }
     };
-#   pragma pack(pop, r1)
 
+    /// <summary>
+    /// Appends the RLE8 encoding of one row of palette indices, including the end of line marker.
+    /// Runs of 3 or more equal indices become encoded runs, whatever lies between them
+    /// becomes an absolute run (or single pixel runs when it is shorter than 3 pixels).
+    /// </summary>
+    void encode_rle8_row(const uint8_t* row, unsigned width, std::vector<uint8_t>& out)
+    {
+        auto run_length = [&](unsigned x)
+        {
+            unsigned length = 1;
+            while (x + length < width && length < 255 && row[x + length] == row[x]) ++length;
+            return length;
+        };
+
+        auto emit_literals = [&](unsigned first, unsigned count)
+        {
+            while (count != 0)
+            {
+                const unsigned chunk = std::min(count, 255U);
+                if (chunk < 3)
+                {
+                    // Absolute mode needs at least 3 pixels
+                    for (unsigned i = 0; i != chunk; ++i)
+                    {
+                        out.push_back(1);
+                        out.push_back(row[first + i]);
+                    }
+                }
+                else
+                {
+                    out.push_back(0);
+                    out.push_back(uint8_t(chunk));
+                    out.insert(out.end(), row + first, row + first + chunk);
+                    if (chunk % 2 == 1) out.push_back(0);
+                }
+
+                first += chunk;
+                count -= chunk;
+            }
+        };
 
-    ARGB to_argb(const Color& c)
+        unsigned x = 0;
+        unsigned literal_start = 0;
+        while (x < width)
+        {
+            const unsigned length = run_length(x);
+            if (length >= 3 || (length == 2 && x + length == width))
+            {
+                emit_literals(literal_start, x - literal_start);
+                out.push_back(uint8_t(length));
+                out.push_back(row[x]);
+                x += length;
+                literal_start = x;
+            }
+            else
+            {
+                x += length;
+            }
+        }
+        emit_literals(literal_start, x - literal_start);
+
+        out.push_back(0);
+        out.push_back(0);
+    }
+
+    /// <summary>
+    /// Returns an empty vector when the frame has too many colors for a palette.
+    /// </summary>
+    std::vector<uint8_t> encode_rle8(const Frame& frame)
     {
-        uint8_t a = 255;
-        uint8_t r = uint8_t(c.r * 255);
-        uint8_t g = uint8_t(c.g * 255);
-        uint8_t b = uint8_t(c.b * 255);
+        PaletteBuilder palette_builder;
+        std::vector<uint8_t> indices(size_t(frame.width) * frame.height);
+
+        uint32_t previous_color = 0;
+        int previous_index = -1;
+        for (size_t i = 0; i != frame.pixels.size(); ++i)
+        {
+            // Frames are mostly long runs of the same color, skip the lookup for those
+            const auto color = frame.pixels[i];
+            if (previous_index == -1 || color != previous_color)
+            {
+                previous_index = palette_builder.index_of(color);
+                previous_color = color;
+                if (previous_index == -1) return {};
+            }
+            indices[i] = uint8_t(previous_index);
+        }
+
+        const auto& palette = palette_builder.palette;
+        const size_t palette_size = sizeof(uint32_t) * palette.size();
 
-        return ARGB{ b, g, r, a };
+        std::vector<uint8_t> data(sizeof(BITMAP_FILE_V5) + palette_size);
+        data.reserve(data.size() + 2 * size_t(frame.width) * frame.height / 16);
+        for (size_t i = 0; i != palette.size(); ++i)
+        {
+            // Palette entries are B, G, R, 0, which is exactly how the colors are stored in memory
+            memcpy(data.data() + sizeof(BITMAP_FILE_V5) + sizeof(uint32_t) * i, &palette[i], sizeof(uint32_t));
+        }
+
+        for (int y = frame.height - 1; y >= 0; --y)
+        {
+            encode_rle8_row(indices.data() + size_t(y) * frame.width, frame.width, data);
+        }
+        data.back() = 1; // the last end of line marker becomes the end of bitmap marker
+
+        const auto image_size = uint32_t(data.size() - sizeof(BITMAP_FILE_V5) - palette_size);
+        const auto header = create_header(frame, 8, BI_RLE8, uint32_t(palette.size()), image_size);
+        memcpy(data.data(), &header, sizeof(header));
+
+        return data;
     }
 }
 
-void imaging::save_as_bmp(const std::string& path, const Bitmap& bitmap)
+void imaging::save_as_bmp(const std::string& path, const Bitmap& bitmap, BmpEncoding encoding)
 {
     std::ofstream out(path, std::ios::binary);
-    save_as_bmp(out, bitmap);
+    save_as_bmp(out, bitmap, encoding);
 }
 
-void imaging::save_as_bmp(std::ostream& out, const Bitmap& bitmap)
+void imaging::save_as_bmp(std::ostream& out, const Bitmap& bitmap, BmpEncoding encoding)
 {
-    BITMAP_FILE_V5 header;
-    memset(&header, 0, sizeof(header));
-
-    header.file_header.FileType = 0x4D42;
-    header.file_header.FileSize = sizeof(BITMAP_FILE_V5) + 4 * bitmap.width() * bitmap.height();
-    header.file_header.Reserved1 = 0;
-    header.file_header.Reserved2 = 0;
-    header.file_header.BitmapOffset = sizeof(BITMAP_FILE_V5);
-
-    header.bitmap_header.Size = sizeof(BITMAP_HEADER_V5);
-    header.bitmap_header.Width = bitmap.width();
-    header.bitmap_header.Height = bitmap.height();
-    header.bitmap_header.Planes = 1;
-    header.bitmap_header.BitsPerPixel = 32;
-    header.bitmap_header.Compression = 0;
-    header.bitmap_header.SizeOfBitmap = 0;
-    header.bitmap_header.HorzResolution = 3779;
-    header.bitmap_header.VertResolution = 3779;
-    header.bitmap_header.ColorsUsed = 0;
-    header.bitmap_header.ColorsImportant = 0;
-    header.bitmap_header.RedMask = 0x00FF0000;
-    header.bitmap_header.GreenMask = 0x0000FF00;
-    header.bitmap_header.BlueMask = 0x000000FF;
-    header.bitmap_header.AlphaMask = 0xFF000000;
-    header.bitmap_header.CSType = 0x73524742;
-    header.bitmap_header.Intent = 4;
-    
-    out.write(reinterpret_cast<char*>(&header), sizeof(header));
-
-    std::unique_ptr<ARGB[]> scanline = std::make_unique<ARGB[]>(bitmap.width());
-
-    for (int y = bitmap.height() - 1; y >= 0; --y)
-    {
-        for (unsigned x = 0; x < bitmap.width(); ++x)
-        {
-            Position pos(x, y);
-
-            scanline[x] = to_argb(bitmap[pos]);
-        }
+    auto data = encode_bmp(rasterize(bitmap), encoding);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
 
-        out.write(reinterpret_cast<char*>(scanline.get()), sizeof(ARGB) * bitmap.width());
+std::vector<uint8_t> imaging::encode_bmp(const Frame& frame, BmpEncoding encoding)
+{
+    if (encoding == BmpEncoding::RLE8)
+    {
+        auto data = encode_rle8(frame);
+        if (!data.empty()) return data;
     }
+
+    return encode_rgb32(frame);
 }
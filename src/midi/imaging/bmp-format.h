@@ -2,12 +2,27 @@
 #define BMP_FORMAT_H
 
 #include "imaging/bitmap.h"
+#include "imaging/frame.h"
+#include <cstdint>
+#include <vector>
 
 
 namespace imaging
 {
-    void save_as_bmp(const std::string& path, const Bitmap& bitmap);
-    void save_as_bmp(std::ostream& out, const Bitmap& bitmap);
+    /// <summary>
+    /// RGB32 writes every pixel as 4 bytes (BI_RGB).
+    /// RLE8 builds a palette of the colors in the frame and run-length encodes the palette indices (BI_RLE8);
+    /// frames with more than 256 colors are written as RGB32 instead.
+    /// </summary>
+    enum class BmpEncoding { RGB32, RLE8 };
+
+    void save_as_bmp(const std::string& path, const Bitmap& bitmap, BmpEncoding encoding = BmpEncoding::RGB32);
+    void save_as_bmp(std::ostream& out, const Bitmap& bitmap, BmpEncoding encoding = BmpEncoding::RGB32);
+
+    /// <summary>
+    /// Encodes <paramref name="frame" /> as a complete BMP file.
+    /// </summary>
+    std::vector<uint8_t> encode_bmp(const Frame& frame, BmpEncoding encoding = BmpEncoding::RGB32);
 }
 
 #endif
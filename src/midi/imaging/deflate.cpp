@@ -0,0 +1,674 @@
+#include "imaging/deflate.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+
+using namespace imaging;
+
+namespace
+{
+    const unsigned WINDOW_SIZE = 32768;
+    const unsigned HASH_BITS = 15;
+    const unsigned MIN_MATCH = 3;
+    const unsigned MAX_MATCH = 258;
+    const size_t SYMBOLS_PER_BLOCK = 1 << 16;
+
+    const unsigned LITLEN_CODES = 286;
+    const unsigned DISTANCE_CODES = 30;
+    const unsigned CODE_LENGTH_CODES = 19;
+    const unsigned END_OF_BLOCK = 256;
+
+    const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t CODE_LENGTH_ORDER[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    struct LEVEL_SETTINGS
+    {
+        unsigned max_chain;     // candidates examined per position
+        unsigned nice_length;   // stop searching once a match is this long
+        bool lazy;              // check whether the next position has a longer match before emitting one
+    };
+
+    const LEVEL_SETTINGS LEVELS[] = {
+        { 0, 0, false },
+        { 4, 16, false },
+        { 8, 32, false },
+        { 16, 64, false },
+        { 16, 64, true },
+        { 32, 128, true },
+        { 64, 128, true },
+        { 128, 258, true },
+        { 512, 258, true },
+        { 4096, 258, true },
+    };
+
+    // Literal when distance is 0, otherwise a (length, distance) back reference.
+    struct SYMBOL
+    {
+        uint16_t literal_or_length;
+        uint16_t distance;
+    };
+
+    unsigned length_code(unsigned length)
+    {
+        return unsigned(std::upper_bound(std::begin(LENGTH_BASE), std::end(LENGTH_BASE), length) - std::begin(LENGTH_BASE)) - 1;
+    }
+
+    unsigned distance_code(unsigned distance)
+    {
+        return unsigned(std::upper_bound(std::begin(DISTANCE_BASE), std::end(DISTANCE_BASE), distance) - std::begin(DISTANCE_BASE)) - 1;
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out), buffer(0), count(0) { }
+
+        // Deflate packs bits starting at the least significant bit of each byte.
+        void write(uint32_t bits, unsigned length)
+        {
+            buffer |= uint64_t(bits) << count;
+            count += length;
+
+            while (count >= 8)
+            {
+                out.push_back(uint8_t(buffer));
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+
+        void align_to_byte()
+        {
+            if (count > 0) write(0, 8 - count);
+        }
+
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t buffer;
+        unsigned count;
+    };
+
+    struct HuffmanCode
+    {
+        std::vector<uint8_t> lengths;
+        std::vector<uint16_t> codes;    // bit reversed, ready to be written LSB first
+    };
+
+    uint16_t reverse_bits(uint16_t code, unsigned length)
+    {
+        uint16_t result = 0;
+        for (unsigned i = 0; i != length; ++i)
+        {
+            result = uint16_t((result << 1) | (code & 1));
+            code >>= 1;
+        }
+
+        return result;
+    }
+
+    // Canonical code assignment (RFC 1951, 3.2.2).
+    void assign_codes(HuffmanCode& huffman)
+    {
+        std::array<uint16_t, 16> length_count{};
+        for (auto length : huffman.lengths) ++length_count[length];
+        length_count[0] = 0;
+
+        std::array<uint16_t, 16> next_code{};
+        uint16_t code = 0;
+        for (unsigned bits = 1; bits != 16; ++bits)
+        {
+            code = uint16_t((code + length_count[bits - 1]) << 1);
+            next_code[bits] = code;
+        }
+
+        huffman.codes.assign(huffman.lengths.size(), 0);
+        for (size_t symbol = 0; symbol != huffman.lengths.size(); ++symbol)
+        {
+            const auto length = huffman.lengths[symbol];
+            if (length != 0) huffman.codes[symbol] = reverse_bits(next_code[length]++, length);
+        }
+    }
+
+    // Builds code lengths no longer than max_length from symbol frequencies.
+    // Unlimited Huffman lengths come from repeatedly merging the two lightest nodes,
+    // overlong codes are then redistributed by the usual Kraft sum adjustment.
+    HuffmanCode build_code(std::vector<uint32_t> frequencies, unsigned max_length)
+    {
+        // Decoders only accept an incomplete code when it has a single symbol of length 1,
+        // make sure there are at least two symbols so the code is always complete.
+        auto used = std::count_if(frequencies.begin(), frequencies.end(), [](uint32_t f) { return f != 0; });
+        for (size_t symbol = 0; symbol != frequencies.size() && used < 2; ++symbol)
+        {
+            if (frequencies[symbol] == 0)
+            {
+                frequencies[symbol] = 1;
+                ++used;
+            }
+        }
+
+        std::vector<unsigned> symbols;
+        for (unsigned symbol = 0; symbol != frequencies.size(); ++symbol)
+        {
+            if (frequencies[symbol] != 0) symbols.push_back(symbol);
+        }
+        std::sort(symbols.begin(), symbols.end(), [&frequencies](unsigned a, unsigned b)
+        {
+            return frequencies[a] != frequencies[b] ? frequencies[a] < frequencies[b] : a < b;
+        });
+
+        // Two queue Huffman construction: leaves are sorted, merged nodes are created in increasing weight order.
+        const size_t n = symbols.size();
+        std::vector<uint64_t> weight(2 * n);
+        std::vector<size_t> parent(2 * n, 0);
+        for (size_t i = 0; i != n; ++i) weight[i] = frequencies[symbols[i]];
+
+        size_t next_leaf = 0, next_node = n, node_count = n;
+        auto take_lightest = [&]()
+        {
+            if (next_leaf < n && (next_node >= node_count || weight[next_leaf] <= weight[next_node])) return next_leaf++;
+            return next_node++;
+        };
+        while (node_count < 2 * n - 1)
+        {
+            const auto a = take_lightest();
+            const auto b = take_lightest();
+            weight[node_count] = weight[a] + weight[b];
+            parent[a] = parent[b] = node_count;
+            ++node_count;
+        }
+
+        std::vector<unsigned> depth(2 * n, 0);
+        for (size_t node = 2 * n - 2; node-- > 0;)
+        {
+            depth[node] = depth[parent[node]] + 1;
+        }
+
+        std::array<uint32_t, 64> length_count{};
+        for (size_t i = 0; i != n; ++i) ++length_count[std::min(depth[i], 63U)];
+
+        for (unsigned length = max_length + 1; length != length_count.size(); ++length)
+        {
+            length_count[max_length] += length_count[length];
+            length_count[length] = 0;
+        }
+
+        uint64_t kraft = 0;
+        for (unsigned length = 1; length <= max_length; ++length)
+        {
+            kraft += uint64_t(length_count[length]) << (max_length - length);
+        }
+        while (kraft > (uint64_t(1) << max_length))
+        {
+            --length_count[max_length];
+            for (unsigned length = max_length - 1; length > 0; --length)
+            {
+                if (length_count[length] != 0)
+                {
+                    --length_count[length];
+                    length_count[length + 1] += 2;
+                    break;
+                }
+            }
+            --kraft;
+        }
+
+        // Least frequent symbols get the longest codes.
+        HuffmanCode huffman;
+        huffman.lengths.assign(frequencies.size(), 0);
+        size_t i = 0;
+        for (unsigned length = max_length; length > 0; --length)
+        {
+            for (uint32_t k = 0; k != length_count[length]; ++k) huffman.lengths[symbols[i++]] = uint8_t(length);
+        }
+
+        assign_codes(huffman);
+        return huffman;
+    }
+
+    HuffmanCode fixed_litlen_code()
+    {
+        HuffmanCode huffman;
+        huffman.lengths.resize(288);
+        std::fill(huffman.lengths.begin(), huffman.lengths.begin() + 144, 8);
+        std::fill(huffman.lengths.begin() + 144, huffman.lengths.begin() + 256, 9);
+        std::fill(huffman.lengths.begin() + 256, huffman.lengths.begin() + 280, 7);
+        std::fill(huffman.lengths.begin() + 280, huffman.lengths.end(), 8);
+        assign_codes(huffman);
+
+        return huffman;
+    }
+
+    HuffmanCode fixed_distance_code()
+    {
+        HuffmanCode huffman;
+        huffman.lengths.assign(30, 5);
+        assign_codes(huffman);
+
+        return huffman;
+    }
+
+    class Matcher
+    {
+    public:
+        Matcher(const uint8_t* data, size_t size, const LEVEL_SETTINGS& settings)
+            : data(data), size(size), settings(settings), head(size_t(1) << HASH_BITS, -1), previous(WINDOW_SIZE, -1) { }
+
+        void insert(size_t position)
+        {
+            if (position + MIN_MATCH > size) return;
+
+            const auto h = hash(position);
+            previous[position & (WINDOW_SIZE - 1)] = head[h];
+            head[h] = int32_t(position);
+        }
+
+        // Longest earlier match for position, following the hash chain of the position's first three bytes.
+        SYMBOL find(size_t position) const
+        {
+            SYMBOL best{ 0, 0 };
+            if (position + MIN_MATCH > size) return best;
+
+            const auto limit = unsigned(std::min<size_t>(MAX_MATCH, size - position));
+            unsigned best_length = MIN_MATCH - 1;
+            int32_t candidate = head[hash(position)];
+
+            for (unsigned chain = settings.max_chain; candidate >= 0 && chain > 0; --chain)
+            {
+                const auto distance = position - size_t(candidate);
+                // Deflate reaches back a whole window, a distance of exactly WINDOW_SIZE included
+                if (distance > WINDOW_SIZE) break;
+
+                // Cheap rejection: the candidate must at least extend beyond the current best.
+                if (data[candidate + best_length] == data[position + best_length])
+                {
+                    const auto length = match_length(size_t(candidate), position, limit);
+                    if (length > best_length)
+                    {
+                        best_length = length;
+                        best = SYMBOL{ uint16_t(length), uint16_t(distance) };
+                        if (length >= settings.nice_length || length == limit) break;
+                    }
+                }
+
+                const auto next = previous[size_t(candidate) & (WINDOW_SIZE - 1)];
+                if (next >= candidate) break;
+                candidate = next;
+            }
+
+            return best;
+        }
+
+    private:
+        uint32_t hash(size_t position) const
+        {
+            const uint32_t bytes = uint32_t(data[position]) | uint32_t(data[position + 1]) << 8 | uint32_t(data[position + 2]) << 16;
+            return (bytes * 2654435761U) >> (32 - HASH_BITS);
+        }
+
+        // Compares eight bytes at a time, the first differing byte is found through the lowest set bit.
+        unsigned match_length(size_t earlier, size_t position, unsigned limit) const
+        {
+            unsigned length = 0;
+            while (length + 8 <= limit)
+            {
+                uint64_t a, b;
+                memcpy(&a, data + earlier + length, 8);
+                memcpy(&b, data + position + length, 8);
+
+                const auto difference = a ^ b;
+                if (difference != 0) return length + unsigned(__builtin_ctzll(difference)) / 8;
+                length += 8;
+            }
+
+            while (length < limit && data[earlier + length] == data[position + length]) ++length;
+            return length;
+        }
+
+        const uint8_t* data;
+        size_t size;
+        const LEVEL_SETTINGS& settings;
+        std::vector<int32_t> head;
+        std::vector<int32_t> previous;
+    };
+
+    std::vector<SYMBOL> find_symbols(const uint8_t* data, size_t size, const LEVEL_SETTINGS& settings)
+    {
+        std::vector<SYMBOL> symbols;
+        symbols.reserve(size / 4 + 16);
+
+        Matcher matcher(data, size, settings);
+        size_t position = 0;
+
+        while (position < size)
+        {
+            auto match = matcher.find(position);
+
+            if (settings.lazy && match.distance != 0 && match.literal_or_length < settings.nice_length)
+            {
+                // Emit a literal instead when the next position has a longer match.
+                matcher.insert(position);
+                const auto next = matcher.find(position + 1);
+                if (next.literal_or_length > match.literal_or_length)
+                {
+                    symbols.push_back(SYMBOL{ data[position], 0 });
+                    ++position;
+                    continue;
+                }
+
+                for (size_t i = 1; i != match.literal_or_length; ++i) matcher.insert(position + i);
+                symbols.push_back(match);
+                position += match.literal_or_length;
+            }
+            else if (match.distance != 0)
+            {
+                for (size_t i = 0; i != match.literal_or_length; ++i) matcher.insert(position + i);
+                symbols.push_back(match);
+                position += match.literal_or_length;
+            }
+            else
+            {
+                matcher.insert(position);
+                symbols.push_back(SYMBOL{ data[position], 0 });
+                ++position;
+            }
+        }
+
+        return symbols;
+    }
+
+    void count_frequencies(const SYMBOL* symbols, size_t count, std::vector<uint32_t>& litlen, std::vector<uint32_t>& distance)
+    {
+        litlen.assign(LITLEN_CODES, 0);
+        distance.assign(DISTANCE_CODES, 0);
+
+        for (size_t i = 0; i != count; ++i)
+        {
+            if (symbols[i].distance == 0) ++litlen[symbols[i].literal_or_length];
+            else
+            {
+                ++litlen[257 + length_code(symbols[i].literal_or_length)];
+                ++distance[distance_code(symbols[i].distance)];
+            }
+        }
+        ++litlen[END_OF_BLOCK];
+    }
+
+    uint64_t symbols_cost(const std::vector<uint32_t>& litlen_frequencies, const std::vector<uint32_t>& distance_frequencies, const HuffmanCode& litlen, const HuffmanCode& distance)
+    {
+        uint64_t bits = 0;
+        for (unsigned symbol = 0; symbol != LITLEN_CODES; ++symbol)
+        {
+            bits += uint64_t(litlen_frequencies[symbol]) * (litlen.lengths[symbol] + (symbol > 256 ? LENGTH_EXTRA[symbol - 257] : 0));
+        }
+        for (unsigned symbol = 0; symbol != DISTANCE_CODES; ++symbol)
+        {
+            bits += uint64_t(distance_frequencies[symbol]) * (distance.lengths[symbol] + DISTANCE_EXTRA[symbol]);
+        }
+
+        return bits;
+    }
+
+    void write_symbols(BitWriter& writer, const SYMBOL* symbols, size_t count, const HuffmanCode& litlen, const HuffmanCode& distance)
+    {
+        for (size_t i = 0; i != count; ++i)
+        {
+            const auto& symbol = symbols[i];
+            if (symbol.distance == 0)
+            {
+                writer.write(litlen.codes[symbol.literal_or_length], litlen.lengths[symbol.literal_or_length]);
+                continue;
+            }
+
+            const auto lcode = length_code(symbol.literal_or_length);
+            writer.write(litlen.codes[257 + lcode], litlen.lengths[257 + lcode]);
+            writer.write(symbol.literal_or_length - LENGTH_BASE[lcode], LENGTH_EXTRA[lcode]);
+
+            const auto dcode = distance_code(symbol.distance);
+            writer.write(distance.codes[dcode], distance.lengths[dcode]);
+            writer.write(symbol.distance - DISTANCE_BASE[dcode], DISTANCE_EXTRA[dcode]);
+        }
+
+        writer.write(litlen.codes[END_OF_BLOCK], litlen.lengths[END_OF_BLOCK]);
+    }
+
+    // Code lengths of both trees, run length encoded with codes 16 (repeat previous), 17 and 18 (repeat zero).
+    struct CODE_LENGTH_SYMBOL
+    {
+        uint8_t code;
+        uint8_t extra;
+    };
+
+    std::vector<CODE_LENGTH_SYMBOL> run_length_encode(const std::vector<uint8_t>& lengths)
+    {
+        std::vector<CODE_LENGTH_SYMBOL> result;
+
+        for (size_t i = 0; i < lengths.size();)
+        {
+            const auto length = lengths[i];
+            size_t run = 1;
+            while (i + run < lengths.size() && lengths[i + run] == length) ++run;
+
+            if (length == 0 && run >= 3)
+            {
+                const auto n = std::min<size_t>(run, 138);
+                if (n >= 11) result.push_back(CODE_LENGTH_SYMBOL{ 18, uint8_t(n - 11) });
+                else result.push_back(CODE_LENGTH_SYMBOL{ 17, uint8_t(n - 3) });
+                i += n;
+            }
+            else if (length != 0 && run >= 4)
+            {
+                result.push_back(CODE_LENGTH_SYMBOL{ length, 0 });
+                const auto n = std::min<size_t>(run - 1, 6);
+                result.push_back(CODE_LENGTH_SYMBOL{ 16, uint8_t(n - 3) });
+                i += n + 1;
+            }
+            else
+            {
+                result.push_back(CODE_LENGTH_SYMBOL{ length, 0 });
+                ++i;
+            }
+        }
+
+        return result;
+    }
+
+    struct DYNAMIC_HEADER
+    {
+        unsigned litlen_count;
+        unsigned distance_count;
+        unsigned code_length_count;
+        std::vector<CODE_LENGTH_SYMBOL> encoded_lengths;
+        HuffmanCode code_length_code;
+
+        uint64_t cost() const
+        {
+            uint64_t bits = 5 + 5 + 4 + 3 * code_length_count;
+            for (auto symbol : encoded_lengths)
+            {
+                bits += code_length_code.lengths[symbol.code];
+                bits += symbol.code == 16 ? 2 : symbol.code == 17 ? 3 : symbol.code == 18 ? 7 : 0;
+            }
+
+            return bits;
+        }
+    };
+
+    DYNAMIC_HEADER build_dynamic_header(const HuffmanCode& litlen, const HuffmanCode& distance)
+    {
+        DYNAMIC_HEADER header;
+
+        header.litlen_count = LITLEN_CODES;
+        while (header.litlen_count > 257 && litlen.lengths[header.litlen_count - 1] == 0) --header.litlen_count;
+        header.distance_count = DISTANCE_CODES;
+        while (header.distance_count > 1 && distance.lengths[header.distance_count - 1] == 0) --header.distance_count;
+
+        std::vector<uint8_t> lengths(litlen.lengths.begin(), litlen.lengths.begin() + header.litlen_count);
+        lengths.insert(lengths.end(), distance.lengths.begin(), distance.lengths.begin() + header.distance_count);
+        header.encoded_lengths = run_length_encode(lengths);
+
+        std::vector<uint32_t> frequencies(CODE_LENGTH_CODES, 0);
+        for (auto symbol : header.encoded_lengths) ++frequencies[symbol.code];
+        header.code_length_code = build_code(frequencies, 7);
+
+        header.code_length_count = CODE_LENGTH_CODES;
+        while (header.code_length_count > 4 && header.code_length_code.lengths[CODE_LENGTH_ORDER[header.code_length_count - 1]] == 0) --header.code_length_count;
+
+        return header;
+    }
+
+    void write_dynamic_header(BitWriter& writer, const DYNAMIC_HEADER& header)
+    {
+        writer.write(header.litlen_count - 257, 5);
+        writer.write(header.distance_count - 1, 5);
+        writer.write(header.code_length_count - 4, 4);
+
+        for (unsigned i = 0; i != header.code_length_count; ++i)
+        {
+            writer.write(header.code_length_code.lengths[CODE_LENGTH_ORDER[i]], 3);
+        }
+
+        for (auto symbol : header.encoded_lengths)
+        {
+            writer.write(header.code_length_code.codes[symbol.code], header.code_length_code.lengths[symbol.code]);
+
+            if (symbol.code == 16) writer.write(symbol.extra, 2);
+            else if (symbol.code == 17) writer.write(symbol.extra, 3);
+            else if (symbol.code == 18) writer.write(symbol.extra, 7);
+        }
+    }
+
+    void write_stored_blocks(BitWriter& writer, std::vector<uint8_t>& out, const uint8_t* data, size_t size, bool last)
+    {
+        do
+        {
+            const auto chunk = std::min<size_t>(size, 65535);
+            const bool final_chunk = chunk == size;
+
+            writer.write(last && final_chunk ? 1 : 0, 1);
+            writer.write(0, 2);
+            writer.align_to_byte();
+
+            const auto length = uint16_t(chunk);
+            const auto complement = uint16_t(~length);
+            out.push_back(uint8_t(length));
+            out.push_back(uint8_t(length >> 8));
+            out.push_back(uint8_t(complement));
+            out.push_back(uint8_t(complement >> 8));
+            out.insert(out.end(), data, data + chunk);
+
+            data += chunk;
+            size -= chunk;
+        } while (size > 0);
+    }
+}
+
+uint32_t imaging::adler32(const uint8_t* data, size_t size, uint32_t adler)
+{
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+
+    // 5552 is the largest block for which b cannot overflow before the modulo
+    while (size > 0)
+    {
+        const auto block = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i != block; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+
+        data += block;
+        size -= block;
+    }
+
+    return (b << 16) | a;
+}
+
+std::vector<uint8_t> imaging::zlib_compress(const uint8_t* data, size_t size, int level)
+{
+    const auto& settings = LEVELS[std::max(0, std::min(level, 9))];
+
+    std::vector<uint8_t> out;
+    out.reserve(size / 8 + 64);
+
+    // CMF: deflate with a 32K window, FLG: no dictionary, check bits make the header a multiple of 31
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter writer(out);
+
+    if (settings.max_chain == 0)
+    {
+        write_stored_blocks(writer, out, data, size, true);
+    }
+    else
+    {
+        const auto symbols = find_symbols(data, size, settings);
+        static const HuffmanCode fixed_litlen = fixed_litlen_code();
+        static const HuffmanCode fixed_distance = fixed_distance_code();
+
+        // An empty input still gets one (empty) final block.
+        size_t consumed = 0;
+        size_t first = 0;
+        do
+        {
+            const auto count = std::min(SYMBOLS_PER_BLOCK, symbols.size() - first);
+            const bool last = first + count == symbols.size();
+
+            size_t block_bytes = 0;
+            for (size_t i = first; i != first + count; ++i)
+            {
+                block_bytes += symbols[i].distance == 0 ? 1 : symbols[i].literal_or_length;
+            }
+
+            std::vector<uint32_t> litlen_frequencies, distance_frequencies;
+            count_frequencies(symbols.data() + first, count, litlen_frequencies, distance_frequencies);
+
+            const auto litlen = build_code(litlen_frequencies, 15);
+            const auto distance = build_code(distance_frequencies, 15);
+            const auto header = build_dynamic_header(litlen, distance);
+
+            const auto dynamic_cost = header.cost() + symbols_cost(litlen_frequencies, distance_frequencies, litlen, distance);
+            const auto fixed_cost = symbols_cost(litlen_frequencies, distance_frequencies, fixed_litlen, fixed_distance);
+            const auto stored_cost = (block_bytes + 5 * (block_bytes / 65535 + 1)) * 8;
+
+            // Incompressible blocks are stored as is, later blocks can still refer back into them.
+            if (stored_cost < std::min(dynamic_cost, fixed_cost))
+            {
+                write_stored_blocks(writer, out, data + consumed, block_bytes, last);
+            }
+            else if (fixed_cost <= dynamic_cost)
+            {
+                writer.write(last ? 1 : 0, 1);
+                writer.write(1, 2);
+                write_symbols(writer, symbols.data() + first, count, fixed_litlen, fixed_distance);
+            }
+            else
+            {
+                writer.write(last ? 1 : 0, 1);
+                writer.write(2, 2);
+                write_dynamic_header(writer, header);
+                write_symbols(writer, symbols.data() + first, count, litlen, distance);
+            }
+
+            consumed += block_bytes;
+            first += count;
+        } while (first < symbols.size());
+    }
+
+    writer.align_to_byte();
+
+    const auto checksum = adler32(data, size);
+    out.push_back(uint8_t(checksum >> 24));
+    out.push_back(uint8_t(checksum >> 16));
+    out.push_back(uint8_t(checksum >> 8));
+    out.push_back(uint8_t(checksum));
+
+    return out;
+}
@@ -0,0 +1,24 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Compresses <paramref name="data" /> into a zlib stream (RFC 1950 wrapping RFC 1951 deflate data).
+    /// <paramref name="level" /> trades speed for ratio: 0 stores the data uncompressed,
+    /// 1 does a greedy LZ77 search with very short hash chains, 9 does lazy matching with long chains.
+    /// </summary>
+    std::vector<uint8_t> zlib_compress(const uint8_t* data, size_t size, int level);
+
+    /// <summary>
+    /// Adler-32 checksum as used by zlib streams.
+    /// </summary>
+    uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+}
+
+#endif
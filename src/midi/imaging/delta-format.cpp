@@ -0,0 +1,276 @@
+#include "imaging/delta-format.h"
+#include "logging.h"
+#include <algorithm>
+#include <cstring>
+
+
+using namespace imaging;
+
+namespace
+{
+    const char HEADER_MAGIC[] = { 'M', 'F', 'D', 'C' };
+    const char INDEX_MAGIC[] = { 'M', 'F', 'D', 'I' };
+    const uint16_t VERSION = 1;
+    const size_t HEADER_SIZE = 28;
+    const size_t RECORD_HEADER_SIZE = 5;
+    const size_t TRAILER_SIZE = 12;
+
+    const uint8_t KEY_FRAME = 'K';
+    const uint8_t DELTA_FRAME = 'D';
+
+    void append_little_endian(std::vector<uint8_t>& out, uint64_t value, unsigned size)
+    {
+        for (unsigned i = 0; i != size; ++i)
+        {
+            out.push_back(uint8_t(value >> (8 * i)));
+        }
+    }
+
+    uint64_t read_little_endian(const uint8_t* data, unsigned size)
+    {
+        uint64_t value = 0;
+        for (unsigned i = 0; i != size; ++i)
+        {
+            value |= uint64_t(data[i]) << (8 * i);
+        }
+
+        return value;
+    }
+
+    void append_variable_length(std::vector<uint8_t>& out, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    /// <summary>
+    /// Appends the runs of the pixels in columns [first_column, first_column + column_count) of every row.
+    /// Runs continue from one row into the next, so an all black region is a single run.
+    /// </summary>
+    void append_runs(std::vector<uint8_t>& out, const Frame& frame, unsigned first_column, unsigned column_count)
+    {
+        uint32_t run_pixel = 0;
+        uint32_t run_length = 0;
+
+        auto flush = [&]()
+        {
+            if (run_length == 0) return;
+
+            append_variable_length(out, run_length);
+            append_little_endian(out, run_pixel, 4);
+        };
+
+        for (unsigned y = 0; y != frame.height; ++y)
+        {
+            const auto row = frame.row(y) + first_column;
+
+            for (unsigned x = 0; x != column_count; ++x)
+            {
+                if (run_length != 0 && row[x] == run_pixel && run_length != UINT32_MAX)
+                {
+                    ++run_length;
+                }
+                else
+                {
+                    flush();
+                    run_pixel = row[x];
+                    run_length = 1;
+                }
+            }
+        }
+
+        flush();
+    }
+
+    std::vector<uint8_t> encode_record(uint8_t type, const Frame& frame, unsigned first_column, unsigned column_count)
+    {
+        std::vector<uint8_t> record(RECORD_HEADER_SIZE);
+        record[0] = type;
+
+        append_runs(record, frame, first_column, column_count);
+
+        const auto payload_size = record.size() - RECORD_HEADER_SIZE;
+        for (unsigned i = 0; i != 4; ++i)
+        {
+            record[1 + i] = uint8_t(payload_size >> (8 * i));
+        }
+
+        return record;
+    }
+
+    /// <summary>
+    /// Decodes runs into columns [first_column, first_column + column_count) of every row of <paramref name="frame" />.
+    /// </summary>
+    void decode_runs(const std::vector<uint8_t>& payload, Frame& frame, unsigned first_column, unsigned column_count)
+    {
+        const size_t pixel_count = size_t(frame.height) * column_count;
+        size_t position = 0;
+        size_t pixel = 0;
+
+        while (pixel != pixel_count)
+        {
+            uint32_t run_length = 0;
+            for (unsigned shift = 0; ; shift += 7)
+            {
+                CHECK(position < payload.size() && shift < 32) << "Corrupt run length in delta container";
+                const auto byte = payload[position++];
+                run_length |= uint32_t(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) break;
+            }
+
+            CHECK(position + 4 <= payload.size()) << "Truncated run in delta container";
+            CHECK(run_length != 0 && run_length <= pixel_count - pixel) << "Run exceeds frame in delta container";
+            const auto value = uint32_t(read_little_endian(payload.data() + position, 4));
+            position += 4;
+
+            for (; run_length != 0; --run_length, ++pixel)
+            {
+                frame.row(unsigned(pixel / column_count))[first_column + pixel % column_count] = value;
+            }
+        }
+
+        CHECK(position == payload.size()) << "Trailing data after record in delta container";
+    }
+}
+
+std::vector<uint8_t> imaging::encode_delta_header(const DELTA_HEADER& header)
+{
+    std::vector<uint8_t> data(std::begin(HEADER_MAGIC), std::end(HEADER_MAGIC));
+    append_little_endian(data, VERSION, 2);
+    append_little_endian(data, 0, 2);
+    append_little_endian(data, header.width, 4);
+    append_little_endian(data, header.height, 4);
+    append_little_endian(data, header.frame_count, 4);
+    append_little_endian(data, header.key_frame_interval, 4);
+    append_little_endian(data, header.shift, 4);
+
+    return data;
+}
+
+std::vector<uint8_t> imaging::encode_key_frame(const Frame& frame)
+{
+    return encode_record(KEY_FRAME, frame, 0, frame.width);
+}
+
+std::vector<uint8_t> imaging::encode_delta_frame(const Frame& frame, unsigned shift)
+{
+    const auto column_count = std::min(shift, frame.width);
+
+    return encode_record(DELTA_FRAME, frame, frame.width - column_count, column_count);
+}
+
+std::vector<uint8_t> imaging::encode_delta_index(const std::vector<uint64_t>& record_offsets, uint64_t index_offset)
+{
+    std::vector<uint8_t> data;
+    data.reserve(8 * record_offsets.size() + TRAILER_SIZE);
+
+    for (auto offset : record_offsets)
+    {
+        append_little_endian(data, offset, 8);
+    }
+    append_little_endian(data, index_offset, 8);
+    data.insert(data.end(), std::begin(INDEX_MAGIC), std::end(INDEX_MAGIC));
+
+    return data;
+}
+
+DeltaReader::DeltaReader(std::istream& in)
+    : in(in), delta_header(), record_offsets(), last_frame(0, 0), last_frame_index(0), has_last_frame(false)
+{
+    uint8_t header[HEADER_SIZE];
+    in.read(reinterpret_cast<char*>(header), HEADER_SIZE);
+    CHECK(!in.fail() && memcmp(header, HEADER_MAGIC, 4) == 0) << "Not a delta container";
+    CHECK(read_little_endian(header + 4, 2) == VERSION) << "Unsupported delta container version";
+
+    delta_header.width = unsigned(read_little_endian(header + 8, 4));
+    delta_header.height = unsigned(read_little_endian(header + 12, 4));
+    delta_header.frame_count = unsigned(read_little_endian(header + 16, 4));
+    delta_header.key_frame_interval = unsigned(read_little_endian(header + 20, 4));
+    delta_header.shift = unsigned(read_little_endian(header + 24, 4));
+
+    uint8_t trailer[TRAILER_SIZE];
+    in.seekg(-static_cast<std::streamoff>(TRAILER_SIZE), std::ios::end);
+    in.read(reinterpret_cast<char*>(trailer), TRAILER_SIZE);
+    CHECK(!in.fail() && memcmp(trailer + 8, INDEX_MAGIC, 4) == 0) << "Delta container has no index, was it written completely?";
+
+    std::vector<uint8_t> index(8 * size_t(delta_header.frame_count));
+    in.seekg(static_cast<std::streamoff>(read_little_endian(trailer, 8)));
+    in.read(reinterpret_cast<char*>(index.data()), index.size());
+    CHECK(!in.fail()) << "Truncated index in delta container";
+
+    for (size_t i = 0; i != delta_header.frame_count; ++i)
+    {
+        record_offsets.push_back(read_little_endian(index.data() + 8 * i, 8));
+    }
+}
+
+const DELTA_HEADER& DeltaReader::header() const
+{
+    return delta_header;
+}
+
+Frame DeltaReader::read_frame(unsigned frame_index)
+{
+    CHECK(frame_index < delta_header.frame_count) << "Frame " << frame_index << " is not in the delta container";
+
+    // Walk back to the closest key frame, unless the last decoded frame comes first
+    unsigned first = frame_index;
+    while (!(has_last_frame && first == last_frame_index))
+    {
+        in.seekg(static_cast<std::streamoff>(record_offsets[first]));
+        const auto type = in.get();
+        CHECK(!in.fail()) << "Truncated record in delta container";
+        if (type == KEY_FRAME || first == 0) break;
+        --first;
+    }
+
+    if (!(has_last_frame && first == last_frame_index))
+    {
+        last_frame = Frame(delta_header.width, delta_header.height);
+        apply_record(first, last_frame);
+    }
+
+    for (unsigned i = first + 1; i <= frame_index; ++i)
+    {
+        apply_record(i, last_frame);
+    }
+
+    last_frame_index = frame_index;
+    has_last_frame = true;
+
+    return last_frame;
+}
+
+void DeltaReader::apply_record(unsigned frame_index, Frame& frame)
+{
+    uint8_t record_header[RECORD_HEADER_SIZE];
+    in.seekg(static_cast<std::streamoff>(record_offsets[frame_index]));
+    in.read(reinterpret_cast<char*>(record_header), RECORD_HEADER_SIZE);
+    CHECK(!in.fail()) << "Truncated record in delta container";
+
+    std::vector<uint8_t> payload(read_little_endian(record_header + 1, 4));
+    in.read(reinterpret_cast<char*>(payload.data()), payload.size());
+    CHECK(!in.fail()) << "Truncated record in delta container";
+
+    if (record_header[0] == KEY_FRAME)
+    {
+        decode_runs(payload, frame, 0, frame.width);
+        return;
+    }
+
+    CHECK(record_header[0] == DELTA_FRAME) << "Unknown record type in delta container";
+
+    // Move everything shift columns to the left, the freed columns on the right are in the payload
+    const auto shift = std::min(delta_header.shift, frame.width);
+    for (unsigned y = 0; y != frame.height; ++y)
+    {
+        auto row = frame.row(y);
+        memmove(row, row + shift, sizeof(uint32_t) * (frame.width - shift));
+    }
+
+    decode_runs(payload, frame, frame.width - shift, shift);
+}
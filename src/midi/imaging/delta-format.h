@@ -0,0 +1,76 @@
+#ifndef DELTA_FORMAT_H
+#define DELTA_FORMAT_H
+
+#include "imaging/frame.h"
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Header of a column delta container (.mfd).
+    ///
+    /// Layout, all integers little endian:
+    ///   header   "MFDC", u16 version, u16 reserved, u32 width, u32 height, u32 frame count, u32 key frame interval, u32 shift
+    ///   records  one per frame: u8 type ('K' or 'D'), u32 payload size, payload
+    ///   index    u64 file offset of every record, followed by the u64 offset of the index itself and "MFDI"
+    ///
+    /// A key frame ('K') holds all pixels of the frame. A delta frame ('D') holds only the rightmost
+    /// <c>shift</c> columns: the frame is the previous frame moved <c>shift</c> columns to the left, plus those columns.
+    /// Payloads are runs of 32-bit pixels (row by row, top to bottom), each stored as a variable length count followed by the pixel.
+    /// </summary>
+    struct DELTA_HEADER final
+    {
+        unsigned width;
+        unsigned height;
+        unsigned frame_count;
+        unsigned key_frame_interval;
+        unsigned shift;
+    };
+
+    std::vector<uint8_t> encode_delta_header(const DELTA_HEADER& header);
+
+    /// <summary>
+    /// Encodes a record holding the whole <paramref name="frame" />.
+    /// </summary>
+    std::vector<uint8_t> encode_key_frame(const Frame& frame);
+
+    /// <summary>
+    /// Encodes a record holding only the rightmost <paramref name="shift" /> columns of <paramref name="frame" />.
+    /// </summary>
+    std::vector<uint8_t> encode_delta_frame(const Frame& frame, unsigned shift);
+
+    /// <summary>
+    /// Encodes the index which ends the container, <paramref name="record_offsets" /> has one entry per frame.
+    /// </summary>
+    std::vector<uint8_t> encode_delta_index(const std::vector<uint64_t>& record_offsets, uint64_t index_offset);
+
+    /// <summary>
+    /// Reads frames back from a column delta container.
+    /// Any frame can be requested: decoding starts at the closest key frame before it,
+    /// or continues from the last decoded frame when that one is closer.
+    /// </summary>
+    class DeltaReader final
+    {
+    public:
+        explicit DeltaReader(std::istream& in);
+
+        const DELTA_HEADER& header() const;
+
+        Frame read_frame(unsigned frame_index);
+
+    private:
+        void apply_record(unsigned frame_index, Frame& frame);
+
+        std::istream& in;
+        DELTA_HEADER delta_header;
+        std::vector<uint64_t> record_offsets;
+        Frame last_frame;
+        unsigned last_frame_index;
+        bool has_last_frame;
+    };
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "imaging/frame.h"
+
+
+using namespace imaging;
+
+Frame::Frame(unsigned width, unsigned height)
+    : width(width), height(height), pixels(size_t(width) * height, 0xFF000000)
+{
+    // NOP
+}
+
+uint32_t imaging::to_argb(const Color& c)
+{
+    uint32_t a = 255;
+    uint32_t r = uint8_t(c.r * 255);
+    uint32_t g = uint8_t(c.g * 255);
+    uint32_t b = uint8_t(c.b * 255);
+
+    return (a << 24U) | (r << 16U) | (g << 8U) | b;
+}
+
+Frame imaging::rasterize(const Bitmap& bitmap)
+{
+    Frame frame(bitmap.width(), bitmap.height());
+
+    for (unsigned y = 0; y != bitmap.height(); ++y)
+    {
+        auto row = frame.row(y);
+
+        for (unsigned x = 0; x != bitmap.width(); ++x)
+        {
+            row[x] = to_argb(bitmap[Position(x, y)]);
+        }
+    }
+
+    return frame;
+}
+
+Frame imaging::copy_frame(const Grid<uint32_t>& pixels, const Position& position, unsigned width, unsigned height)
+{
+    Frame frame(width, height);
+
+    for (unsigned y = 0; y != height; ++y)
+    {
+        auto row = frame.row(y);
+
+        for (unsigned x = 0; x != width; ++x)
+        {
+            row[x] = pixels[position + Position(x, y)] | 0xFF000000U;
+        }
+    }
+
+    return frame;
+}
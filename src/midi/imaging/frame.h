@@ -0,0 +1,68 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "imaging/bitmap.h"
+#include "util/grid.h"
+#include "util/position.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// A bitmap converted to packed 32-bit pixels, ready to be encoded.
+    /// Each pixel is stored as 0xAARRGGBB, i.e. bytes B, G, R, A in memory.
+    /// Rows are stored top to bottom without padding.
+    /// </summary>
+    struct Frame final
+    {
+        unsigned width;
+        unsigned height;
+        std::vector<uint32_t> pixels;
+
+        /// <summary>
+        /// Creates a black frame of the given size.
+        /// </summary>
+        Frame(unsigned width, unsigned height);
+
+        uint32_t& operator [](const Position& position)
+        {
+            return pixels[position.x + size_t(position.y) * width];
+        }
+
+        uint32_t operator [](const Position& position) const
+        {
+            return pixels[position.x + size_t(position.y) * width];
+        }
+
+        const uint32_t* row(unsigned y) const
+        {
+            return pixels.data() + size_t(y) * width;
+        }
+
+        uint32_t* row(unsigned y)
+        {
+            return pixels.data() + size_t(y) * width;
+        }
+    };
+
+    /// <summary>
+    /// Packs a color into 0xAARRGGBB, alpha is always fully opaque.
+    /// </summary>
+    uint32_t to_argb(const Color& color);
+
+    /// <summary>
+    /// Converts every pixel of <paramref name="bitmap" /> to its packed representation.
+    /// </summary>
+    Frame rasterize(const Bitmap& bitmap);
+
+    /// <summary>
+    /// Copies the <paramref name="width" /> by <paramref name="height" /> pixels at <paramref name="position" /> out of a grid
+    /// that already holds packed pixels, so nothing is converted. Only the alpha is set, which turns the zero pixels
+    /// of a <see cref="TiledGrid" /> that were never written into opaque black.
+    /// </summary>
+    Frame copy_frame(const Grid<uint32_t>& pixels, const Position& position, unsigned width, unsigned height);
+}
+
+#endif
@@ -0,0 +1,302 @@
+#include "imaging/gif-format.h"
+#include <algorithm>
+#include <cstring>
+
+
+using namespace imaging;
+
+namespace
+{
+    // Palette: 6 levels of red, 7 of green (the eye is most sensitive to it) and 6 of blue
+    const unsigned RED_LEVELS = 6;
+    const unsigned GREEN_LEVELS = 7;
+    const unsigned BLUE_LEVELS = 6;
+
+    const unsigned MIN_CODE_SIZE = 8;
+    const unsigned MAX_CODES = 4096;
+
+    /// <summary>
+    /// Per channel lookup tables, the palette index of a pixel is the sum of the three lookups.
+    /// </summary>
+    struct QUANTIZER
+    {
+        uint8_t red[256];
+        uint8_t green[256];
+        uint8_t blue[256];
+
+        QUANTIZER()
+        {
+            for (unsigned value = 0; value != 256; ++value)
+            {
+                red[value] = uint8_t((value * (RED_LEVELS - 1) + 127) / 255 * GREEN_LEVELS * BLUE_LEVELS);
+                green[value] = uint8_t((value * (GREEN_LEVELS - 1) + 127) / 255 * BLUE_LEVELS);
+                blue[value] = uint8_t((value * (BLUE_LEVELS - 1) + 127) / 255);
+            }
+        }
+
+        uint8_t operator ()(uint32_t pixel) const
+        {
+            return uint8_t(red[(pixel >> 16) & 0xFF] + green[(pixel >> 8) & 0xFF] + blue[pixel & 0xFF]);
+        }
+    };
+
+    const QUANTIZER quantize;
+
+    void append_u16(std::vector<uint8_t>& out, unsigned value)
+    {
+        out.push_back(uint8_t(value));
+        out.push_back(uint8_t(value >> 8));
+    }
+
+    /// <summary>
+    /// Packs codes least significant bit first into data sub-blocks of at most 255 bytes.
+    /// </summary>
+    class CodeWriter
+    {
+    private:
+        std::vector<uint8_t>& out;
+        uint8_t block[255];
+        unsigned block_size;
+        uint32_t buffer;
+        unsigned count;
+
+        void put(uint8_t byte)
+        {
+            block[block_size++] = byte;
+            if (block_size == sizeof(block)) flush_block();
+        }
+
+        void flush_block()
+        {
+            if (block_size == 0) return;
+
+            out.push_back(uint8_t(block_size));
+            out.insert(out.end(), block, block + block_size);
+            block_size = 0;
+        }
+
+    public:
+        explicit CodeWriter(std::vector<uint8_t>& out) : out(out), block(), block_size(0), buffer(0), count(0) { }
+
+        void write(unsigned code, unsigned size)
+        {
+            buffer |= uint32_t(code) << count;
+            count += size;
+
+            for (; count >= 8; count -= 8, buffer >>= 8)
+            {
+                put(uint8_t(buffer));
+            }
+        }
+
+        /// <summary>
+        /// Writes the remaining bits and the block terminator.
+        /// </summary>
+        void finish()
+        {
+            if (count != 0) put(uint8_t(buffer));
+            flush_block();
+            out.push_back(0);
+        }
+    };
+
+    /// <summary>
+    /// LZW with the string table kept in an open addressing hash table,
+    /// keyed by (code of the prefix, next index).
+    /// </summary>
+    class LzwEncoder
+    {
+    private:
+        static const unsigned TABLE_BITS = 13;
+        static const unsigned TABLE_SIZE = 1U << TABLE_BITS;
+
+        int32_t keys[TABLE_SIZE];
+        uint16_t codes[TABLE_SIZE];
+
+        static unsigned slot_of(int32_t key)
+        {
+            return (uint32_t(key) * 2654435761U) >> (32 - TABLE_BITS);
+        }
+
+    public:
+        void clear()
+        {
+            std::fill(std::begin(keys), std::end(keys), -1);
+        }
+
+        void encode(const std::vector<uint8_t>& indices, CodeWriter& writer)
+        {
+            const unsigned clear_code = 1U << MIN_CODE_SIZE;
+            const unsigned end_code = clear_code + 1;
+
+            unsigned code_size = MIN_CODE_SIZE + 1;
+            unsigned last_code = end_code;
+            clear();
+            writer.write(clear_code, code_size);
+
+            int current = -1;
+            for (auto index : indices)
+            {
+                if (current < 0)
+                {
+                    current = index;
+                    continue;
+                }
+
+                const int32_t key = (current << 8) | index;
+                auto slot = slot_of(key);
+                while (keys[slot] != -1 && keys[slot] != key) slot = (slot + 1) & (TABLE_SIZE - 1);
+
+                if (keys[slot] == key)
+                {
+                    current = codes[slot];
+                    continue;
+                }
+
+                writer.write(unsigned(current), code_size);
+
+                keys[slot] = key;
+                codes[slot] = uint16_t(++last_code);
+                if (last_code >= (1U << code_size)) ++code_size;
+
+                // The table is full: start over with a fresh one
+                if (last_code == MAX_CODES - 1)
+                {
+                    writer.write(clear_code, code_size);
+                    clear();
+                    code_size = MIN_CODE_SIZE + 1;
+                    last_code = end_code;
+                }
+
+                current = index;
+            }
+
+            if (current >= 0) writer.write(unsigned(current), code_size);
+            writer.write(clear_code, code_size);
+            writer.write(end_code, MIN_CODE_SIZE + 1);
+        }
+    };
+
+    struct RECTANGLE
+    {
+        unsigned left, top, width, height;
+    };
+
+    /// <summary>
+    /// Smallest rectangle containing every pixel that differs between the two frames.
+    /// When nothing changed, a single pixel is returned: a frame has to contain at least one.
+    /// </summary>
+    RECTANGLE changed_rectangle(const Frame& frame, const Frame& previous_frame)
+    {
+        unsigned left = frame.width, right = 0, top = frame.height, bottom = 0;
+
+        for (unsigned y = 0; y != frame.height; ++y)
+        {
+            const auto row = frame.row(y);
+            const auto previous_row = previous_frame.row(y);
+            if (memcmp(row, previous_row, sizeof(uint32_t) * frame.width) == 0) continue;
+
+            top = std::min(top, y);
+            bottom = y;
+
+            unsigned x = 0;
+            while (row[x] == previous_row[x]) ++x;
+            left = std::min(left, x);
+
+            x = frame.width - 1;
+            while (row[x] == previous_row[x]) --x;
+            right = std::max(right, x);
+        }
+
+        if (top == frame.height) return RECTANGLE{ 0, 0, 1, 1 };
+
+        return RECTANGLE{ left, top, right - left + 1, bottom - top + 1 };
+    }
+}
+
+std::vector<uint8_t> imaging::gif_header(unsigned width, unsigned height)
+{
+    std::vector<uint8_t> data = { 'G', 'I', 'F', '8', '9', 'a' };
+
+    // Logical screen descriptor: global color table of 2^(7 + 1) entries, 8 bits per primary color
+    append_u16(data, width);
+    append_u16(data, height);
+    data.push_back(0xF7);
+    data.push_back(0);
+    data.push_back(0);
+
+    for (unsigned index = 0; index != 256; ++index)
+    {
+        const unsigned r = index / (GREEN_LEVELS * BLUE_LEVELS);
+        const unsigned g = index / BLUE_LEVELS % GREEN_LEVELS;
+        const unsigned b = index % BLUE_LEVELS;
+        const bool used = r < RED_LEVELS;
+
+        data.push_back(used ? uint8_t(r * 255 / (RED_LEVELS - 1)) : 0);
+        data.push_back(used ? uint8_t(g * 255 / (GREEN_LEVELS - 1)) : 0);
+        data.push_back(used ? uint8_t(b * 255 / (BLUE_LEVELS - 1)) : 0);
+    }
+
+    // NETSCAPE2.0 application extension, loop count 0 means forever
+    const uint8_t loop[] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+    data.insert(data.end(), std::begin(loop), std::end(loop));
+
+    return data;
+}
+
+std::vector<uint8_t> imaging::encode_gif_frame(const Frame& frame, const Frame* previous_frame, unsigned delay_centiseconds)
+{
+    const auto rectangle = previous_frame ? changed_rectangle(frame, *previous_frame) : RECTANGLE{ 0, 0, frame.width, frame.height };
+
+    std::vector<uint8_t> indices(size_t(rectangle.width) * rectangle.height);
+    auto target = indices.data();
+    for (unsigned y = rectangle.top; y != rectangle.top + rectangle.height; ++y)
+    {
+        const auto row = frame.row(y) + rectangle.left;
+        for (unsigned x = 0; x != rectangle.width; ++x)
+        {
+            *target++ = quantize(row[x]);
+        }
+    }
+
+    std::vector<uint8_t> data;
+    data.reserve(32 + indices.size() / 8);
+
+    // Graphic control extension: disposal method 1 leaves the frame in place for the next one to draw over
+    data.push_back(0x21);
+    data.push_back(0xF9);
+    data.push_back(0x04);
+    data.push_back(0x04);
+    append_u16(data, std::min(delay_centiseconds, 0xFFFFU));
+    data.push_back(0);
+    data.push_back(0);
+
+    // Image descriptor without a local color table
+    data.push_back(0x2C);
+    append_u16(data, rectangle.left);
+    append_u16(data, rectangle.top);
+    append_u16(data, rectangle.width);
+    append_u16(data, rectangle.height);
+    data.push_back(0);
+
+    data.push_back(uint8_t(MIN_CODE_SIZE));
+    CodeWriter writer(data);
+    LzwEncoder encoder;
+    encoder.encode(indices, writer);
+    writer.finish();
+
+    return data;
+}
+
+unsigned imaging::gif_frame_delay(unsigned frame_index, unsigned frames_per_second)
+{
+    frames_per_second = std::max(frames_per_second, 1U);
+
+    auto end_of = [frames_per_second](uint64_t frame) { return (frame * 100 + frames_per_second / 2) / frames_per_second; };
+    return unsigned(end_of(frame_index + 1) - end_of(frame_index));
+}
+
+std::vector<uint8_t> imaging::gif_trailer()
+{
+    return { 0x3B };
+}
@@ -0,0 +1,42 @@
+#ifndef GIF_FORMAT_H
+#define GIF_FORMAT_H
+
+#include "imaging/frame.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Offset of the 16-bit little endian delay within the data returned by <see cref="encode_gif_frame" />,
+    /// so a writer can lengthen a frame that is followed by identical ones.
+    /// </summary>
+    const unsigned GIF_DELAY_OFFSET = 4;
+
+    /// <summary>
+    /// Header, logical screen descriptor, global color table and a loop forever extension of an animated GIF89a.
+    /// All frames share one global palette: a 6x7x6 RGB cube, every pixel is mapped to its closest entry.
+    /// </summary>
+    std::vector<uint8_t> gif_header(unsigned width, unsigned height);
+
+    /// <summary>
+    /// Encodes one frame of an animation: a graphic control extension, an image descriptor and LZW compressed pixels.
+    /// When <paramref name="previous_frame" /> is given, only the smallest rectangle containing all changed pixels is stored,
+    /// the rest of the previous frame stays on screen.
+    /// </summary>
+    std::vector<uint8_t> encode_gif_frame(const Frame& frame, const Frame* previous_frame, unsigned delay_centiseconds);
+
+    /// <summary>
+    /// Delay of frame <paramref name="frame_index" /> in hundredths of a second, spread so that the total stays exact
+    /// (e.g. 3, 4, 3, 3, 4, 3, ... centiseconds at 30 frames per second).
+    /// </summary>
+    unsigned gif_frame_delay(unsigned frame_index, unsigned frames_per_second);
+
+    /// <summary>
+    /// Ends the GIF file.
+    /// </summary>
+    std::vector<uint8_t> gif_trailer();
+}
+
+#endif
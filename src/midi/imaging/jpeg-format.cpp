@@ -0,0 +1,553 @@
+#include "imaging/jpeg-format.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JPEG_USE_SSE2
+#endif
+
+
+using namespace imaging;
+
+namespace
+{
+    // Standard tables from Annex K of the JPEG specification
+
+    const uint8_t LUMA_QUANTIZATION[64] = {
+        16, 11, 10, 16,  24,  40,  51,  61,
+        12, 12, 14, 19,  26,  58,  60,  55,
+        14, 13, 16, 24,  40,  57,  69,  56,
+        14, 17, 22, 29,  51,  87,  80,  62,
+        18, 22, 37, 56,  68, 109, 103,  77,
+        24, 35, 55, 64,  81, 104, 113,  92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103,  99
+    };
+
+    const uint8_t CHROMA_QUANTIZATION[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99
+    };
+
+    // ZIGZAG[i] is the position (row * 8 + column) of the i-th coefficient in zigzag order
+    const uint8_t ZIGZAG[64] = {
+         0,  1,  8, 16,  9,  2,  3, 10,
+        17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34,
+        27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36,
+        29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46,
+        53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    constexpr uint8_t DC_LUMA_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    constexpr uint8_t DC_LUMA_VALUES[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    constexpr uint8_t DC_CHROMA_BITS[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    constexpr uint8_t DC_CHROMA_VALUES[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    constexpr uint8_t AC_LUMA_BITS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+    constexpr uint8_t AC_LUMA_VALUES[] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    constexpr uint8_t AC_CHROMA_BITS[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+    constexpr uint8_t AC_CHROMA_VALUES[] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    /// <summary>
+    /// Code and length of every symbol, indexed by symbol.
+    /// </summary>
+    struct HUFFMAN_TABLE
+    {
+        std::array<uint16_t, 256> codes;
+        std::array<uint8_t, 256> lengths;
+    };
+
+    /// <summary>
+    /// Assigns canonical codes to the symbols of a DHT style table (Annex C), at compile time.
+    /// </summary>
+    template<size_t N>
+    constexpr HUFFMAN_TABLE build_huffman_table(const uint8_t (&bits)[16], const uint8_t (&values)[N])
+    {
+        HUFFMAN_TABLE table{};
+        uint16_t code = 0;
+        size_t k = 0;
+
+        for (unsigned length = 1; length <= 16; ++length)
+        {
+            for (unsigned i = 0; i != bits[length - 1]; ++i, ++k)
+            {
+                table.codes[values[k]] = code++;
+                table.lengths[values[k]] = uint8_t(length);
+            }
+            code <<= 1;
+        }
+
+        return table;
+    }
+
+    constexpr HUFFMAN_TABLE DC_LUMA = build_huffman_table(DC_LUMA_BITS, DC_LUMA_VALUES);
+    constexpr HUFFMAN_TABLE DC_CHROMA = build_huffman_table(DC_CHROMA_BITS, DC_CHROMA_VALUES);
+    constexpr HUFFMAN_TABLE AC_LUMA = build_huffman_table(AC_LUMA_BITS, AC_LUMA_VALUES);
+    constexpr HUFFMAN_TABLE AC_CHROMA = build_huffman_table(AC_CHROMA_BITS, AC_CHROMA_VALUES);
+
+    static_assert(DC_LUMA.lengths[0] == 2 && DC_LUMA.codes[0] == 0, "DC luma table");
+    static_assert(AC_LUMA.lengths[0x00] == 4 && AC_LUMA.codes[0x00] == 0xA, "AC luma EOB code");
+    static_assert(AC_LUMA.lengths[0xF0] == 11 && AC_LUMA.codes[0xF0] == 0x7F9, "AC luma ZRL code");
+
+    // DCT_MATRIX[u][x] = c(u) cos((2x + 1) u pi / 16) in 2.13 fixed point, c(0) = sqrt(1/8) and c(u) = 1/2 otherwise.
+    // This is the orthonormal DCT, which is exactly the transform JPEG defines.
+    const int DCT_BITS = 13;
+    const int16_t DCT_MATRIX[8][8] = {
+        { 2896,  2896,  2896,  2896,  2896,  2896,  2896,  2896 },
+        { 4017,  3406,  2276,   799,  -799, -2276, -3406, -4017 },
+        { 3784,  1567, -1567, -3784, -3784, -1567,  1567,  3784 },
+        { 3406,  -799, -4017, -2276,  2276,  4017,   799, -3406 },
+        { 2896, -2896, -2896,  2896,  2896, -2896, -2896,  2896 },
+        { 2276, -4017,   799,  3406, -3406,  -799,  4017, -2276 },
+        { 1567, -3784,  3784, -1567, -1567,  3784, -3784,  1567 },
+        {  799, -2276,  3406, -4017,  4017, -3406,  2276,  -799 }
+    };
+
+    // The first pass keeps 2 extra fraction bits, the second pass removes them again
+    const int PASS1_SHIFT = DCT_BITS - 2;
+    const int PASS2_SHIFT = DCT_BITS + 2;
+
+    struct QUANTIZATION_TABLE
+    {
+        uint8_t values[64];     // natural order
+        float reciprocals[64];  // natural order
+    };
+
+    QUANTIZATION_TABLE scale_quantization_table(const uint8_t (&base)[64], int quality)
+    {
+        quality = std::max(1, std::min(quality, 100));
+        const int scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+
+        QUANTIZATION_TABLE table;
+        for (unsigned i = 0; i != 64; ++i)
+        {
+            const int value = std::max(1, std::min((base[i] * scale + 50) / 100, 255));
+            table.values[i] = uint8_t(value);
+            table.reciprocals[i] = 1.0f / value;
+        }
+
+        return table;
+    }
+
+#ifdef JPEG_USE_SSE2
+    /// <summary>
+    /// One dimensional DCT of the 8 columns of <paramref name="rows" /> at once.
+    /// Output row u is the sum of DCT_MATRIX[u][y] * row y, two rows at a time through madd.
+    /// </summary>
+    void dct_columns(const __m128i (&rows)[8], __m128i (&result)[8], int shift)
+    {
+        __m128i low[4], high[4];
+        for (unsigned pair = 0; pair != 4; ++pair)
+        {
+            low[pair] = _mm_unpacklo_epi16(rows[2 * pair], rows[2 * pair + 1]);
+            high[pair] = _mm_unpackhi_epi16(rows[2 * pair], rows[2 * pair + 1]);
+        }
+
+        const __m128i rounding = _mm_set1_epi32(1 << (shift - 1));
+        for (unsigned u = 0; u != 8; ++u)
+        {
+            __m128i sum_low = rounding;
+            __m128i sum_high = rounding;
+
+            for (unsigned pair = 0; pair != 4; ++pair)
+            {
+                const auto coefficients = _mm_set1_epi32(int32_t(uint16_t(DCT_MATRIX[u][2 * pair])) | (int32_t(DCT_MATRIX[u][2 * pair + 1]) << 16));
+                sum_low = _mm_add_epi32(sum_low, _mm_madd_epi16(low[pair], coefficients));
+                sum_high = _mm_add_epi32(sum_high, _mm_madd_epi16(high[pair], coefficients));
+            }
+
+            result[u] = _mm_packs_epi32(_mm_srai_epi32(sum_low, shift), _mm_srai_epi32(sum_high, shift));
+        }
+    }
+
+    void transpose(__m128i (&rows)[8])
+    {
+        const auto a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+        const auto a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+        const auto a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+        const auto a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+        const auto a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+        const auto a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+        const auto a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+        const auto a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+
+        const auto b0 = _mm_unpacklo_epi32(a0, a2);
+        const auto b1 = _mm_unpackhi_epi32(a0, a2);
+        const auto b2 = _mm_unpacklo_epi32(a1, a3);
+        const auto b3 = _mm_unpackhi_epi32(a1, a3);
+        const auto b4 = _mm_unpacklo_epi32(a4, a6);
+        const auto b5 = _mm_unpackhi_epi32(a4, a6);
+        const auto b6 = _mm_unpacklo_epi32(a5, a7);
+        const auto b7 = _mm_unpackhi_epi32(a5, a7);
+
+        rows[0] = _mm_unpacklo_epi64(b0, b4);
+        rows[1] = _mm_unpackhi_epi64(b0, b4);
+        rows[2] = _mm_unpacklo_epi64(b1, b5);
+        rows[3] = _mm_unpackhi_epi64(b1, b5);
+        rows[4] = _mm_unpacklo_epi64(b2, b6);
+        rows[5] = _mm_unpackhi_epi64(b2, b6);
+        rows[6] = _mm_unpacklo_epi64(b3, b7);
+        rows[7] = _mm_unpackhi_epi64(b3, b7);
+    }
+
+    /// <summary>
+    /// Forward DCT and quantization of one level shifted block, both in natural order.
+    /// </summary>
+    void transform_block(const int16_t* block, const QUANTIZATION_TABLE& table, int16_t* result)
+    {
+        __m128i rows[8], transformed[8];
+        for (unsigned y = 0; y != 8; ++y)
+        {
+            rows[y] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 8 * y));
+        }
+
+        dct_columns(rows, transformed, PASS1_SHIFT);
+        transpose(transformed);
+        dct_columns(transformed, rows, PASS2_SHIFT);
+        transpose(rows);
+
+        // Quantize in single precision: round(coefficient / q), the conversion rounds to nearest
+        for (unsigned y = 0; y != 8; ++y)
+        {
+            const auto low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(rows[y], rows[y]), 16));
+            const auto high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(rows[y], rows[y]), 16));
+            const auto quantized_low = _mm_cvtps_epi32(_mm_mul_ps(low, _mm_loadu_ps(table.reciprocals + 8 * y)));
+            const auto quantized_high = _mm_cvtps_epi32(_mm_mul_ps(high, _mm_loadu_ps(table.reciprocals + 8 * y + 4)));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result + 8 * y), _mm_packs_epi32(quantized_low, quantized_high));
+        }
+    }
+#else
+    void dct_columns(const int16_t* input, int16_t* output, int shift)
+    {
+        for (unsigned u = 0; u != 8; ++u)
+        {
+            for (unsigned x = 0; x != 8; ++x)
+            {
+                int32_t sum = 1 << (shift - 1);
+                for (unsigned y = 0; y != 8; ++y)
+                {
+                    sum += DCT_MATRIX[u][y] * input[8 * y + x];
+                }
+                output[8 * u + x] = int16_t(std::max(-32768, std::min(sum >> shift, 32767)));
+            }
+        }
+    }
+
+    void transpose(int16_t* block)
+    {
+        for (unsigned y = 0; y != 8; ++y)
+        {
+            for (unsigned x = y + 1; x != 8; ++x)
+            {
+                std::swap(block[8 * y + x], block[8 * x + y]);
+            }
+        }
+    }
+
+    void transform_block(const int16_t* block, const QUANTIZATION_TABLE& table, int16_t* result)
+    {
+        int16_t transformed[64], coefficients[64];
+
+        dct_columns(block, transformed, PASS1_SHIFT);
+        transpose(transformed);
+        dct_columns(transformed, coefficients, PASS2_SHIFT);
+        transpose(coefficients);
+
+        for (unsigned i = 0; i != 64; ++i)
+        {
+            const float quantized = coefficients[i] * table.reciprocals[i];
+            result[i] = int16_t(quantized < 0 ? quantized - 0.5f : quantized + 0.5f);
+        }
+    }
+#endif
+
+    /// <summary>
+    /// Writes entropy coded data, inserting a 0x00 after every 0xFF byte as required.
+    /// </summary>
+    class BitWriter
+    {
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t buffer;
+        unsigned count;
+
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out), buffer(0), count(0) { }
+
+        void write(uint32_t bits, unsigned length)
+        {
+            buffer = (buffer << length) | (bits & ((1U << length) - 1));
+            count += length;
+
+            while (count >= 8)
+            {
+                count -= 8;
+                const auto byte = uint8_t(buffer >> count);
+                out.push_back(byte);
+                if (byte == 0xFF) out.push_back(0x00);
+            }
+        }
+
+        /// <summary>
+        /// Pads the last byte with 1 bits.
+        /// </summary>
+        void flush()
+        {
+            if (count != 0) write(0x7F, 8 - count);
+        }
+    };
+
+    unsigned bit_length(unsigned value)
+    {
+        unsigned length = 0;
+        for (; value != 0; value >>= 1) ++length;
+        return length;
+    }
+
+    void encode_coefficients(BitWriter& writer, const int16_t* coefficients, int& previous_dc, const HUFFMAN_TABLE& dc, const HUFFMAN_TABLE& ac)
+    {
+        // Magnitude categories: a value is sent as its bit length followed by its low bits,
+        // negative values as value - 1 so that their leading bit is 0
+        auto write_value = [&writer](int value, unsigned category)
+        {
+            if (category != 0) writer.write(uint32_t(value < 0 ? value - 1 : value), category);
+        };
+
+        const int difference = coefficients[0] - previous_dc;
+        previous_dc = coefficients[0];
+
+        const auto dc_category = bit_length(unsigned(std::abs(difference)));
+        writer.write(dc.codes[dc_category], dc.lengths[dc_category]);
+        write_value(difference, dc_category);
+
+        unsigned zeros = 0;
+        for (unsigned i = 1; i != 64; ++i)
+        {
+            const int value = coefficients[ZIGZAG[i]];
+            if (value == 0)
+            {
+                ++zeros;
+                continue;
+            }
+
+            for (; zeros >= 16; zeros -= 16)
+            {
+                writer.write(ac.codes[0xF0], ac.lengths[0xF0]);
+            }
+
+            const auto category = bit_length(unsigned(std::abs(value)));
+            const auto symbol = (zeros << 4) | category;
+            writer.write(ac.codes[symbol], ac.lengths[symbol]);
+            write_value(value, category);
+            zeros = 0;
+        }
+
+        if (zeros != 0) writer.write(ac.codes[0x00], ac.lengths[0x00]);
+    }
+
+    /// <summary>
+    /// Full range YCbCr planes as JFIF defines them, padded to whole 16x16 macroblocks by repeating the last row and column.
+    /// The planes hold level shifted samples (-128..127) so they can go straight into the DCT.
+    /// </summary>
+    struct PLANES
+    {
+        unsigned luma_width, luma_height;
+        std::vector<int16_t> y, cb, cr;
+    };
+
+    PLANES convert_to_planes(const Frame& frame)
+    {
+        PLANES planes;
+        planes.luma_width = (frame.width + 15) / 16 * 16;
+        planes.luma_height = (frame.height + 15) / 16 * 16;
+        planes.y.resize(size_t(planes.luma_width) * planes.luma_height);
+        planes.cb.resize(planes.y.size() / 4);
+        planes.cr.resize(planes.y.size() / 4);
+
+        const unsigned chroma_width = planes.luma_width / 2;
+
+        for (unsigned y = 0; y < planes.luma_height; y += 2)
+        {
+            const auto row0 = frame.row(std::min(y, frame.height - 1));
+            const auto row1 = frame.row(std::min(y + 1, frame.height - 1));
+
+            for (unsigned x = 0; x < planes.luma_width; x += 2)
+            {
+                const uint32_t block[] = {
+                    row0[std::min(x, frame.width - 1)], row0[std::min(x + 1, frame.width - 1)],
+                    row1[std::min(x, frame.width - 1)], row1[std::min(x + 1, frame.width - 1)]
+                };
+
+                int r = 0, g = 0, b = 0;
+                for (unsigned i = 0; i != 4; ++i)
+                {
+                    const int pixel_r = (block[i] >> 16) & 0xFF;
+                    const int pixel_g = (block[i] >> 8) & 0xFF;
+                    const int pixel_b = block[i] & 0xFF;
+
+                    const auto luma = (19595 * pixel_r + 38470 * pixel_g + 7471 * pixel_b + 32768) >> 16;
+                    planes.y[size_t(y + i / 2) * planes.luma_width + x + i % 2] = int16_t(luma - 128);
+
+                    r += pixel_r;
+                    g += pixel_g;
+                    b += pixel_b;
+                }
+
+                // The chroma of the 2x2 block is computed from the sums, hence the extra shift by 2
+                const auto chroma_index = size_t(y / 2) * chroma_width + x / 2;
+                planes.cb[chroma_index] = int16_t((-11059 * r - 21709 * g + 32768 * b + (1 << 17)) >> 18);
+                planes.cr[chroma_index] = int16_t((32768 * r - 27439 * g - 5329 * b + (1 << 17)) >> 18);
+            }
+        }
+
+        return planes;
+    }
+
+    void load_block(const std::vector<int16_t>& plane, unsigned plane_width, unsigned x, unsigned y, int16_t* block)
+    {
+        for (unsigned row = 0; row != 8; ++row)
+        {
+            memcpy(block + 8 * row, plane.data() + size_t(y + row) * plane_width + x, 8 * sizeof(int16_t));
+        }
+    }
+
+    void append_marker(std::vector<uint8_t>& out, uint8_t marker, uint16_t length)
+    {
+        out.push_back(0xFF);
+        out.push_back(marker);
+        out.push_back(uint8_t(length >> 8));
+        out.push_back(uint8_t(length));
+    }
+
+    void append_huffman_table(std::vector<uint8_t>& out, uint8_t table_class_and_id, const uint8_t (&bits)[16], const uint8_t* values, size_t count)
+    {
+        out.push_back(table_class_and_id);
+        out.insert(out.end(), bits, bits + 16);
+        out.insert(out.end(), values, values + count);
+    }
+
+    void append_headers(std::vector<uint8_t>& out, const Frame& frame, const QUANTIZATION_TABLE& luma, const QUANTIZATION_TABLE& chroma)
+    {
+        // SOI and a JFIF APP0 segment
+        static const uint8_t jfif[] = {
+            0xFF, 0xD8,
+            0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00
+        };
+        out.insert(out.end(), std::begin(jfif), std::end(jfif));
+
+        // DQT, tables are stored in zigzag order
+        append_marker(out, 0xDB, 2 + 2 * 65);
+        out.push_back(0x00);
+        for (auto position : ZIGZAG) out.push_back(luma.values[position]);
+        out.push_back(0x01);
+        for (auto position : ZIGZAG) out.push_back(chroma.values[position]);
+
+        // SOF0: 8 bit samples, Y sampled 2x2, Cb and Cr 1x1
+        append_marker(out, 0xC0, 8 + 3 * 3);
+        const uint8_t frame_header[] = {
+            8,
+            uint8_t(frame.height >> 8), uint8_t(frame.height),
+            uint8_t(frame.width >> 8), uint8_t(frame.width),
+            3,
+            1, 0x22, 0,
+            2, 0x11, 1,
+            3, 0x11, 1
+        };
+        out.insert(out.end(), std::begin(frame_header), std::end(frame_header));
+
+        // DHT, MJPEG decoders do not all know the standard tables, so they are always included
+        append_marker(out, 0xC4, uint16_t(2 + 4 * 17 + sizeof(DC_LUMA_VALUES) + sizeof(AC_LUMA_VALUES) + sizeof(DC_CHROMA_VALUES) + sizeof(AC_CHROMA_VALUES)));
+        append_huffman_table(out, 0x00, DC_LUMA_BITS, DC_LUMA_VALUES, sizeof(DC_LUMA_VALUES));
+        append_huffman_table(out, 0x10, AC_LUMA_BITS, AC_LUMA_VALUES, sizeof(AC_LUMA_VALUES));
+        append_huffman_table(out, 0x01, DC_CHROMA_BITS, DC_CHROMA_VALUES, sizeof(DC_CHROMA_VALUES));
+        append_huffman_table(out, 0x11, AC_CHROMA_BITS, AC_CHROMA_VALUES, sizeof(AC_CHROMA_VALUES));
+
+        // SOS
+        append_marker(out, 0xDA, 6 + 2 * 3);
+        const uint8_t scan_header[] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+        out.insert(out.end(), std::begin(scan_header), std::end(scan_header));
+    }
+}
+
+std::vector<uint8_t> imaging::encode_jpeg(const Frame& frame, int quality)
+{
+    const auto luma_table = scale_quantization_table(LUMA_QUANTIZATION, quality);
+    const auto chroma_table = scale_quantization_table(CHROMA_QUANTIZATION, quality);
+    const auto planes = convert_to_planes(frame);
+
+    std::vector<uint8_t> data;
+    data.reserve(1024 + frame.pixels.size() / 4);
+    append_headers(data, frame, luma_table, chroma_table);
+
+    BitWriter writer(data);
+    int previous_dc[3] = { 0, 0, 0 };
+    alignas(16) int16_t block[64];
+    alignas(16) int16_t coefficients[64];
+
+    const unsigned chroma_width = planes.luma_width / 2;
+    for (unsigned y = 0; y != planes.luma_height; y += 16)
+    {
+        for (unsigned x = 0; x != planes.luma_width; x += 16)
+        {
+            // Four luma blocks, then one block of each chroma plane
+            for (unsigned i = 0; i != 4; ++i)
+            {
+                load_block(planes.y, planes.luma_width, x + 8 * (i % 2), y + 8 * (i / 2), block);
+                transform_block(block, luma_table, coefficients);
+                encode_coefficients(writer, coefficients, previous_dc[0], DC_LUMA, AC_LUMA);
+            }
+
+            load_block(planes.cb, chroma_width, x / 2, y / 2, block);
+            transform_block(block, chroma_table, coefficients);
+            encode_coefficients(writer, coefficients, previous_dc[1], DC_CHROMA, AC_CHROMA);
+
+            load_block(planes.cr, chroma_width, x / 2, y / 2, block);
+            transform_block(block, chroma_table, coefficients);
+            encode_coefficients(writer, coefficients, previous_dc[2], DC_CHROMA, AC_CHROMA);
+        }
+    }
+
+    writer.flush();
+    data.push_back(0xFF);
+    data.push_back(0xD9);
+
+    return data;
+}
@@ -0,0 +1,18 @@
+#ifndef JPEG_FORMAT_H
+#define JPEG_FORMAT_H
+
+#include "imaging/frame.h"
+#include <cstdint>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Encodes <paramref name="frame" /> as a baseline JFIF JPEG file (YCbCr 4:2:0, standard Huffman tables).
+    /// <paramref name="quality" /> (1-100) scales the standard quantization tables the way libjpeg does.
+    /// </summary>
+    std::vector<uint8_t> encode_jpeg(const Frame& frame, int quality = 85);
+}
+
+#endif
@@ -0,0 +1,177 @@
+#include "imaging/png-format.h"
+#include "imaging/deflate.h"
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+
+using namespace imaging;
+
+namespace
+{
+    enum Filter : uint8_t { NONE = 0, SUB = 1, UP = 2, AVERAGE = 3, PAETH = 4 };
+
+    const unsigned BYTES_PER_PIXEL = 3;
+
+    std::array<uint32_t, 256> make_crc_table()
+    {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t n = 0; n != 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k != 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+
+        return table;
+    }
+
+    void append_u32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(uint8_t(value >> 24));
+        out.push_back(uint8_t(value >> 16));
+        out.push_back(uint8_t(value >> 8));
+        out.push_back(uint8_t(value));
+    }
+
+    void append_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+    {
+        append_u32(out, uint32_t(size));
+
+        const auto start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+
+        append_u32(out, crc32(out.data() + start, out.size() - start));
+    }
+
+    uint8_t paeth_predictor(int a, int b, int c)
+    {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+
+        if (pa <= pb && pa <= pc) return uint8_t(a);
+        if (pb <= pc) return uint8_t(b);
+        return uint8_t(c);
+    }
+
+    void apply_filter(Filter filter, const uint8_t* row, const uint8_t* previous, uint8_t* target, size_t size)
+    {
+        for (size_t i = 0; i != size; ++i)
+        {
+            const uint8_t left = i >= BYTES_PER_PIXEL ? row[i - BYTES_PER_PIXEL] : 0;
+            const uint8_t up = previous[i];
+            const uint8_t up_left = i >= BYTES_PER_PIXEL ? previous[i - BYTES_PER_PIXEL] : 0;
+
+            switch (filter)
+            {
+            case NONE:    target[i] = row[i]; break;
+            case SUB:     target[i] = uint8_t(row[i] - left); break;
+            case UP:      target[i] = uint8_t(row[i] - up); break;
+            case AVERAGE: target[i] = uint8_t(row[i] - ((left + up) >> 1)); break;
+            case PAETH:   target[i] = uint8_t(row[i] - paeth_predictor(left, up, up_left)); break;
+            }
+        }
+    }
+
+    // Usual heuristic: the filtered row whose bytes, read as signed values, have the smallest absolute sum
+    // tends to compress best.
+    uint64_t filter_cost(const uint8_t* filtered, size_t size)
+    {
+        uint64_t cost = 0;
+        for (size_t i = 0; i != size; ++i) cost += std::abs(int(int8_t(filtered[i])));
+
+        return cost;
+    }
+}
+
+uint32_t imaging::crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+    static const auto table = make_crc_table();
+
+    crc = ~crc;
+    for (size_t i = 0; i != size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+std::vector<uint8_t> imaging::encode_png(const Frame& frame, int level)
+{
+    const size_t row_size = size_t(frame.width) * BYTES_PER_PIXEL;
+
+    // Scanlines as PNG wants them: a filter type byte followed by the filtered RGB bytes
+    std::vector<uint8_t> filtered((row_size + 1) * frame.height);
+    std::vector<uint8_t> row(row_size), previous(row_size, 0), candidate(row_size);
+
+    for (unsigned y = 0; y != frame.height; ++y)
+    {
+        const auto pixels = frame.row(y);
+        for (unsigned x = 0; x != frame.width; ++x)
+        {
+            row[x * 3] = uint8_t(pixels[x] >> 16);
+            row[x * 3 + 1] = uint8_t(pixels[x] >> 8);
+            row[x * 3 + 2] = uint8_t(pixels[x]);
+        }
+
+        auto target = filtered.data() + y * (row_size + 1);
+
+        if (level < 3)
+        {
+            target[0] = UP;
+            apply_filter(UP, row.data(), previous.data(), target + 1, row_size);
+        }
+        else
+        {
+            uint64_t best_cost = UINT64_MAX;
+            for (auto filter : { NONE, SUB, UP, AVERAGE, PAETH })
+            {
+                apply_filter(filter, row.data(), previous.data(), candidate.data(), row_size);
+
+                const auto cost = filter_cost(candidate.data(), row_size);
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    target[0] = filter;
+                    memcpy(target + 1, candidate.data(), row_size);
+                }
+            }
+        }
+
+        std::swap(row, previous);
+    }
+
+    std::vector<uint8_t> out = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    std::vector<uint8_t> header;
+    append_u32(header, frame.width);
+    append_u32(header, frame.height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // color type: RGB
+    header.push_back(0);    // compression: deflate
+    header.push_back(0);    // filter method: adaptive
+    header.push_back(0);    // no interlacing
+    append_chunk(out, "IHDR", header.data(), header.size());
+
+    const auto compressed = zlib_compress(filtered.data(), filtered.size(), level);
+    append_chunk(out, "IDAT", compressed.data(), compressed.size());
+    append_chunk(out, "IEND", nullptr, 0);
+
+    return out;
+}
+
+void imaging::save_as_png(const std::string& path, const Frame& frame, int level)
+{
+    const auto data = encode_png(frame, level);
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
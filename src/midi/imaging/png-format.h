@@ -0,0 +1,28 @@
+#ifndef PNG_FORMAT_H
+#define PNG_FORMAT_H
+
+#include "imaging/frame.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Encodes <paramref name="frame" /> as an 8-bit RGB PNG file.
+    /// <paramref name="level" /> (0-9) is passed on to deflate and also decides how much effort
+    /// goes into choosing a filter per scanline: low levels always use the Up filter,
+    /// which turns repeated rows into runs of zeros, higher levels try all five filters.
+    /// </summary>
+    std::vector<uint8_t> encode_png(const Frame& frame, int level = 6);
+
+    void save_as_png(const std::string& path, const Frame& frame, int level = 6);
+
+    /// <summary>
+    /// CRC-32 as used by PNG chunks.
+    /// </summary>
+    uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "imaging/y4m-format.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define Y4M_USE_SSE2
+#endif
+
+
+using namespace imaging;
+
+namespace
+{
+    // BT.601 limited range, 8 bit fixed point:
+    //   Y = ((  66 R + 129 G +  25 B + 128) >> 8) +  16
+    //   U = (( -38 R -  74 G + 112 B + 128) >> 8) + 128
+    //   V = (( 112 R -  94 G -  18 B + 128) >> 8) + 128
+    // U and V are computed from the sum of a 2x2 block, hence the extra shift by 2.
+    const int LUMA_OFFSET = 128 + (16 << 8);
+    const int CHROMA_OFFSET = 512 + (128 << 10);
+
+    inline int blue(uint32_t pixel) { return pixel & 0xFF; }
+    inline int green(uint32_t pixel) { return (pixel >> 8) & 0xFF; }
+    inline int red(uint32_t pixel) { return (pixel >> 16) & 0xFF; }
+
+    inline uint8_t luma(uint32_t pixel)
+    {
+        return uint8_t((66 * red(pixel) + 129 * green(pixel) + 25 * blue(pixel) + LUMA_OFFSET) >> 8);
+    }
+
+    void convert_luma_row(const uint32_t* row, uint8_t* target, unsigned width)
+    {
+        unsigned x = 0;
+
+#ifdef Y4M_USE_SSE2
+        // Pixels are B, G, R, A bytes: widen them to 16 bit and let madd compute (25 B + 129 G) and (66 R + 0 A),
+        // then add the two halves of each pixel together.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i coefficients = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+        const __m128i offset = _mm_set1_epi32(LUMA_OFFSET);
+
+        auto luma4 = [&](__m128i pixels)
+        {
+            const __m128i low = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients);
+            const __m128i high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients);
+            const __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low), _mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1)));
+
+            return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), offset), 8);
+        };
+
+        for (; x + 8 <= width; x += 8)
+        {
+            const __m128i first = luma4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)));
+            const __m128i second = luma4(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 4)));
+            const __m128i words = _mm_packs_epi32(first, second);
+
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(target + x), _mm_packus_epi16(words, words));
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            target[x] = luma(row[x]);
+        }
+    }
+
+    // Converts one row of chroma samples from two rows of pixels.
+    // The last column (and the last row, through row1 == row0) is duplicated when the size is odd.
+    void convert_chroma_row(const uint32_t* row0, const uint32_t* row1, uint8_t* u, uint8_t* v, unsigned width)
+    {
+        unsigned x = 0;
+
+#ifdef Y4M_USE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i u_coefficients = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+        const __m128i v_coefficients = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+        const __m128i offset = _mm_set1_epi32(CHROMA_OFFSET);
+
+        // 4 pixels of both rows give 2 chroma samples
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x));
+            const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x));
+            const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+            // [B G R A] sums of the first block followed by those of the second block
+            const __m128i blocks = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+
+            const __m128i u_halves = _mm_madd_epi16(blocks, u_coefficients);
+            const __m128i v_halves = _mm_madd_epi16(blocks, v_coefficients);
+            const __m128i even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(u_halves), _mm_castsi128_ps(v_halves), _MM_SHUFFLE(2, 0, 2, 0)));
+            const __m128i odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(u_halves), _mm_castsi128_ps(v_halves), _MM_SHUFFLE(3, 1, 3, 1)));
+
+            // [U0 U1 V0 V1]
+            const __m128i samples = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), offset), 10);
+            const __m128i words = _mm_packs_epi32(samples, samples);
+            const uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(words, words)));
+
+            u[x / 2] = uint8_t(bytes);
+            u[x / 2 + 1] = uint8_t(bytes >> 8);
+            v[x / 2] = uint8_t(bytes >> 16);
+            v[x / 2 + 1] = uint8_t(bytes >> 24);
+        }
+#endif
+
+        for (; x < width; x += 2)
+        {
+            const unsigned next = std::min(x + 1, width - 1);
+            const uint32_t block[] = { row0[x], row0[next], row1[x], row1[next] };
+
+            int r = 0, g = 0, b = 0;
+            for (auto pixel : block)
+            {
+                r += red(pixel);
+                g += green(pixel);
+                b += blue(pixel);
+            }
+
+            u[x / 2] = uint8_t((-38 * r - 74 * g + 112 * b + CHROMA_OFFSET) >> 10);
+            v[x / 2] = uint8_t((112 * r - 94 * g - 18 * b + CHROMA_OFFSET) >> 10);
+        }
+    }
+
+    void convert_band(const Frame& frame, YUV420_IMAGE& image, unsigned first_chroma_row, unsigned last_chroma_row)
+    {
+        for (unsigned cy = first_chroma_row; cy != last_chroma_row; ++cy)
+        {
+            const unsigned y0 = cy * 2;
+            const unsigned y1 = std::min(y0 + 1, frame.height - 1);
+
+            convert_luma_row(frame.row(y0), image.y.data() + size_t(y0) * frame.width, frame.width);
+            if (y1 != y0) convert_luma_row(frame.row(y1), image.y.data() + size_t(y1) * frame.width, frame.width);
+
+            convert_chroma_row(frame.row(y0), frame.row(y1),
+                               image.u.data() + size_t(cy) * image.chroma_width(),
+                               image.v.data() + size_t(cy) * image.chroma_width(),
+                               frame.width);
+        }
+    }
+}
+
+YUV420_IMAGE::YUV420_IMAGE(unsigned width, unsigned height)
+    : width(width), height(height),
+      y(size_t(width) * height),
+      u(size_t((width + 1) / 2) * ((height + 1) / 2)),
+      v(size_t((width + 1) / 2) * ((height + 1) / 2))
+{
+    // NOP
+}
+
+YUV420_IMAGE imaging::convert_to_yuv420(const Frame& frame, unsigned thread_count)
+{
+    YUV420_IMAGE image(frame.width, frame.height);
+    const unsigned chroma_rows = image.chroma_height();
+    const unsigned bands = std::max(1U, std::min(thread_count, chroma_rows));
+
+    // Bands are made of whole chroma rows, so no two threads ever write the same sample.
+    std::vector<std::thread> threads;
+    for (unsigned band = 1; band < bands; ++band)
+    {
+        threads.emplace_back(convert_band, std::cref(frame), std::ref(image), chroma_rows * band / bands, chroma_rows * (band + 1) / bands);
+    }
+
+    convert_band(frame, image, 0, chroma_rows / bands);
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    return image;
+}
+
+std::string imaging::y4m_header(unsigned width, unsigned height, unsigned frames_per_second)
+{
+    std::stringstream header;
+    header << "YUV4MPEG2 W" << width << " H" << height << " F" << frames_per_second << ":1 Ip A1:1 C420jpeg\n";
+
+    return header.str();
+}
+
+std::vector<uint8_t> imaging::encode_y4m_frame(const Frame& frame, unsigned thread_count)
+{
+    static const char marker[] = "FRAME\n";
+    const size_t marker_size = sizeof(marker) - 1;
+
+    const auto image = convert_to_yuv420(frame, thread_count);
+
+    std::vector<uint8_t> data(marker_size + image.y.size() + image.u.size() + image.v.size());
+    auto target = data.data();
+
+    memcpy(target, marker, marker_size);
+    target += marker_size;
+    memcpy(target, image.y.data(), image.y.size());
+    target += image.y.size();
+    memcpy(target, image.u.data(), image.u.size());
+    target += image.u.size();
+    memcpy(target, image.v.data(), image.v.size());
+
+    return data;
+}
@@ -0,0 +1,48 @@
+#ifndef Y4M_FORMAT_H
+#define Y4M_FORMAT_H
+
+#include "imaging/frame.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace imaging
+{
+    /// <summary>
+    /// Planar YUV 4:2:0 image, BT.601 limited range.
+    /// The chroma planes have half the width and height of the luma plane (rounded up),
+    /// each chroma sample is the average of a 2x2 block of pixels.
+    /// </summary>
+    struct YUV420_IMAGE final
+    {
+        unsigned width;
+        unsigned height;
+        std::vector<uint8_t> y;
+        std::vector<uint8_t> u;
+        std::vector<uint8_t> v;
+
+        YUV420_IMAGE(unsigned width, unsigned height);
+
+        unsigned chroma_width() const { return (width + 1) / 2; }
+        unsigned chroma_height() const { return (height + 1) / 2; }
+    };
+
+    /// <summary>
+    /// Converts <paramref name="frame" /> to YUV 4:2:0.
+    /// The rows are split into <paramref name="thread_count" /> bands which are converted in parallel.
+    /// </summary>
+    YUV420_IMAGE convert_to_yuv420(const Frame& frame, unsigned thread_count = 1);
+
+    /// <summary>
+    /// Stream header of a YUV4MPEG2 stream, to be written once before the first frame.
+    /// </summary>
+    std::string y4m_header(unsigned width, unsigned height, unsigned frames_per_second);
+
+    /// <summary>
+    /// Encodes <paramref name="frame" /> as one YUV4MPEG2 frame (FRAME marker followed by the three planes).
+    /// </summary>
+    std::vector<uint8_t> encode_y4m_frame(const Frame& frame, unsigned thread_count = 1);
+}
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "vli.h"
 #include "read.h"
+#include <algorithm>
 
 uint64_t io::read_variable_length_integer(std::istream& istream)
 {
@@ -17,4 +18,48 @@ uint64_t io::read_variable_length_integer(std::istream& istream)
 
         if(byte >> 7U == 0) return result;
     }
-}
\ No newline at end of file
+}
+
+unsigned io::encode_variable_length_integer(uint64_t value, uint8_t* buffer)
+{
+    //count the groups of 7 bits first, so the bytes can be written in order
+    unsigned size = 1;
+    while(size != MAX_VARIABLE_LENGTH_INTEGER_SIZE && (value >> (7U * size)) != 0) ++size;
+
+    for(unsigned i = 0; i != size; ++i)
+    {
+        const auto shift = 7U * (size - 1 - i);
+        const auto continuation = i + 1 == size ? 0U : 128U;
+
+        buffer[i] = static_cast<uint8_t>(((value >> shift) & 127U) | continuation);
+    }
+
+    return size;
+}
+
+unsigned io::decode_variable_length_integer(const uint8_t* data, size_t size, uint64_t* value)
+{
+    const auto limit = static_cast<unsigned>(std::min<size_t>(size, MAX_VARIABLE_LENGTH_INTEGER_SIZE));
+
+    uint64_t result = 0;
+    for(unsigned i = 0; i != limit; ++i)
+    {
+        result = (result << 7U) | (data[i] & 127U);
+
+        if(data[i] >> 7U == 0)
+        {
+            *value = result;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+void io::write_variable_length_integer(std::ostream& ostream, uint64_t value)
+{
+    uint8_t buffer[MAX_VARIABLE_LENGTH_INTEGER_SIZE];
+    auto size = encode_variable_length_integer(value, buffer);
+
+    ostream.write(reinterpret_cast<const char*>(buffer), size);
+}
@@ -5,12 +5,25 @@
 #ifndef MIDI_PROJECT_VLI_H
 #define MIDI_PROJECT_VLI_H
 
+#include <cstddef>
 #include <cstdint>
 #include <istream>
+#include <ostream>
 
 namespace io
 {
     uint64_t read_variable_length_integer(std::istream&);
+
+    //a 64 bit value takes at most 10 bytes
+    const unsigned MAX_VARIABLE_LENGTH_INTEGER_SIZE = 10;
+
+    //writes the bytes of value to buffer, most significant group of 7 bits first, and returns how many were written
+    unsigned encode_variable_length_integer(uint64_t value, uint8_t* buffer);
+
+    //reads a value from the first bytes of data and returns how many were used,
+    //0 when data ends before the last byte or the value is longer than MAX_VARIABLE_LENGTH_INTEGER_SIZE bytes
+    unsigned decode_variable_length_integer(const uint8_t* data, size_t size, uint64_t* value);
+    void write_variable_length_integer(std::ostream&, uint64_t value);
 }
 
 #endif //MIDI_PROJECT_VLI_H
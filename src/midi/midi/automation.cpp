@@ -0,0 +1,99 @@
+#include "automation.h"
+#include <algorithm>
+#include <tuple>
+
+//AUTOMATION LANES
+bool midi::operator <(const LANE_ID& l, const LANE_ID& r)
+{
+    return std::tie(l.channel, l.kind, l.number) < std::tie(r.channel, r.kind, r.number);
+}
+
+midi::LANE_ID midi::controller_lane(Channel channel, uint8_t controller)
+{
+    return LANE_ID{ value(channel), AutomationKind::CONTROLLER, controller };
+}
+
+midi::LANE_ID midi::pitch_wheel_lane(Channel channel)
+{
+    return LANE_ID{ value(channel), AutomationKind::PITCH_WHEEL, 0 };
+}
+
+midi::LANE_ID midi::channel_pressure_lane(Channel channel)
+{
+    return LANE_ID{ value(channel), AutomationKind::CHANNEL_PRESSURE, 0 };
+}
+
+midi::LANE_ID midi::key_pressure_lane(Channel channel, NoteNumber note)
+{
+    return LANE_ID{ value(channel), AutomationKind::KEY_PRESSURE, value(note) };
+}
+
+uint16_t midi::initial_value(AutomationKind kind)
+{
+    return kind == AutomationKind::PITCH_WHEEL ? 0x2000 : 0;
+}
+
+void midi::AutomationLane::add(Time time, uint16_t point_value)
+{
+    if(!points.empty() && time < points.back().time) sorted = false;
+    points.push_back(AUTOMATION_POINT{ time, point_value });
+}
+
+void midi::AutomationLane::compress()
+{
+    //a stable sort keeps the points at the same time in the order they were parsed, so the last one wins
+    if(!sorted) std::stable_sort(points.begin(), points.end(), [](const AUTOMATION_POINT& l, const AUTOMATION_POINT& r) { return l.time < r.time; });
+    sorted = true;
+
+    size_t kept = 0;
+    for(size_t i = 0; i != points.size(); ++i)
+    {
+        if(i + 1 != points.size() && points[i + 1].time == points[i].time) continue;
+
+        const auto before = kept == 0 ? initial : points[kept - 1].value;
+        if(points[i].value != before) points[kept++] = points[i];
+    }
+    points.resize(kept);
+    points.shrink_to_fit();
+}
+
+size_t midi::AutomationLane::index_after(Time time) const
+{
+    const auto after = std::upper_bound(points.begin(), points.end(), time, [](const Time& t, const AUTOMATION_POINT& point) { return t < point.time; });
+    return static_cast<size_t>(after - points.begin());
+}
+
+uint16_t midi::AutomationLane::value_at(Time time) const
+{
+    const auto after = index_after(time);
+    return after == 0 ? initial : points[after - 1].value;
+}
+
+uint16_t midi::AutomationCursor::value_at(Time time)
+{
+    if(time < previous) next = lane.index_after(time);
+    previous = time;
+
+    while(next != lane.size() && !(time < lane[next].time)) ++next;
+    return next == 0 ? lane.initial_value() : lane[next - 1].value;
+}
+
+void midi::Automation::add(const LANE_ID& id, Time time, uint16_t point_value)
+{
+    auto it = lanes.find(id);
+    if(it == lanes.end()) it = lanes.emplace(id, AutomationLane(initial_value(id.kind))).first;
+
+    it->second.add(time, point_value);
+}
+
+void midi::Automation::finish()
+{
+    for(auto& lane : lanes) lane.second.compress();
+}
+
+const midi::AutomationLane* midi::Automation::lane(const LANE_ID& id) const
+{
+    const auto it = lanes.find(id);
+    return it == lanes.end() ? nullptr : &it->second;
+}
+//END AUTOMATION LANES
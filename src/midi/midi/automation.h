@@ -0,0 +1,103 @@
+#ifndef MIDI_PROJECT_AUTOMATION_H
+#define MIDI_PROJECT_AUTOMATION_H
+
+#include "primitives.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace midi
+{
+    //AUTOMATION LANES
+    //the controllers, pitch wheel and pressure of every channel over time, e.g. to draw sustain, expression and bends
+    enum class AutomationKind : uint8_t
+    {
+        CONTROLLER,
+        PITCH_WHEEL,
+        CHANNEL_PRESSURE,
+        KEY_PRESSURE
+    };
+
+    struct LANE_ID
+    {
+        uint8_t channel;
+        AutomationKind kind;
+        uint8_t number;     //the controller, or the note of polyphonic key pressure, 0 otherwise
+    };
+
+    bool operator <(const LANE_ID&, const LANE_ID&);
+
+    LANE_ID controller_lane(Channel channel, uint8_t controller);
+    LANE_ID pitch_wheel_lane(Channel channel);
+    LANE_ID channel_pressure_lane(Channel channel);
+    LANE_ID key_pressure_lane(Channel channel, NoteNumber note);
+
+    //what a lane holds before its first event: the pitch wheel rests in the middle, everything else at 0
+    uint16_t initial_value(AutomationKind kind);
+
+    //from its time on a point holds until the next one
+    struct AUTOMATION_POINT
+    {
+        Time time;
+        uint16_t value;
+    };
+
+    //a step series of the values of one lane
+    //points are added as they are parsed, in file order per track, but every track of a file starts again at 0
+    //compress sorts them by time once all tracks are in, keeps the last of the points at the same time and drops
+    //the points that repeat the value before them
+    class AutomationLane
+    {
+        uint16_t initial;
+        std::vector<AUTOMATION_POINT> points;
+        bool sorted;
+
+    public:
+        explicit AutomationLane(uint16_t initial) : initial(initial), sorted(true) {};
+
+        void add(Time time, uint16_t value);
+        void compress();
+
+        uint16_t initial_value() const { return initial; }
+        size_t size() const { return points.size(); }
+        const AUTOMATION_POINT& operator[](size_t i) const { return points[i]; }
+
+        //the index of the first point after time, a binary search over the points of a compressed lane
+        size_t index_after(Time time) const;
+        uint16_t value_at(Time time) const;
+    };
+
+    //samples a compressed lane at increasing times, e.g. once per frame, in amortized constant time per sample
+    //a time before the previous one falls back to a binary search
+    class AutomationCursor
+    {
+        const AutomationLane& lane;
+        size_t next;        //the first point after the previous time
+        Time previous;
+
+    public:
+        explicit AutomationCursor(const AutomationLane& lane) : lane(lane), next(0), previous(0) {};
+
+        uint16_t value_at(Time time);
+    };
+
+    //the lanes of every channel that has events for them, in channel order
+    class Automation
+    {
+        std::map<LANE_ID, AutomationLane> lanes;
+
+    public:
+        void add(const LANE_ID& id, Time time, uint16_t value);
+
+        //compresses every lane, after the last track
+        void finish();
+
+        //nullptr if the lane has no events
+        const AutomationLane* lane(const LANE_ID& id) const;
+        const std::map<LANE_ID, AutomationLane>& all() const { return lanes; }
+    };
+    //END AUTOMATION LANES
+}
+
+#endif //MIDI_PROJECT_AUTOMATION_H
@@ -0,0 +1,142 @@
+#include "events.h"
+#include "util/trace.h"
+
+//EVENT RECORDS
+uint32_t midi::TRACK_EVENTS::payload_size(const EVENT_RECORD& record) const
+{
+    const auto* size = payload.data() + record.payload;
+    return uint32_t(size[0]) | (uint32_t(size[1]) << 8U) | (uint32_t(size[2]) << 16U) | (uint32_t(size[3]) << 24U);
+}
+
+void midi::EventRecorder::record(Duration dt, EventKind kind, uint8_t channel, uint8_t d1, uint8_t d2)
+{
+    time += value(dt);
+    track.records.push_back(EVENT_RECORD{time, 0, kind, channel, d1, d2});
+}
+
+void midi::EventRecorder::record_payload(Duration dt, EventKind kind, uint8_t type, const uint8_t* data, uint64_t data_size)
+{
+    //the data of an event comes from a chunk, whose size fits in 32 bits
+    const auto offset = static_cast<uint32_t>(track.payload.size());
+    const auto size = static_cast<uint32_t>(data_size);
+    const uint8_t size_bytes[4] = { uint8_t(size), uint8_t(size >> 8U), uint8_t(size >> 16U), uint8_t(size >> 24U) };
+    track.payload.insert(track.payload.end(), size_bytes, size_bytes + 4);
+    track.payload.insert(track.payload.end(), data, data + size);
+
+    time += value(dt);
+    track.records.push_back(EVENT_RECORD{time, offset, kind, type, 0, 0});
+}
+
+void midi::EventRecorder::note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+{
+    record(dt, EventKind::NOTE_ON, value(channel), value(note), velocity);
+}
+
+void midi::EventRecorder::note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+{
+    record(dt, EventKind::NOTE_OFF, value(channel), value(note), velocity);
+}
+
+void midi::EventRecorder::polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure)
+{
+    record(dt, EventKind::POLYPHONIC_KEY_PRESSURE, value(channel), value(note), pressure);
+}
+
+void midi::EventRecorder::control_change(Duration dt, Channel channel, uint8_t controller, uint8_t controller_value)
+{
+    record(dt, EventKind::CONTROL_CHANGE, value(channel), controller, controller_value);
+}
+
+void midi::EventRecorder::program_change(Duration dt, Channel channel, Instrument program)
+{
+    record(dt, EventKind::PROGRAM_CHANGE, value(channel), value(program), 0);
+}
+
+void midi::EventRecorder::channel_pressure(Duration dt, Channel channel, uint8_t pressure)
+{
+    record(dt, EventKind::CHANNEL_PRESSURE, value(channel), pressure, 0);
+}
+
+void midi::EventRecorder::pitch_wheel_change(Duration dt, Channel channel, uint16_t wheel_value)
+{
+    record(dt, EventKind::PITCH_WHEEL_CHANGE, value(channel), static_cast<uint8_t>(wheel_value & 0x7FU), static_cast<uint8_t>(wheel_value >> 7U));
+}
+
+void midi::EventRecorder::meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+{
+    record_payload(dt, EventKind::META, type, data.get(), data_size);
+}
+
+void midi::EventRecorder::sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+{
+    record_payload(dt, EventKind::SYSEX, 0, data.get(), data_size);
+}
+
+midi::PARSE_RESULT midi::decode_events(const uint8_t* data, size_t size, DECODED_EVENTS* events)
+{
+    tracing::Scope scope("decode_events");
+
+    auto result = parse_mthd(data, size, &events->header);
+    if(!result.ok()) return result;
+
+    events->tracks.clear();
+    events->tracks.reserve(events->header.ntracks);
+
+    //the recorder of a track only lives as long as its track is parsed
+    std::unique_ptr<EventRecorder> event_recorder;
+    auto receiver_of = [&](unsigned) -> EventReceiver&
+    {
+        events->tracks.emplace_back();
+        event_recorder = std::make_unique<EventRecorder>(events->tracks.back());
+        return *event_recorder;
+    };
+
+    result = parse_tracks(data, size, result.offset, events->header.ntracks, receiver_of);
+
+    //a track that ended with a problem is not complete
+    if(!result.ok() && !events->tracks.empty()) events->tracks.pop_back();
+    return result;
+}
+
+void midi::collect_notes(const DECODED_EVENTS& events, std::vector<NOTE>* notes)
+{
+    //the rules of ChannelNoteCollector, for the 16 channels at once: a note ends with a note off, a note on with
+    //velocity 0 or a second note on of the same note, notes that are still held carry over to the next track
+    std::vector<NOTE> started_notes[16];
+    const auto first_note = notes->size();
+
+    for(const auto& track : events.tracks)
+    {
+        uint8_t instruments[16] = {};
+
+        for(const auto& record : track.records)
+        {
+            if(record.kind == EventKind::PROGRAM_CHANGE)
+            {
+                instruments[record.channel] = record.d1;
+                continue;
+            }
+            if(record.kind != EventKind::NOTE_ON && record.kind != EventKind::NOTE_OFF) continue;
+
+            auto& started = started_notes[record.channel];
+            const auto note_number = NoteNumber(record.d1);
+            const auto time = Time(record.time);
+
+            const auto found = std::find_if(started.begin(), started.end(), [&](const NOTE& note) { return note.note_number == note_number; });
+            if(found != started.end())
+            {
+                found->duration = calculate_note_duration(found->start, time);
+                notes->push_back(*found);
+                started.erase(found);
+            }
+
+            if(record.kind == EventKind::NOTE_ON && record.d2 != 0)
+            {
+                started.emplace_back(note_number, time, Duration(0), record.d2, Instrument(instruments[record.channel]));
+            }
+        }
+    }
+
+    tracing::count(tracing::Counter::NOTES, notes->size() - first_note);
+}
+//END EVENT RECORDS
@@ -0,0 +1,104 @@
+#ifndef MIDI_PROJECT_EVENTS_H
+#define MIDI_PROJECT_EVENTS_H
+
+#include "midi.h"
+#include "parse.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace midi
+{
+    //EVENT RECORDS
+    //a midi file decoded once into flat arrays, so every consumer (notes, tempo, statistics, ...) walks the same records
+    //in a plain loop instead of parsing the file again through an EventReceiver
+    enum class EventKind : uint8_t
+    {
+        NOTE_OFF,
+        NOTE_ON,
+        POLYPHONIC_KEY_PRESSURE,
+        CONTROL_CHANGE,
+        PROGRAM_CHANGE,
+        CHANNEL_PRESSURE,
+        PITCH_WHEEL_CHANGE,
+        META,
+        SYSEX
+    };
+
+    //16 bytes, four to a cache line
+    struct EVENT_RECORD
+    {
+        uint64_t time;      //absolute, in ticks since the start of the track
+        uint32_t payload;   //meta and sysex events: offset of their data in the payload of the track
+        EventKind kind;
+        uint8_t channel;    //meta events: the meta type
+        uint8_t d1;         //note, controller, program or pressure, pitch wheel changes: the least significant 7 bits
+        uint8_t d2;         //velocity, pressure or value, pitch wheel changes: the most significant 7 bits
+
+        uint16_t pitch_wheel_value() const { return static_cast<uint16_t>((d2 << 7U) | d1); }
+    };
+    static_assert(sizeof(EVENT_RECORD) == 16, "records are meant to be packed four to a cache line");
+
+    //the records of one track in file order, with the data of its meta and sysex events back to back in payload,
+    //each preceded by its size as a 32 bit little endian number
+    struct TRACK_EVENTS
+    {
+        std::vector<EVENT_RECORD> records;
+        std::vector<uint8_t> payload;
+
+        const uint8_t* payload_data(const EVENT_RECORD& record) const { return payload.data() + record.payload + 4; }
+        uint32_t payload_size(const EVENT_RECORD& record) const;
+    };
+
+    struct DECODED_EVENTS
+    {
+        MTHD header;
+        std::vector<TRACK_EVENTS> tracks;
+    };
+
+    //appends the events it receives to a track, the delta times are summed into absolute times as they come
+    struct EventRecorder : EventReceiver
+    {
+        private:
+            TRACK_EVENTS& track;
+            uint64_t time;
+
+            void record(Duration dt, EventKind kind, uint8_t channel, uint8_t d1, uint8_t d2);
+            void record_payload(Duration dt, EventKind kind, uint8_t type, const uint8_t* data, uint64_t data_size);
+
+        public:
+            explicit EventRecorder(TRACK_EVENTS& track) : track(track), time(0) {};
+
+            void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+            void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+            void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+            void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+            void program_change(Duration dt, Channel channel, Instrument program) override;
+            void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+            void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+            void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+            void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+    };
+
+    //decodes every track of a midi file of any type in one pass, events holds the tracks that were complete before a problem
+    PARSE_RESULT decode_events(const uint8_t* data, size_t size, DECODED_EVENTS* events);
+
+    //hands the records of a track to f in runs of at most batch_size: f(const EVENT_RECORD* records, size_t count)
+    template<typename F>
+    void for_each_batch(const TRACK_EVENTS& track, size_t batch_size, F f)
+    {
+        const auto* records = track.records.data();
+        const auto count = track.records.size();
+        for(size_t first = 0; first < count; first += batch_size)
+        {
+            f(records + first, std::min(batch_size, count - first));
+        }
+    }
+
+    //the notes parse_notes finds in the same file, collected by the same rules, added to the end of notes
+    void collect_notes(const DECODED_EVENTS& events, std::vector<NOTE>* notes);
+    //END EVENT RECORDS
+}
+
+#endif //MIDI_PROJECT_EVENTS_H
@@ -0,0 +1,147 @@
+#include "live.h"
+#include <algorithm>
+
+//LIVE DECODER
+void midi::LiveDecoder::feed(const uint8_t* bytes, size_t size, uint64_t time)
+{
+    for(size_t i = 0; i != size; ++i)
+    {
+        const auto byte = bytes[i];
+
+        //system realtime (clock, start, stop, active sensing, ...) leaves everything as it was
+        if(byte >= 0xF8) continue;
+
+        if(byte & 0x80U)
+        {
+            //a status byte ends a system exclusive message, whether it is the end marker or not
+            in_sysex = byte == 0xF0;
+            data_count = 0;
+            skip_count = 0;
+
+            if(byte < 0xF0)
+            {
+                running_status = byte;
+            }
+            else
+            {
+                //system common messages cancel the running status, only song position pointer has two data bytes
+                running_status = 0;
+                if(byte == 0xF1 || byte == 0xF3) skip_count = 1;
+                else if(byte == 0xF2) skip_count = 2;
+            }
+            continue;
+        }
+
+        if(in_sysex) continue;
+        if(skip_count != 0)
+        {
+            --skip_count;
+            continue;
+        }
+        if(running_status == 0) continue;
+
+        data[data_count++] = byte;
+
+        const auto type = extract_midi_event_type(running_status);
+        const unsigned data_size = is_program_change(type) || is_channel_pressure(type) ? 1 : 2;
+        if(data_count == data_size)
+        {
+            const auto dt = time > last_time ? time - last_time : 0;
+            last_time = std::max(last_time, time);
+
+            dispatch(Duration(dt));
+            data_count = 0;
+        }
+    }
+}
+
+void midi::LiveDecoder::dispatch(Duration dt)
+{
+    const auto type = extract_midi_event_type(running_status);
+    const auto channel = extract_midi_event_channel(running_status);
+    ++event_count;
+
+    if(is_note_off(type)) event_receiver.note_off(dt, channel, NoteNumber(data[0]), data[1]);
+    else if(is_note_on(type)) event_receiver.note_on(dt, channel, NoteNumber(data[0]), data[1]);
+    else if(is_polyphonic_key_pressure(type)) event_receiver.polyphonic_key_pressure(dt, channel, NoteNumber(data[0]), data[1]);
+    else if(is_control_change(type)) event_receiver.control_change(dt, channel, data[0], data[1]);
+    else if(is_program_change(type)) event_receiver.program_change(dt, channel, Instrument(data[0]));
+    else if(is_channel_pressure(type)) event_receiver.channel_pressure(dt, channel, data[0]);
+    else event_receiver.pitch_wheel_change(dt, channel, static_cast<uint16_t>((data[1] << 7U) | data[0]));
+}
+//END LIVE DECODER
+
+//LIVE NOTE COLLECTOR
+void midi::LiveNoteCollector::note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+{
+    current_time += dt;
+
+    //a second note on for a key that is down ends the first note, a velocity of 0 is a note off
+    release(channel, note);
+    if(velocity == 0) return;
+
+    held_notes.push_back(HELD_NOTE{channel, NOTE(note, current_time, Duration(0), velocity, instruments[value(channel) & 0x0FU])});
+}
+
+void midi::LiveNoteCollector::note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+{
+    current_time += dt;
+    release(channel, note);
+}
+
+void midi::LiveNoteCollector::polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure)
+{
+    current_time += dt;
+}
+
+void midi::LiveNoteCollector::control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value)
+{
+    current_time += dt;
+}
+
+void midi::LiveNoteCollector::program_change(Duration dt, Channel channel, Instrument program)
+{
+    current_time += dt;
+    instruments[value(channel) & 0x0FU] = program;
+}
+
+void midi::LiveNoteCollector::channel_pressure(Duration dt, Channel channel, uint8_t pressure)
+{
+    current_time += dt;
+}
+
+void midi::LiveNoteCollector::pitch_wheel_change(Duration dt, Channel channel, uint16_t value)
+{
+    current_time += dt;
+}
+
+void midi::LiveNoteCollector::meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+{
+    //a live connection has a single track, an end of track does not start the time over
+    current_time += dt;
+}
+
+void midi::LiveNoteCollector::sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+{
+    current_time += dt;
+}
+
+void midi::LiveNoteCollector::release(Channel channel, NoteNumber note)
+{
+    auto found = std::find_if(held_notes.begin(), held_notes.end(), [&](const HELD_NOTE& held) { return held.channel == channel && held.note.note_number == note; });
+    if(found == held_notes.end()) return;
+
+    found->note.duration = calculate_note_duration(found->note.start, current_time);
+    note_receiver(found->note);
+    held_notes.erase(found);
+}
+
+std::vector<midi::NOTE> midi::LiveNoteCollector::sounding_notes() const
+{
+    std::vector<NOTE> notes;
+    notes.reserve(held_notes.size());
+    for(const auto& held : held_notes) notes.push_back(held.note);
+
+    return notes;
+}
+//END LIVE NOTE COLLECTOR
@@ -0,0 +1,84 @@
+#ifndef MIDI_PROJECT_LIVE_H
+#define MIDI_PROJECT_LIVE_H
+
+#include "midi.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace midi
+{
+    //LIVE DECODER
+    //turns the bytes of a live midi connection (a keyboard, a FIFO, a socket) into events for a receiver
+    //the wire protocol has no delta times, an event happens when it arrives: the receiver gets the microseconds
+    //between the arrival of an event and the one before it (or the origin) as delta time
+    //running status is kept, system realtime bytes can appear anywhere, even inside another message, and are skipped
+    //like system exclusive and system common messages and data bytes without a status
+    struct LiveDecoder
+    {
+        private:
+            EventReceiver& event_receiver;
+            uint64_t last_time;
+            uint8_t running_status;
+            uint8_t data[2];
+            unsigned data_count;
+            unsigned skip_count;    //data bytes of a system common message that are left
+            bool in_sysex;
+            uint64_t event_count;
+
+            void dispatch(Duration dt);
+
+        public:
+            explicit LiveDecoder(EventReceiver& event_receiver, uint64_t origin = 0)
+                : event_receiver(event_receiver), last_time(origin), running_status(0), data{0, 0}, data_count(0), skip_count(0), in_sysex(false), event_count(0) {};
+
+            //time is when the bytes arrived, in microseconds, it never goes back
+            void feed(const uint8_t* bytes, size_t size, uint64_t time);
+
+            uint64_t events() const { return event_count; }
+    };
+    //END LIVE DECODER
+
+    //LIVE NOTE COLLECTOR
+    //collects the notes of all channels by the rules of ChannelNoteCollector, but also knows the notes that are still
+    //sounding, since during a performance the end of a note is only known once it is released
+    struct LiveNoteCollector : EventReceiver
+    {
+        private:
+            struct HELD_NOTE
+            {
+                Channel channel;
+                NOTE note;
+            };
+
+            Time current_time;
+            Instrument instruments[16];
+            std::vector<HELD_NOTE> held_notes;
+            std::function<void(const NOTE&)> note_receiver;
+
+            void release(Channel channel, NoteNumber note);
+
+        public:
+            explicit LiveNoteCollector(std::function<void(const NOTE&)> note_receiver)
+                : current_time(0), instruments{}, held_notes(), note_receiver(std::move(note_receiver)) {};
+
+            void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+            void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+            void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+            void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+            void program_change(Duration dt, Channel channel, Instrument program) override;
+            void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+            void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+            void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+            void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+
+            Time time() const { return current_time; }
+
+            //the notes that were started but not released yet, with a duration of 0
+            std::vector<NOTE> sounding_notes() const;
+    };
+    //END LIVE NOTE COLLECTOR
+}
+
+#endif //MIDI_PROJECT_LIVE_H
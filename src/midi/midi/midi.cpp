@@ -5,7 +5,7 @@
 #include "midi.h"
 #include "io/read.h"
 #include "io/endianness.h"
-#include "io/vli.h"
+#include "parse.h"
 #include <string>
 
 //CHUNK_HEADER
@@ -24,11 +24,14 @@ std::string midi::header_id(const midi::CHUNK_HEADER& chunk_header)
 //MTHD
 void midi::read_mthd(std::istream& istream, midi::MTHD* mthd)
 {
-    io::read_to(istream,mthd);
-    io::switch_endianness(&mthd->header.size);
-    io::switch_endianness(&mthd->type);
-    io::switch_endianness(&mthd->ntracks);
-    io::switch_endianness(&mthd->division);
+    uint8_t data[sizeof(MTHD)];
+    io::read_to(istream,data,sizeof(data));
+
+    const auto result = parse_mthd_fields(data,sizeof(data),mthd);
+    CHECK(result.ok()) << "Invalid MThd at byte " << result.offset << ": " << describe(result.status);
+
+    //fields added by later versions of the format
+    istream.ignore(mthd->header.size - 6);
 }
 //END MTHD
 
@@ -119,101 +122,8 @@ bool midi::is_end_of_track_event(uint8_t meta_event_type)
 
 void midi::read_mtrk(std::istream& istream, midi::EventReceiver& event_receiver)
 {
-    //read mtrk header
-    midi::CHUNK_HEADER mtrk_header;
-    io::read_to(istream,&mtrk_header);
-    io::switch_endianness(&mtrk_header.size);
-
-    //sanity check
-    CHECK(header_id(mtrk_header) == "MTrk") << "Not a valid mtrk";
-
-    bool end_of_track_reached = false;
-    uint8_t id(0);
-    while(!end_of_track_reached)
-    {
-        //get delta time
-        auto dt = io::read_variable_length_integer(istream);
-
-        //get possible event identifier also called status when midi event, if the status is running the status is omitted
-        if(!is_running_status(istream.peek())) id = io::read<uint8_t >(istream);
-
-        if(is_meta_event(id))
-        {
-            auto type = io::read<uint8_t>(istream);
-            auto length = io::read_variable_length_integer(istream);
-            auto data = io::read_array<uint8_t >(istream,length);
-
-            event_receiver.meta(midi::Duration(dt),type,std::move(data),length);
-            if(is_end_of_track_event(type)) end_of_track_reached = true;
-        }
-        else if(is_sysex_event(id))
-        {
-            auto length = io::read_variable_length_integer(istream);
-            auto data = io::read_array<uint8_t >(istream,length);
-
-            event_receiver.sysex(midi::Duration(dt),std::move(data),length);
-        }
-        else if(is_midi_event(id))
-        {
-            auto midi_event_type = extract_midi_event_type(id);
-            auto midi_event_channel = extract_midi_event_channel(id);
-
-            if(is_note_off(midi_event_type))
-            {
-                auto note = midi::NoteNumber(io::read<uint8_t >(istream));
-                auto velocity = io::read<uint8_t >(istream);
-
-                event_receiver.note_off(midi::Duration(dt),midi_event_channel,note,velocity);
-            }
-            else if(is_note_on(midi_event_type))
-            {
-                auto note = midi::NoteNumber(io::read<uint8_t >(istream));
-                auto velocity = io::read<uint8_t >(istream);
-
-                event_receiver.note_on(midi::Duration(dt),midi_event_channel,note,velocity);
-            }
-            else if(is_polyphonic_key_pressure(midi_event_type))
-            {
-                auto note = midi::NoteNumber(io::read<uint8_t >(istream));
-                auto pressure = io::read<uint8_t >(istream);
-
-                event_receiver.polyphonic_key_pressure(midi::Duration(dt),midi_event_channel,note,pressure);
-            }
-            else if(is_control_change(midi_event_type))
-            {
-                auto controller = io::read<uint8_t >(istream);
-                auto value = io::read<uint8_t >(istream);
-
-                event_receiver.control_change(midi::Duration(dt),midi_event_channel,controller,value);
-            }
-            else if(is_program_change(midi_event_type))
-            {
-                auto program = midi::Instrument(io::read<uint8_t >(istream));
-
-                event_receiver.program_change(midi::Duration(dt),midi_event_channel,program);
-            }
-            else if(is_channel_pressure(midi_event_type))
-            {
-                auto pressure = io::read<uint8_t >(istream);
-
-                event_receiver.channel_pressure(midi::Duration(dt),midi_event_channel,pressure);
-            }
-            else if(is_pitch_wheel_change(midi_event_type))
-            {
-                //our value is 14055 or 0b11011011100111
-                auto lower_bits = io::read<uint8_t>(istream); //we have 01100111
-                auto upper_bits = io::read<uint8_t>(istream); //we have 01101101
-
-                //16 bits 000000000 00000000
-                uint16_t position = upper_bits << 7u; //shift upper bits 7 times to the right => 00110110 10000000
-                position = position | lower_bits; //bitwise or operator with the lower bits
-                //00110110 10000000 OR
-                //00000000 01100111 => 00110110 11100111, we have our value!
-
-                event_receiver.pitch_wheel_change(midi::Duration(dt),midi_event_channel, position);
-            }
-        }
-    }
+    const auto result = parse_mtrk(istream,event_receiver);
+    CHECK(result.ok()) << "Invalid MTrk at byte " << result.offset << ": " << describe(result.status);
 }
 //END MTRK
 
@@ -287,11 +197,17 @@ void midi::ChannelNoteCollector::note_off(midi::Duration dt, midi::Channel chann
 void midi::ChannelNoteCollector::polyphonic_key_pressure(midi::Duration dt, midi::Channel channel, midi::NoteNumber note, uint8_t pressure)
 {
     increase_current_time(dt);
+    if(channel != current_channel || automation == nullptr) return;
+
+    automation->add(key_pressure_lane(channel, note), current_time, pressure);
 }
 
 void midi::ChannelNoteCollector::control_change(midi::Duration dt, midi::Channel channel, uint8_t controller, uint8_t value)
 {
     increase_current_time(dt);
+    if(channel != current_channel || automation == nullptr) return;
+
+    automation->add(controller_lane(channel, controller), current_time, value);
 }
 
 void midi::ChannelNoteCollector::program_change(midi::Duration dt, midi::Channel channel, midi::Instrument program)
@@ -305,11 +221,17 @@ void midi::ChannelNoteCollector::program_change(midi::Duration dt, midi::Channel
 void midi::ChannelNoteCollector::channel_pressure(midi::Duration dt, midi::Channel channel, uint8_t pressure)
 {
     increase_current_time(dt);
+    if(channel != current_channel || automation == nullptr) return;
+
+    automation->add(channel_pressure_lane(channel), current_time, pressure);
 }
 
 void midi::ChannelNoteCollector::pitch_wheel_change(midi::Duration dt, midi::Channel channel, uint16_t value)
 {
     increase_current_time(dt);
+    if(channel != current_channel || automation == nullptr) return;
+
+    automation->add(pitch_wheel_lane(channel), current_time, value);
 }
 
 void midi::ChannelNoteCollector::meta(midi::Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
@@ -425,12 +347,12 @@ void midi::EventMulticaster::add_event_receiver(const std::shared_ptr<EventRecei
 //END EVENT MULTICASTER
 
 //NOTE COLLECTOR
-midi::NoteCollector::NoteCollector(std::function<void(const midi::NOTE &)> function)
+midi::NoteCollector::NoteCollector(std::function<void(const midi::NOTE &)> function, Automation* automation)
         : event_multicaster(midi::EventMulticaster(std::vector<std::shared_ptr<midi::EventReceiver>>()))
 {
     for(int i=0; i!=16; ++i)
     {
-        auto note_channel_collector = std::make_shared<ChannelNoteCollector>(Channel(i),function);
+        auto note_channel_collector = std::make_shared<ChannelNoteCollector>(Channel(i),function,automation);
         event_multicaster.add_event_receiver(note_channel_collector);
     }
 }
@@ -485,20 +407,8 @@ std::vector<midi::NOTE> midi::read_notes(std::istream& istream)
 {
     std::vector<NOTE> notes;
 
-    //read mthd
-    MTHD mthd;
-    read_mthd(istream,&mthd);
-
-    CHECK(mthd.type != 2) << "MTHD with type 2 is not supported";
-
-    //our event receiver
-    NoteCollector noteCollector([&notes](const midi::NOTE& note) { notes.push_back(note); });
-
-    //read mtrk's
-    for(int i=0;i<mthd.ntracks;++i)
-    {
-        read_mtrk(istream,noteCollector);
-    }
+    const auto result = parse_notes(istream,&notes);
+    CHECK(result.ok()) << "Invalid midi file at byte " << result.offset << ": " << describe(result.status);
 
     return notes;
 }
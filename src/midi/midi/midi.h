@@ -5,6 +5,7 @@
 #ifndef MIDI_PROJECT_MIDI_H
 #define MIDI_PROJECT_MIDI_H
 
+#include "automation.h"
 #include "primitives.h"
 #include <cstdint>
 #include <istream>
@@ -103,14 +104,16 @@ namespace midi
             Instrument current_instrument;
             std::vector<NOTE> started_notes;
             std::function<void(const NOTE&)> note_receiver;
+            Automation* automation;
 
             void increase_current_time(const Duration& duration);
             void save_note_on(const NOTE& note_on);
             void new_track();
 
         public:
-            ChannelNoteCollector(const Channel& current_channel, std::function<void(const NOTE&)> note_receiver)
-                : current_channel(current_channel), note_receiver(std::move(note_receiver)), current_time(0), started_notes(), current_instrument(0){};
+            //with an automation, the controllers, pitch wheel and pressure of the channel go to its lanes as well
+            ChannelNoteCollector(const Channel& current_channel, std::function<void(const NOTE&)> note_receiver, Automation* automation = nullptr)
+                : current_channel(current_channel), current_time(0), current_instrument(0), started_notes(), note_receiver(std::move(note_receiver)), automation(automation){};
 
             void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
             void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
@@ -154,7 +157,8 @@ namespace midi
             EventMulticaster event_multicaster;
 
         public:
-            explicit NoteCollector(std::function<void(const NOTE&)>);
+            //the lanes in automation are only compressed by its finish, after the last track
+            explicit NoteCollector(std::function<void(const NOTE&)>, Automation* automation = nullptr);
 
             void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
             void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
@@ -168,6 +172,7 @@ namespace midi
     };
     //END NOTE COLLECTOR
 
+    //read_mthd, read_mtrk and read_notes stop the program on malformed data, parse.h has versions that report it instead
     std::vector<NOTE> read_notes(std::istream&);
 }
 
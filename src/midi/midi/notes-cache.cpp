@@ -0,0 +1,288 @@
+#include "notes-cache.h"
+#include "util/hash.h"
+#include "logging.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char NOTES_FILE_MAGIC[4] = {'M', 'N', 'O', 'T'};
+
+    //the columns are used in place, which only works when the host reads little endian words the same way
+    bool host_is_little_endian()
+    {
+        const uint16_t one = 1;
+        uint8_t first;
+        memcpy(&first, &one, 1);
+
+        return first == 1;
+    }
+
+    void put_little_endian(uint8_t* data, uint64_t value, unsigned size)
+    {
+        for(unsigned i = 0; i != size; ++i) data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    uint64_t get_little_endian(const uint8_t* data, unsigned size)
+    {
+        uint64_t value = 0;
+        for(unsigned i = 0; i != size; ++i) value |= uint64_t(data[i]) << (8 * i);
+        return value;
+    }
+
+    uint64_t notes_file_size(uint64_t note_count)
+    {
+        return midi::NOTES_FILE_HEADER_SIZE + note_count * (2 * sizeof(uint64_t) + 3);
+    }
+}
+
+//NOTES FILE
+void midi::write_notes_file(std::ostream& out, uint64_t source_hash, uint64_t source_size, const std::vector<NOTE>& notes)
+{
+    const uint64_t count = notes.size();
+    std::vector<uint8_t> buffer(notes_file_size(count));
+
+    auto* starts = buffer.data() + NOTES_FILE_HEADER_SIZE;
+    auto* durations = starts + count * sizeof(uint64_t);
+    auto* note_numbers = durations + count * sizeof(uint64_t);
+    auto* velocities = note_numbers + count;
+    auto* instruments = velocities + count;
+
+    for(uint64_t i = 0; i != count; ++i)
+    {
+        put_little_endian(starts + i * sizeof(uint64_t), value(notes[i].start), sizeof(uint64_t));
+        put_little_endian(durations + i * sizeof(uint64_t), value(notes[i].duration), sizeof(uint64_t));
+        note_numbers[i] = value(notes[i].note_number);
+        velocities[i] = notes[i].velocity;
+        instruments[i] = value(notes[i].instrument);
+    }
+
+    memcpy(buffer.data(), NOTES_FILE_MAGIC, 4);
+    put_little_endian(buffer.data() + 4, NOTES_FILE_VERSION, 4);
+    put_little_endian(buffer.data() + 8, source_hash, 8);
+    put_little_endian(buffer.data() + 16, source_size, 8);
+    put_little_endian(buffer.data() + 24, count, 8);
+    put_little_endian(buffer.data() + 32, hashing::hash_bytes(starts, buffer.size() - NOTES_FILE_HEADER_SIZE), 8);
+
+    out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+}
+
+midi::MappedNotes::MappedNotes(const std::string& path, uint64_t source_hash, uint64_t source_size)
+    : data(nullptr), size(0), note_count(0)
+{
+    if(!host_is_little_endian()) return;
+
+    const int fd = open(path.c_str(), O_RDONLY);
+    if(fd == -1) return;
+
+    struct stat status{};
+    void* mapping = MAP_FAILED;
+    if(fstat(fd, &status) == 0 && status.st_size >= static_cast<off_t>(NOTES_FILE_HEADER_SIZE))
+    {
+        mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if(mapping == MAP_FAILED) return;
+
+    const auto* bytes = static_cast<const uint8_t*>(mapping);
+    const auto file_size = static_cast<size_t>(status.st_size);
+    const auto count = get_little_endian(bytes + 24, 8);
+
+    //the hash of the columns catches files that were damaged after they were written
+    const bool matches = memcmp(bytes, NOTES_FILE_MAGIC, 4) == 0
+            && get_little_endian(bytes + 4, 4) == NOTES_FILE_VERSION
+            && get_little_endian(bytes + 8, 8) == source_hash
+            && get_little_endian(bytes + 16, 8) == source_size
+            && count <= file_size && notes_file_size(count) == file_size
+            && get_little_endian(bytes + 32, 8) == hashing::hash_bytes(bytes + NOTES_FILE_HEADER_SIZE, file_size - NOTES_FILE_HEADER_SIZE);
+
+    if(!matches)
+    {
+        munmap(mapping, file_size);
+        return;
+    }
+
+    data = bytes;
+    size = file_size;
+    note_count = count;
+}
+
+midi::MappedNotes::~MappedNotes()
+{
+    if(data != nullptr) munmap(const_cast<uint8_t*>(data), size);
+}
+
+const uint64_t* midi::MappedNotes::starts() const
+{
+    return reinterpret_cast<const uint64_t*>(data + NOTES_FILE_HEADER_SIZE);
+}
+
+const uint64_t* midi::MappedNotes::durations() const
+{
+    return starts() + note_count;
+}
+
+const uint8_t* midi::MappedNotes::note_numbers() const
+{
+    return reinterpret_cast<const uint8_t*>(durations() + note_count);
+}
+
+const uint8_t* midi::MappedNotes::velocities() const
+{
+    return note_numbers() + note_count;
+}
+
+const uint8_t* midi::MappedNotes::instruments() const
+{
+    return velocities() + note_count;
+}
+
+std::vector<midi::NOTE> midi::MappedNotes::notes() const
+{
+    std::vector<NOTE> notes;
+    notes.reserve(note_count);
+
+    const auto* start = starts();
+    const auto* duration = durations();
+    const auto* note_number = note_numbers();
+    const auto* velocity = velocities();
+    const auto* instrument = instruments();
+    for(uint64_t i = 0; i != note_count; ++i)
+    {
+        notes.emplace_back(NoteNumber(note_number[i]), Time(start[i]), Duration(duration[i]), velocity[i], Instrument(instrument[i]));
+    }
+
+    return notes;
+}
+//END NOTES FILE
+
+//NOTES CACHE
+midi::NotesCache::NotesCache(const std::string& directory, uint64_t max_bytes) : directory(directory), max_bytes(max_bytes)
+{
+    std::filesystem::create_directories(directory);
+}
+
+std::string midi::NotesCache::path_of(uint64_t source_hash) const
+{
+    std::stringstream name;
+    name << std::hex << std::setfill('0') << std::setw(16) << source_hash << ".notes";
+
+    return (std::filesystem::path(directory) / name.str()).string();
+}
+
+midi::PARSE_RESULT midi::NotesCache::read_notes(const uint8_t* data, size_t size, std::vector<NOTE>* notes, bool* hit)
+{
+    const auto source_hash = hashing::hash_bytes(data, size);
+    const auto path = path_of(source_hash);
+
+    {
+        const MappedNotes mapped_notes(path, source_hash, size);
+        if(mapped_notes.valid())
+        {
+            //the modification time doubles as the time of last use
+            std::error_code error;
+            std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+            const auto loaded = mapped_notes.notes();
+            notes->insert(notes->end(), loaded.begin(), loaded.end());
+            if(hit != nullptr) *hit = true;
+            return PARSE_RESULT{ParseStatus::OK, size};
+        }
+    }
+
+    if(hit != nullptr) *hit = false;
+    std::vector<NOTE> parsed;
+    const auto result = parse_notes(data, size, &parsed);
+    if(result.ok() && host_is_little_endian())
+    {
+        store(path, source_hash, size, parsed);
+        evict();
+    }
+    notes->insert(notes->end(), parsed.begin(), parsed.end());
+
+    return result;
+}
+
+void midi::NotesCache::store(const std::string& path, uint64_t source_hash, uint64_t source_size, const std::vector<NOTE>& notes)
+{
+    //written next to its final name and renamed, so a reader never maps a file that is only partly written
+    static std::atomic<unsigned> counter{0};
+    const auto temporary_path = path + ".tmp-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+
+    {
+        std::ofstream out(temporary_path, std::ios_base::binary);
+        if(!out.is_open()) return;
+
+        write_notes_file(out, source_hash, source_size, notes);
+        if(!out.good())
+        {
+            out.close();
+            std::remove(temporary_path.c_str());
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if(error) std::filesystem::remove(temporary_path, error);
+}
+
+void midi::NotesCache::evict()
+{
+    std::lock_guard<std::mutex> lock(eviction_mutex);
+
+    struct ENTRY
+    {
+        std::filesystem::file_time_type last_used;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+
+    std::vector<ENTRY> entries;
+    uint64_t total = 0;
+    std::error_code error;
+    for(const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if(entry.path().extension() != ".notes") continue;
+
+        //another process may have removed the file in the meantime
+        std::error_code entry_error;
+        const auto size = entry.file_size(entry_error);
+        const auto last_used = entry.last_write_time(entry_error);
+        if(entry_error) continue;
+
+        entries.push_back(ENTRY{last_used, size, entry.path()});
+        total += size;
+    }
+    if(total <= max_bytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const ENTRY& l, const ENTRY& r) { return l.last_used < r.last_used; });
+    for(const auto& entry : entries)
+    {
+        if(total <= max_bytes) break;
+
+        std::filesystem::remove(entry.path, error);
+        total -= entry.size;
+    }
+}
+
+std::vector<midi::NOTE> midi::read_notes(std::istream& istream, NotesCache& cache)
+{
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(istream)), std::istreambuf_iterator<char>());
+    std::vector<NOTE> notes;
+
+    const auto result = cache.read_notes(data.data(), data.size(), &notes);
+    CHECK(result.ok()) << "Invalid midi file at byte " << result.offset << ": " << describe(result.status);
+
+    return notes;
+}
+//END NOTES CACHE
@@ -0,0 +1,85 @@
+#ifndef MIDI_PROJECT_NOTES_CACHE_H
+#define MIDI_PROJECT_NOTES_CACHE_H
+
+#include "midi.h"
+#include "parse.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace midi
+{
+    //NOTES FILE
+    //the notes of one midi file, column after column so they can be used straight from a mapping:
+    //  header   "MNOT", version (u32), hash and size of the midi file (u64), note count (u64), hash of the columns (u64)
+    //  columns  starts, durations (u64), note numbers, velocities, instruments (u8)
+    //everything is little endian, a file with another version is treated as missing and replaced
+    const uint32_t NOTES_FILE_VERSION = 1;
+    const size_t NOTES_FILE_HEADER_SIZE = 40;
+
+    void write_notes_file(std::ostream&, uint64_t source_hash, uint64_t source_size, const std::vector<NOTE>& notes);
+
+    //a notes file mapped into memory, the columns stay valid as long as the object lives
+    class MappedNotes
+    {
+        const uint8_t* data;
+        size_t size;
+        uint64_t note_count;
+
+    public:
+        //valid() is false when the file cannot be read, is damaged or belongs to another midi file
+        MappedNotes(const std::string& path, uint64_t source_hash, uint64_t source_size);
+        ~MappedNotes();
+
+        MappedNotes(const MappedNotes&) = delete;
+        MappedNotes& operator =(const MappedNotes&) = delete;
+
+        bool valid() const { return data != nullptr; }
+        uint64_t count() const { return note_count; }
+
+        const uint64_t* starts() const;
+        const uint64_t* durations() const;
+        const uint8_t* note_numbers() const;
+        const uint8_t* velocities() const;
+        const uint8_t* instruments() const;
+
+        std::vector<NOTE> notes() const;
+    };
+    //END NOTES FILE
+
+    //NOTES CACHE
+    //a directory of notes files named after the hash of their midi file, so a midi file is found again whatever its name
+    //once the files take up more than max_bytes, the least recently used ones are removed
+    //several threads and processes can share a cache directory, files are only ever replaced as a whole
+    class NotesCache
+    {
+        std::string directory;
+        uint64_t max_bytes;
+        std::mutex eviction_mutex;
+
+        void store(const std::string& path, uint64_t source_hash, uint64_t source_size, const std::vector<NOTE>& notes);
+
+    public:
+        NotesCache(const std::string& directory, uint64_t max_bytes);
+
+        std::string path_of(uint64_t source_hash) const;
+
+        //the notes of the midi file in data, loaded from the cache when it has them, otherwise parsed and stored
+        //like parse_notes the notes are added to the end of notes, hit tells which of both happened
+        //a file that does not parse is never stored
+        PARSE_RESULT read_notes(const uint8_t* data, size_t size, std::vector<NOTE>* notes, bool* hit = nullptr);
+
+        //removes the least recently used files until the rest fit in max_bytes
+        void evict();
+    };
+
+    //like read_notes(std::istream&), through the cache
+    std::vector<NOTE> read_notes(std::istream&, NotesCache&);
+    //END NOTES CACHE
+}
+
+#endif //MIDI_PROJECT_NOTES_CACHE_H
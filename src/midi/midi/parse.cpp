@@ -0,0 +1,531 @@
+#include "parse.h"
+#include "io/vli.h"
+#include "util/trace.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    using midi::ParseStatus;
+    using midi::PARSE_RESULT;
+
+    const size_t CHUNK_HEADER_SIZE = 8;
+
+    uint32_t big_endian_32(const uint8_t* data)
+    {
+        return (uint32_t(data[0]) << 24U) | (uint32_t(data[1]) << 16U) | (uint32_t(data[2]) << 8U) | uint32_t(data[3]);
+    }
+
+    uint16_t big_endian_16(const uint8_t* data)
+    {
+        return static_cast<uint16_t>((data[0] << 8U) | data[1]);
+    }
+
+    //reads the events of a chunk front to back, every read is preceded by a check of what is left,
+    //which is almost never taken on valid data and thus predicted well
+    class Cursor
+    {
+        const uint8_t* begin;
+        const uint8_t* position;
+        const uint8_t* end;
+
+    public:
+        Cursor(const uint8_t* data, size_t size, size_t offset) : begin(data), position(data + offset), end(data + size) {};
+
+        size_t remaining() const { return static_cast<size_t>(end - position); }
+        uint64_t offset() const { return static_cast<uint64_t>(position - begin); }
+        uint8_t peek() const { return *position; }
+        uint8_t next() { return *position++; }
+
+        const uint8_t* take(size_t size)
+        {
+            const auto result = position;
+            position += size;
+            return result;
+        }
+
+        ParseStatus variable_length_integer(uint64_t* value)
+        {
+            const auto size = io::decode_variable_length_integer(position, remaining(), value);
+            if(size == 0) return remaining() < io::MAX_VARIABLE_LENGTH_INTEGER_SIZE ? ParseStatus::TRUNCATED : ParseStatus::VARIABLE_LENGTH_INTEGER_TOO_LONG;
+
+            position += size;
+            return ParseStatus::OK;
+        }
+    };
+
+    //the data of a meta or sysex event, preceded by its length
+    ParseStatus read_data(Cursor& cursor, std::unique_ptr<uint8_t[]>* data, uint64_t* length)
+    {
+        const auto status = cursor.variable_length_integer(length);
+        if(status != ParseStatus::OK) return status;
+        if(*length > cursor.remaining()) return ParseStatus::TRUNCATED;
+
+        *data = std::make_unique<uint8_t[]>(*length);
+        std::memcpy(data->get(), cursor.take(*length), *length);
+        return ParseStatus::OK;
+    }
+
+    PARSE_RESULT failure(ParseStatus status, uint64_t offset)
+    {
+        return PARSE_RESULT{status, offset};
+    }
+
+    //the events from offset on up to and including the end of track, which gives the offset right after it,
+    //or the problem with the offset of the event it is in
+    //an event only reaches the receiver once all of its bytes are there, so after TRUNCATED parsing can resume
+    //at the returned offset when more data is available, with running_status as it was left
+    //meta and sysex events leave the running status of the midi events as it was
+    PARSE_RESULT parse_events(const uint8_t* data, size_t size, size_t offset, uint8_t* running_status, midi::EventReceiver& event_receiver)
+    {
+        using namespace midi;
+
+        Cursor cursor(data, size, offset);
+        while(true)
+        {
+            const auto event_offset = cursor.offset();
+
+            uint64_t dt;
+            const auto dt_status = cursor.variable_length_integer(&dt);
+            if(dt_status != ParseStatus::OK) return failure(dt_status, event_offset);
+            if(cursor.remaining() == 0) return failure(ParseStatus::TRUNCATED, event_offset);
+
+            const auto status_offset = cursor.offset();
+            uint8_t id = *running_status;
+            if(!is_running_status(cursor.peek())) id = cursor.next();
+            else if(id == 0) return failure(ParseStatus::NO_RUNNING_STATUS, status_offset);
+
+            if(is_meta_event(id))
+            {
+                if(cursor.remaining() == 0) return failure(ParseStatus::TRUNCATED, event_offset);
+                const auto type = cursor.next();
+
+                std::unique_ptr<uint8_t[]> event_data;
+                uint64_t length;
+                const auto status = read_data(cursor, &event_data, &length);
+                if(status != ParseStatus::OK) return failure(status, event_offset);
+
+                tracing::count(tracing::Counter::META_EVENTS);
+                event_receiver.meta(Duration(dt), type, std::move(event_data), length);
+
+                if(is_end_of_track_event(type)) return PARSE_RESULT{ParseStatus::OK, cursor.offset()};
+            }
+            else if(is_sysex_event(id))
+            {
+                std::unique_ptr<uint8_t[]> event_data;
+                uint64_t length;
+                const auto status = read_data(cursor, &event_data, &length);
+                if(status != ParseStatus::OK) return failure(status, event_offset);
+
+                tracing::count(tracing::Counter::SYSEX_EVENTS);
+                event_receiver.sysex(Duration(dt), std::move(event_data), length);
+            }
+            else if(is_midi_event(id))
+            {
+                const auto type = extract_midi_event_type(id);
+                const auto channel = extract_midi_event_channel(id);
+
+                //program changes and channel pressure have a single data byte, the others two
+                const size_t data_size = is_program_change(type) || is_channel_pressure(type) ? 1 : 2;
+                if(cursor.remaining() < data_size) return failure(ParseStatus::TRUNCATED, event_offset);
+                const auto event_data = cursor.take(data_size);
+                *running_status = id;
+
+                if(is_note_off(type))
+                {
+                    tracing::count(tracing::Counter::NOTE_OFF_EVENTS);
+                    event_receiver.note_off(Duration(dt), channel, NoteNumber(event_data[0]), event_data[1]);
+                }
+                else if(is_note_on(type))
+                {
+                    tracing::count(tracing::Counter::NOTE_ON_EVENTS);
+                    event_receiver.note_on(Duration(dt), channel, NoteNumber(event_data[0]), event_data[1]);
+                }
+                else if(is_polyphonic_key_pressure(type))
+                {
+                    tracing::count(tracing::Counter::POLYPHONIC_KEY_PRESSURE_EVENTS);
+                    event_receiver.polyphonic_key_pressure(Duration(dt), channel, NoteNumber(event_data[0]), event_data[1]);
+                }
+                else if(is_control_change(type))
+                {
+                    tracing::count(tracing::Counter::CONTROL_CHANGE_EVENTS);
+                    event_receiver.control_change(Duration(dt), channel, event_data[0], event_data[1]);
+                }
+                else if(is_program_change(type))
+                {
+                    tracing::count(tracing::Counter::PROGRAM_CHANGE_EVENTS);
+                    event_receiver.program_change(Duration(dt), channel, Instrument(event_data[0]));
+                }
+                else if(is_channel_pressure(type))
+                {
+                    tracing::count(tracing::Counter::CHANNEL_PRESSURE_EVENTS);
+                    event_receiver.channel_pressure(Duration(dt), channel, event_data[0]);
+                }
+                else
+                {
+                    //14 bits, least significant 7 first
+                    tracing::count(tracing::Counter::PITCH_WHEEL_CHANGE_EVENTS);
+                    event_receiver.pitch_wheel_change(Duration(dt), channel, static_cast<uint16_t>((event_data[1] << 7U) | event_data[0]));
+                }
+            }
+            else
+            {
+                return failure(ParseStatus::UNKNOWN_EVENT, status_offset);
+            }
+        }
+    }
+}
+
+const char* midi::describe(ParseStatus status)
+{
+    switch(status)
+    {
+        case ParseStatus::OK: return "no problem";
+        case ParseStatus::TRUNCATED: return "the data ends too early";
+        case ParseStatus::BAD_CHUNK_ID: return "unexpected chunk id";
+        case ParseStatus::BAD_HEADER_SIZE: return "the MThd chunk is too short";
+        case ParseStatus::UNSUPPORTED_FORMAT: return "a type 2 file holds independent sequences instead of one list of notes";
+        case ParseStatus::VARIABLE_LENGTH_INTEGER_TOO_LONG: return "variable length integer too long";
+        case ParseStatus::NO_RUNNING_STATUS: return "running status without a previous midi event";
+        case ParseStatus::UNKNOWN_EVENT: return "unknown event";
+        case ParseStatus::MISSING_END_OF_TRACK: return "the MTrk chunk has no end of track event";
+    }
+
+    return "unknown problem";
+}
+
+midi::PARSE_RESULT midi::parse_mthd_fields(const uint8_t* data, size_t size, MTHD* mthd)
+{
+    if(size < sizeof(MTHD)) return failure(ParseStatus::TRUNCATED, 0);
+    if(std::memcmp(data, "MThd", 4) != 0) return failure(ParseStatus::BAD_CHUNK_ID, 0);
+
+    std::memcpy(mthd->header.id, data, 4);
+    mthd->header.size = big_endian_32(data + 4);
+    mthd->type = big_endian_16(data + 8);
+    mthd->ntracks = big_endian_16(data + 10);
+    mthd->division = big_endian_16(data + 12);
+    if(mthd->header.size < 6) return failure(ParseStatus::BAD_HEADER_SIZE, 4);
+
+    tracing::count(tracing::Counter::BYTES_READ, CHUNK_HEADER_SIZE + mthd->header.size);
+    return PARSE_RESULT{ParseStatus::OK, CHUNK_HEADER_SIZE + mthd->header.size};
+}
+
+midi::PARSE_RESULT midi::parse_mthd(const uint8_t* data, size_t size, MTHD* mthd)
+{
+    const auto result = parse_mthd_fields(data, size, mthd);
+    if(result.ok() && result.offset > size) return failure(ParseStatus::TRUNCATED, 0);
+
+    return result;
+}
+
+midi::PARSE_RESULT midi::parse_mtrk(const uint8_t* data, size_t size, EventReceiver& event_receiver)
+{
+    tracing::Scope scope("read_mtrk");
+
+    if(size < CHUNK_HEADER_SIZE) return failure(ParseStatus::TRUNCATED, 0);
+    if(std::memcmp(data, "MTrk", 4) != 0) return failure(ParseStatus::BAD_CHUNK_ID, 0);
+
+    //the end of track event ends the track, a chunk size that is too small is tolerated like read_mtrk always did
+    const uint64_t chunk_end = CHUNK_HEADER_SIZE + uint64_t(big_endian_32(data + 4));
+    uint8_t running_status = 0;
+    const auto result = parse_events(data, size, CHUNK_HEADER_SIZE, &running_status, event_receiver);
+    if(!result.ok()) return failure(result.status == ParseStatus::TRUNCATED && result.offset == chunk_end ? ParseStatus::MISSING_END_OF_TRACK : result.status, result.offset);
+
+    //whatever follows the end of track in the chunk is skipped
+    const auto end = chunk_end <= size ? std::max(chunk_end, result.offset) : result.offset;
+
+    tracing::count(tracing::Counter::BYTES_READ, end);
+    return PARSE_RESULT{ParseStatus::OK, end};
+}
+
+midi::PARSE_RESULT midi::parse_mtrk(std::istream& istream, EventReceiver& event_receiver)
+{
+    tracing::Scope scope("read_mtrk");
+
+    std::vector<uint8_t> data(CHUNK_HEADER_SIZE);
+    istream.read(reinterpret_cast<char*>(data.data()), CHUNK_HEADER_SIZE);
+    if(istream.gcount() != CHUNK_HEADER_SIZE) return failure(ParseStatus::TRUNCATED, 0);
+    if(std::memcmp(data.data(), "MTrk", 4) != 0) return failure(ParseStatus::BAD_CHUNK_ID, 0);
+
+    //in blocks, so a chunk size beyond the end of the stream does not allocate memory for it up front
+    const uint64_t chunk_end = CHUNK_HEADER_SIZE + uint64_t(big_endian_32(data.data() + 4));
+    while(data.size() < chunk_end && istream)
+    {
+        const auto offset = data.size();
+        data.resize(static_cast<size_t>(std::min<uint64_t>(chunk_end, offset + (1U << 20U))));
+        istream.read(reinterpret_cast<char*>(data.data() + offset), data.size() - offset);
+        data.resize(offset + istream.gcount());
+    }
+
+    uint8_t running_status = 0;
+    size_t offset = CHUNK_HEADER_SIZE;
+    while(true)
+    {
+        const auto result = parse_events(data.data(), data.size(), offset, &running_status, event_receiver);
+        if(result.ok())
+        {
+            tracing::count(tracing::Counter::BYTES_READ, data.size());
+            return PARSE_RESULT{ParseStatus::OK, data.size()};
+        }
+        if(result.status != ParseStatus::TRUNCATED) return result;
+
+        //the chunk size was too small: one byte more at a time, so nothing after the end of track is taken from the stream
+        const auto byte = istream.get();
+        if(byte == std::char_traits<char>::eof()) return failure(result.offset == chunk_end ? ParseStatus::MISSING_END_OF_TRACK : ParseStatus::TRUNCATED, result.offset);
+
+        data.push_back(static_cast<uint8_t>(byte));
+        offset = static_cast<size_t>(result.offset);
+    }
+}
+
+midi::PARSE_RESULT midi::parse_tracks(const uint8_t* data, size_t size, uint64_t offset, unsigned ntracks, const std::function<EventReceiver&(unsigned)>& receiver_of)
+{
+    for(unsigned tracks = 0; tracks != ntracks;)
+    {
+        if(offset > size || size - offset < CHUNK_HEADER_SIZE) return failure(ParseStatus::TRUNCATED, offset);
+
+        //unknown chunks are allowed by the specification, and are to be skipped
+        if(std::memcmp(data + offset, "MTrk", 4) != 0)
+        {
+            const auto chunk_end = offset + CHUNK_HEADER_SIZE + big_endian_32(data + offset + 4);
+            if(chunk_end > size) return failure(ParseStatus::TRUNCATED, offset);
+
+            offset = chunk_end;
+            continue;
+        }
+
+        const auto result = parse_mtrk(data + offset, size - offset, receiver_of(tracks));
+        if(!result.ok()) return failure(result.status, offset + result.offset);
+
+        offset += result.offset;
+        ++tracks;
+    }
+
+    return PARSE_RESULT{ParseStatus::OK, offset};
+}
+
+midi::PARSE_RESULT midi::parse_notes(const uint8_t* data, size_t size, std::vector<NOTE>* notes, Automation* automation)
+{
+    tracing::Scope scope("read_notes");
+
+    MTHD mthd;
+    const auto result = parse_mthd(data, size, &mthd);
+    if(!result.ok()) return result;
+    if(mthd.type == 2) return failure(ParseStatus::UNSUPPORTED_FORMAT, 8);
+
+    const auto first_note = notes->size();
+    NoteCollector note_collector([notes](const NOTE& note) { notes->push_back(note); }, automation);
+
+    const auto tracks_result = parse_tracks(data, size, result.offset, mthd.ntracks, [&](unsigned) -> EventReceiver& { return note_collector; });
+    if(tracks_result.ok()) tracing::count(tracing::Counter::NOTES, notes->size() - first_note);
+    if(automation != nullptr) automation->finish();
+
+    return tracks_result;
+}
+
+midi::PARSE_RESULT midi::parse_sequences(const uint8_t* data, size_t size, std::vector<std::vector<NOTE>>* sequences)
+{
+    MTHD mthd;
+    const auto result = parse_mthd(data, size, &mthd);
+    if(!result.ok()) return result;
+
+    if(mthd.type != 2)
+    {
+        sequences->emplace_back();
+        return parse_notes(data, size, &sequences->back());
+    }
+
+    tracing::Scope scope("read_sequences");
+
+    //the note collector starts its time over at every end of track, so a collector per track only has to know where its notes go
+    const auto first_sequence = sequences->size();
+    sequences->resize(first_sequence + mthd.ntracks);
+    std::unique_ptr<NoteCollector> note_collector;
+    auto receiver_of = [&](unsigned track) -> EventReceiver&
+    {
+        auto* sequence = &(*sequences)[first_sequence + track];
+        note_collector = std::make_unique<NoteCollector>([sequence](const NOTE& note) { sequence->push_back(note); });
+        return *note_collector;
+    };
+
+    const auto tracks_result = parse_tracks(data, size, result.offset, mthd.ntracks, receiver_of);
+    if(tracks_result.ok())
+    {
+        uint64_t note_count = 0;
+        for(auto i = first_sequence; i != sequences->size(); ++i) note_count += (*sequences)[i].size();
+        tracing::count(tracing::Counter::NOTES, note_count);
+    }
+
+    return tracks_result;
+}
+
+bool midi::holds_sequences(const uint8_t* data, size_t size)
+{
+    MTHD mthd;
+    return parse_mthd(data, size, &mthd).ok() && mthd.type == 2;
+}
+
+midi::PARSE_RESULT midi::parse_notes(std::istream& istream, std::vector<NOTE>* notes, Automation* automation)
+{
+    std::vector<uint8_t> data;
+    char buffer[1 << 16];
+    do
+    {
+        istream.read(buffer, sizeof(buffer));
+        data.insert(data.end(), buffer, buffer + istream.gcount());
+    } while(istream);
+
+    return parse_notes(data.data(), data.size(), notes, automation);
+}
+
+//PUSH PARSER
+midi::PushParser::PushParser(EventReceiver& event_receiver)
+    : event_receiver(event_receiver), state(State::MTHD), mthd(), header_read(false), tracks_left(0), offset(0), skip_left(0), skip_origin(0),
+      chunk_end(0), running_status(0), problem{ParseStatus::OK, 0}, data_ended(false)
+{
+}
+
+midi::PARSE_RESULT midi::PushParser::feed(const uint8_t* data, size_t size)
+{
+    if(state == State::FAILED) return problem;
+
+    //a part that was split between calls is completed in pending, otherwise the data is parsed where it is
+    //and only the incomplete part at its end is kept
+    if(pending.empty())
+    {
+        const auto used = parse(data, size);
+        pending.assign(data + used, data + size);
+    }
+    else
+    {
+        pending.insert(pending.end(), data, data + size);
+        const auto used = parse(pending.data(), pending.size());
+        pending.erase(pending.begin(), pending.begin() + used);
+    }
+
+    return state == State::FAILED ? problem : PARSE_RESULT{ParseStatus::OK, offset};
+}
+
+midi::PARSE_RESULT midi::PushParser::finish()
+{
+    //the rest of a chunk that runs past the data is not skipped but parsed as the chunks that follow the track
+    if(!data_ended)
+    {
+        data_ended = true;
+        if(state == State::TRACK_TAIL)
+        {
+            const auto used = parse(pending.data(), pending.size());
+            pending.erase(pending.begin(), pending.begin() + used);
+        }
+    }
+
+    if(state == State::FAILED) return problem;
+    if(state == State::DONE) return PARSE_RESULT{ParseStatus::OK, offset};
+
+    //like parse_mthd and parse_tracks, a chunk that cannot be skipped is truncated where it starts
+    if(state == State::SKIP) return failure(ParseStatus::TRUNCATED, skip_origin);
+
+    //like parse_mtrk, a track whose events stop right where its chunk ends lacks its end of track
+    return PARSE_RESULT{state == State::EVENTS && offset == chunk_end ? ParseStatus::MISSING_END_OF_TRACK : ParseStatus::TRUNCATED, offset};
+}
+
+//parses as much of data as forms complete parts, advances offset past them and returns how many bytes they took
+size_t midi::PushParser::parse(const uint8_t* data, size_t size)
+{
+    size_t position = 0;
+    auto stop = [this, &position]()
+    {
+        offset += position;
+        return position;
+    };
+    auto fail = [this, size](ParseStatus status, size_t at)
+    {
+        problem = PARSE_RESULT{status, offset + at};
+        state = State::FAILED;
+        return size;
+    };
+
+    while(true)
+    {
+        const auto available = size - position;
+        if(state == State::DONE)
+        {
+            stop();
+            return size;
+        }
+        else if(state == State::MTHD)
+        {
+            //a file that is not a midi file is recognized before its first 14 bytes are in
+            if(available >= 4 && std::memcmp(data + position, "MThd", 4) != 0) return fail(ParseStatus::BAD_CHUNK_ID, position);
+            if(available < sizeof(MTHD)) return stop();
+
+            const auto result = parse_mthd_fields(data + position, available, &mthd);
+            if(!result.ok()) return fail(result.status, position + result.offset);
+
+            header_read = true;
+            tracks_left = mthd.ntracks;
+            skip_origin = offset + position;
+            position += sizeof(MTHD);
+            skip_left = mthd.header.size - 6;
+            state = State::SKIP;
+        }
+        else if(state == State::SKIP)
+        {
+            const auto skipped = static_cast<size_t>(std::min<uint64_t>(skip_left, available));
+            position += skipped;
+            skip_left -= skipped;
+            if(skip_left != 0) return stop();
+
+            state = tracks_left == 0 ? State::DONE : State::CHUNK_HEADER;
+        }
+        else if(state == State::CHUNK_HEADER)
+        {
+            if(available < CHUNK_HEADER_SIZE) return stop();
+
+            //unknown chunks are allowed by the specification, and are to be skipped
+            const auto chunk_size = big_endian_32(data + position + 4);
+            const bool is_track = std::memcmp(data + position, "MTrk", 4) == 0;
+            position += CHUNK_HEADER_SIZE;
+
+            if(is_track)
+            {
+                chunk_end = offset + position + chunk_size;
+                running_status = 0;
+                state = State::EVENTS;
+            }
+            else
+            {
+                skip_origin = offset + position - CHUNK_HEADER_SIZE;
+                skip_left = chunk_size;
+                state = State::SKIP;
+            }
+        }
+        else if(state == State::TRACK_TAIL)
+        {
+            //parse_mtrk only skips the rest of the chunk if the data holds all of it, otherwise the next chunk starts
+            //right after the end of track, so the bytes are kept until either the chunk is complete or the data ends
+            const auto track_end = offset + position;
+            const auto tail = chunk_end > track_end ? chunk_end - track_end : 0;
+            if(tail > available && !data_ended) return stop();
+
+            if(tail <= available) position += static_cast<size_t>(tail);
+            state = tracks_left == 0 ? State::DONE : State::CHUNK_HEADER;
+        }
+        else
+        {
+            //an event that is not complete yet is parsed again from its start once more data is fed
+            const auto result = parse_events(data, size, position, &running_status, event_receiver);
+            if(result.status == ParseStatus::TRUNCATED)
+            {
+                position = static_cast<size_t>(result.offset);
+                return stop();
+            }
+            if(!result.ok()) return fail(result.status, static_cast<size_t>(result.offset));
+
+            position = static_cast<size_t>(result.offset);
+            --tracks_left;
+            state = State::TRACK_TAIL;
+        }
+    }
+}
+//END PUSH PARSER
@@ -0,0 +1,125 @@
+#ifndef MIDI_PROJECT_PARSE_H
+#define MIDI_PROJECT_PARSE_H
+
+#include "midi.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <vector>
+
+namespace midi
+{
+    //PARSE RESULT
+    //the parse functions never throw or log, a malformed file is reported like this so the caller can move on
+    enum class ParseStatus
+    {
+        OK,
+        TRUNCATED,                  //the data ends inside a chunk or an event
+        BAD_CHUNK_ID,               //an MThd or MTrk chunk was expected
+        BAD_HEADER_SIZE,            //an MThd chunk shorter than its 6 bytes of fields
+        UNSUPPORTED_FORMAT,         //a type 2 file asked for as a single list of notes, parse_sequences reads those
+        VARIABLE_LENGTH_INTEGER_TOO_LONG,
+        NO_RUNNING_STATUS,          //a data byte where a status byte was expected, without a previous midi event
+        UNKNOWN_EVENT,              //a system common or realtime status byte, which cannot appear in a file
+        MISSING_END_OF_TRACK        //the MTrk chunk ends before its end of track event
+    };
+
+    struct PARSE_RESULT
+    {
+        ParseStatus status;
+        uint64_t offset;    //of the byte where parsing failed, or of the first byte after what was parsed
+
+        bool ok() const { return status == ParseStatus::OK; }
+    };
+
+    const char* describe(ParseStatus);
+    //END PARSE RESULT
+
+    //mthd is filled in, its chunk may be longer than the fields it holds but not run past the data, offset is where the chunk ends
+    PARSE_RESULT parse_mthd(const uint8_t* data, size_t size, MTHD* mthd);
+
+    //the same from the first 14 bytes of the chunk alone, for readers that do not hold the rest of it yet
+    PARSE_RESULT parse_mthd_fields(const uint8_t* data, size_t size, MTHD* mthd);
+
+    //data starts with the MTrk chunk header, the events are handed to the receiver up to the first problem
+    //the end of track event ends the track, a chunk size that is too small is tolerated, offset is where the next chunk starts
+    PARSE_RESULT parse_mtrk(const uint8_t* data, size_t size, EventReceiver&);
+    PARSE_RESULT parse_mtrk(std::istream&, EventReceiver&);
+
+    //the ntracks MTrk chunks from offset on, which is where the MThd chunk ends, chunks that are neither MThd nor MTrk are skipped
+    //the events of track i go to the receiver that receiver_of(i) returns
+    PARSE_RESULT parse_tracks(const uint8_t* data, size_t size, uint64_t offset, unsigned ntracks, const std::function<EventReceiver&(unsigned)>& receiver_of);
+
+    //an entire midi file, chunks that are neither MThd nor MTrk are skipped
+    //notes holds the notes that were complete before a problem
+    //with an automation, the controllers, pitch wheel and pressure of every channel are collected in the same pass,
+    //its lanes are compressed once the tracks are parsed, even after a problem
+    PARSE_RESULT parse_notes(const uint8_t* data, size_t size, std::vector<NOTE>* notes, Automation* automation = nullptr);
+    PARSE_RESULT parse_notes(std::istream&, std::vector<NOTE>* notes, Automation* automation = nullptr);
+
+    //an entire midi file as independent sequences: in a type 2 file every track is a sequence with its own timeline
+    //(and thus its own tempo) starting at 0, a type 0 or 1 file is a single sequence holding what parse_notes gives
+    //a sequence is added to the end of sequences for every track, even one without notes
+    PARSE_RESULT parse_sequences(const uint8_t* data, size_t size, std::vector<std::vector<NOTE>>* sequences);
+
+    //whether data starts with the MThd chunk of a type 2 file, whose notes only parse_sequences reads
+    bool holds_sequences(const uint8_t* data, size_t size);
+
+    //PUSH PARSER
+    //parses a midi file that arrives in pieces of any size, e.g. from a socket or a pipe, without waiting for the rest
+    //every event reaches the receiver as soon as its last byte was fed, the bytes of an event, chunk header or
+    //variable length integer that is split between calls are kept until the rest arrives
+    //chunks are handled like parse_notes does: unknown chunks are skipped, whatever follows the last track is ignored
+    class PushParser
+    {
+        enum class State
+        {
+            MTHD,
+            CHUNK_HEADER,
+            SKIP,       //an unknown chunk or the fields of the MThd chunk that are not used
+            EVENTS,
+            TRACK_TAIL, //what follows an end of track in its chunk, kept until it is known whether the data holds all of it
+            DONE,
+            FAILED
+        };
+
+        EventReceiver& event_receiver;
+        State state;
+        MTHD mthd;
+        bool header_read;
+        unsigned tracks_left;
+        uint64_t offset;        //in the whole file, of the first byte that was not parsed yet, or where the last track ended
+        uint64_t skip_left;
+        uint64_t skip_origin;   //of the chunk being skipped, where the data is truncated if it ends before the skip does
+        uint64_t chunk_end;     //of the MTrk chunk whose events are being parsed
+        uint8_t running_status;
+        PARSE_RESULT problem;
+        bool data_ended;
+        std::vector<uint8_t> pending;   //bytes from offset on that did not form a complete part yet
+
+        size_t parse(const uint8_t* data, size_t size);
+
+    public:
+        explicit PushParser(EventReceiver&);
+
+        //OK as long as nothing is wrong with the data so far, offset is where the parsed data ends
+        //after a problem, this and every later call return that problem
+        PARSE_RESULT feed(const uint8_t* data, size_t size);
+
+        //the data has ended, the result is what parse_notes gives for the same data: TRUNCATED or MISSING_END_OF_TRACK when
+        //it ends before its last track does, at the same offset
+        //like parse_notes, a track ends at its end of track event when its chunk runs past the data, so the events that
+        //follow it in such a chunk only reach the receiver here
+        PARSE_RESULT finish();
+
+        //all tracks were parsed, more data is ignored
+        bool done() const { return state == State::DONE; }
+
+        //nullptr until the MThd chunk was fed
+        const MTHD* header() const { return header_read ? &mthd : nullptr; }
+    };
+    //END PUSH PARSER
+}
+
+#endif //MIDI_PROJECT_PARSE_H
@@ -0,0 +1,169 @@
+#include "synthetic.h"
+#include "writer.h"
+#include "logging.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+    //std::mt19937_64 is specified bit for bit, the standard distributions are not, so those are avoided
+    class Random
+    {
+        std::mt19937_64 engine;
+
+    public:
+        explicit Random(uint64_t seed) : engine(seed) {};
+
+        //uniform enough for synthetic data, the bias of the modulo is negligible for small bounds
+        uint64_t below(uint64_t bound) { return bound == 0 ? 0 : engine() % bound; }
+    };
+
+    struct NOTE_OFF
+    {
+        uint64_t time;
+        uint8_t channel;
+        uint8_t note;
+    };
+
+    //some common controllers: modulation, volume, pan, expression and sustain
+    const uint8_t CONTROLLERS[] = { 1, 7, 10, 11, 64 };
+
+    midi::TrackWriter synthetic_track(const midi::SYNTHETIC_SETTINGS& settings, unsigned track_index, uint64_t event_count)
+    {
+        //every track has its own stream, derived from the seed and its index
+        Random random(settings.seed * 0x9E3779B97F4A7C15ULL + track_index);
+        midi::TrackWriter track(settings.running_status);
+
+        uint64_t time = 0;
+        uint64_t last_time = 0;
+        uint64_t channel_events = 0;
+        uint64_t next_sysex = settings.sysex_interval;
+        uint64_t next_tempo = settings.tempo_interval;
+        std::vector<NOTE_OFF> pending;
+        std::vector<bool> sounding(16 * 128, false);
+
+        //a single track plays on all channels, otherwise every track gets its own
+        auto pick_channel = [&]() { return static_cast<uint8_t>(settings.tracks == 1 ? random.below(16) : track_index % 16); };
+        auto dt = [&](uint64_t at) { const auto result = midi::Duration(at - last_time); last_time = at; return result; };
+
+        auto note_offs_until = [&](uint64_t until)
+        {
+            std::sort(pending.begin(), pending.end(), [](const NOTE_OFF& l, const NOTE_OFF& r) { return l.time > r.time; });
+            while(!pending.empty() && pending.back().time <= until)
+            {
+                const auto off = pending.back();
+                pending.pop_back();
+                sounding[off.channel * 128 + off.note] = false;
+
+                track.note_off(dt(off.time), midi::Channel(off.channel), midi::NoteNumber(off.note), 64);
+                ++channel_events;
+            }
+        };
+
+        auto extras = [&]()
+        {
+            if(settings.sysex_interval != 0 && channel_events >= next_sysex)
+            {
+                next_sysex += settings.sysex_interval;
+
+                //manufacturer id 0x7D is reserved for non commercial use, the data ends with the end of exclusive byte
+                std::vector<uint8_t> dump(std::max(settings.sysex_size, 2U));
+                dump[0] = 0x7D;
+                for(size_t i = 1; i + 1 < dump.size(); ++i) dump[i] = static_cast<uint8_t>(random.below(128));
+                dump.back() = 0xF7;
+
+                track.sysex(dt(time), dump.data(), dump.size());
+            }
+
+            if(track_index == 0 && settings.tempo_interval != 0 && channel_events >= next_tempo)
+            {
+                next_tempo += settings.tempo_interval;
+
+                //between 40 and 240 beats per minute
+                track.tempo(dt(time), static_cast<uint32_t>(250000 + random.below(1250000)));
+            }
+        };
+
+        while(true)
+        {
+            time += random.below(settings.division / 2 + 1);
+            note_offs_until(time);
+
+            //the note offs that are still pending count as written already
+            const auto remaining = event_count - channel_events - pending.size();
+            if(remaining == 0) break;
+
+            const auto channel = pick_channel();
+            const auto kind = random.below(100);
+            auto threshold = settings.control_changes;
+
+            //a note needs room for its note off, so a single remaining event is always a control change
+            if(kind < threshold || remaining == 1)
+            {
+                track.control_change(dt(time), midi::Channel(channel), CONTROLLERS[random.below(sizeof(CONTROLLERS))], static_cast<uint8_t>(random.below(128)));
+                ++channel_events;
+            }
+            else if(kind < (threshold += settings.pitch_wheel_changes))
+            {
+                track.pitch_wheel_change(dt(time), midi::Channel(channel), static_cast<uint16_t>(random.below(1U << 14U)));
+                ++channel_events;
+            }
+            else if(kind < (threshold += settings.pressure_events))
+            {
+                if(random.below(2) == 0) track.channel_pressure(dt(time), midi::Channel(channel), static_cast<uint8_t>(random.below(128)));
+                else track.polyphonic_key_pressure(dt(time), midi::Channel(channel), midi::NoteNumber(static_cast<uint8_t>(random.below(128))), static_cast<uint8_t>(random.below(128)));
+                ++channel_events;
+            }
+            else if(kind < (threshold += settings.program_changes))
+            {
+                track.program_change(dt(time), midi::Channel(channel), midi::Instrument(static_cast<uint8_t>(random.below(128))));
+                ++channel_events;
+            }
+            else
+            {
+                //a chord around a random root, skipping notes that are still sounding so every note on has its own note off
+                const auto root = 36 + random.below(48);
+                const auto length = 1 + random.below(2 * settings.division);
+                for(unsigned i = 0; i != std::max(settings.chord_size, 1U) && channel_events + pending.size() + 2 <= event_count; ++i)
+                {
+                    const auto note = static_cast<uint8_t>((root + 4 * i + random.below(3)) % 128);
+                    if(sounding[channel * 128 + note]) continue;
+
+                    sounding[channel * 128 + note] = true;
+                    track.note_on(dt(time), midi::Channel(channel), midi::NoteNumber(note), static_cast<uint8_t>(1 + random.below(127)));
+                    pending.push_back(NOTE_OFF{time + length, channel, note});
+                    ++channel_events;
+                }
+            }
+
+            extras();
+        }
+
+        note_offs_until(UINT64_MAX);
+        track.end_of_track(midi::Duration(0));
+
+        return track;
+    }
+}
+
+void midi::write_synthetic_midi(std::ostream& ostream, const SYNTHETIC_SETTINGS& settings)
+{
+    CHECK(settings.format <= 2) << "Unknown midi format " << settings.format;
+    CHECK(settings.format != 0 || settings.tracks == 1) << "A format 0 file has a single track";
+    CHECK(settings.tracks >= 1 && settings.tracks <= 0xFFFF) << "A midi file has between 1 and 65535 tracks";
+    CHECK(settings.division >= 1 && settings.division <= 0x7FFF) << "The division is between 1 and 32767 ticks per quarter note";
+
+    MTHD mthd{};
+    mthd.type = static_cast<uint16_t>(settings.format);
+    mthd.ntracks = static_cast<uint16_t>(settings.tracks);
+    mthd.division = static_cast<uint16_t>(settings.division);
+    write_mthd(ostream, mthd);
+
+    //the channel events are spread evenly, the first tracks get one more when they do not divide
+    for(unsigned i = 0; i != settings.tracks; ++i)
+    {
+        const auto event_count = settings.events / settings.tracks + (i < settings.events % settings.tracks ? 1 : 0);
+        write_mtrk(ostream, synthetic_track(settings, i, event_count));
+    }
+}
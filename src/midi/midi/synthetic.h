@@ -0,0 +1,32 @@
+#ifndef MIDI_PROJECT_SYNTHETIC_H
+#define MIDI_PROJECT_SYNTHETIC_H
+
+#include <cstdint>
+#include <ostream>
+
+namespace midi
+{
+    //what a synthetic midi file consists of, percentages are of the channel events
+    struct SYNTHETIC_SETTINGS
+    {
+        uint64_t seed = 1;
+        unsigned format = 1;                    //0 only allows a single track
+        unsigned tracks = 16;
+        uint64_t events = 1000000;              //channel events over all tracks, note ons and offs included
+        unsigned division = 480;                //ticks per quarter note
+        unsigned chord_size = 3;                //notes that start together
+        unsigned control_changes = 10;
+        unsigned pitch_wheel_changes = 5;
+        unsigned pressure_events = 5;           //polyphonic key pressure and channel pressure
+        unsigned program_changes = 1;
+        uint64_t sysex_interval = 0;            //a sysex dump after every n channel events of a track, 0 for none
+        unsigned sysex_size = 4096;
+        uint64_t tempo_interval = 0;            //a tempo change after every n channel events of the first track, 0 for none
+        bool running_status = true;
+    };
+
+    //the same settings always give the same bytes, on every platform: only the raw output of a fixed generator is used
+    void write_synthetic_midi(std::ostream&, const SYNTHETIC_SETTINGS&);
+}
+
+#endif //MIDI_PROJECT_SYNTHETIC_H
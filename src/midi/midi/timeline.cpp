@@ -0,0 +1,68 @@
+#include "timeline.h"
+#include <algorithm>
+#include <utility>
+
+//MERGED TIMELINE
+midi::MergedTimeline::MergedTimeline(const DECODED_EVENTS& events)
+{
+    for(const auto& track : events.tracks)
+    {
+        positions.push_back(track.records.data());
+        ends.push_back(track.records.data() + track.records.size());
+    }
+
+    //the leaves of track i are node tracks + i, which gives every inner node two children for any number of tracks
+    losers.resize(std::max<size_t>(positions.size(), 1));
+    if(positions.size() > 1) losers[0] = build(1);
+}
+
+bool midi::MergedTimeline::before(unsigned track_l, unsigned track_r) const
+{
+    //an exhausted track comes after everything
+    if(positions[track_l] == ends[track_l]) return false;
+    if(positions[track_r] == ends[track_r]) return true;
+
+    const auto time_l = positions[track_l]->time;
+    const auto time_r = positions[track_r]->time;
+    return time_l < time_r || (time_l == time_r && track_l < track_r);
+}
+
+unsigned midi::MergedTimeline::build(unsigned node)
+{
+    const auto tracks = static_cast<unsigned>(positions.size());
+    if(node >= tracks) return node - tracks;
+
+    const auto left = build(2 * node);
+    const auto right = build(2 * node + 1);
+    if(before(right, left))
+    {
+        losers[node] = left;
+        return right;
+    }
+
+    losers[node] = right;
+    return left;
+}
+
+bool midi::MergedTimeline::next(TIMELINE_EVENT* event)
+{
+    if(positions.empty()) return false;
+
+    auto winner = losers[0];
+    if(positions[winner] == ends[winner]) return false;
+
+    event->record = positions[winner]++;
+    event->track = winner;
+
+    //only the path from the leaf of the winner to the root can change: at every node the track with the earlier event
+    //goes on up and the other one stays behind as the loser
+    const auto tracks = static_cast<unsigned>(positions.size());
+    for(auto node = (winner + tracks) / 2; node != 0; node /= 2)
+    {
+        if(before(losers[node], winner)) std::swap(losers[node], winner);
+    }
+    losers[0] = winner;
+
+    return true;
+}
+//END MERGED TIMELINE
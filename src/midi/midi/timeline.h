@@ -0,0 +1,41 @@
+#ifndef MIDI_PROJECT_TIMELINE_H
+#define MIDI_PROJECT_TIMELINE_H
+
+#include "events.h"
+#include <cstdint>
+#include <vector>
+
+namespace midi
+{
+    //MERGED TIMELINE
+    struct TIMELINE_EVENT
+    {
+        const EVENT_RECORD* record;
+        unsigned track;
+    };
+
+    //the events of every track of a decoded file in one chronological stream, e.g. the tempo changes of track 0
+    //of a type 1 file among the notes of the other tracks
+    //the tracks are merged lazily with a loser tree: the merge only holds a position and a tree node per track,
+    //and every event costs log2(tracks) comparisons
+    //events at the same tick come in track order, and within a track in file order
+    class MergedTimeline
+    {
+        std::vector<const EVENT_RECORD*> positions;     //of the next event of every track
+        std::vector<const EVENT_RECORD*> ends;
+        std::vector<unsigned> losers;                   //losers[0] is the track with the next event, losers[1..] the losers of the inner nodes
+
+        bool before(unsigned track_l, unsigned track_r) const;
+        unsigned build(unsigned node);
+
+    public:
+        //the events are those of the tracks in events, which have to outlive the timeline
+        explicit MergedTimeline(const DECODED_EVENTS& events);
+
+        //the next event, false once every track is exhausted
+        bool next(TIMELINE_EVENT* event);
+    };
+    //END MERGED TIMELINE
+}
+
+#endif //MIDI_PROJECT_TIMELINE_H
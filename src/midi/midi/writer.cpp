@@ -0,0 +1,150 @@
+#include "writer.h"
+#include "../io/endianness.h"
+#include "../io/vli.h"
+#include "logging.h"
+#include <cstring>
+
+namespace
+{
+    void write_chunk_header(std::ostream& ostream, const char (&id)[5], uint32_t size)
+    {
+        midi::CHUNK_HEADER header;
+        std::memcpy(header.id, id, sizeof(header.id));
+        header.size = size;
+        io::switch_endianness(&header.size);
+
+        ostream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+}
+
+void midi::TrackWriter::delta_time(Duration dt)
+{
+    uint8_t buffer[io::MAX_VARIABLE_LENGTH_INTEGER_SIZE];
+    auto size = io::encode_variable_length_integer(value(dt), buffer);
+
+    events.insert(events.end(), buffer, buffer + size);
+    ++event_count;
+}
+
+void midi::TrackWriter::midi_event(Duration dt, uint8_t status, Channel channel)
+{
+    delta_time(dt);
+
+    const auto status_byte = static_cast<uint8_t>((status << 4U) | (value(channel) & 0x0FU));
+    if(!running_status || status_byte != last_status) events.push_back(status_byte);
+    last_status = status_byte;
+}
+
+void midi::TrackWriter::note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+{
+    midi_event(dt, 0x09, channel);
+    events.push_back(value(note));
+    events.push_back(velocity);
+}
+
+void midi::TrackWriter::note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity)
+{
+    midi_event(dt, 0x08, channel);
+    events.push_back(value(note));
+    events.push_back(velocity);
+}
+
+void midi::TrackWriter::polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure)
+{
+    midi_event(dt, 0x0A, channel);
+    events.push_back(value(note));
+    events.push_back(pressure);
+}
+
+void midi::TrackWriter::control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value)
+{
+    midi_event(dt, 0x0B, channel);
+    events.push_back(controller);
+    events.push_back(value);
+}
+
+void midi::TrackWriter::program_change(Duration dt, Channel channel, Instrument program)
+{
+    midi_event(dt, 0x0C, channel);
+    events.push_back(value(program));
+}
+
+void midi::TrackWriter::channel_pressure(Duration dt, Channel channel, uint8_t pressure)
+{
+    midi_event(dt, 0x0D, channel);
+    events.push_back(pressure);
+}
+
+void midi::TrackWriter::pitch_wheel_change(Duration dt, Channel channel, uint16_t value)
+{
+    //14 bits, least significant 7 first
+    midi_event(dt, 0x0E, channel);
+    events.push_back(static_cast<uint8_t>(value & 0x7FU));
+    events.push_back(static_cast<uint8_t>((value >> 7U) & 0x7FU));
+}
+
+void midi::TrackWriter::meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+{
+    meta(dt, type, data.get(), data_size);
+}
+
+void midi::TrackWriter::sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size)
+{
+    sysex(dt, data.get(), data_size);
+}
+
+void midi::TrackWriter::meta(Duration dt, uint8_t type, const uint8_t* data, uint64_t data_size)
+{
+    delta_time(dt);
+    events.push_back(0xFF);
+    events.push_back(type);
+
+    uint8_t buffer[io::MAX_VARIABLE_LENGTH_INTEGER_SIZE];
+    auto size = io::encode_variable_length_integer(data_size, buffer);
+    events.insert(events.end(), buffer, buffer + size);
+    events.insert(events.end(), data, data + data_size);
+
+    last_status = -1;
+}
+
+void midi::TrackWriter::sysex(Duration dt, const uint8_t* data, uint64_t data_size)
+{
+    delta_time(dt);
+    events.push_back(0xF0);
+
+    uint8_t buffer[io::MAX_VARIABLE_LENGTH_INTEGER_SIZE];
+    auto size = io::encode_variable_length_integer(data_size, buffer);
+    events.insert(events.end(), buffer, buffer + size);
+    events.insert(events.end(), data, data + data_size);
+
+    last_status = -1;
+}
+
+void midi::TrackWriter::tempo(Duration dt, uint32_t microseconds_per_quarter_note)
+{
+    const uint8_t data[] = { static_cast<uint8_t>(microseconds_per_quarter_note >> 16U), static_cast<uint8_t>(microseconds_per_quarter_note >> 8U), static_cast<uint8_t>(microseconds_per_quarter_note) };
+    meta(dt, 0x51, data, sizeof(data));
+}
+
+void midi::TrackWriter::end_of_track(Duration dt)
+{
+    meta(dt, 0x2F, static_cast<const uint8_t*>(nullptr), 0);
+}
+
+void midi::write_mthd(std::ostream& ostream, const MTHD& mthd)
+{
+    write_chunk_header(ostream, "MThd", 6);
+
+    uint16_t fields[] = { mthd.type, mthd.ntracks, mthd.division };
+    for(auto& field : fields) io::switch_endianness(&field);
+
+    ostream.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+}
+
+void midi::write_mtrk(std::ostream& ostream, const TrackWriter& track)
+{
+    CHECK(track.data().size() <= UINT32_MAX) << "An MTrk chunk holds at most 4 GB of events";
+
+    write_chunk_header(ostream, "MTrk", static_cast<uint32_t>(track.data().size()));
+    ostream.write(reinterpret_cast<const char*>(track.data().data()), track.data().size());
+}
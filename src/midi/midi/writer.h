@@ -0,0 +1,56 @@
+#ifndef MIDI_PROJECT_WRITER_H
+#define MIDI_PROJECT_WRITER_H
+
+#include "midi.h"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace midi
+{
+    //TRACK WRITER
+    //builds the events of one MTrk chunk, the counterpart of read_mtrk
+    //being an event receiver itself, read_mtrk can also copy a track into it
+    //with running status, the status byte of a midi event is left out when it equals the one of the previous event
+    //meta and sysex events cancel running status, like the specification requires
+    struct TrackWriter : EventReceiver
+    {
+        private:
+            std::vector<uint8_t> events;
+            bool running_status;
+            int last_status;
+            uint64_t event_count;
+
+            void delta_time(Duration dt);
+            void midi_event(Duration dt, uint8_t status, Channel channel);
+
+        public:
+            explicit TrackWriter(bool running_status = true) : running_status(running_status), last_status(-1), event_count(0) {};
+
+            void note_on(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+            void note_off(Duration dt, Channel channel, NoteNumber note, uint8_t velocity) override;
+            void polyphonic_key_pressure(Duration dt, Channel channel, NoteNumber note, uint8_t pressure) override;
+            void control_change(Duration dt, Channel channel, uint8_t controller, uint8_t value) override;
+            void program_change(Duration dt, Channel channel, Instrument program) override;
+            void channel_pressure(Duration dt, Channel channel, uint8_t pressure) override;
+            void pitch_wheel_change(Duration dt, Channel channel, uint16_t value) override;
+            void meta(Duration dt, uint8_t type, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+            void sysex(Duration dt, std::unique_ptr<uint8_t[]> data, uint64_t data_size) override;
+
+            void meta(Duration dt, uint8_t type, const uint8_t* data, uint64_t data_size);
+            void sysex(Duration dt, const uint8_t* data, uint64_t data_size);
+            void tempo(Duration dt, uint32_t microseconds_per_quarter_note);
+            void end_of_track(Duration dt);
+
+            //the bytes of the events, without the chunk header
+            const std::vector<uint8_t>& data() const { return events; }
+            uint64_t size() const { return event_count; }
+    };
+    //END TRACK WRITER
+
+    //the chunk sizes are filled in, the other fields of mthd are written as they are
+    void write_mthd(std::ostream&, const MTHD&);
+    void write_mtrk(std::ostream&, const TrackWriter&);
+}
+
+#endif //MIDI_PROJECT_WRITER_H
@@ -0,0 +1,306 @@
+#include "batch.h"
+#include "../midi/parse.h"
+#include "../util/trace.h"
+#include "../util/work-stealing-pool.h"
+#include "../logging.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <set>
+
+using namespace rendering;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    bool is_midi_file(const std::filesystem::path& path)
+    {
+        auto extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        return extension == ".mid" || extension == ".midi";
+    }
+
+    uint64_t size_of(const std::filesystem::path& path)
+    {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(path, error);
+
+        return error ? 0 : size;
+    }
+
+    std::string quoted(const std::string& text)
+    {
+        std::string result = "\"";
+        for(auto c : text)
+        {
+            if(c == '"' || c == '\\') result += '\\';
+            if(static_cast<unsigned char>(c) < 0x20) result += ' ';
+            else result += c;
+        }
+
+        return result + "\"";
+    }
+
+    //reads and parses one file into its sequences, a single one unless it is a type 2 file, which are left empty when that fails
+    void parse_file(const BATCH_INPUT& input, midi::NotesCache* notes_cache, std::vector<std::vector<midi::NOTE>>* sequences, BATCH_RESULT* result)
+    {
+        tracing::Scope scope("parse_file");
+        const auto start = Clock::now();
+
+        try
+        {
+            std::ifstream in(input.path, std::ios_base::binary);
+            if(!in.is_open())
+            {
+                result->error = "could not open the file";
+                return;
+            }
+
+            const std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            const bool has_sequences = midi::holds_sequences(data.data(), data.size());
+            if(!has_sequences) sequences->resize(1);
+
+            const auto parse_result = has_sequences ? midi::parse_sequences(data.data(), data.size(), sequences)
+                                    : notes_cache != nullptr ? notes_cache->read_notes(data.data(), data.size(), &sequences->front())
+                                    : midi::parse_notes(data.data(), data.size(), &sequences->front());
+
+            if(!parse_result.ok())
+            {
+                result->error = std::string("invalid midi file at byte ") + std::to_string(parse_result.offset) + ": " + midi::describe(parse_result.status);
+                sequences->clear();
+            }
+        }
+        catch(const std::exception& e)
+        {
+            result->error = e.what();
+            sequences->clear();
+        }
+
+        result->parse_seconds = seconds_since(start);
+    }
+
+    void render_file(const std::vector<std::vector<midi::NOTE>>& sequences, const RENDER_OPTIONS& options, const std::string& pattern, BATCH_RESULT* result)
+    {
+        tracing::Scope scope("render_file");
+        const auto start = Clock::now();
+
+        try
+        {
+            //frame files go in a directory of their own, the sinks expect its path to end in a separator
+            const std::filesystem::path output(result->output);
+            std::filesystem::create_directories(is_single_file_format(options.format) ? output.parent_path() : output);
+            const auto target = is_single_file_format(options.format) ? result->output : result->output + "/";
+
+            if(sequences.size() == 1)
+            {
+                const auto rendered = render_notes(sequences.front(), options, target, pattern, nullptr);
+                result->frames = rendered.frames;
+                result->error = rendered.error;
+            }
+            else
+            {
+                //the sequences of a type 2 file each get an output of their own, sequences that are left out only fail the file
+                //when none of them renders, a sequence whose render fails always does
+                const auto sequence_results = render_sequences(sequences, options, target, pattern, nullptr);
+                for(const auto& sequence_result : sequence_results) result->frames += sequence_result.frames;
+
+                const auto failed = std::find_if(sequence_results.begin(), sequence_results.end(), [](const SEQUENCE_RESULT& r) { return !r.error.empty(); });
+                const bool none_rendered = std::all_of(sequence_results.begin(), sequence_results.end(), [](const SEQUENCE_RESULT& r) { return r.problem != nullptr; });
+                if(failed != sequence_results.end()) result->error = "sequence " + std::to_string(failed - sequence_results.begin()) + ": " + failed->error;
+                else if(none_rendered) result->error = sequence_results.empty() ? "no sequences" : sequence_results.front().problem;
+            }
+        }
+        catch(const std::exception& e)
+        {
+            result->error = e.what();
+        }
+
+        result->render_seconds = seconds_since(start);
+    }
+}
+
+std::vector<BATCH_INPUT> rendering::collect_batch_inputs(const std::string& manifest_or_directory)
+{
+    std::vector<BATCH_INPUT> inputs;
+    std::set<std::string> output_names;
+
+    //two inputs never share an output, the later one gets a number appended
+    auto add = [&](const std::filesystem::path& path, std::filesystem::path output_name)
+    {
+        output_name.replace_extension();
+        auto name = output_name.generic_string();
+        for(unsigned i = 2; !output_names.insert(name).second; ++i) name = output_name.generic_string() + "-" + std::to_string(i);
+
+        inputs.push_back(BATCH_INPUT{path.string(), name, size_of(path)});
+    };
+
+    if(std::filesystem::is_directory(manifest_or_directory))
+    {
+        std::vector<std::filesystem::path> paths;
+        for(const auto& entry : std::filesystem::recursive_directory_iterator(manifest_or_directory))
+        {
+            if(entry.is_regular_file() && is_midi_file(entry.path())) paths.push_back(entry.path());
+        }
+
+        //directory order differs between file systems, the summary should not
+        std::sort(paths.begin(), paths.end());
+        for(const auto& path : paths) add(path, std::filesystem::relative(path, manifest_or_directory));
+    }
+    else
+    {
+        std::ifstream manifest(manifest_or_directory);
+        CHECK(manifest.is_open()) << "Could not open " << manifest_or_directory;
+
+        const auto base = std::filesystem::path(manifest_or_directory).parent_path();
+        std::string line;
+        while(std::getline(manifest, line))
+        {
+            line = line.substr(0, line.find('#'));
+            const auto first = line.find_first_not_of(" \t\r");
+            if(first == std::string::npos) continue;
+            line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+
+            //files outside of the manifest's directory keep only their name in the output root
+            const auto path = std::filesystem::path(line).lexically_normal();
+            const bool inside = path.is_relative() && *path.begin() != "..";
+            add(base / path, inside ? path : path.filename());
+        }
+    }
+
+    return inputs;
+}
+
+BATCH_SUMMARY rendering::render_batch(const std::vector<BATCH_INPUT>& inputs, const RENDER_OPTIONS& options, const std::string& output_root, const std::string& pattern, unsigned jobs,
+                                      midi::NotesCache* notes_cache)
+{
+    const auto start = Clock::now();
+    jobs = std::max(jobs, 1U);
+
+    //every file renders with its share of the threads and memory
+    const auto file_options = shared_options(options, jobs);
+
+    BATCH_SUMMARY summary{std::vector<BATCH_RESULT>(inputs.size()), jobs, 0, 0};
+    for(size_t i = 0; i != inputs.size(); ++i)
+    {
+        auto& result = summary.results[i];
+        result.path = inputs[i].path;
+        result.output = (std::filesystem::path(output_root) / inputs[i].output_name).string();
+        if(is_single_file_format(options.format)) result.output += file_extension(options.format);
+    }
+
+    //the largest files are submitted last, so every worker starts with the largest file in its own deque
+    //while the smallest are left at the front, for idle workers to steal at the end
+    std::vector<size_t> order(inputs.size());
+    for(size_t i = 0; i != order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) { return inputs[l].size < inputs[r].size; });
+
+    WorkStealingPool pool(jobs);
+    for(auto index : order)
+    {
+        pool.submit([&, index]()
+        {
+            tracing::name_thread("batch");
+            auto& result = summary.results[index];
+            result.worker = pool.worker_index();
+
+            auto sequences = std::make_shared<std::vector<std::vector<midi::NOTE>>>();
+            parse_file(inputs[index], notes_cache, sequences.get(), &result);
+            if(!result.ok()) return;
+
+            for(const auto& sequence : *sequences) result.notes += sequence.size();
+            result.sequences = static_cast<unsigned>(sequences->size());
+            if(sequences->size() == 1)
+            {
+                if(const auto problem = render_problem(sequences->front(), file_options))
+                {
+                    result.error = problem;
+                    return;
+                }
+            }
+
+            //the render goes to the back of this worker's deque and so runs next, while the notes are still in its cache
+            pool.submit([&, index, sequences]()
+            {
+                auto& result = summary.results[index];
+                result.worker = pool.worker_index();
+                render_file(*sequences, file_options, pattern, &result);
+            });
+        });
+    }
+    pool.wait();
+
+    summary.steals = pool.steals();
+    summary.seconds = seconds_since(start);
+
+    return summary;
+}
+
+void rendering::write_batch_summary(std::ostream& out, const BATCH_SUMMARY& summary)
+{
+    const auto failed = std::count_if(summary.results.begin(), summary.results.end(), [](const BATCH_RESULT& result) { return !result.ok(); });
+
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::setprecision(9) << std::defaultfloat;
+    out << "{\n  \"files\": " << summary.results.size() << ",\n  \"failed\": " << failed << ",\n  \"jobs\": " << summary.jobs
+        << ",\n  \"steals\": " << summary.steals << ",\n  \"seconds\": " << summary.seconds << ",\n  \"results\": [";
+
+    for(size_t i = 0; i != summary.results.size(); ++i)
+    {
+        const auto& result = summary.results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\n"
+            << "      \"path\": " << quoted(result.path) << ",\n"
+            << "      \"output\": " << quoted(result.output) << ",\n"
+            << "      \"status\": " << (result.ok() ? "\"ok\"" : "\"failed\"") << ",\n"
+            << "      \"error\": " << quoted(result.error) << ",\n"
+            << "      \"notes\": " << result.notes << ",\n"
+            << "      \"sequences\": " << result.sequences << ",\n"
+            << "      \"frames\": " << result.frames << ",\n"
+            << "      \"parse_seconds\": " << result.parse_seconds << ",\n"
+            << "      \"render_seconds\": " << result.render_seconds << ",\n"
+            << "      \"worker\": " << result.worker << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void rendering::print_batch_summary(std::ostream& out, const BATCH_SUMMARY& summary)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    unsigned failed = 0;
+    for(const auto& result : summary.results)
+    {
+        if(result.ok())
+        {
+            out << "ok      " << std::setw(9) << result.parse_seconds << "s parse " << std::setw(9) << result.render_seconds << "s render "
+                << std::setw(7) << result.frames << " frames  " << result.path << "\n";
+        }
+        else
+        {
+            ++failed;
+            out << "failed  " << result.path << ": " << result.error << "\n";
+        }
+    }
+
+    out << summary.results.size() - failed << " of " << summary.results.size() << " files rendered in " << summary.seconds << "s by "
+        << summary.jobs << " jobs (" << summary.steals << " steals)\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,56 @@
+#ifndef MIDI_PROJECT_BATCH_H
+#define MIDI_PROJECT_BATCH_H
+
+#include "render-job.h"
+#include "../midi/notes-cache.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rendering
+{
+    struct BATCH_INPUT
+    {
+        std::string path;
+        std::string output_name;    //relative to the output root, without extension
+        uint64_t size;
+    };
+
+    //every midi file (.mid or .midi) below a directory, or the files listed in a manifest: one path per line,
+    //relative to the manifest, '#' starts a comment
+    std::vector<BATCH_INPUT> collect_batch_inputs(const std::string& manifest_or_directory);
+
+    struct BATCH_RESULT
+    {
+        std::string path;
+        std::string output;
+        std::string error;          //why the file was not rendered, empty when it was
+        uint64_t notes = 0;
+        unsigned sequences = 0;     //more than one for a type 2 file, whose sequences are rendered to outputs of their own
+        unsigned frames = 0;
+        double parse_seconds = 0;
+        double render_seconds = 0;
+        unsigned worker = 0;
+
+        bool ok() const { return error.empty(); }
+    };
+
+    struct BATCH_SUMMARY
+    {
+        std::vector<BATCH_RESULT> results;     //in the order of the inputs
+        unsigned jobs;
+        uint64_t steals;
+        double seconds;
+    };
+
+    //renders every input into output_root, jobs files at a time, the threads and memory budget of the options are shared between the jobs
+    //a file that cannot be read, parsed or rendered only fails its own result, notes come from notes_cache unless it is nullptr
+    BATCH_SUMMARY render_batch(const std::vector<BATCH_INPUT>& inputs, const RENDER_OPTIONS& options, const std::string& output_root, const std::string& pattern, unsigned jobs,
+                               midi::NotesCache* notes_cache = nullptr);
+
+    void write_batch_summary(std::ostream& out, const BATCH_SUMMARY& summary);
+    void print_batch_summary(std::ostream& out, const BATCH_SUMMARY& summary);
+}
+
+#endif //MIDI_PROJECT_BATCH_H
@@ -0,0 +1,452 @@
+#include "frame-pipeline.h"
+#include "../util/bounded-queue.h"
+#include "../util/hash.h"
+#include "../util/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace rendering;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct FRAME_JOB
+    {
+        unsigned index;
+        std::shared_ptr<const imaging::Frame> frame;
+        std::shared_ptr<const imaging::Frame> previous_frame;     //only for sinks that encode differences
+        std::vector<uint8_t> data;
+        bool failed;
+        bool duplicate;
+        unsigned original_index;    //first frame with this content, the one that was actually encoded
+        unsigned match_index;       //the frame within the window this one was found to be equal to
+
+        explicit FRAME_JOB(unsigned index) : index(index), frame(), previous_frame(), data(), failed(false), duplicate(false), original_index(index), match_index(index) {};
+    };
+
+    struct WINDOW_ENTRY
+    {
+        unsigned index;
+        unsigned original_index;
+        uint64_t hash;
+        bool valid;
+    };
+
+    //a null job tells a worker that its stage is finished
+    using JobQueue = BoundedQueue<std::unique_ptr<FRAME_JOB>>;
+
+    struct StageCounters
+    {
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> starved_ns{0};
+        std::atomic<uint64_t> blocked_ns{0};
+        std::atomic<uint64_t> occupancy_sum{0};
+        std::atomic<uint64_t> occupancy_samples{0};
+    };
+
+    uint64_t nanoseconds_since(Clock::time_point start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+    std::unique_ptr<FRAME_JOB> pop(JobQueue& queue, StageCounters& counters)
+    {
+        counters.occupancy_sum += queue.size();
+        ++counters.occupancy_samples;
+
+        const auto start = Clock::now();
+        auto job = queue.pop();
+        counters.starved_ns += nanoseconds_since(start);
+
+        return job;
+    }
+
+    void push(JobQueue& queue, std::unique_ptr<FRAME_JOB> job, StageCounters& counters)
+    {
+        const auto start = Clock::now();
+        queue.push(std::move(job));
+        counters.blocked_ns += nanoseconds_since(start);
+    }
+
+    STAGE_STATISTICS to_statistics(const std::string& name, unsigned threads, const StageCounters& counters, size_t queue_capacity)
+    {
+        const auto samples = counters.occupancy_samples.load();
+
+        return STAGE_STATISTICS{
+            name,
+            threads,
+            counters.frames.load(),
+            counters.bytes.load(),
+            counters.busy_ns.load() / 1e9,
+            counters.starved_ns.load() / 1e9,
+            counters.blocked_ns.load() / 1e9,
+            samples == 0 ? 0.0 : static_cast<double>(counters.occupancy_sum.load()) / samples,
+            queue_capacity
+        };
+    }
+}
+
+PIPELINE_SETTINGS PIPELINE_SETTINGS::for_threads(unsigned thread_count)
+{
+    return PIPELINE_SETTINGS(std::max(thread_count / 4, 1U), std::max(thread_count / 2, 1U), std::max(thread_count / 4, 1U), std::max(thread_count * 2, 4U));
+}
+
+FramePipeline::FramePipeline(const PIPELINE_SETTINGS& settings, FrameSink& sink)
+        : settings(settings), sink(sink), stage_statistics(), deduplication_statistics{0, 0}, wall_seconds(0)
+{
+    this->settings.raster_threads = std::max(settings.raster_threads, 1U);
+    this->settings.encode_threads = std::max(settings.encode_threads, 1U);
+    this->settings.queue_capacity = std::max(settings.queue_capacity, 1U);
+
+    //a sink that needs its frames in order gets a single writer which reorders them
+    this->settings.write_threads = sink.ordered() ? 1 : std::max(settings.write_threads, 1U);
+}
+
+void FramePipeline::run(unsigned frame_count, const std::function<imaging::Frame(unsigned)>& rasterize_frame)
+{
+    const auto start = Clock::now();
+
+    JobQueue encode_queue(settings.queue_capacity);
+    JobQueue write_queue(settings.queue_capacity);
+    StageCounters raster_counters, encode_counters, write_counters;
+
+    //frames that were claimed by the raster stage but not written yet, this bounds the memory in use
+    //(and the size of the reorder buffer of an ordered sink) regardless of which stage is the slowest
+    const unsigned max_frames_in_flight = static_cast<unsigned>(encode_queue.capacity() + write_queue.capacity())
+                                          + settings.raster_threads + settings.encode_threads + settings.write_threads;
+    std::atomic<unsigned> next_frame(0);
+    std::atomic<unsigned> frames_written(0);
+    std::atomic<unsigned> running_rasterizers(settings.raster_threads);
+    std::atomic<unsigned> running_encoders(settings.encode_threads);
+
+    //duplicates are resolved strictly in frame order, so the outcome does not depend on thread timing:
+    //frame i only looks at the window once frames i - window .. i - 1 have been entered into it
+    //a sink that encodes the difference to the previous frame can only skip repeats of that previous frame
+    const bool keep_previous_frame = sink.needs_previous_frame();
+    const unsigned window_size = keep_previous_frame ? std::min(settings.deduplication_window, 1U) : settings.deduplication_window;
+    std::vector<WINDOW_ENTRY> window(window_size, WINDOW_ENTRY{0, 0, 0, false});
+    std::atomic<unsigned> frames_resolved(0);
+    std::shared_ptr<const imaging::Frame> last_frame;
+    std::atomic<uint64_t> duplicate_frames(0);
+    std::atomic<uint64_t> bytes_saved(0);
+
+    //unordered writers may only refer to an original once it has been written
+    std::vector<std::atomic<bool>> written(window_size == 0 ? 0 : frame_count);
+    std::vector<uint64_t> written_sizes(written.size(), 0);
+
+    auto resolve_in_order = [&](FRAME_JOB& job, uint64_t hash)
+    {
+        for(unsigned spins = 0; frames_resolved.load() != job.index; ++spins)
+        {
+            if(spins > 64) std::this_thread::sleep_for(std::chrono::microseconds(50));
+            else std::this_thread::yield();
+        }
+
+        if(!job.failed)
+        {
+            //the most recent match, which is the one an ordered writer still has cached
+            for(unsigned distance = 1; window_size != 0 && distance <= std::min(window_size, job.index); ++distance)
+            {
+                const auto& entry = window[(job.index - distance) % window_size];
+                if(entry.valid && entry.hash == hash)
+                {
+                    job.duplicate = true;
+                    job.original_index = entry.original_index;
+                    job.match_index = entry.index;
+                    break;
+                }
+            }
+        }
+
+        if(window_size != 0) window[job.index % window_size] = WINDOW_ENTRY{job.index, job.original_index, hash, !job.failed};
+
+        if(keep_previous_frame)
+        {
+            job.previous_frame = std::move(last_frame);
+            last_frame = job.frame;
+        }
+
+        frames_resolved.store(job.index + 1);
+    };
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto record_error = [&error_mutex, &error](FRAME_JOB& job)
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if(!error) error = std::current_exception();
+        job.failed = true;
+    };
+
+    auto rasterizer = [&]()
+    {
+        tracing::name_thread("raster");
+        for(unsigned i = next_frame++; i < frame_count; i = next_frame++)
+        {
+            const auto wait_start = Clock::now();
+            for(unsigned spins = 0; i >= frames_written.load() + max_frames_in_flight; ++spins)
+            {
+                if(spins > 64) std::this_thread::sleep_for(std::chrono::microseconds(50));
+                else std::this_thread::yield();
+            }
+            raster_counters.blocked_ns += nanoseconds_since(wait_start);
+
+            auto job = std::make_unique<FRAME_JOB>(i);
+            uint64_t hash = 0;
+            const auto busy_start = Clock::now();
+            try
+            {
+                tracing::Scope scope("rasterize");
+                job->frame = std::make_shared<const imaging::Frame>(rasterize_frame(i));
+                raster_counters.bytes += job->frame->pixels.size() * sizeof(uint32_t);
+
+                if(window_size != 0) hash = hashing::hash_bytes(job->frame->pixels.data(), job->frame->pixels.size() * sizeof(uint32_t));
+            }
+            catch(...) { record_error(*job); }
+            raster_counters.busy_ns += nanoseconds_since(busy_start);
+
+            if(window_size != 0 || keep_previous_frame)
+            {
+                const auto resolve_start = Clock::now();
+                resolve_in_order(*job, hash);
+                raster_counters.blocked_ns += nanoseconds_since(resolve_start);
+
+                if(job->duplicate)
+                {
+                    job->frame.reset();
+                    job->previous_frame.reset();
+                }
+            }
+            ++raster_counters.frames;
+
+            push(encode_queue, std::move(job), raster_counters);
+        }
+
+        if(--running_rasterizers == 0)
+        {
+            for(unsigned i = 0; i != settings.encode_threads; ++i) encode_queue.push(nullptr);
+        }
+    };
+
+    auto encoder = [&]()
+    {
+        tracing::name_thread("encode");
+        while(auto job = pop(encode_queue, encode_counters))
+        {
+            const auto busy_start = Clock::now();
+            if(!job->failed && !job->duplicate)
+            {
+                try
+                {
+                    tracing::Scope scope("encode");
+                    job->data = keep_previous_frame ? sink.encode_difference(job->index, *job->frame, job->previous_frame.get())
+                                                    : sink.encode(job->index, *job->frame);
+                    encode_counters.bytes += job->data.size();
+                }
+                catch(...) { record_error(*job); }
+            }
+            job->frame.reset();
+            job->previous_frame.reset();
+            encode_counters.busy_ns += nanoseconds_since(busy_start);
+            ++encode_counters.frames;
+
+            push(write_queue, std::move(job), encode_counters);
+        }
+
+        if(--running_encoders == 0)
+        {
+            for(unsigned i = 0; i != settings.write_threads; ++i) write_queue.push(nullptr);
+        }
+    };
+
+    //cached_data holds the encoded bytes when the ordered writer keeps them around for duplicates:
+    //those of the frame itself, or for a duplicate those of its original (see FrameSink::write_duplicate)
+    auto write = [&](FRAME_JOB& job, const std::vector<uint8_t>* cached_data)
+    {
+        static const std::vector<uint8_t> no_data;
+
+        const auto busy_start = Clock::now();
+        if(!job.failed)
+        {
+            try
+            {
+                tracing::Scope scope("write");
+                if(job.duplicate)
+                {
+                    const auto saved = written_sizes[job.original_index];
+                    sink.write_duplicate(job.index, job.original_index, cached_data ? *cached_data : no_data);
+                    ++duplicate_frames;
+                    bytes_saved += saved;
+                    written_sizes[job.index] = saved;
+                }
+                else
+                {
+                    const auto& data = cached_data ? *cached_data : job.data;
+                    sink.write(job.index, data);
+                    write_counters.bytes += data.size();
+                    tracing::count(tracing::Counter::BYTES_WRITTEN, data.size());
+                    if(!written.empty()) written_sizes[job.index] = data.size();
+                }
+            }
+            catch(...) { record_error(job); }
+        }
+        write_counters.busy_ns += nanoseconds_since(busy_start);
+        ++write_counters.frames;
+        tracing::count(tracing::Counter::FRAMES);
+        if(!written.empty()) written[job.index].store(true);
+        ++frames_written;
+    };
+
+    auto can_write = [&](const FRAME_JOB& job)
+    {
+        return !job.duplicate || written[job.original_index].load();
+    };
+
+    auto writer = [&]()
+    {
+        tracing::name_thread("write");
+        if(!sink.ordered())
+        {
+            //a duplicate can overtake its original in the queues, it waits here until the original has been written
+            std::vector<std::unique_ptr<FRAME_JOB>> deferred;
+            auto write_deferred = [&]()
+            {
+                auto ready = std::partition(deferred.begin(), deferred.end(), [&](const std::unique_ptr<FRAME_JOB>& job) { return !can_write(*job); });
+                for(auto it = ready; it != deferred.end(); ++it) write(**it, nullptr);
+                deferred.erase(ready, deferred.end());
+            };
+
+            while(auto job = pop(write_queue, write_counters))
+            {
+                if(can_write(*job)) write(*job, nullptr);
+                else deferred.push_back(std::move(job));
+
+                write_deferred();
+            }
+
+            //the originals are in the hands of the other writers
+            while(!deferred.empty())
+            {
+                std::this_thread::yield();
+                write_deferred();
+            }
+            return;
+        }
+
+        //the encoded bytes of the last frames, so a duplicate can write those of the frame it matched again
+        std::vector<std::shared_ptr<const std::vector<uint8_t>>> recent_data(window_size);
+
+        std::map<unsigned, std::unique_ptr<FRAME_JOB>> pending;
+        unsigned next_index = 0;
+        while(auto job = pop(write_queue, write_counters))
+        {
+            pending[job->index] = std::move(job);
+
+            for(auto it = pending.begin(); it != pending.end() && it->first == next_index; it = pending.erase(it), ++next_index)
+            {
+                auto& ready_job = *it->second;
+                if(window_size == 0)
+                {
+                    write(ready_job, nullptr);
+                    continue;
+                }
+
+                auto data = ready_job.duplicate ? recent_data[ready_job.match_index % window_size]
+                                                : std::make_shared<const std::vector<uint8_t>>(std::move(ready_job.data));
+                if(!data) ready_job.failed = true; //the frame it matched failed, that error was recorded already
+
+                write(ready_job, data.get());
+                recent_data[ready_job.index % window_size] = std::move(data);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned i = 0; i != settings.write_threads; ++i) threads.emplace_back(writer);
+    for(unsigned i = 0; i != settings.encode_threads; ++i) threads.emplace_back(encoder);
+    for(unsigned i = 0; i != settings.raster_threads; ++i) threads.emplace_back(rasterizer);
+    for(auto& thread : threads) thread.join();
+
+    wall_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stage_statistics = {
+        to_statistics("raster", settings.raster_threads, raster_counters, 0),
+        to_statistics("encode", settings.encode_threads, encode_counters, encode_queue.capacity()),
+        to_statistics("write", settings.write_threads, write_counters, write_queue.capacity())
+    };
+    deduplication_statistics = DEDUPLICATION_STATISTICS{duplicate_frames.load(), bytes_saved.load()};
+
+    if(error) std::rethrow_exception(error);
+}
+
+const std::vector<STAGE_STATISTICS>& FramePipeline::statistics() const
+{
+    return stage_statistics;
+}
+
+const DEDUPLICATION_STATISTICS& FramePipeline::deduplication() const
+{
+    return deduplication_statistics;
+}
+
+double FramePipeline::elapsed_seconds() const
+{
+    return wall_seconds;
+}
+
+void FramePipeline::print_report(std::ostream& out) const
+{
+    if(stage_statistics.empty()) return;
+
+    const auto frames = stage_statistics.back().frames;
+    out << "\nExported " << frames << " frames in " << std::fixed << std::setprecision(3) << wall_seconds << "s ("
+        << std::setprecision(1) << (wall_seconds > 0 ? frames / wall_seconds : 0) << " frames/sec)\n";
+
+    out << std::left << std::setw(8) << "stage" << std::right
+        << std::setw(8) << "threads" << std::setw(12) << "frames/sec" << std::setw(10) << "MB/sec"
+        << std::setw(8) << "busy" << std::setw(9) << "starved" << std::setw(9) << "blocked" << std::setw(16) << "input queue" << "\n";
+
+    const STAGE_STATISTICS* bottleneck = nullptr;
+    double highest_utilization = -1;
+    for(const auto& stage : stage_statistics)
+    {
+        const auto thread_seconds = wall_seconds * stage.threads;
+        auto percentage = [thread_seconds](double seconds) { return thread_seconds > 0 ? 100 * seconds / thread_seconds : 0; };
+
+        out << std::left << std::setw(8) << stage.name << std::right << std::setprecision(1)
+            << std::setw(8) << stage.threads
+            << std::setw(12) << (wall_seconds > 0 ? stage.frames / wall_seconds : 0)
+            << std::setw(10) << (wall_seconds > 0 ? stage.bytes / wall_seconds / (1024 * 1024) : 0)
+            << std::setw(7) << percentage(stage.busy_seconds) << "%"
+            << std::setw(8) << percentage(stage.starved_seconds) << "%"
+            << std::setw(8) << percentage(stage.blocked_seconds) << "%";
+
+        if(stage.queue_capacity == 0) out << std::setw(16) << "-";
+        else out << std::setw(10) << stage.average_queue_occupancy << " / " << std::setw(3) << stage.queue_capacity;
+        out << "\n";
+
+        if(percentage(stage.busy_seconds) > highest_utilization)
+        {
+            highest_utilization = percentage(stage.busy_seconds);
+            bottleneck = &stage;
+        }
+    }
+
+    out << "Bottleneck: " << bottleneck->name << (bottleneck->name == "write" ? " (I/O bound)" : " (CPU bound)") << "\n";
+
+    if(settings.deduplication_window != 0)
+    {
+        out << "Deduplicated " << deduplication_statistics.duplicate_frames << " of " << frames << " frames ("
+            << std::setprecision(1) << (frames > 0 ? 100.0 * deduplication_statistics.duplicate_frames / frames : 0) << "%), "
+            << std::setprecision(2) << deduplication_statistics.bytes_saved / (1024.0 * 1024.0) << " MB not encoded or written\n";
+    }
+    out.unsetf(std::ios_base::floatfield);
+}
@@ -0,0 +1,76 @@
+#ifndef MIDI_PROJECT_FRAME_PIPELINE_H
+#define MIDI_PROJECT_FRAME_PIPELINE_H
+
+#include "frame-sink.h"
+#include "../imaging/frame.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace rendering
+{
+    struct PIPELINE_SETTINGS
+    {
+        unsigned raster_threads;
+        unsigned encode_threads;
+        unsigned write_threads;
+        unsigned queue_capacity;
+        unsigned deduplication_window;  //a frame identical to one of the previous n frames is not encoded again, 0 disables this
+
+        PIPELINE_SETTINGS(unsigned raster_threads, unsigned encode_threads, unsigned write_threads, unsigned queue_capacity, unsigned deduplication_window = 0):
+                raster_threads(raster_threads), encode_threads(encode_threads), write_threads(write_threads), queue_capacity(queue_capacity), deduplication_window(deduplication_window) {};
+
+        //spreads thread_count threads over the stages, encoding is usually the most expensive one
+        static PIPELINE_SETTINGS for_threads(unsigned thread_count);
+    };
+
+    struct STAGE_STATISTICS
+    {
+        std::string name;
+        unsigned threads;
+        uint64_t frames;
+        uint64_t bytes;
+        double busy_seconds;
+        double starved_seconds;     //waiting for input
+        double blocked_seconds;     //waiting for room in the next stage's queue
+        double average_queue_occupancy;
+        size_t queue_capacity;
+    };
+
+    struct DEDUPLICATION_STATISTICS
+    {
+        uint64_t duplicate_frames;
+        uint64_t bytes_saved;       //encoded bytes that did not have to be produced and written again
+    };
+
+    //exports frames through three stages connected by bounded lock free queues:
+    //  raster: slices a frame out of the canvas and converts it to packed pixels
+    //  encode: turns the packed pixels into the sink's file format
+    //  write:  hands the encoded bytes to the sink (disk, pipe, ...)
+    //each stage has its own thread count, so CPU heavy and I/O heavy work overlap
+    //with deduplication enabled, the raster stage hashes every frame and compares it to the frames before it,
+    //duplicates skip the encoder and are handed to the sink's write_duplicate instead
+    class FramePipeline
+    {
+        PIPELINE_SETTINGS settings;
+        FrameSink& sink;
+        std::vector<STAGE_STATISTICS> stage_statistics;
+        DEDUPLICATION_STATISTICS deduplication_statistics;
+        double wall_seconds;
+
+    public:
+        FramePipeline(const PIPELINE_SETTINGS& settings, FrameSink& sink);
+
+        void run(unsigned frame_count, const std::function<imaging::Frame(unsigned)>& rasterize_frame);
+
+        const std::vector<STAGE_STATISTICS>& statistics() const;
+        const DEDUPLICATION_STATISTICS& deduplication() const;
+        double elapsed_seconds() const;
+        void print_report(std::ostream& out) const;
+    };
+}
+
+#endif //MIDI_PROJECT_FRAME_PIPELINE_H
@@ -0,0 +1,280 @@
+#include "frame-sink.h"
+#include "../imaging/delta-format.h"
+#include "../imaging/gif-format.h"
+#include "../imaging/jpeg-format.h"
+#include "../imaging/png-format.h"
+#include "../imaging/y4m-format.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace rendering;
+
+namespace
+{
+    //a full disk or a closed pipe must stop the render, not leave truncated frames behind
+    //name is the path of a file, or what a stream holds
+    void check_written(const std::ostream& out, const std::string& name)
+    {
+        if(!out) throw std::runtime_error("could not write " + name);
+    }
+}
+
+//frame names only depend on the frame index, so the order in which workers finish does not matter
+std::string rendering::frame_file_path(const std::string& target_directory_path, const std::string& pattern, unsigned frame_index, const std::string& extension)
+{
+    std::stringstream string_stream;
+    string_stream << std::setfill('0') << std::setw(5) << frame_index;
+
+    auto frame_name = pattern;
+    return target_directory_path + frame_name.replace(frame_name.find("%d"),2,string_stream.str()) + extension;
+}
+
+void FrameFileSink::write(unsigned frame_index, const std::vector<uint8_t>& data)
+{
+    const auto path = file_path(frame_index);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    out.close();
+    check_written(out, path);
+}
+
+void FrameFileSink::write_duplicate(unsigned frame_index, unsigned original_index, const std::vector<uint8_t>& original_data)
+{
+    if(duplicate_mode == DuplicateMode::MANIFEST)
+    {
+        std::lock_guard<std::mutex> lock(manifest_mutex);
+        duplicates.emplace_back(frame_index, original_index);
+        return;
+    }
+
+    //a file left over from a previous run would make create_hard_link fail
+    const auto path = file_path(frame_index);
+    std::filesystem::remove(path);
+    std::filesystem::create_hard_link(file_path(original_index), path);
+}
+
+void FrameFileSink::finish()
+{
+    if(duplicate_mode != DuplicateMode::MANIFEST) return;
+
+    //one line per skipped frame: the name it would have had and the name of the file holding its content
+    std::sort(duplicates.begin(), duplicates.end());
+    const auto manifest_path = target_directory_path + "frames.manifest";
+    std::ofstream manifest(manifest_path);
+    for(const auto& [frame_index, original_index] : duplicates)
+    {
+        const auto path = std::filesystem::path(file_path(frame_index)).filename();
+        const auto original_path = std::filesystem::path(file_path(original_index)).filename();
+
+        manifest << "skip " << path.string() << " " << original_path.string() << "\n";
+    }
+    manifest.close();
+    check_written(manifest, manifest_path);
+}
+
+std::string FrameFileSink::file_path(unsigned frame_index) const
+{
+    return frame_file_path(target_directory_path, pattern, frame_index, extension);
+}
+
+std::vector<uint8_t> BmpFileSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    return imaging::encode_bmp(frame, encoding);
+}
+
+std::vector<uint8_t> PngFileSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    return imaging::encode_png(frame, compression_level);
+}
+
+void RawStreamSink::begin(unsigned width, unsigned height, unsigned frame_count)
+{
+    std::cerr << "rawvideo: -f rawvideo -pix_fmt " << (pixel_format == RawPixelFormat::BGRA ? "bgra" : "rgb24")
+              << " -video_size " << width << "x" << height << " frames=" << frame_count << std::endl;
+}
+
+std::vector<uint8_t> RawStreamSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    if(pixel_format == RawPixelFormat::BGRA)
+    {
+        //frame pixels are stored as B, G, R, A bytes already
+        std::vector<uint8_t> data(frame.pixels.size() * sizeof(uint32_t));
+        memcpy(data.data(), frame.pixels.data(), data.size());
+
+        return data;
+    }
+
+    std::vector<uint8_t> data(frame.pixels.size() * 3);
+    auto target = data.data();
+    for(auto pixel : frame.pixels)
+    {
+        *target++ = uint8_t(pixel >> 16U);
+        *target++ = uint8_t(pixel >> 8U);
+        *target++ = uint8_t(pixel);
+    }
+
+    return data;
+}
+
+void RawStreamSink::write(unsigned frame_index, const std::vector<uint8_t>& data)
+{
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    check_written(out, "the raw video stream");
+}
+
+void RawStreamSink::finish()
+{
+    out.flush();
+    check_written(out, "the raw video stream");
+}
+
+void Y4mStreamSink::begin(unsigned width, unsigned height, unsigned frame_count)
+{
+    out << imaging::y4m_header(width, height, frames_per_second);
+    check_written(out, "the y4m stream");
+}
+
+std::vector<uint8_t> Y4mStreamSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    return imaging::encode_y4m_frame(frame, band_threads);
+}
+
+void Y4mStreamSink::write(unsigned frame_index, const std::vector<uint8_t>& data)
+{
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    check_written(out, "the y4m stream");
+}
+
+void Y4mStreamSink::finish()
+{
+    out.flush();
+    check_written(out, "the y4m stream");
+}
+
+void DeltaStreamSink::begin(unsigned width, unsigned height, unsigned frame_count)
+{
+    const auto header = imaging::encode_delta_header(imaging::DELTA_HEADER{width, height, frame_count, key_frame_interval, shift});
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    check_written(out, "the delta stream");
+    bytes_written = header.size();
+    record_offsets.clear();
+    record_offsets.reserve(frame_count);
+}
+
+std::vector<uint8_t> DeltaStreamSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    //frames are slices of one canvas, so a frame is always the previous one moved by shift columns plus its own last columns
+    //which means a delta only depends on the frame itself and can be encoded in parallel like any other format
+    const bool key_frame = frame_index == 0 || shift >= frame.width || (key_frame_interval != 0 && frame_index % key_frame_interval == 0);
+
+    return key_frame ? imaging::encode_key_frame(frame) : imaging::encode_delta_frame(frame, shift);
+}
+
+void DeltaStreamSink::write(unsigned frame_index, const std::vector<uint8_t>& data)
+{
+    record_offsets.push_back(bytes_written);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    check_written(out, "the delta stream");
+    bytes_written += data.size();
+}
+
+void DeltaStreamSink::finish()
+{
+    //without its index at the end the container cannot be read, so this has to reach the output as well
+    const auto index = imaging::encode_delta_index(record_offsets, bytes_written);
+    out.write(reinterpret_cast<const char*>(index.data()), index.size());
+    out.flush();
+    check_written(out, "the delta stream index");
+}
+
+void AviFileSink::begin(unsigned width, unsigned height, unsigned frame_count)
+{
+    out.open(path, std::ios::binary);
+    if(!out.is_open()) throw std::runtime_error("could not open " + path);
+
+    writer = std::make_unique<imaging::AviWriter>(out, width, height, frames_per_second, "MJPG");
+}
+
+std::vector<uint8_t> AviFileSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    return imaging::encode_jpeg(frame, quality);
+}
+
+void AviFileSink::write(unsigned frame_index, const std::vector<uint8_t>& data)
+{
+    writer->add_frame(data.data(), data.size());
+    check_written(out, path);
+}
+
+void AviFileSink::finish()
+{
+    writer->finish();
+    check_written(out, path);
+    out.close();
+}
+
+void GifFileSink::begin(unsigned width, unsigned height, unsigned frame_count)
+{
+    if(width > 0xFFFF || height > 0xFFFF) throw std::runtime_error("a gif can be at most 65535 pixels wide and high");
+
+    out.open(path, std::ios::binary);
+    if(!out.is_open()) throw std::runtime_error("could not open " + path);
+
+    const auto header = imaging::gif_header(width, height);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    check_written(out, path);
+}
+
+std::vector<uint8_t> GifFileSink::encode(unsigned frame_index, const imaging::Frame& frame)
+{
+    return encode_difference(frame_index, frame, nullptr);
+}
+
+std::vector<uint8_t> GifFileSink::encode_difference(unsigned frame_index, const imaging::Frame& frame, const imaging::Frame* previous_frame)
+{
+    return imaging::encode_gif_frame(frame, previous_frame, imaging::gif_frame_delay(frame_index, frames_per_second));
+}
+
+void GifFileSink::write(unsigned frame_index, const std::vector<uint8_t>& data)
+{
+    last_delay_position = static_cast<std::streamoff>(out.tellp()) + imaging::GIF_DELAY_OFFSET;
+    last_delay = imaging::gif_frame_delay(frame_index, frames_per_second);
+
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    check_written(out, path);
+}
+
+void GifFileSink::write_duplicate(unsigned frame_index, unsigned original_index, const std::vector<uint8_t>& original_data)
+{
+    //no image was written before this one (the original failed), so there is no delay to lengthen: store the frame itself
+    if(last_delay_position == -1)
+    {
+        if(original_data.empty()) throw std::runtime_error("frame " + std::to_string(frame_index) + " repeats a frame that was never written to " + path);
+        write(frame_index, original_data);
+        return;
+    }
+
+    //the previous frame is identical, so it simply stays on screen longer
+    last_delay = std::min(last_delay + imaging::gif_frame_delay(frame_index, frames_per_second), 0xFFFFU);
+
+    const char delay[] = { static_cast<char>(last_delay & 0xFF), static_cast<char>(last_delay >> 8) };
+    const auto end = out.tellp();
+    out.seekp(last_delay_position);
+    out.write(delay, sizeof(delay));
+    out.seekp(end);
+    check_written(out, path);
+}
+
+void GifFileSink::finish()
+{
+    const auto trailer = imaging::gif_trailer();
+    out.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+    out.close();
+    check_written(out, path);
+}
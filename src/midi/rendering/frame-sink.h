@@ -0,0 +1,222 @@
+#ifndef MIDI_PROJECT_FRAME_SINK_H
+#define MIDI_PROJECT_FRAME_SINK_H
+
+#include "../imaging/avi-format.h"
+#include "../imaging/bmp-format.h"
+#include "../imaging/frame.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rendering
+{
+    //receives the frames exported by the renderer
+    //encode is called concurrently by the encoder threads, write by the writer threads
+    struct FrameSink
+    {
+        virtual ~FrameSink() = default;
+
+        //called once before the first frame and once after the last one
+        virtual void begin(unsigned width, unsigned height, unsigned frame_count) {}
+        virtual void finish() {}
+
+        //passes what was written so far on to the reader of a stream, for frames that are shown as they are made
+        virtual void flush() {}
+
+        virtual std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) = 0;
+        virtual void write(unsigned frame_index, const std::vector<uint8_t>& data) = 0;
+
+        //sinks that only store what changed since the previous frame return true, encode_difference is then called
+        //instead of encode, with the previous frame (nullptr for the first frame or when it could not be rendered)
+        //duplicates are then only detected for repeats of the previous frame
+        virtual bool needs_previous_frame() const { return false; }
+        virtual std::vector<uint8_t> encode_difference(unsigned frame_index, const imaging::Frame& frame, const imaging::Frame* previous_frame)
+        {
+            return encode(frame_index, frame);
+        }
+
+        //called instead of encode and write for a frame that is identical to an earlier, already written frame
+        //ordered sinks receive the encoded bytes of the original and by default simply write them again,
+        //unordered sinks receive no bytes and have to refer to the original instead
+        virtual void write_duplicate(unsigned frame_index, unsigned original_index, const std::vector<uint8_t>& original_data)
+        {
+            write(frame_index, original_data);
+        }
+
+        //true when write has to receive the frames in order, e.g. when they are appended to one stream
+        virtual bool ordered() const = 0;
+    };
+
+    enum class DuplicateMode { HARDLINK, MANIFEST };
+
+    //writes every frame to its own file, the pattern's %d is replaced by the zero padded frame index
+    //a duplicate frame becomes a hardlink to the file of its original, or with DuplicateMode::MANIFEST
+    //is not written at all and only listed as a skip entry in frames.manifest
+    struct FrameFileSink : FrameSink
+    {
+        private:
+            std::string target_directory_path;
+            std::string pattern;
+            std::string extension;
+            DuplicateMode duplicate_mode;
+            std::mutex manifest_mutex;
+            std::vector<std::pair<unsigned, unsigned>> duplicates;
+
+        public:
+            FrameFileSink(std::string target_directory_path, std::string pattern, std::string extension)
+                : target_directory_path(std::move(target_directory_path)), pattern(std::move(pattern)), extension(std::move(extension)), duplicate_mode(DuplicateMode::HARDLINK) {};
+
+            void write(unsigned frame_index, const std::vector<uint8_t>& data) override;
+            void write_duplicate(unsigned frame_index, unsigned original_index, const std::vector<uint8_t>& original_data) override;
+            void finish() override;
+            bool ordered() const override { return false; }
+
+            void set_duplicate_mode(DuplicateMode mode) { duplicate_mode = mode; }
+            std::string file_path(unsigned frame_index) const;
+    };
+
+    struct BmpFileSink : FrameFileSink
+    {
+        private:
+            imaging::BmpEncoding encoding;
+
+        public:
+            BmpFileSink(std::string target_directory_path, std::string pattern, imaging::BmpEncoding encoding = imaging::BmpEncoding::RGB32)
+                : FrameFileSink(std::move(target_directory_path), std::move(pattern), ".bmp"), encoding(encoding) {};
+
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+    };
+
+    struct PngFileSink : FrameFileSink
+    {
+        private:
+            int compression_level;
+
+        public:
+            PngFileSink(std::string target_directory_path, std::string pattern, int compression_level)
+                : FrameFileSink(std::move(target_directory_path), std::move(pattern), ".png"), compression_level(compression_level) {};
+
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+    };
+
+    enum class RawPixelFormat { BGRA, RGB24 };
+
+    //writes the bare pixels of every frame back to back into one stream (stdout or a named pipe),
+    //so an encoder can read them directly: ffmpeg -f rawvideo -pix_fmt bgra -video_size WxH -i -
+    //the dimensions are announced on stderr in begin, the stream itself carries no header
+    struct RawStreamSink : FrameSink
+    {
+        private:
+            std::ostream& out;
+            RawPixelFormat pixel_format;
+
+        public:
+            RawStreamSink(std::ostream& out, RawPixelFormat pixel_format) : out(out), pixel_format(pixel_format) {};
+
+            void begin(unsigned width, unsigned height, unsigned frame_count) override;
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+            void write(unsigned frame_index, const std::vector<uint8_t>& data) override;
+            void finish() override;
+            void flush() override { out.flush(); }
+            bool ordered() const override { return true; }
+    };
+
+    //writes a YUV4MPEG2 stream, colour conversion to 4:2:0 happens here so the encoder only has to encode
+    //every frame is converted by band_threads threads, each working on its own band of rows
+    struct Y4mStreamSink : FrameSink
+    {
+        private:
+            std::ostream& out;
+            unsigned frames_per_second;
+            unsigned band_threads;
+
+        public:
+            Y4mStreamSink(std::ostream& out, unsigned frames_per_second, unsigned band_threads)
+                : out(out), frames_per_second(frames_per_second), band_threads(band_threads) {};
+
+            void begin(unsigned width, unsigned height, unsigned frame_count) override;
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+            void write(unsigned frame_index, const std::vector<uint8_t>& data) override;
+            void finish() override;
+            void flush() override { out.flush(); }
+            bool ordered() const override { return true; }
+    };
+
+    //writes a column delta container (see imaging/delta-format.h) for frames that scroll shift columns at a time
+    //every key_frame_interval-th frame is stored completely, the others only store their new columns
+    struct DeltaStreamSink : FrameSink
+    {
+        private:
+            std::ostream& out;
+            unsigned shift;
+            unsigned key_frame_interval;
+            uint64_t bytes_written;
+            std::vector<uint64_t> record_offsets;
+
+        public:
+            DeltaStreamSink(std::ostream& out, unsigned shift, unsigned key_frame_interval)
+                : out(out), shift(shift), key_frame_interval(key_frame_interval), bytes_written(0), record_offsets() {};
+
+            void begin(unsigned width, unsigned height, unsigned frame_count) override;
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+            void write(unsigned frame_index, const std::vector<uint8_t>& data) override;
+            void finish() override;
+            bool ordered() const override { return true; }
+    };
+
+    //writes a Motion JPEG AVI file, a preview that plays without any external tools
+    //the frames are JPEG encoded in parallel by the encoder threads, the AVI index is written by finish
+    struct AviFileSink : FrameSink
+    {
+        private:
+            std::string path;
+            unsigned frames_per_second;
+            int quality;
+            std::ofstream out;
+            std::unique_ptr<imaging::AviWriter> writer;
+
+        public:
+            AviFileSink(std::string path, unsigned frames_per_second, int quality)
+                : path(std::move(path)), frames_per_second(frames_per_second), quality(quality), out(), writer() {};
+
+            void begin(unsigned width, unsigned height, unsigned frame_count) override;
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+            void write(unsigned frame_index, const std::vector<uint8_t>& data) override;
+            void finish() override;
+            bool ordered() const override { return true; }
+    };
+
+    //writes an animated GIF which loops forever, every frame but the first only stores the rectangle that changed
+    //a repeated frame does not add an image, the delay of the frame before it is lengthened instead
+    struct GifFileSink : FrameSink
+    {
+        private:
+            std::string path;
+            unsigned frames_per_second;
+            std::ofstream out;
+            std::streamoff last_delay_position;
+            unsigned last_delay;
+
+        public:
+            GifFileSink(std::string path, unsigned frames_per_second)
+                : path(std::move(path)), frames_per_second(frames_per_second), out(), last_delay_position(-1), last_delay(0) {};
+
+            void begin(unsigned width, unsigned height, unsigned frame_count) override;
+            std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override;
+            bool needs_previous_frame() const override { return true; }
+            std::vector<uint8_t> encode_difference(unsigned frame_index, const imaging::Frame& frame, const imaging::Frame* previous_frame) override;
+            void write(unsigned frame_index, const std::vector<uint8_t>& data) override;
+            void write_duplicate(unsigned frame_index, unsigned original_index, const std::vector<uint8_t>& original_data) override;
+            void finish() override;
+            bool ordered() const override { return true; }
+    };
+
+    std::string frame_file_path(const std::string& target_directory_path, const std::string& pattern, unsigned frame_index, const std::string& extension);
+}
+
+#endif //MIDI_PROJECT_FRAME_SINK_H
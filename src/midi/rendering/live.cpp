@@ -0,0 +1,238 @@
+#include "live.h"
+#include "../logging.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace rendering;
+
+uint64_t rendering::live_clock()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+//LIVE ROLL
+LiveRoll::LiveRoll(uint64_t origin, uint64_t window)
+    : origin(origin), window(window), finished_notes(),
+      note_collector([this](const midi::NOTE& note) { finished_notes.push_back(note); }),
+      decoder(note_collector, origin), arrivals()
+{
+}
+
+void LiveRoll::feed(const uint8_t* bytes, size_t size, uint64_t time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto events_before = decoder.events();
+    decoder.feed(bytes, size, time);
+    arrivals.insert(arrivals.end(), decoder.events() - events_before, time);
+}
+
+LIVE_SNAPSHOT LiveRoll::snapshot(uint64_t time)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    LIVE_SNAPSHOT snapshot;
+    snapshot.time = std::max(time, origin) - origin;
+
+    //notes are released in time order, so the ones that left the window are at the front
+    while(!finished_notes.empty())
+    {
+        const auto& note = finished_notes.front();
+        if(value(note.start) + value(note.duration) + window >= snapshot.time) break;
+        finished_notes.pop_front();
+    }
+
+    snapshot.notes.assign(finished_notes.begin(), finished_notes.end());
+    for(auto note : note_collector.sounding_notes())
+    {
+        note.duration = midi::Duration(snapshot.time > value(note.start) ? snapshot.time - value(note.start) : 0);
+        snapshot.notes.push_back(note);
+    }
+    snapshot.arrivals.swap(arrivals);
+
+    return snapshot;
+}
+//END LIVE ROLL
+
+imaging::Frame rendering::draw_live_frame(const LIVE_SNAPSHOT& snapshot, uint64_t window, unsigned width, unsigned note_height, const NoteColors& note_colors)
+{
+    imaging::Frame frame(width, 128 * note_height);
+
+    //the column of a time, negative before the window
+    auto column_of = [&](uint64_t time) {
+        const auto age = snapshot.time > time ? snapshot.time - time : 0;
+        return int64_t(width) - static_cast<int64_t>(std::min(age, window + 1) * width / window);
+    };
+
+    for(const auto& note : snapshot.notes)
+    {
+        const auto end = column_of(value(note.start) + value(note.duration));
+        if(end < 0) continue;
+
+        //a note shorter than a column still gets one
+        const auto first = std::clamp<int64_t>(column_of(value(note.start)), 0, int64_t(width) - 1);
+        const auto last = std::clamp<int64_t>(end, first + 1, width);
+
+        const auto color = note_colors.argb_of(note);
+        const auto top = (127U - value(note.note_number)) * note_height;
+        for(unsigned i = 0; i != note_height; ++i)
+        {
+            auto* row = frame.row(top + i);
+            std::fill(row + first, row + last, color);
+        }
+    }
+
+    return frame;
+}
+
+//LIVE SESSION
+int rendering::open_live_input(const std::string& path)
+{
+    if(path == "-") return STDIN_FILENO;
+
+    struct stat status{};
+    CHECK(stat(path.c_str(), &status) == 0) << "Could not find " << path;
+
+    if(S_ISSOCK(status.st_mode))
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        CHECK(path.size() < sizeof(address.sun_path)) << "Socket path too long: " << path;
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        const int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        CHECK(socket_fd != -1 && connect(socket_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) << "Could not connect to " << path;
+        return socket_fd;
+    }
+
+    //opening a FIFO waits until the other end is opened for writing
+    const int fd = open(path.c_str(), O_RDONLY);
+    CHECK(fd != -1) << "Could not open " << path;
+    return fd;
+}
+
+LIVE_REPORT rendering::run_live(int input, FrameSink& sink, const LIVE_SETTINGS& settings)
+{
+    const auto start = live_clock();
+    LiveRoll roll(start, settings.window);
+
+    //the reader stamps the bytes as they arrive, it wakes up now and then to see whether the session is over
+    std::atomic<bool> stop{false};
+    std::atomic<bool> input_ended{false};
+    std::thread reader([&]() {
+        uint8_t buffer[4096];
+        while(!stop.load())
+        {
+            pollfd poll_fd{input, POLLIN, 0};
+            const auto ready = poll(&poll_fd, 1, 50);
+            if(ready < 0 && errno != EINTR) break;
+            if(ready <= 0) continue;
+
+            const auto size = read(input, buffer, sizeof(buffer));
+            if(size < 0 && errno == EINTR) continue;
+            if(size <= 0) break;
+
+            roll.feed(buffer, static_cast<size_t>(size), live_clock());
+        }
+        input_ended.store(true);
+    });
+
+    //a sink whose consumer went away throws, the reader is stopped and joined on that way out as well
+    struct STOP_READER
+    {
+        std::atomic<bool>& stop;
+        std::thread& reader;
+
+        ~STOP_READER()
+        {
+            stop.store(true);
+            if(reader.joinable()) reader.join();
+        }
+    } stop_reader{stop, reader};
+
+    LIVE_REPORT report;
+    const NoteColors note_colors(theme_named(settings.theme));
+    const uint64_t interval = 1000000 / std::max(settings.frames_per_second, 1U);
+    sink.begin(settings.frame_width, 128 * settings.note_height, 0);
+
+    auto deadline = start;
+    while(true)
+    {
+        const auto before = live_clock();
+        if(before < deadline) std::this_thread::sleep_for(std::chrono::microseconds(deadline - before));
+
+        const auto now = live_clock();
+        if(now >= deadline + interval)
+        {
+            const auto missed = (now - deadline) / interval;
+            report.frames_dropped += static_cast<unsigned>(missed);
+            deadline += missed * interval;
+        }
+
+        //read before the snapshot, so the last frame holds everything the input had
+        const bool last = input_ended.load() || (settings.duration != 0 && now - start >= settings.duration);
+        const auto snapshot = roll.snapshot(now);
+
+        const auto frame = draw_live_frame(snapshot, settings.window, settings.frame_width, settings.note_height, note_colors);
+        sink.write(report.frames_written, sink.encode(report.frames_written, frame));
+        sink.flush();
+        ++report.frames_written;
+
+        const auto written = live_clock();
+        for(auto arrival : snapshot.arrivals)
+        {
+            const auto latency = written - arrival;
+            report.latency.record(latency);
+            if(latency > settings.latency_budget) ++report.over_budget;
+        }
+        report.events += snapshot.arrivals.size();
+
+        if(last) break;
+        deadline += interval;
+    }
+
+    stop.store(true);
+    reader.join();
+    sink.finish();
+
+    return report;
+}
+
+void rendering::write_live_report(std::ostream& out, const LIVE_REPORT& report, const LIVE_SETTINGS& settings)
+{
+    out << "{\n  \"frames_per_second\": " << settings.frames_per_second << ",\n  \"window_us\": " << settings.window
+        << ",\n  \"latency_budget_us\": " << settings.latency_budget << ",\n  \"frames_written\": " << report.frames_written
+        << ",\n  \"frames_dropped\": " << report.frames_dropped << ",\n  \"events\": " << report.events
+        << ",\n  \"over_budget\": " << report.over_budget << ",\n  \"latency\": ";
+    report.latency.write_json(out, "  ");
+    out << "\n}\n";
+}
+
+void rendering::print_live_report(std::ostream& out, const LIVE_REPORT& report, const LIVE_SETTINGS& settings)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+
+    auto milliseconds = [](uint64_t microseconds) { return double(microseconds) / 1000; };
+    out << "Live: " << report.frames_written << " frames written, " << report.frames_dropped << " dropped, " << report.events << " events\n"
+        << "Input to pixel latency: p50 " << milliseconds(report.latency.percentile(0.5)) << "ms, p90 " << milliseconds(report.latency.percentile(0.9))
+        << "ms, p99 " << milliseconds(report.latency.percentile(0.99)) << "ms, max " << milliseconds(report.latency.max()) << "ms\n"
+        << report.over_budget << " events over the " << milliseconds(settings.latency_budget) << "ms budget" << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+//END LIVE SESSION
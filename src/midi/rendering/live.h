@@ -0,0 +1,94 @@
+#ifndef MIDI_PROJECT_RENDERING_LIVE_H
+#define MIDI_PROJECT_RENDERING_LIVE_H
+
+#include "frame-sink.h"
+#include "note-colors.h"
+#include "../imaging/frame.h"
+#include "../midi/live.h"
+#include "../util/latency-histogram.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rendering
+{
+    //microseconds on a clock that never goes back
+    uint64_t live_clock();
+
+    //LIVE ROLL
+    struct LIVE_SNAPSHOT
+    {
+        uint64_t time;                      //microseconds since the origin
+        std::vector<midi::NOTE> notes;      //times in microseconds since the origin, notes that are still held end at time
+        std::vector<uint64_t> arrivals;     //live_clock times of the events that arrived since the previous snapshot
+    };
+
+    //the notes of the last window microseconds of a live performance
+    //bytes are fed by the thread reading the input while the frames are drawn from snapshots on another thread
+    class LiveRoll
+    {
+        std::mutex mutex;
+        uint64_t origin;
+        uint64_t window;
+        std::deque<midi::NOTE> finished_notes;      //in the order they were released
+        midi::LiveNoteCollector note_collector;
+        midi::LiveDecoder decoder;
+        std::vector<uint64_t> arrivals;
+
+    public:
+        LiveRoll(uint64_t origin, uint64_t window);
+
+        LiveRoll(const LiveRoll&) = delete;
+        LiveRoll& operator =(const LiveRoll&) = delete;
+
+        //time is the live_clock time the bytes arrived
+        void feed(const uint8_t* bytes, size_t size, uint64_t time);
+
+        //forgets the notes that ended before the window
+        LIVE_SNAPSHOT snapshot(uint64_t time);
+    };
+    //END LIVE ROLL
+
+    //the right edge of the frame is the time of the snapshot, the left edge window microseconds earlier
+    //every key has a row of note_height pixels, the highest key at the top
+    imaging::Frame draw_live_frame(const LIVE_SNAPSHOT& snapshot, uint64_t window, unsigned width, unsigned note_height, const NoteColors& note_colors);
+
+    //LIVE SESSION
+    struct LIVE_SETTINGS
+    {
+        unsigned frame_width = 1280;
+        unsigned note_height = 16;
+        unsigned frames_per_second = 30;
+        uint64_t window = 5000000;          //in microseconds
+        uint64_t latency_budget = 100000;   //in microseconds
+        uint64_t duration = 0;              //in microseconds, 0 runs until the input ends
+        std::string theme = "instruments";
+    };
+
+    struct LIVE_REPORT
+    {
+        unsigned frames_written = 0;
+        unsigned frames_dropped = 0;        //deadlines that passed while an earlier frame was still being made
+        uint64_t events = 0;
+        uint64_t over_budget = 0;           //events that took longer than the latency budget to reach a written frame
+        LatencyHistogram latency;           //from the arrival of an event to the end of the write of the first frame showing it
+    };
+
+    //a midi byte stream: stdin for "-", a unix domain socket, or anything that can be opened for reading like a FIFO
+    //returns the file descriptor
+    int open_live_input(const std::string& path);
+
+    //reads input until it ends or the duration is over and writes a frame to sink every 1/fps seconds
+    //a frame is never made late to catch up: when a deadline passes before the previous frame is written,
+    //it is dropped so the next frame shows the newest state instead of building up a backlog of stale ones
+    LIVE_REPORT run_live(int input, FrameSink& sink, const LIVE_SETTINGS& settings);
+
+    void write_live_report(std::ostream& out, const LIVE_REPORT& report, const LIVE_SETTINGS& settings);
+    void print_live_report(std::ostream& out, const LIVE_REPORT& report, const LIVE_SETTINGS& settings);
+    //END LIVE SESSION
+}
+
+#endif //MIDI_PROJECT_RENDERING_LIVE_H
@@ -0,0 +1,53 @@
+#include "note-colors.h"
+#include "../imaging/frame.h"
+#include "../logging.h"
+
+//COLOR THEMES
+bool rendering::is_known_theme(const std::string& name)
+{
+    return name == "instruments" || name == "mono";
+}
+
+rendering::COLOR_THEME rendering::theme_named(const std::string& name)
+{
+    CHECK(is_known_theme(name)) << "Unknown theme " << name;
+
+    if(name == "mono") return COLOR_THEME{ { imaging::colors::orange() }, 0.3 };
+
+    //piano, chromatic percussion, organ, guitar, bass, strings, ensemble, brass,
+    //reed, pipe, synth lead, synth pad, synth effects, ethnic, percussive, sound effects
+    return COLOR_THEME{
+        {
+            { 1.0, 0.85, 0.4 }, { 0.4, 0.9, 1.0 }, { 0.9, 0.4, 0.2 }, { 0.3, 0.8, 0.3 },
+            { 0.2, 0.4, 1.0 }, { 0.9, 0.2, 0.4 }, { 1.0, 0.5, 0.7 }, { 1.0, 0.65, 0.1 },
+            { 0.6, 0.9, 0.2 }, { 0.5, 1.0, 0.8 }, { 1.0, 0.2, 1.0 }, { 0.6, 0.5, 1.0 },
+            { 0.3, 0.6, 0.9 }, { 0.8, 0.6, 0.4 }, { 0.7, 0.7, 0.7 }, { 0.5, 0.5, 0.5 }
+        },
+        0.3
+    };
+}
+
+rendering::NoteColors::NoteColors(const COLOR_THEME& theme)
+    : argb(128 * 128)
+{
+    CHECK(!theme.instrument_colors.empty()) << "A theme needs at least one colour";
+    CHECK(theme.quietest_brightness >= 0 && theme.quietest_brightness <= 1) << "The quietest brightness has to lie in [0, 1]";
+
+    //to_argb does not saturate, a component outside [0, 1] would wrap around
+    auto in_range = [](double component) { return component >= 0 && component <= 1; };
+    for(const auto& color : theme.instrument_colors)
+    {
+        CHECK(in_range(color.r) && in_range(color.g) && in_range(color.b)) << "Theme colours have to lie in [0, 1]";
+    }
+
+    for(size_t instrument = 0; instrument != 128; ++instrument)
+    {
+        const auto& color = theme.instrument_colors[instrument * theme.instrument_colors.size() / 128];
+        for(size_t velocity = 0; velocity != 128; ++velocity)
+        {
+            const auto brightness = theme.quietest_brightness + (1 - theme.quietest_brightness) * velocity / 127.0;
+            argb[instrument * 128 + velocity] = imaging::to_argb(color * brightness);
+        }
+    }
+}
+//END COLOR THEMES
@@ -0,0 +1,41 @@
+#ifndef MIDI_PROJECT_RENDERING_NOTE_COLORS_H
+#define MIDI_PROJECT_RENDERING_NOTE_COLORS_H
+
+#include "../imaging/color.h"
+#include "../midi/midi.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rendering
+{
+    //COLOR THEMES
+    //a note takes the colour of its instrument, the louder it is played the brighter
+    struct COLOR_THEME
+    {
+        std::vector<imaging::Color> instrument_colors;  //spread evenly over the 128 instruments, e.g. 16 for the general midi families
+        double quietest_brightness;                     //of velocity 0, velocity 127 gets the full colour, colours and brightness lie in [0, 1]
+    };
+
+    //instruments: a colour per general midi family, mono: every instrument orange
+    bool is_known_theme(const std::string& name);
+    COLOR_THEME theme_named(const std::string& name);
+
+    //the colour of every instrument and velocity, worked out once from a theme so drawing a note takes one lookup
+    class NoteColors
+    {
+        std::vector<uint32_t> argb;     //128 velocities per instrument
+
+        size_t index_of(const midi::NOTE& note) const { return std::min<size_t>(value(note.instrument), 127) * 128 + std::min<size_t>(note.velocity, 127); }
+
+    public:
+        explicit NoteColors(const COLOR_THEME& theme);
+
+        //the packed pixel, drawn on the canvas and copied into frames as it is
+        uint32_t argb_of(const midi::NOTE& note) const { return argb[index_of(note)]; }
+    };
+    //END COLOR THEMES
+}
+
+#endif //MIDI_PROJECT_RENDERING_NOTE_COLORS_H
@@ -0,0 +1,283 @@
+#include "render-job.h"
+#include "render-plan.h"
+#include "renderer.h"
+#include "../util/trace.h"
+#include "../util/work-stealing-pool.h"
+#include "../logging.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace rendering;
+
+namespace
+{
+    NOTE_RENDERING_DATA calculate_note_rendering_data(const std::vector<midi::NOTE>& notes, unsigned note_height)
+    {
+        //calculate the width needed for the renderer
+        const auto ending_note = std::max_element(notes.begin(),notes.end(),
+                [](const midi::NOTE& note_l, const midi::NOTE& note_r)
+                {
+                    return (value(note_l.start) + value(note_l.duration)) < (value(note_r.start) + value(note_r.duration));
+                });
+
+        //get the lowest and highest note
+        const auto [lowest_note,highest_note] = std::minmax_element(notes.begin(),notes.end(),
+                [](const midi::NOTE& note_l, const midi::NOTE& note_r)
+                {
+                    return value(note_l.note_number) < value(note_r.note_number);
+                });
+
+        return NOTE_RENDERING_DATA(note_height,value(lowest_note->note_number), value(highest_note->note_number), value(ending_note->start + ending_note->duration));
+    }
+
+    //render_notes once the options are known to work, a sink that cannot open or write its output throws
+    unsigned render_to_sink(const std::vector<midi::NOTE>& notes, const RENDER_OPTIONS& options, const std::string& output, const std::string& pattern, std::ostream* report)
+    {
+        auto renderer = Renderer(options.frame_width,options.horizontal_step,options.horizontal_scale, calculate_note_rendering_data(notes, options.note_height),
+                                 options.scratch_directory, options.memory_budget);
+        renderer.set_report(report);
+        renderer.set_theme(theme_named(options.theme));
+
+        {
+            tracing::Scope scope("collect_notes");
+            for(auto& note: notes) {
+                renderer.draw_note(note);
+            }
+        }
+
+        //stages that were not sized explicitly get their share of the threads
+        auto pipeline_settings = options.pipeline_settings;
+        const auto default_settings = PIPELINE_SETTINGS::for_threads(options.thread_count);
+        if(pipeline_settings.raster_threads == 0) pipeline_settings.raster_threads = default_settings.raster_threads;
+        if(pipeline_settings.encode_threads == 0) pipeline_settings.encode_threads = default_settings.encode_threads;
+        if(pipeline_settings.write_threads == 0) pipeline_settings.write_threads = default_settings.write_threads;
+        if(pipeline_settings.queue_capacity == 0) pipeline_settings.queue_capacity = default_settings.queue_capacity;
+        pipeline_settings.deduplication_window = options.deduplication_window;
+
+        //duplicate frames become hardlinks to the first file with the same content, or skip entries in frames.manifest
+        const auto duplicate_mode = options.deduplication_manifest ? DuplicateMode::MANIFEST : DuplicateMode::HARDLINK;
+
+        const auto& format = options.format;
+        if(format == "bmp")
+        {
+            //rle8 falls back to rgb32 for frames with more than 256 colours
+            BmpFileSink frame_sink(output, pattern, options.bmp_encoding == "rle8" ? imaging::BmpEncoding::RLE8 : imaging::BmpEncoding::RGB32);
+            frame_sink.set_duplicate_mode(duplicate_mode);
+            renderer.render_frames(frame_sink, pipeline_settings);
+        }
+        else if(format == "png")
+        {
+            PngFileSink frame_sink(output, pattern, static_cast<int>(options.compression_level));
+            frame_sink.set_duplicate_mode(duplicate_mode);
+            renderer.render_frames(frame_sink, pipeline_settings);
+        }
+        else if(format == "avi")
+        {
+            AviFileSink frame_sink(output, options.frames_per_second, static_cast<int>(options.quality));
+            renderer.render_frames(frame_sink, pipeline_settings);
+        }
+        else if(format == "gif")
+        {
+            GifFileSink frame_sink(output, options.frames_per_second);
+            renderer.render_frames(frame_sink, pipeline_settings);
+        }
+        else
+        {
+            //a named pipe is opened like any other file, the writer blocks until the encoder opens the other end
+            std::ofstream output_file_stream;
+            if(!output.empty() && output != "-")
+            {
+                output_file_stream.open(output, std::ios_base::binary);
+                if(!output_file_stream.is_open()) throw std::runtime_error("could not open " + output);
+            }
+            auto& out = output_file_stream.is_open() ? static_cast<std::ostream&>(output_file_stream) : std::cout;
+
+            //left unspecified, the threads an encoder does not get from -j convert its frame in bands
+            const auto band_threads = options.band_threads != 0 ? options.band_threads : std::max(options.thread_count / pipeline_settings.encode_threads, 1U);
+            const auto frame_sink = make_stream_sink(options, out, band_threads);
+            renderer.render_frames(*frame_sink, pipeline_settings);
+        }
+
+        return renderer.frame_count();
+    }
+}
+
+bool rendering::is_known_format(const std::string& format)
+{
+    return format == "bmp" || format == "png" || is_single_file_format(format);
+}
+
+bool rendering::is_streamed_format(const std::string& format)
+{
+    return format == "raw" || format == "y4m" || format == "delta";
+}
+
+bool rendering::is_single_file_format(const std::string& format)
+{
+    return is_streamed_format(format) || format == "avi" || format == "gif";
+}
+
+std::string rendering::file_extension(const std::string& format)
+{
+    return format == "delta" ? ".mfd" : "." + format;
+}
+
+const char* rendering::render_problem(const std::vector<midi::NOTE>& notes, const RENDER_OPTIONS& options)
+{
+    if(!is_known_format(options.format)) return "unknown format";
+    if(!is_known_theme(options.theme)) return "unknown theme";
+    if(options.format == "bmp" && options.bmp_encoding != "rgb32" && options.bmp_encoding != "rle8") return "unknown bmp encoding";
+    if(options.format == "raw" && options.pixel_format != "bgra" && options.pixel_format != "rgb24") return "unknown pixel format";
+    if(options.horizontal_step == 0) return "the horizontal step has to be at least 1";
+    if(notes.empty()) return "no notes";
+
+    const auto note_rendering_data = calculate_note_rendering_data(notes, options.note_height);
+    const uint64_t canvas_width = uint64_t(note_rendering_data.ending_note_time_value/20) * options.horizontal_scale;
+    if(canvas_width > UINT32_MAX) return "the canvas would be too wide, lower the horizontal scale";
+
+    if(options.format == "gif")
+    {
+        const uint64_t canvas_height = uint64_t(options.note_height) * (note_rendering_data.highest_note_number_value - note_rendering_data.lowest_note_number_value + 1);
+        const uint64_t frame_width = options.frame_width == 0 ? canvas_width : options.frame_width;
+        if(frame_width > 0xFFFF || canvas_height > 0xFFFF) return "a gif can be at most 65535 pixels wide and high";
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<FrameSink> rendering::make_stream_sink(const RENDER_OPTIONS& options, std::ostream& out, unsigned band_threads)
+{
+    if(options.format == "raw")
+    {
+        return std::make_unique<RawStreamSink>(out, options.pixel_format == "bgra" ? RawPixelFormat::BGRA : RawPixelFormat::RGB24);
+    }
+    if(options.format == "delta")
+    {
+        return std::make_unique<DeltaStreamSink>(out, options.horizontal_step, options.key_frame_interval);
+    }
+
+    return std::make_unique<Y4mStreamSink>(out, options.frames_per_second, band_threads);
+}
+
+RENDER_OPTIONS rendering::shared_options(const RENDER_OPTIONS& options, unsigned jobs)
+{
+    jobs = std::max(jobs, 1U);
+
+    auto job_options = options;
+    job_options.thread_count = std::max(options.thread_count / jobs, 1U);
+    job_options.memory_budget = (options.memory_budget == 0 ? physical_memory_bytes() / 2 : options.memory_budget) / jobs;
+
+    return job_options;
+}
+
+RENDER_RESULT rendering::render_notes(const std::vector<midi::NOTE>& notes, const RENDER_OPTIONS& options, const std::string& output, const std::string& pattern, std::ostream* report)
+{
+    RENDER_RESULT result;
+    if(const auto problem = render_problem(notes, options))
+    {
+        result.error = problem;
+        return result;
+    }
+
+    //the avi index and sizes are filled in at the end, so this needs a real file instead of a pipe, a gif is seeked in as well
+    const auto& format = options.format;
+    if((format == "avi" || format == "gif") && (output.empty() || output == "-"))
+    {
+        result.error = "--format " + format + " needs an --output file";
+        return result;
+    }
+
+    //a failing sink or pipeline stage throws, which ends up here rather than stopping the process
+    try
+    {
+        result.frames = render_to_sink(notes, options, output, pattern, report);
+    }
+    catch(const std::exception& e)
+    {
+        result.error = e.what();
+    }
+
+    return result;
+}
+
+//SEQUENCES
+std::string rendering::sequence_output(const std::string& output, const std::string& format, unsigned index)
+{
+    const auto name = "sequence-" + std::to_string(index);
+    if(!is_single_file_format(format)) return output + (output.empty() || output.back() == '/' ? "" : "-") + name + "/";
+
+    const std::filesystem::path path(output);
+    return (path.parent_path() / (path.stem().string() + "-" + std::to_string(index) + path.extension().string())).string();
+}
+
+std::vector<SEQUENCE_RESULT> rendering::render_sequences(const std::vector<std::vector<midi::NOTE>>& sequences, const RENDER_OPTIONS& options,
+                                                         const std::string& output, const std::string& pattern, std::ostream* report)
+{
+    std::vector<SEQUENCE_RESULT> results(sequences.size());
+    std::vector<size_t> order;
+    for(size_t i = 0; i != sequences.size(); ++i)
+    {
+        results[i].output = sequence_output(output, options.format, static_cast<unsigned>(i));
+        results[i].notes = sequences[i].size();
+        results[i].problem = render_problem(sequences[i], options);
+        if(results[i].problem == nullptr) order.push_back(i);
+    }
+
+    //stdout cannot hold several streams
+    if(is_single_file_format(options.format) && (output.empty() || output == "-"))
+    {
+        for(auto index : order) results[index].error = "the sequences of a type 2 file need an --output to name their files after";
+        order.clear();
+    }
+
+    //every render gets its share of the threads and memory
+    const auto jobs = std::max(std::min(options.thread_count, static_cast<unsigned>(order.size())), 1U);
+    const auto sequence_options = shared_options(options, jobs);
+
+    //the largest sequences are submitted last, so every worker starts with the largest one in its own deque
+    std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) { return sequences[l].size() < sequences[r].size(); });
+
+    WorkStealingPool pool(jobs);
+    for(auto index : order)
+    {
+        pool.submit([&, index]()
+        {
+            tracing::Scope scope("render_sequence");
+            auto& result = results[index];
+
+            //frame files go in a directory of their own
+            const std::filesystem::path path(result.output);
+            const auto directory = is_single_file_format(options.format) ? path.parent_path() : path;
+            std::error_code error;
+            if(!directory.empty()) std::filesystem::create_directories(directory, error);
+            if(error)
+            {
+                result.error = "could not create " + directory.string();
+                return;
+            }
+
+            const auto rendered = render_notes(sequences[index], sequence_options, result.output, pattern, nullptr);
+            result.frames = rendered.frames;
+            result.error = rendered.error;
+        });
+    }
+    pool.wait();
+
+    if(report != nullptr)
+    {
+        for(size_t i = 0; i != results.size(); ++i)
+        {
+            *report << "Sequence " << i << ": ";
+            if(results[i].problem != nullptr) *report << "left out, " << results[i].problem << "\n";
+            else if(!results[i].error.empty()) *report << "failed, " << results[i].error << "\n";
+            else *report << results[i].notes << " notes, " << results[i].frames << " frames in " << results[i].output << "\n";
+        }
+        report->flush();
+    }
+
+    return results;
+}
+//END SEQUENCES
@@ -0,0 +1,98 @@
+#ifndef MIDI_PROJECT_RENDER_JOB_H
+#define MIDI_PROJECT_RENDER_JOB_H
+
+#include "../midi/midi.h"
+#include "frame-pipeline.h"
+#include "frame-sink.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rendering
+{
+    //how the notes of a midi file are turned into frames, as given on the command line
+    struct RENDER_OPTIONS
+    {
+        unsigned frame_width = 0;
+        unsigned note_height = 16;
+        unsigned horizontal_step = 1;
+        unsigned horizontal_scale = 1;
+        unsigned thread_count = 1;
+        PIPELINE_SETTINGS pipeline_settings = PIPELINE_SETTINGS(0, 0, 0, 0);   //stages left at 0 get their share of thread_count
+        std::string format = "bmp";
+        std::string theme = "instruments";
+        std::string pixel_format = "bgra";
+        unsigned frames_per_second = 30;
+        unsigned band_threads = 0;
+        unsigned compression_level = 6;
+        std::string bmp_encoding = "rgb32";
+        unsigned deduplication_window = 8;
+        bool deduplication_manifest = false;
+        unsigned key_frame_interval = 300;
+        unsigned quality = 85;
+        std::string scratch_directory;
+        uint64_t memory_budget = 0;     //in bytes, 0 allows half of the physical memory
+    };
+
+    bool is_known_format(const std::string& format);
+
+    //raw, y4m and delta frames go to a stream, stdout by default
+    bool is_streamed_format(const std::string& format);
+
+    //every frame ends up in one file instead of a file per frame
+    bool is_single_file_format(const std::string& format);
+
+    //the extension of the file a single file format writes, including the dot
+    std::string file_extension(const std::string& format);
+
+    //why these notes cannot be rendered with these options, or nullptr when they can
+    //these are the problems the renderer and the sinks would otherwise stop the process for
+    const char* render_problem(const std::vector<midi::NOTE>& notes, const RENDER_OPTIONS& options);
+
+    //the sink of a streamed format, writing to out, y4m frames are converted by band_threads threads
+    std::unique_ptr<FrameSink> make_stream_sink(const RENDER_OPTIONS& options, std::ostream& out, unsigned band_threads);
+
+    //the options each of jobs renders running side by side gets: its share of the threads and of the memory budget,
+    //pipeline stages sized explicitly keep their size
+    RENDER_OPTIONS shared_options(const RENDER_OPTIONS& options, unsigned jobs);
+
+    struct RENDER_RESULT
+    {
+        unsigned frames = 0;
+        std::string error;          //why the notes were not (completely) rendered, empty when they were
+
+        bool ok() const { return error.empty(); }
+    };
+
+    //renders the notes to output, which is the prefix of the frame files (named after pattern) for formats with a file per frame
+    //and the file to write otherwise, streamed formats write to stdout when output is empty or "-"
+    //the render plan and pipeline report go to report, nullptr leaves them out
+    //never stops the process: a render_problem, or an output that cannot be opened or written, is returned as the error
+    RENDER_RESULT render_notes(const std::vector<midi::NOTE>& notes, const RENDER_OPTIONS& options, const std::string& output, const std::string& pattern, std::ostream* report);
+
+    //SEQUENCES
+    struct SEQUENCE_RESULT
+    {
+        std::string output;
+        const char* problem = nullptr;      //why the sequence was left out (see render_problem), nullptr when it was rendered
+        std::string error;                  //why rendering it failed, empty when it was rendered or left out
+        uint64_t notes = 0;
+        unsigned frames = 0;
+    };
+
+    //where sequence index of a file with several sequences goes: output with -index before its extension for single file formats,
+    //a directory sequence-index/ with the output as prefix for formats with a file per frame
+    std::string sequence_output(const std::string& output, const std::string& format, unsigned index);
+
+    //renders every sequence of a type 2 file to its own sequence_output, as many at a time as there are threads,
+    //the threads and memory budget of the options are shared between them
+    //sequences that cannot be rendered, like a track without notes, are left out, a line per sequence goes to report
+    //a sequence whose render fails keeps the error, the others are rendered all the same
+    std::vector<SEQUENCE_RESULT> render_sequences(const std::vector<std::vector<midi::NOTE>>& sequences, const RENDER_OPTIONS& options,
+                                                  const std::string& output, const std::string& pattern, std::ostream* report);
+    //END SEQUENCES
+}
+
+#endif //MIDI_PROJECT_RENDER_JOB_H
@@ -0,0 +1,141 @@
+#include "render-plan.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace rendering;
+
+namespace
+{
+    //the canvas holds packed pixels
+    const uint64_t PIXEL_BYTES = sizeof(uint32_t);
+
+    //the least a tiled canvas may keep resident, below this it spends its time faulting pages back in
+    const uint64_t MINIMUM_RESIDENT_CANVAS = uint64_t(64) << 20;
+
+    unsigned frames_in_flight(const PIPELINE_SETTINGS& settings, unsigned queue_capacity)
+    {
+        //the queues round their capacity up to a power of two, and to at least 2
+        unsigned capacity = 2;
+        while(capacity < queue_capacity) capacity *= 2;
+        queue_capacity = capacity;
+
+        //both queues full, one frame in the hands of every thread, and the encoded frames kept for deduplication
+        return 2 * queue_capacity + std::max(settings.raster_threads, 1U) + std::max(settings.encode_threads, 1U)
+               + std::max(settings.write_threads, 1U) + settings.deduplication_window;
+    }
+
+    double megabytes(uint64_t bytes)
+    {
+        return static_cast<double>(bytes) / (1024 * 1024);
+    }
+}
+
+RENDER_PLAN rendering::plan_render(const RENDER_REQUIREMENTS& requirements, const PIPELINE_SETTINGS& pipeline_settings, uint64_t memory_budget)
+{
+    //a rasterized frame and, at worst, as many encoded bytes
+    const uint64_t frame_bytes = 2 * uint64_t(requirements.frame_width) * requirements.canvas_height * sizeof(uint32_t);
+    const uint64_t column_bytes = uint64_t(requirements.canvas_height) * PIXEL_BYTES;
+    const uint64_t full_canvas_bytes = requirements.canvas_width * column_bytes;
+
+    auto make_plan = [&](CanvasStrategy strategy, unsigned frames_per_window, unsigned queue_capacity, uint64_t canvas_bytes)
+    {
+        const auto in_flight = frames_in_flight(pipeline_settings, queue_capacity);
+        const auto predicted_peak_bytes = requirements.baseline_bytes + canvas_bytes + in_flight * frame_bytes;
+
+        return RENDER_PLAN{strategy, frames_per_window, queue_capacity, in_flight, canvas_bytes, frame_bytes, predicted_peak_bytes, predicted_peak_bytes <= memory_budget};
+    };
+
+    auto left_for_canvas = [&](unsigned queue_capacity)
+    {
+        const auto used = requirements.baseline_bytes + frames_in_flight(pipeline_settings, queue_capacity) * frame_bytes;
+        return used < memory_budget ? memory_budget - used : 0;
+    };
+
+    //fewer frames in flight only cost some overlap between the stages, so that is given up before the canvas
+    const auto requested_capacity = std::max(pipeline_settings.queue_capacity, 1U);
+    for(unsigned queue_capacity = requested_capacity; queue_capacity != 0; queue_capacity /= 2)
+    {
+        const auto full = make_plan(CanvasStrategy::FULL, 0, queue_capacity, full_canvas_bytes);
+        if(full.within_budget) return full;
+
+        //every raster thread can be working in a different window, and one more may be drawn already
+        const uint64_t window_count = std::max(pipeline_settings.raster_threads, 1U) + 1;
+        const uint64_t window_width = left_for_canvas(queue_capacity) / window_count / std::max<uint64_t>(column_bytes, 1);
+        if(requirements.frame_count > 1 && window_width >= requirements.frame_width)
+        {
+            const auto frames_per_window = static_cast<unsigned>(std::min<uint64_t>((window_width - requirements.frame_width) / std::max(requirements.horizontal_step, 1U) + 1, requirements.frame_count));
+            const auto used_width = uint64_t(frames_per_window - 1) * requirements.horizontal_step + requirements.frame_width;
+
+            return make_plan(CanvasStrategy::WINDOWED, frames_per_window, queue_capacity, window_count * used_width * column_bytes);
+        }
+    }
+
+    //a tiled canvas lets the OS page it, what is left of the budget is how much of it may stay resident
+    for(unsigned queue_capacity = requested_capacity; queue_capacity != 0; queue_capacity /= 2)
+    {
+        const auto resident = left_for_canvas(queue_capacity);
+        if(resident >= MINIMUM_RESIDENT_CANVAS) return make_plan(CanvasStrategy::TILED, 0, queue_capacity, std::min(resident, full_canvas_bytes));
+    }
+
+    //nothing fits, so use whatever needs the least
+    const auto tiled = make_plan(CanvasStrategy::TILED, 0, 1, std::min(MINIMUM_RESIDENT_CANVAS, full_canvas_bytes));
+    if(requirements.frame_count <= 1) return tiled;
+
+    const auto windowed = make_plan(CanvasStrategy::WINDOWED, 1, 1, (std::max(pipeline_settings.raster_threads, 1U) + 1) * uint64_t(requirements.frame_width) * column_bytes);
+    return windowed.predicted_peak_bytes < tiled.predicted_peak_bytes ? windowed : tiled;
+}
+
+void rendering::print_plan(std::ostream& out, const RENDER_PLAN& plan, uint64_t memory_budget)
+{
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(1) << "Render plan: ";
+    switch(plan.strategy)
+    {
+        case CanvasStrategy::FULL:
+            out << "full canvas in memory (" << megabytes(plan.canvas_bytes) << " MB)";
+            break;
+        case CanvasStrategy::WINDOWED:
+            out << "windowed canvas, " << plan.frames_per_window << " frames per window (" << megabytes(plan.canvas_bytes) << " MB of windows)";
+            break;
+        case CanvasStrategy::TILED:
+            out << "tiled canvas in a scratch file, at most " << megabytes(plan.canvas_bytes) << " MB of it resident";
+            break;
+    }
+
+    out << ", up to " << plan.frames_in_flight << " frames in flight (queue capacity " << plan.queue_capacity << ")\n";
+    out << "Predicted peak memory " << megabytes(plan.predicted_peak_bytes) << " MB of a " << megabytes(memory_budget) << " MB budget";
+    if(!plan.within_budget) out << ", the budget is too small for any plan, using the smallest one";
+    out << "\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+uint64_t rendering::physical_memory_bytes()
+{
+    return uint64_t(sysconf(_SC_PHYS_PAGES)) * uint64_t(sysconf(_SC_PAGESIZE));
+}
+
+uint64_t rendering::current_resident_bytes()
+{
+    //the second field is the resident set in pages
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    statm >> size >> resident;
+
+    return resident * uint64_t(sysconf(_SC_PAGESIZE));
+}
+
+uint64_t rendering::peak_resident_bytes()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    //ru_maxrss is in kilobytes on Linux
+    return uint64_t(usage.ru_maxrss) * 1024;
+}
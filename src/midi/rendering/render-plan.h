@@ -0,0 +1,50 @@
+#ifndef MIDI_PROJECT_RENDER_PLAN_H
+#define MIDI_PROJECT_RENDER_PLAN_H
+
+#include "frame-pipeline.h"
+#include <cstdint>
+#include <iostream>
+
+namespace rendering
+{
+    enum class CanvasStrategy
+    {
+        FULL,       //the whole piece is drawn on one bitmap in memory
+        WINDOWED,   //only the part a few frames need is drawn, one window of frames after the other
+        TILED       //the whole piece is drawn on a bitmap in a memory mapped scratch file
+    };
+
+    struct RENDER_REQUIREMENTS
+    {
+        uint64_t canvas_width;
+        unsigned canvas_height;
+        unsigned frame_width;       //the canvas width when every frame shows the whole piece
+        unsigned horizontal_step;
+        unsigned frame_count;
+        uint64_t baseline_bytes;    //in use before rendering starts, e.g. the notes
+    };
+
+    struct RENDER_PLAN
+    {
+        CanvasStrategy strategy;
+        unsigned frames_per_window;     //only used by WINDOWED
+        unsigned queue_capacity;
+        unsigned frames_in_flight;
+        uint64_t canvas_bytes;          //the bitmap(s) kept in memory, for TILED the part of the scratch file allowed to stay resident
+        uint64_t frame_bytes;
+        uint64_t predicted_peak_bytes;
+        bool within_budget;
+    };
+
+    //picks the cheapest canvas strategy that fits in memory_budget, trading queue capacity (and so the number of
+    //frames in flight) for a full canvas first, since a canvas that fits makes every frame cheap to slice
+    RENDER_PLAN plan_render(const RENDER_REQUIREMENTS& requirements, const PIPELINE_SETTINGS& pipeline_settings, uint64_t memory_budget);
+
+    void print_plan(std::ostream& out, const RENDER_PLAN& plan, uint64_t memory_budget);
+
+    uint64_t physical_memory_bytes();
+    uint64_t current_resident_bytes();
+    uint64_t peak_resident_bytes();
+}
+
+#endif //MIDI_PROJECT_RENDER_PLAN_H
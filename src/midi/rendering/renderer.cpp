@@ -3,67 +3,268 @@
 //
 
 #include "renderer.h"
+#include "../util/thread-pool.h"
+#include "../util/tiled-grid.h"
+#include "../util/trace.h"
+#include "../logging.h"
+#include <algorithm>
+#include <future>
 #include <iomanip>
-#include <new>
+#include <map>
+#include <mutex>
+#include <numeric>
 
 using namespace rendering;
 
-Renderer::Renderer(unsigned frame_width, unsigned horizontal_step, unsigned horizontal_scale, const NOTE_RENDERING_DATA& note_rendering_data)
-        : frame_width(frame_width),horizontal_step(horizontal_step),horizontal_scale(horizontal_scale),note_rendering_data(std::make_unique<NOTE_RENDERING_DATA>(note_rendering_data))
+namespace
 {
-    try
+    //slices frames out of windows of frames_per_window consecutive frames, a window is drawn when one of its frames
+    //is needed first and dropped once all of its frames were sliced, so only the windows the raster threads are in exist
+    class CanvasWindows
     {
-        this->bitmap = std::make_unique<imaging::Bitmap>((note_rendering_data.ending_note_time_value/20) * horizontal_scale,
-                                                         (note_rendering_data.note_height*(note_rendering_data.highest_note_number_value - note_rendering_data.lowest_note_number_value + 1)));
-    }catch(std::bad_alloc&)
-    {
-        std::cout << "\nThe bitmap is scaled too big, falling back to horizontal scale 1!\n";
-        this->horizontal_scale = 1;
-        this->bitmap = std::make_unique<imaging::Bitmap>((note_rendering_data.ending_note_time_value/20),
-                                                         (note_rendering_data.note_height*(note_rendering_data.highest_note_number_value - note_rendering_data.lowest_note_number_value + 1)));
-    }
+        struct WINDOW
+        {
+            std::shared_future<std::shared_ptr<const Grid<uint32_t>>> pixels;
+            unsigned frames_left;
+        };
+
+        std::function<std::shared_ptr<const Grid<uint32_t>>(unsigned first_frame, unsigned frame_count)> draw_window;
+        unsigned frames_per_window;
+        unsigned frame_count;
+        std::mutex mutex;
+        std::map<unsigned, WINDOW> windows;
+
+    public:
+        CanvasWindows(std::function<std::shared_ptr<const Grid<uint32_t>>(unsigned, unsigned)> draw_window, unsigned frames_per_window, unsigned frame_count)
+                : draw_window(std::move(draw_window)), frames_per_window(std::max(frames_per_window, 1U)), frame_count(frame_count) {};
+
+        //the window holding frame_index, together with the index of its first frame
+        std::pair<std::shared_ptr<const Grid<uint32_t>>, unsigned> acquire(unsigned frame_index)
+        {
+            const auto window_index = frame_index / frames_per_window;
+            const auto first_frame = window_index * frames_per_window;
+
+            std::promise<std::shared_ptr<const Grid<uint32_t>>> promise;
+            std::shared_future<std::shared_ptr<const Grid<uint32_t>>> pixels;
+            bool draw = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto it = windows.find(window_index);
+                if(it == windows.end())
+                {
+                    const auto frames = std::min(frames_per_window, frame_count - first_frame);
+                    it = windows.emplace(window_index, WINDOW{promise.get_future().share(), frames}).first;
+                    draw = true;
+                }
+                pixels = it->second.pixels;
+            }
+
+            //drawn outside of the lock, raster threads in other windows carry on meanwhile
+            if(draw)
+            {
+                try
+                {
+                    promise.set_value(draw_window(first_frame, std::min(frames_per_window, frame_count - first_frame)));
+                }
+                catch(...) { promise.set_exception(std::current_exception()); }
+            }
+
+            return {pixels.get(), first_frame};
+        }
+
+        void release(unsigned frame_index)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = windows.find(frame_index / frames_per_window);
+            if(it != windows.end() && --it->second.frames_left == 0) windows.erase(it);
+        }
+    };
+}
+
+Renderer::Renderer(unsigned frame_width, unsigned horizontal_step, unsigned horizontal_scale, const NOTE_RENDERING_DATA& note_rendering_data,
+                   const std::string& scratch_directory, uint64_t memory_budget)
+        : frame_width(frame_width),horizontal_step(horizontal_step),horizontal_scale(horizontal_scale),note_rendering_data(std::make_unique<NOTE_RENDERING_DATA>(note_rendering_data)),
+          longest_note_width(0),scratch_directory(scratch_directory),memory_budget(memory_budget == 0 ? physical_memory_bytes() / 2 : memory_budget),
+          report(&std::cerr),note_colors(theme_named("instruments"))
+{
+    const uint64_t width = uint64_t(note_rendering_data.ending_note_time_value/20) * horizontal_scale;
+    CHECK(width <= UINT32_MAX) << "The bitmap would be " << width << " pixels wide, lower the horizontal scale";
+
+    this->canvas_width = static_cast<unsigned>(width);
+    this->canvas_height = note_rendering_data.note_height*(note_rendering_data.highest_note_number_value - note_rendering_data.lowest_note_number_value + 1);
 }
 
 void Renderer::draw_note(const midi::NOTE& note)
 {
-    auto position = transform_note(note);
+    notes.push_back(note);
+    longest_note_width = std::max(longest_note_width, calculate_note_width(note));
+}
+
+void Renderer::set_report(std::ostream* report)
+{
+    this->report = report;
+}
+
+void Renderer::set_theme(const COLOR_THEME& theme)
+{
+    note_colors = NoteColors(theme);
+}
+
+void Renderer::draw_notes(Grid<uint32_t>& canvas, unsigned origin, const std::vector<unsigned>& note_indices) const
+{
+    tracing::Scope scope("draw_notes");
+    const auto end = uint64_t(origin) + canvas.width();
+    uint64_t pixels_filled = 0;
 
-    for(unsigned i=0; i != note_rendering_data->note_height; ++i)
+    for(auto note_index : note_indices)
     {
-        for(unsigned j=0; j != calculate_note_width(note); ++j)
+        const auto& note = notes[note_index];
+        const auto position = transform_note(note);
+
+        //only the columns of the note that fall inside the canvas
+        const auto first = std::max<uint64_t>(position.x, origin);
+        const auto last = std::min<uint64_t>(uint64_t(position.x) + calculate_note_width(note), end);
+        const auto color = note_colors.argb_of(note);
+
+        for(unsigned i=0; i != note_rendering_data->note_height; ++i)
         {
-            (*bitmap)[position + Position(j,i)] = imaging::Color {
-                    static_cast<double>(value(note.note_number)),
-                    static_cast<double >(value(note.instrument)),
-                    static_cast<double >(note.velocity)
-            };
+            for(auto x = first; x < last; ++x)
+            {
+                canvas[Position(static_cast<unsigned>(x - origin), position.y + i)] = color;
+            }
         }
+        if(last > first) pixels_filled += (last - first) * note_rendering_data->note_height;
     }
+
+    tracing::count(tracing::Counter::PIXELS_FILLED, pixels_filled);
+}
+
+unsigned Renderer::frame_count() const
+{
+    return calculate_frame_count();
 }
 
 void Renderer::render_frames(const std::string& target_directory_path, const std::string& pattern) const
 {
-    std::stringstream string_stream;
-    if(frame_width == 0)
+    render_frames(target_directory_path, pattern, PIPELINE_SETTINGS::for_threads(ThreadPool::default_thread_count()));
+}
+
+void Renderer::render_frames(const std::string& target_directory_path, const std::string& pattern, const PIPELINE_SETTINGS& pipeline_settings) const
+{
+    BmpFileSink frame_sink(target_directory_path, pattern);
+    render_frames(frame_sink, pipeline_settings);
+}
+
+void Renderer::render_frames(FrameSink& frame_sink, const PIPELINE_SETTINGS& pipeline_settings) const
+{
+    tracing::Scope scope("render_frames");
+    const auto requirements = calculate_requirements();
+    const auto plan = plan_render(requirements, pipeline_settings, memory_budget);
+    if(report != nullptr) print_plan(*report, plan, memory_budget);
+
+    auto settings = pipeline_settings;
+    settings.queue_capacity = plan.queue_capacity;
+
+    //every note in the order it was drawn, later notes are drawn over earlier ones
+    std::vector<unsigned> all_notes(notes.size());
+    std::iota(all_notes.begin(), all_notes.end(), 0U);
+
+    //every frame only reads from the canvas, so frames can be sliced and encoded independently
+    std::function<imaging::Frame(unsigned)> rasterize_frame;
+    std::shared_ptr<Grid<uint32_t>> canvas;
+    std::unique_ptr<CanvasWindows> windows;
+    std::vector<unsigned> notes_by_start;
+
+    //the canvas holds the packed pixels of the note colours, so a frame is a plain copy
+    auto slice_frame = [this](const Grid<uint32_t>& pixels, unsigned x)
     {
-        string_stream << std::setfill('0') << std::setw(5) << (0);
-        auto frame_name = pattern;
+        if(frame_width == 0) return imaging::copy_frame(pixels, Position(0, 0), pixels.width(), pixels.height());
 
-        imaging::save_as_bmp(target_directory_path + frame_name.replace(frame_name.find("%d"),2,string_stream.str()) + ".bmp", *bitmap);
-    }
-    else
+        return imaging::copy_frame(pixels, Position(x, 0), frame_width, pixels.height());
+    };
+
+    switch(plan.strategy)
     {
-        for(unsigned i=0;i <= bitmap->width() - frame_width; i+=horizontal_step)
+        case CanvasStrategy::FULL:
+            canvas = std::make_shared<ConcreteGrid<uint32_t>>(canvas_width, canvas_height, 0xFF000000U);
+            draw_notes(*canvas, 0, all_notes);
+            rasterize_frame = [&](unsigned frame_index) { return slice_frame(*canvas, frame_index * horizontal_step); };
+            break;
+
+        case CanvasStrategy::TILED:
         {
-            auto sliced_bitmap = bitmap->slice(static_cast<int>(i), 0, static_cast<int>(frame_width), static_cast<int>(bitmap->height()));
+            auto tiled_canvas = std::make_shared<TiledGrid<uint32_t>>(canvas_width, canvas_height, scratch_directory);
+            canvas = tiled_canvas;
+
+            //the pages of the scratch file count as resident while mapped, they are dropped whenever the plan is exceeded
+            auto keep_within_plan = [&plan, tiled_canvas]()
+            {
+                if(current_resident_bytes() > plan.predicted_peak_bytes) tiled_canvas->release();
+            };
 
-            string_stream << std::setfill('0') << std::setw(5) << (i/horizontal_step);
-            auto frame_name = pattern;
+            const unsigned notes_per_check = 256;
+            for(size_t first = 0; first < all_notes.size(); first += notes_per_check)
+            {
+                const auto last = std::min(first + notes_per_check, all_notes.size());
+                draw_notes(*canvas, 0, std::vector<unsigned>(all_notes.begin() + first, all_notes.begin() + last));
+                keep_within_plan();
+            }
 
-            imaging::save_as_bmp(target_directory_path + frame_name.replace(frame_name.find("%d"),2,string_stream.str()) + ".bmp",*sliced_bitmap);
-            string_stream.str(std::string());
+            rasterize_frame = [&, keep_within_plan](unsigned frame_index)
+            {
+                auto frame = slice_frame(*canvas, frame_index * horizontal_step);
+                keep_within_plan();
+                return frame;
+            };
+            break;
+        }
+
+        case CanvasStrategy::WINDOWED:
+        {
+            notes_by_start = all_notes;
+            std::stable_sort(notes_by_start.begin(), notes_by_start.end(), [this](unsigned l, unsigned r) { return value(notes[l].start) < value(notes[r].start); });
+
+            auto draw_window = [&](unsigned first_frame, unsigned frame_count)
+            {
+                const auto origin = first_frame * horizontal_step;
+                const auto width = static_cast<unsigned>(std::min<uint64_t>(uint64_t(frame_count - 1) * horizontal_step + frame_width, canvas_width - origin));
+
+                //a note overlaps the window when it starts before its end and is at most longest_note_width before its start
+                auto starts_before = [this](unsigned note_index, uint64_t x) { return transform_note(notes[note_index]).x < x; };
+                const auto first = std::lower_bound(notes_by_start.begin(), notes_by_start.end(), origin < longest_note_width ? 0 : uint64_t(origin) - longest_note_width, starts_before);
+                const auto last = std::lower_bound(first, notes_by_start.end(), uint64_t(origin) + width, starts_before);
+
+                std::vector<unsigned> window_notes(first, last);
+                std::sort(window_notes.begin(), window_notes.end());
+
+                auto window = std::make_shared<ConcreteGrid<uint32_t>>(width, canvas_height, 0xFF000000U);
+                draw_notes(*window, origin, window_notes);
+                return std::shared_ptr<const Grid<uint32_t>>(window);
+            };
+
+            windows = std::make_unique<CanvasWindows>(draw_window, plan.frames_per_window, requirements.frame_count);
+            rasterize_frame = [&](unsigned frame_index)
+            {
+                const auto [window, first_frame] = windows->acquire(frame_index);
+                auto frame = slice_frame(*window, (frame_index - first_frame) * horizontal_step);
+                windows->release(frame_index);
+                return frame;
+            };
+            break;
         }
     }
+
+    frame_sink.begin(frame_width == 0 ? canvas_width : frame_width, canvas_height, requirements.frame_count);
+
+    FramePipeline pipeline(settings, frame_sink);
+    pipeline.run(requirements.frame_count, rasterize_frame);
+    frame_sink.finish();
+
+    //stdout may be carrying the frames themselves, so the report never goes there by default
+    if(report == nullptr) return;
+    pipeline.print_report(*report);
+    *report << std::fixed << std::setprecision(1) << "Peak memory " << static_cast<double>(peak_resident_bytes()) / (1024 * 1024) << " MB measured, "
+              << static_cast<double>(plan.predicted_peak_bytes) / (1024 * 1024) << " MB predicted\n";
 }
 
 Position Renderer::transform_note(const midi::NOTE& note) const
@@ -75,3 +276,16 @@ unsigned Renderer::calculate_note_width(const midi::NOTE& note) const
 {
     return ((value(note.duration)/20) * horizontal_scale);
 }
+
+unsigned Renderer::calculate_frame_count() const
+{
+    if(frame_width == 0) return 1;
+    if(frame_width > canvas_width) return 0;
+
+    return (canvas_width - frame_width) / horizontal_step + 1;
+}
+
+RENDER_REQUIREMENTS Renderer::calculate_requirements() const
+{
+    return RENDER_REQUIREMENTS{canvas_width, canvas_height, frame_width == 0 ? canvas_width : frame_width, horizontal_step, calculate_frame_count(), current_resident_bytes()};
+}
@@ -9,8 +9,15 @@
 #include "../imaging/bmp-format.h"
 #include "../imaging/color.h"
 #include "../midi/midi.h"
+#include "../util/grid.h"
 #include "../util/position.h"
+#include "frame-pipeline.h"
+#include "frame-sink.h"
+#include "note-colors.h"
+#include "render-plan.h"
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace rendering {
 
@@ -28,20 +35,45 @@ namespace rendering {
     class Renderer
     {
 
-        std::unique_ptr<imaging::Bitmap> bitmap;
+        std::vector<midi::NOTE> notes;
         std::unique_ptr<NOTE_RENDERING_DATA> note_rendering_data;
         unsigned frame_width;
         unsigned horizontal_step;
         unsigned horizontal_scale;
+        unsigned canvas_width;
+        unsigned canvas_height;
+        unsigned longest_note_width;
+        std::string scratch_directory;
+        uint64_t memory_budget;
+        std::ostream* report;
+        NoteColors note_colors;
 
         Position transform_note(const midi::NOTE &note) const;
         unsigned calculate_note_width(const midi::NOTE &note) const;
+        unsigned calculate_frame_count() const;
+        RENDER_REQUIREMENTS calculate_requirements() const;
+        void draw_notes(Grid<uint32_t>& canvas, unsigned origin, const std::vector<unsigned>& note_indices) const;
 
     public:
-        Renderer(unsigned frame_width, unsigned horizontal_step, unsigned horizontal_scale, const NOTE_RENDERING_DATA& note_rendering_data);
+        //memory_budget is in bytes, 0 allows half of the physical memory
+        //canvases that do not fit in it are drawn in windows or kept in a scratch file in scratch_directory
+        Renderer(unsigned frame_width, unsigned horizontal_step, unsigned horizontal_scale, const NOTE_RENDERING_DATA& note_rendering_data,
+                 const std::string& scratch_directory, uint64_t memory_budget);
 
+        //notes are only drawn when the frames are rendered, once it is known how much of the canvas fits in memory
         void draw_note(const midi::NOTE &note);
+
+        //the render plan and the pipeline report go to stderr unless another stream is given, nullptr leaves them out
+        void set_report(std::ostream* report);
+
+        //the instruments theme unless another one is given
+        void set_theme(const COLOR_THEME& theme);
+
+        unsigned frame_count() const;
+
         void render_frames(const std::string& target_directory_path, const std::string& pattern) const;
+        void render_frames(const std::string& target_directory_path, const std::string& pattern, const PIPELINE_SETTINGS& pipeline_settings) const;
+        void render_frames(FrameSink& frame_sink, const PIPELINE_SETTINGS& pipeline_settings) const;
     };
 }
 
@@ -0,0 +1,78 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "io/vli.h"
+#include "Catch.h"
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    std::vector<uint8_t> encode(uint64_t value)
+    {
+        uint8_t buffer[io::MAX_VARIABLE_LENGTH_INTEGER_SIZE];
+        auto size = io::encode_variable_length_integer(value, buffer);
+
+        return std::vector<uint8_t>(buffer, buffer + size);
+    }
+}
+
+TEST_CASE("Encoding variable sized integer 0")
+{
+    CATCH_CHECK(encode(0) == std::vector<uint8_t>{ 0x00 });
+}
+
+TEST_CASE("Encoding variable sized integer 0x7F")
+{
+    CATCH_CHECK(encode(0x7F) == std::vector<uint8_t>{ 0x7F });
+}
+
+TEST_CASE("Encoding variable sized integer 0x80")
+{
+    CATCH_CHECK(encode(0x80) == std::vector<uint8_t>{ 0x81, 0x00 });
+}
+
+TEST_CASE("Encoding variable sized integer 0x2000")
+{
+    CATCH_CHECK(encode(0x2000) == std::vector<uint8_t>{ 0xC0, 0x00 });
+}
+
+TEST_CASE("Encoding variable sized integer 0x3FFF")
+{
+    CATCH_CHECK(encode(0x3FFF) == std::vector<uint8_t>{ 0xFF, 0x7F });
+}
+
+TEST_CASE("Encoding variable sized integer 0x4000")
+{
+    CATCH_CHECK(encode(0x4000) == std::vector<uint8_t>{ 0x81, 0x80, 0x00 });
+}
+
+TEST_CASE("Encoding variable sized integer 0x0FFFFFFF")
+{
+    CATCH_CHECK(encode(0x0FFFFFFF) == std::vector<uint8_t>{ 0xFF, 0xFF, 0xFF, 0x7F });
+}
+
+TEST_CASE("Encoding variable sized integer 0xFFFFFFFFFFFFFFFF")
+{
+    CATCH_CHECK(encode(UINT64_MAX) == std::vector<uint8_t>{ 0x81, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F });
+}
+
+TEST_CASE("Writing and reading back variable sized integers")
+{
+    std::stringstream ss;
+    for(unsigned shift = 0; shift != 64; ++shift)
+    {
+        io::write_variable_length_integer(ss, uint64_t(1) << shift);
+        io::write_variable_length_integer(ss, (uint64_t(1) << shift) - 1);
+    }
+
+    for(unsigned shift = 0; shift != 64; ++shift)
+    {
+        CATCH_CHECK(io::read_variable_length_integer(ss) == uint64_t(1) << shift);
+        CATCH_CHECK(io::read_variable_length_integer(ss) == (uint64_t(1) << shift) - 1);
+    }
+}
+
+#endif
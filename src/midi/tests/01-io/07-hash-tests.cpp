@@ -0,0 +1,57 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/hash.h"
+#include "Catch.h"
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    uint64_t hash(const std::string& text, uint64_t seed = 0)
+    {
+        return hashing::hash_bytes(text.data(), text.size(), seed);
+    }
+}
+
+TEST_CASE("Hashing no bytes")
+{
+    CATCH_CHECK(hash("") == 0xEF46DB3751D8E999ULL);
+}
+
+TEST_CASE("Hashing a single byte")
+{
+    CATCH_CHECK(hash("a") == 0xD24EC4F1A98C6E5BULL);
+}
+
+TEST_CASE("Hashing fewer bytes than a stripe")
+{
+    CATCH_CHECK(hash("abc") == 0x44BC2CF5AD770999ULL);
+}
+
+TEST_CASE("Hashing more bytes than a stripe")
+{
+    CATCH_CHECK(hash("Nobody inspects the spammish repetition") == 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST_CASE("Hashing with another seed gives another hash")
+{
+    CATCH_CHECK(hash("abc", 1) != hash("abc"));
+}
+
+TEST_CASE("Hashing bytes that differ in a single bit")
+{
+    std::vector<uint8_t> data(1000, 0x55);
+    const auto original = hashing::hash_bytes(data.data(), data.size());
+
+    for(size_t i : {0, 31, 32, 500, 996, 999})
+    {
+        auto changed = data;
+        changed[i] ^= 0x01;
+        CATCH_CHECK(hashing::hash_bytes(changed.data(), changed.size()) != original);
+    }
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/writer.h"
+#include "tests/tests-util.h"
+#include <sstream>
+
+using namespace testutils;
+
+
+namespace
+{
+    std::string written(const midi::TrackWriter& writer)
+    {
+        std::stringstream ss;
+        write_mtrk(ss, writer);
+
+        return ss.str();
+    }
+
+    std::string expected(const char* buffer, size_t size)
+    {
+        return std::string(buffer, size);
+    }
+}
+
+TEST_CASE("Writing MTrk, empty")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 0x04, // Length
+        END_OF_TRACK
+    };
+
+    midi::TrackWriter writer;
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+    CATCH_CHECK(writer.size() == 1);
+}
+
+TEST_CASE("Writing MTrk, multiple note on events with running status")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 11, // Length
+        0, NOTE_ON(0, 0, 0),
+        10, NOTE_ON_RS(5, 0),
+        END_OF_TRACK
+    };
+
+    midi::TrackWriter writer;
+    writer.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(0), 0);
+    writer.note_on(midi::Duration(10), midi::Channel(0), midi::NoteNumber(5), 0);
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+}
+
+TEST_CASE("Writing MTrk, multiple note on events without running status")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 12, // Length
+        0, NOTE_ON(0, 0, 0),
+        10, NOTE_ON(0, 5, 0),
+        END_OF_TRACK
+    };
+
+    midi::TrackWriter writer(false);
+    writer.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(0), 0);
+    writer.note_on(midi::Duration(10), midi::Channel(0), midi::NoteNumber(5), 0);
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+}
+
+TEST_CASE("Writing MTrk, running status only applies to the same channel")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 12, // Length
+        0, NOTE_ON(0, 60, 100),
+        0, NOTE_ON(1, 60, 100),
+        END_OF_TRACK
+    };
+
+    midi::TrackWriter writer;
+    writer.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+    writer.note_on(midi::Duration(0), midi::Channel(1), midi::NoteNumber(60), 100);
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+}
+
+TEST_CASE("Writing MTrk, meta event cancels running status")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 17, // Length
+        0, NOTE_ON(0, 60, 100),
+        0, char(0xFF), 0x01, 0x01, 'x',
+        0, NOTE_ON(0, 62, 100),
+        END_OF_TRACK
+    };
+
+    const uint8_t text[] = { 'x' };
+    midi::TrackWriter writer;
+    writer.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+    writer.meta(midi::Duration(0), 0x01, text, sizeof(text));
+    writer.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(62), 100);
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+}
+
+TEST_CASE("Writing MTrk, sysex with a long delta time")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 11, // Length
+        char(0x81), 0x00, char(0xF0), 0x03, 0x7D, 0x01, char(0xF7),
+        END_OF_TRACK
+    };
+
+    const uint8_t data[] = { 0x7D, 0x01, 0xF7 };
+    midi::TrackWriter writer;
+    writer.sysex(midi::Duration(128), data, sizeof(data));
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+}
+
+TEST_CASE("Writing MTrk, tempo and pitch wheel change")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 15, // Length
+        0, char(0xFF), 0x51, 0x03, 0x07, char(0xA1), 0x20,
+        0, PITCH_WHEEL_CHANGE(3, 0x2001),
+        END_OF_TRACK
+    };
+
+    midi::TrackWriter writer;
+    writer.tempo(midi::Duration(0), 500000);
+    writer.pitch_wheel_change(midi::Duration(0), midi::Channel(3), 0x2001);
+    writer.end_of_track(midi::Duration(0));
+
+    CATCH_CHECK(written(writer) == expected(buffer, sizeof(buffer)));
+}
+
+TEST_CASE("Writing MTrk, every kind of event reads back the same")
+{
+    const uint8_t data[] = { 0x7D, 0x10, 0x20, 0x30 };
+    const uint8_t text[] = { 'a', 'b', 'c' };
+
+    for(bool running_status : { true, false })
+    {
+        midi::TrackWriter writer(running_status);
+        writer.note_on(midi::Duration(0), midi::Channel(2), midi::NoteNumber(60), 100);
+        writer.note_on(midi::Duration(5), midi::Channel(2), midi::NoteNumber(64), 90);
+        writer.polyphonic_key_pressure(midi::Duration(300), midi::Channel(2), midi::NoteNumber(60), 30);
+        writer.control_change(midi::Duration(0), midi::Channel(15), 7, 127);
+        writer.program_change(midi::Duration(1), midi::Channel(15), midi::Instrument(5));
+        writer.program_change(midi::Duration(1), midi::Channel(15), midi::Instrument(6));
+        writer.channel_pressure(midi::Duration(70000), midi::Channel(0), 12);
+        writer.pitch_wheel_change(midi::Duration(0), midi::Channel(0), 0x3FFF);
+        writer.sysex(midi::Duration(2), data, sizeof(data));
+        writer.note_off(midi::Duration(0), midi::Channel(2), midi::NoteNumber(60), 64);
+        writer.meta(midi::Duration(0), 0x03, text, sizeof(text));
+        writer.note_off(midi::Duration(8), midi::Channel(2), midi::NoteNumber(64), 64);
+        writer.end_of_track(midi::Duration(0));
+        CATCH_CHECK(writer.size() == 13);
+
+        std::stringstream ss(written(writer));
+        auto receiver = Builder()
+            .note_on(midi::Duration(0), midi::Channel(2), midi::NoteNumber(60), 100)
+            .note_on(midi::Duration(5), midi::Channel(2), midi::NoteNumber(64), 90)
+            .polyphonic_key_pressure(midi::Duration(300), midi::Channel(2), midi::NoteNumber(60), 30)
+            .control_change(midi::Duration(0), midi::Channel(15), 7, 127)
+            .program_change(midi::Duration(1), midi::Channel(15), midi::Instrument(5))
+            .program_change(midi::Duration(1), midi::Channel(15), midi::Instrument(6))
+            .channel_pressure(midi::Duration(70000), midi::Channel(0), 12)
+            .pitch_wheel_change(midi::Duration(0), midi::Channel(0), 0x3FFF)
+            .sysex(midi::Duration(2), std::string(reinterpret_cast<const char*>(data), sizeof(data)))
+            .note_off(midi::Duration(0), midi::Channel(2), midi::NoteNumber(60), 64)
+            .meta(midi::Duration(0), 0x03, "abc")
+            .note_off(midi::Duration(8), midi::Channel(2), midi::NoteNumber(64), 64)
+            .meta(midi::Duration(0), 0x2F, "")
+            .build();
+
+        read_mtrk(ss, *receiver);
+        receiver->check_finished();
+    }
+}
+
+#endif
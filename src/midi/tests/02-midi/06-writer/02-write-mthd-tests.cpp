@@ -0,0 +1,30 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/writer.h"
+#include "Catch.h"
+#include <sstream>
+
+
+TEST_CASE("Writing MThd and reading it back")
+{
+    midi::MTHD mthd{};
+    mthd.type = 1;
+    mthd.ntracks = 0x0102;
+    mthd.division = 480;
+
+    std::stringstream ss;
+    midi::write_mthd(ss, mthd);
+    CATCH_CHECK(ss.str().size() == sizeof(midi::MTHD));
+
+    midi::MTHD actual;
+    midi::read_mthd(ss, &actual);
+    CATCH_CHECK(midi::header_id(actual.header) == "MThd");
+    CATCH_CHECK(actual.header.size == 6);
+    CATCH_CHECK(actual.type == 1);
+    CATCH_CHECK(actual.ntracks == 0x0102);
+    CATCH_CHECK(actual.division == 480);
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/midi.h"
+#include "midi/synthetic.h"
+#include "Catch.h"
+#include <sstream>
+
+
+namespace
+{
+    struct CountingReceiver : midi::EventReceiver
+    {
+        uint64_t note_ons = 0;
+        uint64_t note_offs = 0;
+        uint64_t other_channel_events = 0;
+        uint64_t tempo_changes = 0;
+        uint64_t sysex_dumps = 0;
+        uint64_t end_of_tracks = 0;
+
+        void note_on(midi::Duration, midi::Channel, midi::NoteNumber, uint8_t) override { ++note_ons; }
+        void note_off(midi::Duration, midi::Channel, midi::NoteNumber, uint8_t) override { ++note_offs; }
+        void polyphonic_key_pressure(midi::Duration, midi::Channel, midi::NoteNumber, uint8_t) override { ++other_channel_events; }
+        void control_change(midi::Duration, midi::Channel, uint8_t, uint8_t) override { ++other_channel_events; }
+        void program_change(midi::Duration, midi::Channel, midi::Instrument) override { ++other_channel_events; }
+        void channel_pressure(midi::Duration, midi::Channel, uint8_t) override { ++other_channel_events; }
+        void pitch_wheel_change(midi::Duration, midi::Channel, uint16_t) override { ++other_channel_events; }
+        void meta(midi::Duration, uint8_t type, std::unique_ptr<uint8_t[]>, uint64_t) override { if(type == 0x51) ++tempo_changes; if(type == 0x2F) ++end_of_tracks; }
+        void sysex(midi::Duration, std::unique_ptr<uint8_t[]>, uint64_t) override { ++sysex_dumps; }
+    };
+
+    std::string synthetic(const midi::SYNTHETIC_SETTINGS& settings)
+    {
+        std::stringstream ss;
+        midi::write_synthetic_midi(ss, settings);
+
+        return ss.str();
+    }
+
+    midi::SYNTHETIC_SETTINGS small_settings()
+    {
+        midi::SYNTHETIC_SETTINGS settings;
+        settings.tracks = 4;
+        settings.events = 2000;
+        settings.sysex_interval = 100;
+        settings.sysex_size = 50;
+        settings.tempo_interval = 250;
+
+        return settings;
+    }
+}
+
+TEST_CASE("Synthetic midi, the same seed gives the same bytes")
+{
+    CATCH_CHECK(synthetic(small_settings()) == synthetic(small_settings()));
+}
+
+TEST_CASE("Synthetic midi, another seed gives other bytes")
+{
+    auto settings = small_settings();
+    settings.seed = 2;
+
+    CATCH_CHECK(synthetic(small_settings()) != synthetic(settings));
+}
+
+TEST_CASE("Synthetic midi, running status only changes the size")
+{
+    auto settings = small_settings();
+    settings.running_status = false;
+
+    const auto with_running_status = synthetic(small_settings());
+    const auto without_running_status = synthetic(settings);
+    CATCH_CHECK(with_running_status.size() < without_running_status.size());
+
+    std::stringstream l(with_running_status), r(without_running_status);
+    CATCH_CHECK(midi::read_notes(l) == midi::read_notes(r));
+}
+
+TEST_CASE("Synthetic midi, reading back the tracks")
+{
+    const auto settings = small_settings();
+    std::stringstream ss(synthetic(settings));
+
+    midi::MTHD mthd;
+    read_mthd(ss, &mthd);
+    CATCH_CHECK(mthd.type == 1);
+    CATCH_CHECK(mthd.ntracks == 4);
+    CATCH_CHECK(mthd.division == 480);
+
+    CountingReceiver receiver;
+    for(unsigned i = 0; i != mthd.ntracks; ++i) read_mtrk(ss, receiver);
+
+    CATCH_CHECK(receiver.note_ons + receiver.note_offs + receiver.other_channel_events == settings.events);
+    CATCH_CHECK(receiver.note_ons == receiver.note_offs);
+    CATCH_CHECK(receiver.note_ons > receiver.other_channel_events);
+    CATCH_CHECK(receiver.sysex_dumps >= 16);
+    CATCH_CHECK(receiver.tempo_changes >= 1);
+    CATCH_CHECK(receiver.end_of_tracks == 4);
+    CATCH_CHECK(ss.peek() == EOF);
+}
+
+TEST_CASE("Synthetic midi, every note on becomes a note")
+{
+    midi::SYNTHETIC_SETTINGS settings;
+    settings.format = 0;
+    settings.tracks = 1;
+    settings.events = 1000;
+    settings.control_changes = 0;
+    settings.pitch_wheel_changes = 0;
+    settings.pressure_events = 0;
+    settings.program_changes = 0;
+
+    std::stringstream ss(synthetic(settings));
+    CATCH_CHECK(midi::read_notes(ss).size() == 500);
+}
+
+#endif
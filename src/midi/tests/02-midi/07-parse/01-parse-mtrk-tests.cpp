@@ -0,0 +1,269 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/parse.h"
+#include "tests/tests-util.h"
+#include <sstream>
+
+using namespace testutils;
+
+
+namespace
+{
+    midi::PARSE_RESULT parse(const char* buffer, size_t size, midi::EventReceiver& receiver)
+    {
+        return midi::parse_mtrk(reinterpret_cast<const uint8_t*>(buffer), size, receiver);
+    }
+}
+
+TEST_CASE("Parsing MTrk, events up to the end of track")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 11, // Length
+        0, NOTE_ON(0, 60, 100),
+        10, NOTE_ON_RS(62, 100),
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder()
+        .note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100)
+        .note_on(midi::Duration(10), midi::Channel(0), midi::NoteNumber(62), 100)
+        .meta(midi::Duration(0), 0x2F, "")
+        .build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == sizeof(buffer));
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, what follows the end of track in the chunk is skipped")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 6, // Length
+        END_OF_TRACK,
+        0x12, 0x34
+    };
+
+    auto receiver = Builder().meta(midi::Duration(0), 0x2F, "").build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == sizeof(buffer));
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, a chunk size that is too small is tolerated")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 4, // Length
+        0, NOTE_ON(0, 60, 100),
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder()
+        .note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100)
+        .meta(midi::Duration(0), 0x2F, "")
+        .build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == sizeof(buffer));
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, truncated inside an event")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 11, // Length
+        0, NOTE_ON(0, 60, 100),
+        10, NOTE_ON_RS(62, 100),
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder().note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100).build();
+
+    const auto result = parse(buffer, 14, *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+    CATCH_CHECK(result.offset == 12);
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, truncated chunk header")
+{
+    char buffer[] = { MTRK, 0x00, 0x00 };
+
+    auto receiver = Builder().build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+    CATCH_CHECK(result.offset == 0);
+}
+
+TEST_CASE("Parsing MTrk, chunk without end of track")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 4, // Length
+        0, NOTE_ON(0, 60, 100)
+    };
+
+    auto receiver = Builder().note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100).build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::MISSING_END_OF_TRACK);
+    CATCH_CHECK(result.offset == 12);
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, wrong chunk id")
+{
+    char buffer[] = {
+        MTHD,
+        0x00, 0x00, 0x00, 4, // Length
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder().build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::BAD_CHUNK_ID);
+    CATCH_CHECK(result.offset == 0);
+}
+
+TEST_CASE("Parsing MTrk, running status without a previous midi event")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 7, // Length
+        0, NOTE_ON_RS(60, 100),
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder().build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::NO_RUNNING_STATUS);
+    CATCH_CHECK(result.offset == 9);
+}
+
+TEST_CASE("Parsing MTrk, running status continues after a meta event")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 15, // Length
+        0, NOTE_ON(3, 60, 100),
+        0, char(0xFF), 0x01, 0x00,
+        0, NOTE_ON_RS(62, 100),
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder()
+        .note_on(midi::Duration(0), midi::Channel(3), midi::NoteNumber(60), 100)
+        .meta(midi::Duration(0), 0x01, "")
+        .note_on(midi::Duration(0), midi::Channel(3), midi::NoteNumber(62), 100)
+        .meta(midi::Duration(0), 0x2F, "")
+        .build();
+
+    CATCH_CHECK(parse(buffer, sizeof(buffer), *receiver).ok());
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, system common event")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 10, // Length
+        0, NOTE_ON(0, 60, 100),
+        0, char(0xF2), 0x00, 0x00,
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder().note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100).build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::UNKNOWN_EVENT);
+    CATCH_CHECK(result.offset == 13);
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk, variable length integer of more than 10 bytes")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 15, // Length
+        char(0x81), char(0x81), char(0x81), char(0x81), char(0x81), char(0x81), char(0x81), char(0x81), char(0x81), char(0x81), 0x00,
+        END_OF_TRACK
+    };
+
+    auto receiver = Builder().build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::VARIABLE_LENGTH_INTEGER_TOO_LONG);
+    CATCH_CHECK(result.offset == 8);
+}
+
+TEST_CASE("Parsing MTrk, meta event longer than the data")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 8, // Length
+        0, char(0xFF), 0x01, 0x20, 'a', 'b', 'c', 'd'
+    };
+
+    auto receiver = Builder().build();
+
+    const auto result = parse(buffer, sizeof(buffer), *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+    CATCH_CHECK(result.offset == 8);
+}
+
+TEST_CASE("Parsing MTrk from a stream, a chunk size that is too small takes no more than the track")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 2, // Length
+        0, NOTE_ON(0, 60, 100),
+        END_OF_TRACK,
+        'n', 'e', 'x', 't'
+    };
+    std::string data(buffer, sizeof(buffer));
+    std::stringstream ss(data);
+
+    auto receiver = Builder()
+        .note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100)
+        .meta(midi::Duration(0), 0x2F, "")
+        .build();
+
+    const auto result = midi::parse_mtrk(ss, *receiver);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == 16);
+    CATCH_CHECK(char(ss.get()) == 'n');
+    receiver->check_finished();
+}
+
+TEST_CASE("Parsing MTrk from a stream, truncated")
+{
+    char buffer[] = {
+        MTRK,
+        0x00, 0x00, 0x00, 8, // Length
+        0, NOTE_ON(0, 60, 100),
+        0, char(0xFF)
+    };
+    std::string data(buffer, sizeof(buffer));
+    std::stringstream ss(data);
+
+    auto receiver = Builder().note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100).build();
+
+    const auto result = midi::parse_mtrk(ss, *receiver);
+    CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+    CATCH_CHECK(result.offset == 12);
+    receiver->check_finished();
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/parse.h"
+#include "midi/synthetic.h"
+#include "tests/tests-util.h"
+#include <sstream>
+
+using namespace testutils;
+
+TEST_CASE("Parsing notes, two tracks")
+{
+    const auto data = midi_file(1, { single_note_track(60), single_note_track(64) });
+
+    std::vector<midi::NOTE> notes;
+    const auto result = parse_notes(data, &notes);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == data.size());
+    CATCH_REQUIRE(notes.size() == 2);
+    CATCH_CHECK(notes[0] == midi::NOTE(midi::NoteNumber(60), midi::Time(0), midi::Duration(10), 100, midi::Instrument(0)));
+    CATCH_CHECK(notes[1] == midi::NOTE(midi::NoteNumber(64), midi::Time(0), midi::Duration(10), 100, midi::Instrument(0)));
+}
+
+TEST_CASE("Parsing notes, unknown chunks are skipped")
+{
+    const std::string unknown_chunk("XFIH\x00\x00\x00\x03" "abc", 11);
+    const auto data = midi_file(1, { single_note_track(60) }, unknown_chunk);
+
+    std::vector<midi::NOTE> notes;
+    CATCH_CHECK(parse_notes(data, &notes).ok());
+    CATCH_CHECK(notes.size() == 1);
+}
+
+TEST_CASE("Parsing notes, type 2 is not supported")
+{
+    const auto data = midi_file(2, { single_note_track(60) });
+
+    std::vector<midi::NOTE> notes;
+    const auto result = parse_notes(data, &notes);
+    CATCH_CHECK(result.status == midi::ParseStatus::UNSUPPORTED_FORMAT);
+    CATCH_CHECK(result.offset == 8);
+}
+
+TEST_CASE("Parsing notes, not a midi file")
+{
+    const std::string data = "RIFF....WAVEfmt ";
+
+    std::vector<midi::NOTE> notes;
+    const auto result = parse_notes(data, &notes);
+    CATCH_CHECK(result.status == midi::ParseStatus::BAD_CHUNK_ID);
+    CATCH_CHECK(result.offset == 0);
+}
+
+TEST_CASE("Parsing notes, an MThd chunk longer than the file")
+{
+    const std::string data("MThd\xFF\xFF\xFF\x00\x00\x01\x00\x01\x00\x60", 14);
+
+    std::vector<midi::NOTE> notes;
+    const auto result = parse_notes(data, &notes);
+    CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+    CATCH_CHECK(result.offset == 0);
+    CATCH_CHECK(notes.empty());
+
+    std::vector<std::vector<midi::NOTE>> sequences;
+    CATCH_CHECK(midi::parse_sequences(bytes(data), data.size(), &sequences).status == midi::ParseStatus::TRUNCATED);
+}
+
+TEST_CASE("Parsing notes, offsets are those in the file")
+{
+    auto data = midi_file(1, { single_note_track(60), single_note_track(64) });
+
+    //the status byte of the note on in the second track
+    const auto offset = 14 + 8 + 12 + 8 + 1;
+    data[offset] = char(0xF4);
+
+    std::vector<midi::NOTE> notes;
+    const auto result = parse_notes(data, &notes);
+    CATCH_CHECK(result.status == midi::ParseStatus::UNKNOWN_EVENT);
+    CATCH_CHECK(result.offset == offset);
+    CATCH_CHECK(notes.size() == 1);
+}
+
+TEST_CASE("Parsing notes, every truncation of a file is reported")
+{
+    midi::SYNTHETIC_SETTINGS settings;
+    settings.tracks = 3;
+    settings.events = 60;
+    settings.sysex_interval = 7;
+    settings.sysex_size = 5;
+    settings.tempo_interval = 9;
+
+    std::stringstream ss;
+    midi::write_synthetic_midi(ss, settings);
+    const auto data = ss.str();
+
+    std::vector<midi::NOTE> all_notes;
+    CATCH_REQUIRE(parse_notes(data, &all_notes).ok());
+
+    for(size_t size = 0; size != data.size(); ++size)
+    {
+        std::vector<midi::NOTE> notes;
+        const auto result = parse_notes(data.substr(0, size), &notes);
+
+        CATCH_CHECK(!result.ok());
+        CATCH_CHECK(result.offset <= size);
+        CATCH_CHECK(notes.size() <= all_notes.size());
+    }
+}
+
+TEST_CASE("Parsing notes from a stream")
+{
+    std::stringstream ss(midi_file(0, { single_note_track(60) }));
+
+    std::vector<midi::NOTE> notes;
+    CATCH_CHECK(midi::parse_notes(ss, &notes).ok());
+    CATCH_CHECK(notes.size() == 1);
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/parse.h"
+#include "midi/synthetic.h"
+#include "tests/tests-util.h"
+#include <sstream>
+
+using namespace testutils;
+
+namespace
+{
+    std::string synthetic_file()
+    {
+        midi::SYNTHETIC_SETTINGS settings;
+        settings.seed = 7;
+        settings.tracks = 3;
+        settings.events = 3000;
+        settings.sysex_interval = 50;
+        settings.sysex_size = 300;
+        settings.tempo_interval = 100;
+
+        std::stringstream ss;
+        midi::write_synthetic_midi(ss, settings);
+        return ss.str();
+    }
+
+    midi::PARSE_RESULT feed(midi::PushParser& parser, const std::string& data, size_t piece_size)
+    {
+        auto result = midi::PARSE_RESULT{midi::ParseStatus::OK, 0};
+        for(size_t i = 0; i < data.size() && result.ok(); i += piece_size)
+        {
+            const auto size = std::min(piece_size, data.size() - i);
+            result = parser.feed(bytes(data) + i, size);
+        }
+
+        return result;
+    }
+
+    //counts the events and remembers the last delta time
+    struct EventCounter : midi::EventReceiver
+    {
+        unsigned events = 0;
+        uint64_t last_dt = 0;
+
+        void event(midi::Duration dt) { ++events; last_dt = value(dt); }
+
+        void note_on(midi::Duration dt, midi::Channel, midi::NoteNumber, uint8_t) override { event(dt); }
+        void note_off(midi::Duration dt, midi::Channel, midi::NoteNumber, uint8_t) override { event(dt); }
+        void polyphonic_key_pressure(midi::Duration dt, midi::Channel, midi::NoteNumber, uint8_t) override { event(dt); }
+        void control_change(midi::Duration dt, midi::Channel, uint8_t, uint8_t) override { event(dt); }
+        void program_change(midi::Duration dt, midi::Channel, midi::Instrument) override { event(dt); }
+        void channel_pressure(midi::Duration dt, midi::Channel, uint8_t) override { event(dt); }
+        void pitch_wheel_change(midi::Duration dt, midi::Channel, uint16_t) override { event(dt); }
+        void meta(midi::Duration dt, uint8_t, std::unique_ptr<uint8_t[]>, uint64_t) override { event(dt); }
+        void sysex(midi::Duration dt, std::unique_ptr<uint8_t[]>, uint64_t) override { event(dt); }
+    };
+}
+
+TEST_CASE("Push parser, pieces of any size give the notes of parse_notes")
+{
+    const auto data = synthetic_file();
+
+    std::vector<midi::NOTE> expected;
+    CATCH_REQUIRE(parse_notes(data, &expected).ok());
+
+    for(size_t piece_size : {size_t(1), size_t(2), size_t(3), size_t(5), size_t(13), size_t(64), size_t(1000), data.size()})
+    {
+        std::vector<midi::NOTE> notes;
+        midi::NoteCollector note_collector([&notes](const midi::NOTE& note) { notes.push_back(note); });
+        midi::PushParser parser(note_collector);
+
+        CATCH_CHECK(feed(parser, data, piece_size).ok());
+        CATCH_CHECK(parser.done());
+        CATCH_CHECK(parser.finish().ok());
+        CATCH_CHECK(parser.finish().offset == data.size());
+        CATCH_CHECK(notes == expected);
+    }
+}
+
+TEST_CASE("Push parser, a track fed one byte at a time is rebuilt byte for byte")
+{
+    midi::TrackWriter track;
+    track.program_change(midi::Duration(0), midi::Channel(2), midi::Instrument(5));
+    track.note_on(midi::Duration(200), midi::Channel(2), midi::NoteNumber(60), 100);
+    track.sysex(midi::Duration(3), std::vector<uint8_t>(200, 0x11).data(), 200);
+    track.note_on(midi::Duration(0), midi::Channel(2), midi::NoteNumber(64), 100);
+    track.pitch_wheel_change(midi::Duration(1), midi::Channel(2), 0x2000);
+    track.tempo(midi::Duration(1000000), 500000);
+    track.note_off(midi::Duration(7), midi::Channel(2), midi::NoteNumber(60), 0);
+    track.end_of_track(midi::Duration(0));
+    const auto data = midi_file(0, { track });
+
+    midi::TrackWriter copy;
+    midi::PushParser parser(copy);
+    CATCH_CHECK(feed(parser, data, 1).ok());
+    CATCH_CHECK(parser.finish().ok());
+    CATCH_CHECK(copy.data() == track.data());
+}
+
+TEST_CASE("Push parser, every prefix of a file gives the status and offset of parse_notes")
+{
+    midi::SYNTHETIC_SETTINGS settings;
+    settings.tracks = 3;
+    settings.events = 40;
+    settings.sysex_interval = 7;
+    settings.sysex_size = 5;
+    settings.tempo_interval = 9;
+
+    std::stringstream ss;
+    midi::write_synthetic_midi(ss, settings);
+    const auto synthetic = ss.str();
+
+    //the size of the first MTrk chunk, right after the MThd chunk
+    auto with_first_track_size = [](std::string data, uint32_t size)
+    {
+        for(unsigned i = 0; i != 4; ++i) data[14 + 4 + i] = char(size >> (24U - 8 * i));
+        return data;
+    };
+
+    //a chunk size that runs past the file, one too small, one with bytes after the end of track,
+    //an MThd chunk with fields of a later version of the format and an unknown chunk
+    auto padded_tracks = midi_file(1, { single_note_track(60), single_note_track(62) });
+    padded_tracks = with_first_track_size(padded_tracks, 12 + 3);
+    padded_tracks.insert(14 + 8 + 12, "\x01\x02\x03", 3);
+
+    auto longer_header = midi_file(1, { single_note_track(60), single_note_track(62) });
+    longer_header[7] = 8;
+    longer_header.insert(14, "\x00\x00", 2);
+
+    const std::string files[] = {
+        synthetic,
+        with_first_track_size(synthetic, 0x7FFFFFFF),
+        with_first_track_size(synthetic, 2),
+        padded_tracks,
+        longer_header,
+        midi_file(1, { single_note_track(60), single_note_track(62) }, std::string("XFIH\x00\x00\x00\x03" "abc", 11))
+    };
+
+    for(const auto& file : files)
+    {
+        std::vector<midi::NOTE> complete;
+        CATCH_REQUIRE(parse_notes(file, &complete).ok());
+
+        bool same = true;
+        for(size_t size = 0; size <= file.size(); ++size)
+        {
+            const auto data = file.substr(0, size);
+
+            std::vector<midi::NOTE> expected;
+            const auto expected_result = parse_notes(data, &expected);
+
+            std::vector<midi::NOTE> notes;
+            midi::NoteCollector note_collector([&notes](const midi::NOTE& note) { notes.push_back(note); });
+            midi::PushParser parser(note_collector);
+            feed(parser, data, 1);
+            const auto result = parser.finish();
+
+            same = same && result.status == expected_result.status && result.offset == expected_result.offset && notes == expected;
+        }
+        CATCH_CHECK(same);
+    }
+}
+
+TEST_CASE("Push parser, a track chunk that runs past the file ends at its end of track")
+{
+    auto data = midi_file(1, { single_note_track(60), single_note_track(62) });
+    data[14 + 4] = char(0x7F);
+
+    std::vector<midi::NOTE> notes;
+    midi::NoteCollector note_collector([&notes](const midi::NOTE& note) { notes.push_back(note); });
+    midi::PushParser parser(note_collector);
+    CATCH_CHECK(feed(parser, data, 1).ok());
+    CATCH_CHECK(!parser.done());
+
+    //the second track is only known to follow the first once the data has ended
+    const auto result = parser.finish();
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == data.size());
+    CATCH_CHECK(notes.size() == 2);
+}
+
+TEST_CASE("Push parser, an event is delivered with its last byte")
+{
+    const auto data = midi_file(0, { single_note_track(60) });
+
+    EventCounter counter;
+    midi::PushParser parser(counter);
+
+    //the header chunks and the delta time and first two bytes of the note on
+    const auto note_on_end = 14 + 8 + 4;
+    feed(parser, data.substr(0, note_on_end - 1), 1);
+    CATCH_CHECK(counter.events == 0);
+
+    feed(parser, data.substr(note_on_end - 1, 1), 1);
+    CATCH_CHECK(counter.events == 1);
+}
+
+TEST_CASE("Push parser, a delta time split between calls")
+{
+    const auto data = midi_file(0, { single_note_track(60, midi::Duration(0x200000)) });
+
+    EventCounter counter;
+    midi::PushParser parser(counter);
+    feed(parser, data.substr(0, 14 + 8 + 1), data.size());
+    feed(parser, data.substr(14 + 8 + 1, 1), data.size());
+    CATCH_CHECK(counter.events == 0);
+
+    feed(parser, data.substr(14 + 8 + 2), data.size());
+    CATCH_CHECK(counter.events == 3);
+    CATCH_CHECK(parser.finish().ok());
+}
+
+TEST_CASE("Push parser, the header is known once the MThd chunk is in")
+{
+    const auto data = midi_file(1, { single_note_track(60), single_note_track(62) });
+
+    EventCounter counter;
+    midi::PushParser parser(counter);
+    feed(parser, data.substr(0, 13), 1);
+    CATCH_CHECK(parser.header() == nullptr);
+
+    feed(parser, data.substr(13, 1), 1);
+    CATCH_REQUIRE(parser.header() != nullptr);
+    CATCH_CHECK(parser.header()->ntracks == 2);
+    CATCH_CHECK(parser.header()->type == 1);
+}
+
+TEST_CASE("Push parser, unknown chunks are skipped")
+{
+    const std::string unknown_chunk("XFIH\x00\x00\x00\x05" "abcde", 13);
+    const auto data = midi_file(1, { single_note_track(60) }, unknown_chunk);
+
+    EventCounter counter;
+    midi::PushParser parser(counter);
+    CATCH_CHECK(feed(parser, data, 1).ok());
+    CATCH_CHECK(parser.finish().ok());
+    CATCH_CHECK(counter.events == 3);
+}
+
+TEST_CASE("Push parser, what follows the last track is ignored")
+{
+    const auto file = midi_file(0, { single_note_track(60) });
+
+    EventCounter counter;
+    midi::PushParser parser(counter);
+    CATCH_CHECK(feed(parser, file + "trailing garbage", 3).ok());
+    CATCH_CHECK(parser.done());
+    CATCH_CHECK(parser.finish().ok());
+    CATCH_CHECK(parser.finish().offset == file.size());
+}
+
+TEST_CASE("Push parser, not a midi file is rejected after four bytes")
+{
+    EventCounter counter;
+    midi::PushParser parser(counter);
+
+    const auto result = feed(parser, "RIFF", 4);
+    CATCH_CHECK(result.status == midi::ParseStatus::BAD_CHUNK_ID);
+    CATCH_CHECK(result.offset == 0);
+
+    //a problem sticks
+    CATCH_CHECK(feed(parser, "more", 4).status == midi::ParseStatus::BAD_CHUNK_ID);
+    CATCH_CHECK(parser.finish().status == midi::ParseStatus::BAD_CHUNK_ID);
+}
+
+TEST_CASE("Push parser, problems are reported at their offset in the file")
+{
+    auto data = midi_file(1, { single_note_track(60), single_note_track(64) });
+
+    //the status byte of the note on in the second track
+    const auto offset = 14 + 8 + 12 + 8 + 1;
+    data[offset] = char(0xF4);
+
+    EventCounter counter;
+    midi::PushParser parser(counter);
+    const auto result = feed(parser, data, 7);
+    CATCH_CHECK(result.status == midi::ParseStatus::UNKNOWN_EVENT);
+    CATCH_CHECK(result.offset == offset);
+    CATCH_CHECK(counter.events == 3);
+}
+
+TEST_CASE("Push parser, incomplete files")
+{
+    EventCounter counter;
+    midi::PushParser parser(counter);
+
+    CATCH_CHECK(parser.finish().status == midi::ParseStatus::TRUNCATED);
+
+    CATCH_SECTION("ending inside an event")
+    {
+        const auto data = midi_file(0, { single_note_track(60) });
+        CATCH_CHECK(feed(parser, data.substr(0, data.size() - 2), 5).ok());
+        CATCH_CHECK(!parser.done());
+
+        const auto result = parser.finish();
+        CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+        CATCH_CHECK(result.offset == data.size() - 4);
+    }
+    CATCH_SECTION("ending where the track chunk ends, without an end of track")
+    {
+        midi::TrackWriter track;
+        track.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+        const auto data = midi_file(0, { track });
+        CATCH_CHECK(feed(parser, data, 5).ok());
+
+        const auto result = parser.finish();
+        CATCH_CHECK(result.status == midi::ParseStatus::MISSING_END_OF_TRACK);
+        CATCH_CHECK(result.offset == data.size());
+    }
+    CATCH_SECTION("ending before the last track")
+    {
+        const auto data = midi_file(1, { single_note_track(60), single_note_track(62) });
+        CATCH_CHECK(feed(parser, data.substr(0, 14 + 8 + 12 + 3), 5).ok());
+
+        const auto result = parser.finish();
+        CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+        CATCH_CHECK(result.offset == 14 + 8 + 12);
+    }
+}
+
+#endif
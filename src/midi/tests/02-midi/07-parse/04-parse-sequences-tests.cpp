@@ -0,0 +1,114 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/parse.h"
+#include "tests/tests-util.h"
+
+using namespace testutils;
+
+namespace
+{
+    midi::TrackWriter pattern_track(uint8_t note, uint64_t start, uint32_t tempo)
+    {
+        midi::TrackWriter track;
+        track.tempo(midi::Duration(0), tempo);
+        track.note_on(midi::Duration(start), midi::Channel(0), midi::NoteNumber(note), 100);
+        track.note_off(midi::Duration(10), midi::Channel(0), midi::NoteNumber(note), 0);
+        track.end_of_track(midi::Duration(0));
+
+        return track;
+    }
+
+    midi::NOTE note(uint8_t note_number, uint64_t start, uint8_t instrument = 0)
+    {
+        return midi::NOTE(midi::NoteNumber(note_number), midi::Time(start), midi::Duration(10), 100, midi::Instrument(instrument));
+    }
+}
+
+TEST_CASE("Parsing sequences, every track of a type 2 file is a sequence of its own")
+{
+    auto first = pattern_track(60, 0, 500000);
+    midi::TrackWriter second;
+    second.program_change(midi::Duration(0), midi::Channel(0), midi::Instrument(7));
+    second.note_on(midi::Duration(40), midi::Channel(0), midi::NoteNumber(62), 100);
+    second.note_off(midi::Duration(10), midi::Channel(0), midi::NoteNumber(62), 0);
+    second.end_of_track(midi::Duration(0));
+    auto third = pattern_track(64, 5, 250000);
+    const auto data = midi_file(2, { first, second, third });
+
+    std::vector<std::vector<midi::NOTE>> sequences;
+    const auto result = parse_sequences(data, &sequences);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == data.size());
+
+    //each starts at time 0, and the instrument of one sequence does not carry over to the next
+    CATCH_REQUIRE(sequences.size() == 3);
+    CATCH_CHECK(sequences[0] == std::vector<midi::NOTE>{ note(60, 0) });
+    CATCH_CHECK(sequences[1] == std::vector<midi::NOTE>{ note(62, 40, 7) });
+    CATCH_CHECK(sequences[2] == std::vector<midi::NOTE>{ note(64, 5) });
+}
+
+TEST_CASE("Parsing sequences, a track without notes is an empty sequence")
+{
+    midi::TrackWriter empty;
+    empty.tempo(midi::Duration(0), 500000);
+    empty.end_of_track(midi::Duration(100));
+    const auto data = midi_file(2, { empty, pattern_track(60, 0, 500000) });
+
+    std::vector<std::vector<midi::NOTE>> sequences;
+    CATCH_CHECK(parse_sequences(data, &sequences).ok());
+    CATCH_REQUIRE(sequences.size() == 2);
+    CATCH_CHECK(sequences[0].empty());
+    CATCH_CHECK(sequences[1].size() == 1);
+}
+
+TEST_CASE("Parsing sequences, type 0 and 1 files are a single sequence")
+{
+    const auto data = midi_file(1, { pattern_track(60, 0, 500000), pattern_track(64, 5, 500000) });
+
+    std::vector<midi::NOTE> notes;
+    CATCH_REQUIRE(parse_notes(data, &notes).ok());
+
+    std::vector<std::vector<midi::NOTE>> sequences;
+    CATCH_CHECK(parse_sequences(data, &sequences).ok());
+    CATCH_REQUIRE(sequences.size() == 1);
+    CATCH_CHECK(sequences[0] == notes);
+}
+
+TEST_CASE("Parsing sequences, sequences are added to the end")
+{
+    const auto data = midi_file(2, { pattern_track(60, 0, 500000), pattern_track(62, 0, 500000) });
+
+    std::vector<std::vector<midi::NOTE>> sequences(1);
+    CATCH_CHECK(parse_sequences(data, &sequences).ok());
+    CATCH_REQUIRE(sequences.size() == 3);
+    CATCH_CHECK(sequences[0].empty());
+    CATCH_CHECK(sequences[2] == std::vector<midi::NOTE>{ note(62, 0) });
+}
+
+TEST_CASE("Parsing sequences, a problem is reported at its offset in the file")
+{
+    auto data = midi_file(2, { pattern_track(60, 0, 500000), pattern_track(64, 0, 500000) });
+
+    //the status byte of the note on in the second track, after its tempo event
+    const auto offset = 14 + 8 + 19 + 8 + 7 + 1;
+    data[offset] = char(0xF4);
+
+    std::vector<std::vector<midi::NOTE>> sequences;
+    const auto result = parse_sequences(data, &sequences);
+    CATCH_CHECK(result.status == midi::ParseStatus::UNKNOWN_EVENT);
+    CATCH_CHECK(result.offset == offset);
+}
+
+TEST_CASE("Parsing sequences, type 2 files are recognized by their header")
+{
+    const auto type_2 = midi_file(2, { pattern_track(60, 0, 500000) });
+    const auto type_1 = midi_file(1, { pattern_track(60, 0, 500000) });
+
+    CATCH_CHECK(midi::holds_sequences(bytes(type_2), type_2.size()));
+    CATCH_CHECK(!midi::holds_sequences(bytes(type_1), type_1.size()));
+    CATCH_CHECK(!midi::holds_sequences(bytes(type_2), 10));
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/events.h"
+#include "midi/synthetic.h"
+#include "tests/tests-util.h"
+#include <sstream>
+
+using namespace testutils;
+
+namespace
+{
+    std::string synthetic_file(unsigned tracks)
+    {
+        midi::SYNTHETIC_SETTINGS settings;
+        settings.seed = 11;
+        settings.tracks = tracks;
+        settings.events = 4000;
+        settings.sysex_interval = 40;
+        settings.tempo_interval = 70;
+
+        std::stringstream ss;
+        midi::write_synthetic_midi(ss, settings);
+        return ss.str();
+    }
+}
+
+TEST_CASE("Decoding events, a record for every event")
+{
+    const uint8_t sysex_data[] = { 0x7E, 0x7F, 0x09, 0x01 };
+
+    midi::TrackWriter track;
+    track.note_on(midi::Duration(5), midi::Channel(3), midi::NoteNumber(60), 100);
+    track.note_off(midi::Duration(10), midi::Channel(3), midi::NoteNumber(60), 64);
+    track.polyphonic_key_pressure(midi::Duration(0), midi::Channel(1), midi::NoteNumber(61), 20);
+    track.control_change(midi::Duration(1), midi::Channel(2), 7, 127);
+    track.program_change(midi::Duration(2), midi::Channel(4), midi::Instrument(5));
+    track.channel_pressure(midi::Duration(3), midi::Channel(5), 70);
+    track.pitch_wheel_change(midi::Duration(4), midi::Channel(6), 0x2001);
+    track.tempo(midi::Duration(100), 500000);
+    track.sysex(midi::Duration(0), sysex_data, sizeof(sysex_data));
+    track.end_of_track(midi::Duration(7));
+    const auto data = midi_file(0, { track });
+
+    midi::DECODED_EVENTS events;
+    const auto result = decode_events(data, &events);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == data.size());
+    CATCH_CHECK(events.header.type == 0);
+    CATCH_REQUIRE(events.tracks.size() == 1);
+
+    const auto& records = events.tracks[0].records;
+    CATCH_REQUIRE(records.size() == 10);
+
+    //times are absolute
+    const uint64_t times[] = { 5, 15, 15, 16, 18, 21, 25, 125, 125, 132 };
+    for(size_t i = 0; i != records.size(); ++i) CATCH_CHECK(records[i].time == times[i]);
+
+    CATCH_CHECK(records[0].kind == midi::EventKind::NOTE_ON);
+    CATCH_CHECK(records[0].channel == 3);
+    CATCH_CHECK(records[0].d1 == 60);
+    CATCH_CHECK(records[0].d2 == 100);
+    CATCH_CHECK(records[1].kind == midi::EventKind::NOTE_OFF);
+    CATCH_CHECK(records[1].d2 == 64);
+    CATCH_CHECK(records[2].kind == midi::EventKind::POLYPHONIC_KEY_PRESSURE);
+    CATCH_CHECK(records[3].kind == midi::EventKind::CONTROL_CHANGE);
+    CATCH_CHECK(records[3].d1 == 7);
+    CATCH_CHECK(records[3].d2 == 127);
+    CATCH_CHECK(records[4].kind == midi::EventKind::PROGRAM_CHANGE);
+    CATCH_CHECK(records[4].d1 == 5);
+    CATCH_CHECK(records[5].kind == midi::EventKind::CHANNEL_PRESSURE);
+    CATCH_CHECK(records[5].d1 == 70);
+    CATCH_CHECK(records[6].kind == midi::EventKind::PITCH_WHEEL_CHANGE);
+    CATCH_CHECK(records[6].channel == 6);
+    CATCH_CHECK(records[6].pitch_wheel_value() == 0x2001);
+
+    const auto& decoded = events.tracks[0];
+    CATCH_CHECK(records[7].kind == midi::EventKind::META);
+    CATCH_CHECK(records[7].channel == 0x51);
+    CATCH_REQUIRE(decoded.payload_size(records[7]) == 3);
+    CATCH_CHECK(std::vector<uint8_t>(decoded.payload_data(records[7]), decoded.payload_data(records[7]) + 3) == std::vector<uint8_t>{ 0x07, 0xA1, 0x20 });
+
+    CATCH_CHECK(records[8].kind == midi::EventKind::SYSEX);
+    CATCH_REQUIRE(decoded.payload_size(records[8]) == sizeof(sysex_data));
+    CATCH_CHECK(std::equal(sysex_data, sysex_data + sizeof(sysex_data), decoded.payload_data(records[8])));
+
+    CATCH_CHECK(records[9].kind == midi::EventKind::META);
+    CATCH_CHECK(records[9].channel == 0x2F);
+    CATCH_CHECK(decoded.payload_size(records[9]) == 0);
+}
+
+TEST_CASE("Decoding events, every track starts at time 0")
+{
+    const auto data = midi_file(1, { single_note_track(60), single_note_track(64) });
+
+    midi::DECODED_EVENTS events;
+    CATCH_CHECK(decode_events(data, &events).ok());
+    CATCH_REQUIRE(events.tracks.size() == 2);
+    CATCH_CHECK(events.tracks[1].records[0].time == 0);
+    CATCH_CHECK(events.tracks[1].records[1].time == 10);
+}
+
+TEST_CASE("Decoding events, the notes are those of parse_notes")
+{
+    for(unsigned tracks : { 1U, 4U })
+    {
+        const auto data = synthetic_file(tracks);
+
+        std::vector<midi::NOTE> expected;
+        CATCH_REQUIRE(parse_notes(data, &expected).ok());
+
+        midi::DECODED_EVENTS events;
+        CATCH_REQUIRE(decode_events(data, &events).ok());
+        CATCH_CHECK(events.tracks.size() == tracks);
+
+        std::vector<midi::NOTE> notes;
+        midi::collect_notes(events, &notes);
+        CATCH_CHECK(notes == expected);
+    }
+}
+
+TEST_CASE("Decoding events, type 2 files are decoded as well")
+{
+    const auto data = midi_file(2, { single_note_track(60), single_note_track(64), single_note_track(67) });
+
+    midi::DECODED_EVENTS events;
+    CATCH_CHECK(decode_events(data, &events).ok());
+    CATCH_CHECK(events.header.type == 2);
+    CATCH_CHECK(events.tracks.size() == 3);
+}
+
+TEST_CASE("Decoding events, only complete tracks are kept after a problem")
+{
+    auto data = midi_file(1, { single_note_track(60), single_note_track(64) });
+
+    //the status byte of the note on in the second track
+    const auto offset = 14 + 8 + 12 + 8 + 1;
+    data[offset] = char(0xF4);
+
+    midi::DECODED_EVENTS events;
+    const auto result = decode_events(data, &events);
+    CATCH_CHECK(result.status == midi::ParseStatus::UNKNOWN_EVENT);
+    CATCH_CHECK(result.offset == offset);
+    CATCH_CHECK(events.tracks.size() == 1);
+}
+
+TEST_CASE("Decoding events, records in batches")
+{
+    const auto data = synthetic_file(1);
+
+    midi::DECODED_EVENTS events;
+    CATCH_REQUIRE(decode_events(data, &events).ok());
+    const auto& track = events.tracks[0];
+
+    std::vector<size_t> batch_sizes;
+    const midi::EVENT_RECORD* next = track.records.data();
+    bool contiguous = true;
+    midi::for_each_batch(track, 256, [&](const midi::EVENT_RECORD* records, size_t count)
+    {
+        contiguous = contiguous && records == next;
+        next = records + count;
+        batch_sizes.push_back(count);
+    });
+
+    CATCH_CHECK(contiguous);
+    CATCH_CHECK(next == track.records.data() + track.records.size());
+    CATCH_REQUIRE(!batch_sizes.empty());
+    CATCH_CHECK(batch_sizes.size() == (track.records.size() + 255) / 256);
+    CATCH_CHECK(std::all_of(batch_sizes.begin(), batch_sizes.end() - 1, [](size_t size) { return size == 256; }));
+}
+
+#endif
@@ -0,0 +1,122 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/timeline.h"
+#include "midi/synthetic.h"
+#include "tests/tests-util.h"
+#include <algorithm>
+#include <sstream>
+#include <tuple>
+
+using namespace testutils;
+
+namespace
+{
+    midi::DECODED_EVENTS decode(const std::string& data)
+    {
+        midi::DECODED_EVENTS events;
+        CATCH_REQUIRE(decode_events(data, &events).ok());
+
+        return events;
+    }
+
+    //(time, track, index in the track) of every event in the order of the timeline
+    std::vector<std::tuple<uint64_t, unsigned, size_t>> merge(const midi::DECODED_EVENTS& events)
+    {
+        std::vector<std::tuple<uint64_t, unsigned, size_t>> merged;
+        midi::MergedTimeline timeline(events);
+        midi::TIMELINE_EVENT event{};
+        while(timeline.next(&event))
+        {
+            merged.emplace_back(event.record->time, event.track, size_t(event.record - events.tracks[event.track].records.data()));
+        }
+
+        return merged;
+    }
+
+    //the same by sorting every event
+    std::vector<std::tuple<uint64_t, unsigned, size_t>> sort(const midi::DECODED_EVENTS& events)
+    {
+        std::vector<std::tuple<uint64_t, unsigned, size_t>> sorted;
+        for(unsigned track = 0; track != events.tracks.size(); ++track)
+        {
+            const auto& records = events.tracks[track].records;
+            for(size_t i = 0; i != records.size(); ++i) sorted.emplace_back(records[i].time, track, i);
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        return sorted;
+    }
+}
+
+TEST_CASE("Merged timeline, the tempo track among the notes")
+{
+    midi::TrackWriter tempo_track;
+    tempo_track.tempo(midi::Duration(0), 500000);
+    tempo_track.tempo(midi::Duration(100), 250000);
+    tempo_track.end_of_track(midi::Duration(0));
+
+    midi::TrackWriter note_track;
+    note_track.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+    note_track.note_off(midi::Duration(50), midi::Channel(0), midi::NoteNumber(60), 0);
+    note_track.note_on(midi::Duration(50), midi::Channel(0), midi::NoteNumber(62), 100);
+    note_track.end_of_track(midi::Duration(10));
+
+    const auto events = decode(midi_file(1, { tempo_track, note_track }));
+    const auto merged = merge(events);
+
+    //at the same tick the tempo track comes first
+    using EVENT = std::tuple<uint64_t, unsigned, size_t>;
+    const std::vector<EVENT> expected = { EVENT{0, 0, 0}, EVENT{0, 1, 0}, EVENT{50, 1, 1}, EVENT{100, 0, 1}, EVENT{100, 0, 2}, EVENT{100, 1, 2}, EVENT{110, 1, 3} };
+    CATCH_CHECK(merged == expected);
+}
+
+TEST_CASE("Merged timeline, the order of a stable sort by tick")
+{
+    for(unsigned tracks : { 2U, 3U, 7U, 16U })
+    {
+        midi::SYNTHETIC_SETTINGS settings;
+        settings.seed = tracks;
+        settings.tracks = tracks;
+        settings.events = 5000;
+        settings.tempo_interval = 30;
+
+        std::stringstream ss;
+        midi::write_synthetic_midi(ss, settings);
+        const auto events = decode(ss.str());
+
+        CATCH_CHECK(merge(events) == sort(events));
+    }
+}
+
+TEST_CASE("Merged timeline, empty tracks")
+{
+    midi::TrackWriter empty_track;
+    empty_track.end_of_track(midi::Duration(0));
+
+    midi::TrackWriter note_track;
+    note_track.note_on(midi::Duration(5), midi::Channel(0), midi::NoteNumber(60), 100);
+    note_track.end_of_track(midi::Duration(5));
+
+    CATCH_SECTION("a single track")
+    {
+        const auto events = decode(midi_file(1, { note_track }));
+        CATCH_CHECK(merge(events) == sort(events));
+    }
+    CATCH_SECTION("tracks with nothing but their end")
+    {
+        const auto events = decode(midi_file(1, { empty_track, note_track, empty_track, empty_track, note_track }));
+        CATCH_CHECK(merge(events) == sort(events));
+    }
+    CATCH_SECTION("no tracks")
+    {
+        const auto events = decode(midi_file(1, {}));
+        midi::MergedTimeline timeline(events);
+        midi::TIMELINE_EVENT event{};
+        CATCH_CHECK(!timeline.next(&event));
+        CATCH_CHECK(!timeline.next(&event));
+    }
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/notes-cache.h"
+#include "util/hash.h"
+#include "tests/tests-util.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using testutils::bytes;
+
+namespace
+{
+    std::string notes_file(const std::vector<uint8_t>& note_numbers)
+    {
+        midi::TrackWriter track;
+        for(auto note_number : note_numbers)
+        {
+            track.note_on(midi::Duration(5), midi::Channel(0), midi::NoteNumber(note_number), 90);
+            track.note_off(midi::Duration(10), midi::Channel(0), midi::NoteNumber(note_number), 0);
+        }
+        track.end_of_track(midi::Duration(0));
+
+        return testutils::midi_file(0, { track });
+    }
+
+    //a fresh directory that is removed again at the end of a test
+    struct TEMPORARY_DIRECTORY
+    {
+        std::filesystem::path path;
+
+        explicit TEMPORARY_DIRECTORY(const std::string& name)
+            : path(std::filesystem::temp_directory_path() / (name + "-" + std::to_string(getpid())))
+        {
+            std::filesystem::remove_all(path);
+            std::filesystem::create_directories(path);
+        }
+
+        ~TEMPORARY_DIRECTORY()
+        {
+            std::filesystem::remove_all(path);
+        }
+    };
+
+    std::vector<midi::NOTE> example_notes()
+    {
+        return {
+            midi::NOTE(midi::NoteNumber(60), midi::Time(0), midi::Duration(10), 100, midi::Instrument(0)),
+            midi::NOTE(midi::NoteNumber(127), midi::Time(uint64_t(1) << 40), midi::Duration(3), 1, midi::Instrument(127)),
+            midi::NOTE(midi::NoteNumber(0), midi::Time(15), midi::Duration(0), 64, midi::Instrument(12))
+        };
+    }
+
+    void write_file(const std::filesystem::path& path, const std::vector<midi::NOTE>& notes, uint64_t hash, uint64_t size)
+    {
+        std::ofstream out(path, std::ios_base::binary);
+        midi::write_notes_file(out, hash, size, notes);
+    }
+}
+
+TEST_CASE("Notes file, columns are read back")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-file-test");
+    const auto path = (directory.path / "example.notes").string();
+    const auto notes = example_notes();
+    write_file(path, notes, 1234, 56);
+
+    CATCH_CHECK(std::filesystem::file_size(path) == midi::NOTES_FILE_HEADER_SIZE + 3 * 19);
+
+    const midi::MappedNotes mapped_notes(path, 1234, 56);
+    CATCH_REQUIRE(mapped_notes.valid());
+    CATCH_REQUIRE(mapped_notes.count() == 3);
+    CATCH_CHECK(mapped_notes.starts()[1] == uint64_t(1) << 40);
+    CATCH_CHECK(mapped_notes.durations()[2] == 0);
+    CATCH_CHECK(mapped_notes.note_numbers()[1] == 127);
+    CATCH_CHECK(mapped_notes.velocities()[0] == 100);
+    CATCH_CHECK(mapped_notes.instruments()[2] == 12);
+    CATCH_CHECK(mapped_notes.notes() == notes);
+}
+
+TEST_CASE("Notes file without notes")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-file-test");
+    const auto path = (directory.path / "empty.notes").string();
+    write_file(path, {}, 1, 2);
+
+    const midi::MappedNotes mapped_notes(path, 1, 2);
+    CATCH_REQUIRE(mapped_notes.valid());
+    CATCH_CHECK(mapped_notes.notes().empty());
+}
+
+TEST_CASE("Notes file of another midi file")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-file-test");
+    const auto path = (directory.path / "example.notes").string();
+    write_file(path, example_notes(), 1234, 56);
+
+    CATCH_CHECK(!midi::MappedNotes(path, 1235, 56).valid());
+    CATCH_CHECK(!midi::MappedNotes(path, 1234, 57).valid());
+    CATCH_CHECK(!midi::MappedNotes((directory.path / "missing.notes").string(), 1234, 56).valid());
+}
+
+TEST_CASE("Notes file that was damaged")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-file-test");
+    const auto path = (directory.path / "example.notes").string();
+    write_file(path, example_notes(), 1234, 56);
+
+    CATCH_SECTION("a changed column byte")
+    {
+        std::fstream file(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        file.seekp(midi::NOTES_FILE_HEADER_SIZE + 50);
+        file.put('\x7F');
+    }
+    CATCH_SECTION("a missing byte")
+    {
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    }
+    CATCH_SECTION("another version")
+    {
+        std::fstream file(path, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        file.seekp(4);
+        file.put(static_cast<char>(midi::NOTES_FILE_VERSION + 1));
+    }
+
+    CATCH_CHECK(!midi::MappedNotes(path, 1234, 56).valid());
+}
+
+TEST_CASE("Notes cache, a midi file is parsed once")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-cache-test");
+    midi::NotesCache cache(directory.path.string(), 1 << 20);
+    const auto data = notes_file({ 60, 62, 64 });
+
+    std::vector<midi::NOTE> parsed;
+    bool hit = true;
+    CATCH_REQUIRE(cache.read_notes(bytes(data), data.size(), &parsed, &hit).ok());
+    CATCH_CHECK(!hit);
+    CATCH_CHECK(parsed.size() == 3);
+    CATCH_CHECK(std::filesystem::exists(cache.path_of(hashing::hash_bytes(bytes(data), data.size()))));
+
+    std::vector<midi::NOTE> loaded;
+    const auto result = cache.read_notes(bytes(data), data.size(), &loaded, &hit);
+    CATCH_CHECK(result.ok());
+    CATCH_CHECK(result.offset == data.size());
+    CATCH_CHECK(hit);
+    CATCH_CHECK(loaded == parsed);
+}
+
+TEST_CASE("Notes cache, other contents miss")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-cache-test");
+    midi::NotesCache cache(directory.path.string(), 1 << 20);
+    const auto first = notes_file({ 60 });
+    const auto second = notes_file({ 61 });
+
+    std::vector<midi::NOTE> notes;
+    bool hit = true;
+    cache.read_notes(bytes(first), first.size(), &notes, &hit);
+    notes.clear();
+    cache.read_notes(bytes(second), second.size(), &notes, &hit);
+    CATCH_CHECK(!hit);
+    CATCH_REQUIRE(notes.size() == 1);
+    CATCH_CHECK(notes[0].note_number == midi::NoteNumber(61));
+}
+
+TEST_CASE("Notes cache, malformed files are not stored")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-cache-test");
+    midi::NotesCache cache(directory.path.string(), 1 << 20);
+    const auto data = notes_file({ 60, 62 }).substr(0, 30);
+
+    std::vector<midi::NOTE> notes;
+    const auto result = cache.read_notes(bytes(data), data.size(), &notes);
+    CATCH_CHECK(result.status == midi::ParseStatus::TRUNCATED);
+    CATCH_CHECK(std::filesystem::is_empty(directory.path));
+}
+
+TEST_CASE("Notes cache, the least recently used files are evicted")
+{
+    TEMPORARY_DIRECTORY directory("midi-notes-cache-test");
+    const auto a = notes_file({ 60 });
+    const auto b = notes_file({ 61 });
+    const auto c = notes_file({ 62 });
+
+    //room for two notes files of a single note
+    midi::NotesCache cache(directory.path.string(), 2 * (midi::NOTES_FILE_HEADER_SIZE + 19));
+    auto path_of = [&](const std::string& data) { return cache.path_of(hashing::hash_bytes(bytes(data), data.size())); };
+
+    std::vector<midi::NOTE> notes;
+    cache.read_notes(bytes(a), a.size(), &notes);
+    cache.read_notes(bytes(b), b.size(), &notes);
+
+    //a was stored first but is used again after b
+    const auto now = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(path_of(a), now - std::chrono::hours(2));
+    std::filesystem::last_write_time(path_of(b), now - std::chrono::hours(1));
+    bool hit = false;
+    cache.read_notes(bytes(a), a.size(), &notes, &hit);
+    CATCH_CHECK(hit);
+
+    cache.read_notes(bytes(c), c.size(), &notes);
+    CATCH_CHECK(std::filesystem::exists(path_of(a)));
+    CATCH_CHECK(!std::filesystem::exists(path_of(b)));
+    CATCH_CHECK(std::filesystem::exists(path_of(c)));
+}
+
+#endif
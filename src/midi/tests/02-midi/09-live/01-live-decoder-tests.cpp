@@ -0,0 +1,177 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/live.h"
+#include "midi/writer.h"
+#include "Catch.h"
+#include <vector>
+
+
+namespace
+{
+    void feed(midi::LiveDecoder& decoder, const std::vector<uint8_t>& bytes, uint64_t time)
+    {
+        decoder.feed(bytes.data(), bytes.size(), time);
+    }
+
+    midi::NOTE note(uint8_t note_number, uint64_t start, uint64_t duration, uint8_t velocity, uint8_t instrument = 0)
+    {
+        return midi::NOTE(midi::NoteNumber(note_number), midi::Time(start), midi::Duration(duration), velocity, midi::Instrument(instrument));
+    }
+}
+
+TEST_CASE("Live decoder, every channel message")
+{
+    midi::TrackWriter decoded;
+    midi::LiveDecoder decoder(decoded);
+    feed(decoder, { 0x80, 60, 10, 0x91, 60, 100, 0xA2, 61, 20, 0xB3, 7, 127, 0xC4, 5, 0xD5, 70, 0xE6, 0x01, 0x40 }, 0);
+
+    midi::TrackWriter expected;
+    expected.note_off(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 10);
+    expected.note_on(midi::Duration(0), midi::Channel(1), midi::NoteNumber(60), 100);
+    expected.polyphonic_key_pressure(midi::Duration(0), midi::Channel(2), midi::NoteNumber(61), 20);
+    expected.control_change(midi::Duration(0), midi::Channel(3), 7, 127);
+    expected.program_change(midi::Duration(0), midi::Channel(4), midi::Instrument(5));
+    expected.channel_pressure(midi::Duration(0), midi::Channel(5), 70);
+    expected.pitch_wheel_change(midi::Duration(0), midi::Channel(6), 0x2001);
+
+    CATCH_CHECK(decoded.data() == expected.data());
+    CATCH_CHECK(decoder.events() == 7);
+}
+
+TEST_CASE("Live decoder, delta times are the microseconds between arrivals")
+{
+    midi::TrackWriter decoded;
+    midi::LiveDecoder decoder(decoded, 1000);
+    feed(decoder, { 0x90, 60, 100 }, 1500);
+    feed(decoder, { 0x90, 62, 100, 0x80, 60, 0 }, 4000);
+
+    midi::TrackWriter expected;
+    expected.note_on(midi::Duration(500), midi::Channel(0), midi::NoteNumber(60), 100);
+    expected.note_on(midi::Duration(2500), midi::Channel(0), midi::NoteNumber(62), 100);
+    expected.note_off(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 0);
+
+    CATCH_CHECK(decoded.data() == expected.data());
+}
+
+TEST_CASE("Live decoder, a message split between reads arrives with its last byte")
+{
+    midi::TrackWriter decoded;
+    midi::LiveDecoder decoder(decoded);
+    feed(decoder, { 0x90, 60 }, 100);
+    CATCH_CHECK(decoder.events() == 0);
+
+    feed(decoder, { 100 }, 300);
+
+    midi::TrackWriter expected;
+    expected.note_on(midi::Duration(300), midi::Channel(0), midi::NoteNumber(60), 100);
+    CATCH_CHECK(decoded.data() == expected.data());
+}
+
+TEST_CASE("Live decoder, running status")
+{
+    midi::TrackWriter decoded;
+    midi::LiveDecoder decoder(decoded);
+    feed(decoder, { 0x93, 60, 100, 64, 100, 60, 0, 0xC3, 1, 2 }, 0);
+
+    midi::TrackWriter expected;
+    expected.note_on(midi::Duration(0), midi::Channel(3), midi::NoteNumber(60), 100);
+    expected.note_on(midi::Duration(0), midi::Channel(3), midi::NoteNumber(64), 100);
+    expected.note_on(midi::Duration(0), midi::Channel(3), midi::NoteNumber(60), 0);
+    expected.program_change(midi::Duration(0), midi::Channel(3), midi::Instrument(1));
+    expected.program_change(midi::Duration(0), midi::Channel(3), midi::Instrument(2));
+
+    CATCH_CHECK(decoded.data() == expected.data());
+}
+
+TEST_CASE("Live decoder, system messages")
+{
+    midi::TrackWriter decoded;
+    midi::LiveDecoder decoder(decoded);
+
+    CATCH_SECTION("realtime bytes inside a message are skipped")
+    {
+        feed(decoder, { 0xF8, 0x90, 0xFE, 60, 0xF8, 100, 0xFA, 62, 0xFC, 100 }, 0);
+        CATCH_CHECK(decoder.events() == 2);
+    }
+    CATCH_SECTION("system exclusive is skipped and cancels the running status")
+    {
+        feed(decoder, { 0x90, 60, 100, 0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7, 62, 100, 0x90, 64, 100 }, 0);
+
+        midi::TrackWriter expected;
+        expected.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+        expected.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(64), 100);
+        CATCH_CHECK(decoded.data() == expected.data());
+    }
+    CATCH_SECTION("system exclusive ended by another status byte")
+    {
+        feed(decoder, { 0xF0, 0x43, 0x12, 0x90, 60, 100 }, 0);
+        CATCH_CHECK(decoder.events() == 1);
+    }
+    CATCH_SECTION("the data bytes of system common messages are skipped")
+    {
+        feed(decoder, { 0xF2, 60, 100, 0xF1, 60, 0xF3, 60, 0xF6, 60, 100 }, 0);
+        CATCH_CHECK(decoder.events() == 0);
+    }
+    CATCH_SECTION("data bytes without a status are ignored")
+    {
+        feed(decoder, { 60, 100, 0x90, 60, 100 }, 0);
+        CATCH_CHECK(decoder.events() == 1);
+    }
+}
+
+TEST_CASE("Live note collector")
+{
+    std::vector<midi::NOTE> notes;
+    midi::LiveNoteCollector note_collector([&notes](const midi::NOTE& note) { notes.push_back(note); });
+    midi::LiveDecoder decoder(note_collector);
+
+    CATCH_SECTION("a note ends when its key is released")
+    {
+        feed(decoder, { 0x90, 60, 100 }, 1000);
+        CATCH_CHECK(notes.empty());
+        CATCH_REQUIRE(note_collector.sounding_notes().size() == 1);
+        CATCH_CHECK(note_collector.sounding_notes()[0] == note(60, 1000, 0, 100));
+
+        feed(decoder, { 0x80, 60, 0 }, 3000);
+        CATCH_REQUIRE(notes.size() == 1);
+        CATCH_CHECK(notes[0] == note(60, 1000, 2000, 100));
+        CATCH_CHECK(note_collector.sounding_notes().empty());
+        CATCH_CHECK(value(note_collector.time()) == 3000);
+    }
+    CATCH_SECTION("a note on with velocity 0 is a release")
+    {
+        feed(decoder, { 0x90, 60, 100 }, 1000);
+        feed(decoder, { 60, 0 }, 1500);
+        CATCH_REQUIRE(notes.size() == 1);
+        CATCH_CHECK(notes[0] == note(60, 1000, 500, 100));
+    }
+    CATCH_SECTION("a key struck again ends its note")
+    {
+        feed(decoder, { 0x90, 60, 100 }, 0);
+        feed(decoder, { 0x90, 60, 50 }, 200);
+        CATCH_REQUIRE(notes.size() == 1);
+        CATCH_CHECK(notes[0] == note(60, 0, 200, 100));
+        CATCH_REQUIRE(note_collector.sounding_notes().size() == 1);
+        CATCH_CHECK(note_collector.sounding_notes()[0] == note(60, 200, 0, 50));
+    }
+    CATCH_SECTION("channels and their instruments are kept apart")
+    {
+        feed(decoder, { 0xC1, 40, 0x90, 60, 100, 0x91, 60, 90 }, 0);
+        feed(decoder, { 0x81, 60, 0 }, 100);
+        feed(decoder, { 0x80, 60, 0 }, 300);
+
+        CATCH_REQUIRE(notes.size() == 2);
+        CATCH_CHECK(notes[0] == note(60, 0, 100, 90, 40));
+        CATCH_CHECK(notes[1] == note(60, 0, 300, 100, 0));
+    }
+    CATCH_SECTION("releasing a key that is not held does nothing")
+    {
+        feed(decoder, { 0x80, 60, 0 }, 100);
+        CATCH_CHECK(notes.empty());
+        CATCH_CHECK(note_collector.sounding_notes().empty());
+    }
+}
+
+#endif
@@ -0,0 +1,159 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "midi/automation.h"
+#include "midi/parse.h"
+#include "midi/synthetic.h"
+#include "tests/tests-util.h"
+#include <sstream>
+
+using namespace testutils;
+
+TEST_CASE("Automation lane, a step series")
+{
+    midi::AutomationLane lane(64);
+    lane.add(midi::Time(10), 64);
+    lane.add(midi::Time(20), 100);
+    lane.add(midi::Time(30), 100);
+    lane.add(midi::Time(40), 0);
+    lane.add(midi::Time(40), 127);
+    lane.compress();
+
+    //the repeats and the point that was overwritten at the same time are gone
+    CATCH_REQUIRE(lane.size() == 2);
+    CATCH_CHECK(lane[0].time == midi::Time(20));
+    CATCH_CHECK(lane[0].value == 100);
+    CATCH_CHECK(lane[1].time == midi::Time(40));
+    CATCH_CHECK(lane[1].value == 127);
+
+    CATCH_CHECK(lane.value_at(midi::Time(0)) == 64);
+    CATCH_CHECK(lane.value_at(midi::Time(19)) == 64);
+    CATCH_CHECK(lane.value_at(midi::Time(20)) == 100);
+    CATCH_CHECK(lane.value_at(midi::Time(39)) == 100);
+    CATCH_CHECK(lane.value_at(midi::Time(40)) == 127);
+    CATCH_CHECK(lane.value_at(midi::Time(1000)) == 127);
+}
+
+TEST_CASE("Automation lane, points of several tracks")
+{
+    //the second track starts again at 0 and changes the value between two points of the first track that repeat
+    midi::AutomationLane lane(0);
+    lane.add(midi::Time(0), 5);
+    lane.add(midi::Time(100), 5);
+    lane.add(midi::Time(50), 9);
+    lane.compress();
+
+    CATCH_CHECK(lane.value_at(midi::Time(49)) == 5);
+    CATCH_CHECK(lane.value_at(midi::Time(50)) == 9);
+    CATCH_CHECK(lane.value_at(midi::Time(100)) == 5);
+    CATCH_CHECK(lane.size() == 3);
+}
+
+TEST_CASE("Automation cursor, the values of value_at")
+{
+    midi::AutomationLane lane(0x2000);
+    for(uint64_t t = 0; t < 1000; t += 7) lane.add(midi::Time(t), static_cast<uint16_t>((t * 37) % 0x4000));
+    lane.compress();
+
+    midi::AutomationCursor cursor(lane);
+    bool same = true;
+    for(uint64_t t = 0; t < 1100; t += 3) same = same && cursor.value_at(midi::Time(t)) == lane.value_at(midi::Time(t));
+    CATCH_CHECK(same);
+
+    //going back in time
+    CATCH_CHECK(cursor.value_at(midi::Time(8)) == lane.value_at(midi::Time(8)));
+    CATCH_CHECK(cursor.value_at(midi::Time(14)) == lane.value_at(midi::Time(14)));
+
+    midi::AutomationLane empty_lane(0x2000);
+    empty_lane.compress();
+    midi::AutomationCursor empty_cursor(empty_lane);
+    CATCH_CHECK(empty_cursor.value_at(midi::Time(50)) == 0x2000);
+}
+
+TEST_CASE("Automation, collected by parse_notes")
+{
+    midi::TrackWriter first_track;
+    first_track.control_change(midi::Duration(0), midi::Channel(0), 64, 127);
+    first_track.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+    first_track.pitch_wheel_change(midi::Duration(10), midi::Channel(0), 0x3000);
+    first_track.polyphonic_key_pressure(midi::Duration(5), midi::Channel(0), midi::NoteNumber(60), 40);
+    first_track.note_off(midi::Duration(5), midi::Channel(0), midi::NoteNumber(60), 0);
+    first_track.control_change(midi::Duration(0), midi::Channel(0), 64, 0);
+    first_track.end_of_track(midi::Duration(0));
+
+    midi::TrackWriter second_track;
+    second_track.channel_pressure(midi::Duration(8), midi::Channel(3), 90);
+    second_track.control_change(midi::Duration(2), midi::Channel(3), 11, 70);
+    second_track.end_of_track(midi::Duration(0));
+
+    const auto data = midi_file(1, { first_track, second_track });
+
+    std::vector<midi::NOTE> notes;
+    midi::Automation automation;
+    CATCH_REQUIRE(parse_notes(data, &notes, &automation).ok());
+    CATCH_CHECK(notes.size() == 1);
+    CATCH_CHECK(automation.all().size() == 5);
+
+    const auto* sustain = automation.lane(midi::controller_lane(midi::Channel(0), 64));
+    CATCH_REQUIRE(sustain != nullptr);
+    CATCH_CHECK(sustain->value_at(midi::Time(0)) == 127);
+    CATCH_CHECK(sustain->value_at(midi::Time(19)) == 127);
+    CATCH_CHECK(sustain->value_at(midi::Time(20)) == 0);
+
+    const auto* pitch_wheel = automation.lane(midi::pitch_wheel_lane(midi::Channel(0)));
+    CATCH_REQUIRE(pitch_wheel != nullptr);
+    CATCH_CHECK(pitch_wheel->value_at(midi::Time(9)) == 0x2000);
+    CATCH_CHECK(pitch_wheel->value_at(midi::Time(10)) == 0x3000);
+
+    const auto* key_pressure = automation.lane(midi::key_pressure_lane(midi::Channel(0), midi::NoteNumber(60)));
+    CATCH_REQUIRE(key_pressure != nullptr);
+    CATCH_CHECK(key_pressure->value_at(midi::Time(15)) == 40);
+
+    //the second track starts at time 0 again
+    const auto* channel_pressure = automation.lane(midi::channel_pressure_lane(midi::Channel(3)));
+    CATCH_REQUIRE(channel_pressure != nullptr);
+    CATCH_CHECK(channel_pressure->value_at(midi::Time(8)) == 90);
+
+    const auto* expression = automation.lane(midi::controller_lane(midi::Channel(3), 11));
+    CATCH_REQUIRE(expression != nullptr);
+    CATCH_CHECK(expression->value_at(midi::Time(10)) == 70);
+
+    CATCH_CHECK(automation.lane(midi::controller_lane(midi::Channel(1), 64)) == nullptr);
+}
+
+TEST_CASE("Automation, the notes stay the same")
+{
+    midi::SYNTHETIC_SETTINGS settings;
+    settings.seed = 5;
+    settings.tracks = 4;
+    settings.events = 5000;
+
+    std::stringstream ss;
+    midi::write_synthetic_midi(ss, settings);
+    const auto data = ss.str();
+
+    std::vector<midi::NOTE> expected;
+    CATCH_REQUIRE(parse_notes(data, &expected, nullptr).ok());
+
+    std::vector<midi::NOTE> notes;
+    midi::Automation automation;
+    CATCH_REQUIRE(parse_notes(data, &notes, &automation).ok());
+    CATCH_CHECK(notes == expected);
+    CATCH_CHECK(!automation.all().empty());
+
+    //every lane is compressed: sorted by time and without repeats
+    bool compressed = true;
+    for(const auto& lane : automation.all())
+    {
+        auto before = lane.second.initial_value();
+        for(size_t i = 0; i != lane.second.size(); ++i)
+        {
+            compressed = compressed && lane.second[i].value != before && (i == 0 || lane.second[i - 1].time < lane.second[i].time);
+            before = lane.second[i].value;
+        }
+    }
+    CATCH_CHECK(compressed);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/frame.h"
+#include "util/tiled-grid.h"
+#include "Catch.h"
+#include <filesystem>
+
+
+TEST_CASE("Copying a frame, packed pixels are copied as they are")
+{
+    ConcreteGrid<uint32_t> pixels(6, 3, [](const Position& p) { return 0xFF000000U | (p.x << 8U) | p.y; });
+
+    const auto frame = imaging::copy_frame(pixels, Position(2, 1), 3, 2);
+    CATCH_REQUIRE(frame.width == 3);
+    CATCH_REQUIRE(frame.height == 2);
+    for(unsigned y = 0; y != 2; ++y)
+    {
+        for(unsigned x = 0; x != 3; ++x) CATCH_CHECK(frame[Position(x, y)] == pixels[Position(x + 2, y + 1)]);
+    }
+}
+
+TEST_CASE("Copying a frame, pixels never written to a tiled grid become opaque black")
+{
+    TiledGrid<uint32_t> pixels(100, 100, std::filesystem::temp_directory_path().string());
+    pixels[Position(70, 10)] = 0xFF123456U;
+
+    const auto frame = imaging::copy_frame(pixels, Position(60, 0), 20, 20);
+    CATCH_CHECK(frame[Position(10, 10)] == 0xFF123456U);
+    CATCH_CHECK(frame[Position(0, 0)] == 0xFF000000U);
+    CATCH_CHECK(frame[Position(19, 19)] == 0xFF000000U);
+}
+
+TEST_CASE("Packing colours")
+{
+    CATCH_CHECK(imaging::to_argb(imaging::colors::black()) == 0xFF000000U);
+    CATCH_CHECK(imaging::to_argb(imaging::colors::white()) == 0xFFFFFFFFU);
+    CATCH_CHECK(imaging::to_argb(imaging::colors::red()) == 0xFFFF0000U);
+    CATCH_CHECK(imaging::to_argb(imaging::Color(0, 0.5, 1)) == 0xFF007FFFU);
+}
+
+#endif
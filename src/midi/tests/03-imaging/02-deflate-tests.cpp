@@ -0,0 +1,395 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/deflate.h"
+#include "imaging/png-format.h"
+#include "imaging/frame.h"
+#include "Catch.h"
+#include <set>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t CODE_LENGTH_ORDER[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    //canonical huffman code, decoded one bit at a time
+    struct HUFFMAN
+    {
+        std::vector<int> counts;    //of every code length
+        std::vector<int> symbols;   //ordered by code
+
+        explicit HUFFMAN(const std::vector<uint8_t>& lengths)
+            : counts(16, 0)
+        {
+            for(auto length : lengths) ++counts[length];
+            counts[0] = 0;
+
+            std::vector<int> offsets(16, 0);
+            for(unsigned length = 1; length != 15; ++length) offsets[length + 1] = offsets[length] + counts[length];
+
+            symbols.resize(lengths.size());
+            for(size_t symbol = 0; symbol != lengths.size(); ++symbol)
+            {
+                if(lengths[symbol] != 0) symbols[offsets[lengths[symbol]]++] = int(symbol);
+            }
+        }
+    };
+
+    //fails the test through an exception, checking every bit read with CATCH_REQUIRE would count millions of assertions
+    void require(bool condition, const char* message)
+    {
+        if(!condition) throw std::runtime_error(message);
+    }
+
+    //a plain RFC 1951 decoder to check the encoder against, it remembers what the stream was made of
+    class Inflater
+    {
+        const uint8_t* data;
+        size_t size;
+        size_t position;
+        uint32_t bit_buffer;
+        unsigned bit_count;
+
+    public:
+        std::vector<uint8_t> out;
+        std::set<unsigned> block_types;
+        unsigned longest_match;
+        unsigned farthest_distance;
+
+        Inflater(const uint8_t* data, size_t size)
+            : data(data), size(size), position(0), bit_buffer(0), bit_count(0), longest_match(0), farthest_distance(0) {}
+
+        void inflate()
+        {
+            bool last = false;
+            while(!last)
+            {
+                last = bits(1) == 1;
+                const auto type = bits(2);
+                block_types.insert(type);
+
+                if(type == 0) stored();
+                else if(type == 1) fixed();
+                else if(type == 2) dynamic();
+                else require(false, "reserved block type");
+            }
+        }
+
+        size_t consumed() const { return position; }
+
+    private:
+        unsigned bits(unsigned count)
+        {
+            while(bit_count < count)
+            {
+                require(position < size, "the stream ends early");
+                bit_buffer |= uint32_t(data[position++]) << bit_count;
+                bit_count += 8;
+            }
+
+            const auto result = bit_buffer & ((1U << count) - 1);
+            bit_buffer >>= count;
+            bit_count -= count;
+            return result;
+        }
+
+        int decode(const HUFFMAN& huffman)
+        {
+            int code = 0, first = 0, index = 0;
+            for(unsigned length = 1; length != 16; ++length)
+            {
+                code |= int(bits(1));
+                const auto count = huffman.counts[length];
+                if(code - count < first) return huffman.symbols[index + (code - first)];
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+
+            require(false, "invalid huffman code");
+            return -1;
+        }
+
+        void stored()
+        {
+            bit_buffer = 0;
+            bit_count = 0;
+            require(position + 4 <= size, "the stream ends early");
+            const unsigned length = data[position] | data[position + 1] << 8;
+            const unsigned complement = data[position + 2] | data[position + 3] << 8;
+            require(length == (~complement & 0xFFFF), "stored length does not match its complement");
+            position += 4;
+
+            require(position + length <= size, "the stream ends early");
+            out.insert(out.end(), data + position, data + position + length);
+            position += length;
+        }
+
+        void fixed()
+        {
+            std::vector<uint8_t> litlen(288, 8);
+            std::fill(litlen.begin() + 144, litlen.begin() + 256, 9);
+            std::fill(litlen.begin() + 256, litlen.begin() + 280, 7);
+            codes(HUFFMAN(litlen), HUFFMAN(std::vector<uint8_t>(30, 5)));
+        }
+
+        void dynamic()
+        {
+            const auto litlen_count = bits(5) + 257;
+            const auto distance_count = bits(5) + 1;
+            const auto code_length_count = bits(4) + 4;
+
+            std::vector<uint8_t> code_lengths(19, 0);
+            for(unsigned i = 0; i != code_length_count; ++i) code_lengths[CODE_LENGTH_ORDER[i]] = uint8_t(bits(3));
+            const HUFFMAN code_length_code(code_lengths);
+
+            std::vector<uint8_t> lengths;
+            while(lengths.size() < litlen_count + distance_count)
+            {
+                const auto symbol = decode(code_length_code);
+                if(symbol < 16) lengths.push_back(uint8_t(symbol));
+                else if(symbol == 16)
+                {
+                    require(!lengths.empty(), "nothing to repeat");
+                    lengths.insert(lengths.end(), 3 + bits(2), lengths.back());
+                }
+                else if(symbol == 17) lengths.insert(lengths.end(), 3 + bits(3), 0);
+                else lengths.insert(lengths.end(), 11 + bits(7), 0);
+            }
+            require(lengths.size() == litlen_count + distance_count, "code lengths run past the codes");
+            require(lengths[256] != 0, "no end of block code");
+
+            codes(HUFFMAN(std::vector<uint8_t>(lengths.begin(), lengths.begin() + litlen_count)),
+                  HUFFMAN(std::vector<uint8_t>(lengths.begin() + litlen_count, lengths.end())));
+        }
+
+        void codes(const HUFFMAN& litlen, const HUFFMAN& distance)
+        {
+            for(auto symbol = decode(litlen); symbol != 256; symbol = decode(litlen))
+            {
+                if(symbol < 256)
+                {
+                    out.push_back(uint8_t(symbol));
+                    continue;
+                }
+
+                require(symbol - 257 < 29, "invalid length code");
+                const auto length = LENGTH_BASE[symbol - 257] + bits(LENGTH_EXTRA[symbol - 257]);
+                const auto distance_symbol = decode(distance);
+                require(distance_symbol < 30, "invalid distance code");
+                const auto back = DISTANCE_BASE[distance_symbol] + bits(DISTANCE_EXTRA[distance_symbol]);
+                require(back <= out.size() && back <= 32768, "distance too far back");
+
+                //byte by byte, a match may overlap the bytes it produces
+                for(unsigned i = 0; i != length; ++i) out.push_back(out[out.size() - back]);
+                longest_match = std::max(longest_match, length);
+                farthest_distance = std::max(farthest_distance, back);
+            }
+        }
+    };
+
+    //checks the zlib wrapper and inflates what it wraps
+    Inflater inflate_zlib(const std::vector<uint8_t>& stream)
+    {
+        CATCH_REQUIRE(stream.size() >= 6);
+        CATCH_CHECK((stream[0] & 0x0F) == 8);
+        CATCH_CHECK((stream[0] << 8 | stream[1]) % 31 == 0);
+
+        Inflater inflater(stream.data() + 2, stream.size() - 6);
+        inflater.inflate();
+        CATCH_CHECK(inflater.consumed() == stream.size() - 6);
+
+        const auto* trailer = stream.data() + stream.size() - 4;
+        const uint32_t adler = uint32_t(trailer[0]) << 24 | uint32_t(trailer[1]) << 16 | uint32_t(trailer[2]) << 8 | trailer[3];
+        CATCH_CHECK(adler == imaging::adler32(inflater.out.data(), inflater.out.size()));
+
+        return inflater;
+    }
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data, int level)
+    {
+        return imaging::zlib_compress(data.data(), data.size(), level);
+    }
+
+    std::vector<uint8_t> random_bytes(size_t size, uint32_t seed)
+    {
+        std::vector<uint8_t> bytes(size);
+        for(auto& byte : bytes)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            byte = uint8_t(seed >> 24);
+        }
+
+        return bytes;
+    }
+
+    const uint8_t* bytes(const std::string& text)
+    {
+        return reinterpret_cast<const uint8_t*>(text.data());
+    }
+
+    uint32_t read_u32(const uint8_t* data)
+    {
+        return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+    }
+}
+
+TEST_CASE("CRC-32 of known vectors")
+{
+    const std::string check = "123456789";
+    const std::string fox = "The quick brown fox jumps over the lazy dog";
+    const std::vector<uint8_t> ones(100000, 0xFF);
+
+    CATCH_CHECK(imaging::crc32(nullptr, 0) == 0);
+    CATCH_CHECK(imaging::crc32(bytes(check), check.size()) == 0xCBF43926U);
+    CATCH_CHECK(imaging::crc32(bytes(fox), fox.size()) == 0x414FA339U);
+    CATCH_CHECK(imaging::crc32(ones.data(), ones.size()) == 0x68C6CEC4U);
+
+    //continued over pieces
+    CATCH_CHECK(imaging::crc32(bytes(fox) + 10, fox.size() - 10, imaging::crc32(bytes(fox), 10)) == 0x414FA339U);
+}
+
+TEST_CASE("Adler-32 of known vectors")
+{
+    const std::string wikipedia = "Wikipedia";
+    const std::string check = "123456789";
+    const std::vector<uint8_t> ones(100000, 0xFF);
+
+    CATCH_CHECK(imaging::adler32(nullptr, 0) == 1);
+    CATCH_CHECK(imaging::adler32(bytes(wikipedia), wikipedia.size()) == 0x11E60398U);
+    CATCH_CHECK(imaging::adler32(bytes(check), check.size()) == 0x091E01DEU);
+    //long enough for the sums to be reduced several times along the way
+    CATCH_CHECK(imaging::adler32(ones.data(), ones.size()) == 0x149A302CU);
+    CATCH_CHECK(imaging::adler32(ones.data() + 7000, ones.size() - 7000, imaging::adler32(ones.data(), 7000)) == 0x149A302CU);
+}
+
+TEST_CASE("Deflate, level 0 stores the data")
+{
+    //more than the 65535 bytes a stored block holds
+    const auto data = random_bytes(150000, 1);
+
+    const auto inflater = inflate_zlib(compress(data, 0));
+    CATCH_CHECK(inflater.out == data);
+    CATCH_CHECK(inflater.block_types == std::set<unsigned>{ 0 });
+
+    const auto empty = inflate_zlib(compress({}, 0));
+    CATCH_CHECK(empty.out.empty());
+}
+
+TEST_CASE("Deflate, round trips")
+{
+    std::string text;
+    for(unsigned i = 0; i != 2000; ++i) text += "note " + std::to_string(i % 97) + " on channel " + std::to_string(i % 16) + "\n";
+
+    std::vector<std::vector<uint8_t>> inputs = {
+        {},
+        { 42 },
+        std::vector<uint8_t>(bytes(text), bytes(text) + text.size()),
+        random_bytes(100000, 2),
+        std::vector<uint8_t>(300000, 7),
+    };
+
+    //compressible and incompressible stretches in one stream, over more than one block of symbols
+    auto mixed = random_bytes(40000, 3);
+    for(unsigned i = 0; i != 200000; ++i) mixed.push_back(uint8_t(i % 251 < 50 ? i % 7 : mixed[i]));
+    inputs.push_back(mixed);
+
+    for(int level : { 1, 6, 9 })
+    {
+        for(const auto& input : inputs)
+        {
+            const auto compressed = compress(input, level);
+            const auto inflater = inflate_zlib(compressed);
+            CATCH_CHECK(inflater.out == input);
+        }
+    }
+}
+
+TEST_CASE("Deflate, the longest match and the farthest distance")
+{
+    //the first 300 bytes come back exactly one window later, anything closer is random
+    auto data = random_bytes(32768, 4);
+    const std::vector<uint8_t> repeated(data.begin(), data.begin() + 300);
+    data.insert(data.end(), repeated.begin(), repeated.end());
+    //a run of one byte is made of matches of the longest length
+    data.insert(data.end(), 2000, 0x55);
+
+    for(int level : { 1, 6, 9 })
+    {
+        const auto inflater = inflate_zlib(compress(data, level));
+        CATCH_CHECK(inflater.out == data);
+        CATCH_CHECK(inflater.farthest_distance == 32768);
+        CATCH_CHECK(inflater.longest_match == 258);
+        CATCH_CHECK(inflater.block_types.count(0) == 0);
+    }
+}
+
+TEST_CASE("PNG, every chunk has a valid CRC and the pixels come back")
+{
+    imaging::Frame frame(37, 23);
+    for(unsigned y = 0; y != frame.height; ++y)
+    {
+        for(unsigned x = 0; x != frame.width; ++x) frame[Position(x, y)] = 0xFF000000U | (x * 7 << 16) | (y * 11 << 8) | ((x * y) & 0xFF);
+    }
+
+    for(int level : { 0, 1, 6, 9 })
+    {
+        const auto png = imaging::encode_png(frame, level);
+        const std::vector<uint8_t> signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        CATCH_REQUIRE(std::vector<uint8_t>(png.begin(), png.begin() + 8) == signature);
+
+        std::vector<std::string> types;
+        std::vector<uint8_t> idat;
+        for(size_t offset = 8; offset < png.size();)
+        {
+            const auto length = read_u32(png.data() + offset);
+            CATCH_REQUIRE(offset + 12 + length <= png.size());
+            const auto type = std::string(reinterpret_cast<const char*>(png.data()) + offset + 4, 4);
+            CATCH_CHECK(imaging::crc32(png.data() + offset + 4, 4 + length) == read_u32(png.data() + offset + 8 + length));
+            if(type == "IDAT") idat.insert(idat.end(), png.data() + offset + 8, png.data() + offset + 8 + length);
+
+            types.push_back(type);
+            offset += 12 + length;
+        }
+        CATCH_CHECK(types == std::vector<std::string>{ "IHDR", "IDAT", "IEND" });
+
+        //undo the filters of every scanline
+        const auto scanlines = inflate_zlib(idat).out;
+        const size_t row_size = frame.width * 3;
+        CATCH_REQUIRE(scanlines.size() == (row_size + 1) * frame.height);
+
+        std::vector<uint8_t> previous(row_size, 0), row(row_size);
+        bool same = true;
+        for(unsigned y = 0; y != frame.height; ++y)
+        {
+            const auto* line = scanlines.data() + y * (row_size + 1);
+            CATCH_REQUIRE(line[0] < 5);
+            for(size_t i = 0; i != row_size; ++i)
+            {
+                const int left = i >= 3 ? row[i - 3] : 0;
+                const int up = previous[i];
+                const int up_left = i >= 3 ? previous[i - 3] : 0;
+                const int p = left + up - up_left;
+                const int paeth = std::abs(p - left) <= std::abs(p - up) && std::abs(p - left) <= std::abs(p - up_left) ? left : std::abs(p - up) <= std::abs(p - up_left) ? up : up_left;
+                const int predictions[] = { 0, left, up, (left + up) / 2, paeth };
+                row[i] = uint8_t(line[1 + i] + predictions[line[0]]);
+            }
+
+            for(unsigned x = 0; x != frame.width; ++x)
+            {
+                same = same && (0xFF000000U | uint32_t(row[x * 3]) << 16 | uint32_t(row[x * 3 + 1]) << 8 | row[x * 3 + 2]) == frame[Position(x, y)];
+            }
+            std::swap(row, previous);
+        }
+        CATCH_CHECK(same);
+    }
+}
+
+#endif
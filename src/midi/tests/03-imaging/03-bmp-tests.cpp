@@ -0,0 +1,189 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/bmp-format.h"
+#include "Catch.h"
+#include <stdexcept>
+
+
+namespace
+{
+    const uint32_t BI_RGB = 0;
+    const uint32_t BI_RLE8 = 1;
+
+    uint32_t read_u32(const std::vector<uint8_t>& data, size_t offset)
+    {
+        return uint32_t(data[offset]) | uint32_t(data[offset + 1]) << 8 | uint32_t(data[offset + 2]) << 16 | uint32_t(data[offset + 3]) << 24;
+    }
+
+    uint16_t read_u16(const std::vector<uint8_t>& data, size_t offset)
+    {
+        return uint16_t(data[offset] | data[offset + 1] << 8);
+    }
+
+    void require(bool condition, const char* message)
+    {
+        if(!condition) throw std::runtime_error(message);
+    }
+
+    struct DECODED_BMP
+    {
+        uint32_t compression;
+        uint16_t bits_per_pixel;
+        uint32_t colors_used;
+        imaging::Frame frame;
+    };
+
+    //reads back the two kinds of file encode_bmp writes, pixels come back with an opaque alpha
+    DECODED_BMP decode_bmp(const std::vector<uint8_t>& data)
+    {
+        require(data.size() >= 138 && read_u16(data, 0) == 0x4D42, "not a bmp file");
+        require(read_u32(data, 2) == data.size(), "wrong file size");
+
+        const auto offset = read_u32(data, 10);
+        const auto width = read_u32(data, 18);
+        const auto height = read_u32(data, 22);
+        DECODED_BMP bmp{ read_u32(data, 30), read_u16(data, 28), read_u32(data, 46), imaging::Frame(width, height) };
+
+        if(bmp.compression == BI_RGB)
+        {
+            require(bmp.bits_per_pixel == 32 && offset + size_t(width) * height * 4 == data.size(), "wrong rgb32 size");
+            for(unsigned y = 0; y != height; ++y)
+            {
+                for(unsigned x = 0; x != width; ++x) bmp.frame[Position(x, height - 1 - y)] = read_u32(data, offset + (size_t(y) * width + x) * 4);
+            }
+
+            return bmp;
+        }
+
+        require(bmp.compression == BI_RLE8 && bmp.bits_per_pixel == 8, "neither rgb32 nor rle8");
+        require(bmp.colors_used >= 1 && bmp.colors_used <= 256 && offset == 138 + 4 * bmp.colors_used, "wrong palette size");
+        require(read_u32(data, 34) == data.size() - offset, "wrong image size");
+
+        std::vector<uint32_t> palette(bmp.colors_used);
+        for(size_t i = 0; i != palette.size(); ++i) palette[i] = 0xFF000000U | read_u32(data, 138 + 4 * i);
+
+        //rows are stored bottom up
+        unsigned x = 0, y = 0;
+        size_t position = offset;
+        auto put = [&](uint8_t index)
+        {
+            require(index < palette.size() && x < width && y < height, "pixel outside the frame or the palette");
+            bmp.frame[Position(x++, height - 1 - y)] = palette[index];
+        };
+
+        while(true)
+        {
+            require(position + 2 <= data.size(), "no end of bitmap");
+            const auto count = data[position];
+            const auto second = data[position + 1];
+            position += 2;
+
+            if(count != 0)
+            {
+                for(unsigned i = 0; i != count; ++i) put(second);
+            }
+            else if(second == 0)
+            {
+                require(x == width, "a row ends early");
+                x = 0;
+                ++y;
+            }
+            else if(second == 1)
+            {
+                require(x == width && y == height - 1, "the bitmap ends early");
+                require(position == data.size(), "bytes after the end of bitmap");
+                return bmp;
+            }
+            else
+            {
+                require(second != 2, "delta is not written");
+                require(position + second <= data.size(), "absolute run past the end");
+                for(unsigned i = 0; i != second; ++i) put(data[position + i]);
+                position += second + second % 2;
+            }
+        }
+    }
+
+    //row y repeats runs of the given lengths, alternating between colours
+    imaging::Frame runs_frame(unsigned width, unsigned height)
+    {
+        const unsigned lengths[] = { 1, 2, 3, 1, 1, 4, 254, 255, 256, 1, 2, 300, 1, 1, 1, 5 };
+        const uint32_t colors[] = { 0xFF000000U, 0xFFFF8000U, 0xFF123456U, 0xFFFFFFFFU, 0xFF00FF00U };
+
+        imaging::Frame frame(width, height);
+        for(unsigned y = 0; y != height; ++y)
+        {
+            unsigned x = 0, run = y, color = y;
+            while(x < width)
+            {
+                const auto length = lengths[run++ % 16];
+                for(unsigned i = 0; i != length && x < width; ++i) frame[Position(x++, y)] = colors[color % 5];
+                ++color;
+            }
+        }
+
+        return frame;
+    }
+
+    imaging::Frame colors_frame(unsigned color_count)
+    {
+        imaging::Frame frame(64, 8);
+        for(unsigned i = 0; i != frame.pixels.size(); ++i) frame.pixels[i] = 0xFF000000U | (i % color_count) << 8U;
+
+        return frame;
+    }
+}
+
+TEST_CASE("BMP, RGB32 round trip")
+{
+    const auto frame = runs_frame(500, 7);
+    const auto bmp = decode_bmp(imaging::encode_bmp(frame, imaging::BmpEncoding::RGB32));
+
+    CATCH_CHECK(bmp.compression == BI_RGB);
+    CATCH_CHECK(bmp.frame.pixels == frame.pixels);
+}
+
+TEST_CASE("BMP, RLE8 round trip of runs and literal stretches")
+{
+    //odd and even widths, since absolute runs are padded to an even length
+    for(unsigned width : { 1U, 2U, 3U, 4U, 257U, 1000U, 1001U })
+    {
+        const auto frame = runs_frame(width, 16);
+        const auto bmp = decode_bmp(imaging::encode_bmp(frame, imaging::BmpEncoding::RLE8));
+
+        CATCH_CHECK(bmp.compression == BI_RLE8);
+        CATCH_CHECK(bmp.colors_used <= 5);
+        CATCH_CHECK(bmp.frame.pixels == frame.pixels);
+    }
+}
+
+TEST_CASE("BMP, RLE8 of a single colour is tiny")
+{
+    const imaging::Frame frame(1280, 720);
+    const auto data = imaging::encode_bmp(frame, imaging::BmpEncoding::RLE8);
+    const auto bmp = decode_bmp(data);
+
+    CATCH_CHECK(bmp.compression == BI_RLE8);
+    CATCH_CHECK(bmp.colors_used == 1);
+    CATCH_CHECK(bmp.frame.pixels == frame.pixels);
+    CATCH_CHECK(data.size() < 20000);
+}
+
+TEST_CASE("BMP, RLE8 with 256 colours keeps the palette, above that falls back to RGB32")
+{
+    const auto fits = colors_frame(256);
+    const auto fitting_bmp = decode_bmp(imaging::encode_bmp(fits, imaging::BmpEncoding::RLE8));
+    CATCH_CHECK(fitting_bmp.compression == BI_RLE8);
+    CATCH_CHECK(fitting_bmp.colors_used == 256);
+    CATCH_CHECK(fitting_bmp.frame.pixels == fits.pixels);
+
+    const auto too_many = colors_frame(257);
+    const auto fallback_bmp = decode_bmp(imaging::encode_bmp(too_many, imaging::BmpEncoding::RLE8));
+    CATCH_CHECK(fallback_bmp.compression == BI_RGB);
+    CATCH_CHECK(fallback_bmp.bits_per_pixel == 32);
+    CATCH_CHECK(fallback_bmp.frame.pixels == too_many.pixels);
+}
+
+#endif
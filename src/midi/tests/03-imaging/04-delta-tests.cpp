@@ -0,0 +1,96 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/delta-format.h"
+#include "rendering/frame-pipeline.h"
+#include "rendering/frame-sink.h"
+#include "Catch.h"
+#include <sstream>
+
+
+namespace
+{
+    const unsigned FRAME_WIDTH = 40;
+    const unsigned FRAME_HEIGHT = 12;
+
+    //frames slide over a canvas shift columns at a time, like the renderer's frames do
+    struct SLIDING_FRAMES
+    {
+        ConcreteGrid<uint32_t> canvas;
+        unsigned shift;
+        unsigned frame_count;
+
+        SLIDING_FRAMES(unsigned shift, unsigned frame_count)
+            : canvas(FRAME_WIDTH + shift * (frame_count - 1), FRAME_HEIGHT, [](const Position& p) { return 0xFF000000U | ((p.x / 5) % 3 == 0 ? p.x * 0x10101U : (p.y % 4) * 0x400000U); }),
+              shift(shift), frame_count(frame_count) {}
+
+        imaging::Frame frame(unsigned index) const
+        {
+            return imaging::copy_frame(canvas, Position(index * shift, 0), FRAME_WIDTH, FRAME_HEIGHT);
+        }
+    };
+
+    //the container as the delta sink writes it at the end of a pipeline with several encoder threads
+    std::string delta_container(const SLIDING_FRAMES& frames, unsigned key_frame_interval)
+    {
+        std::stringstream out;
+        rendering::DeltaStreamSink sink(out, frames.shift, key_frame_interval);
+        sink.begin(FRAME_WIDTH, FRAME_HEIGHT, frames.frame_count);
+
+        rendering::FramePipeline pipeline(rendering::PIPELINE_SETTINGS(2, 3, 1, 4), sink);
+        pipeline.run(frames.frame_count, [&frames](unsigned index) { return frames.frame(index); });
+        sink.finish();
+
+        return out.str();
+    }
+}
+
+TEST_CASE("Delta container, every frame is read back in order")
+{
+    const SLIDING_FRAMES frames(3, 30);
+    std::istringstream in(delta_container(frames, 7));
+    imaging::DeltaReader reader(in);
+
+    CATCH_CHECK(reader.header().width == FRAME_WIDTH);
+    CATCH_CHECK(reader.header().height == FRAME_HEIGHT);
+    CATCH_CHECK(reader.header().frame_count == 30);
+    CATCH_CHECK(reader.header().key_frame_interval == 7);
+    CATCH_CHECK(reader.header().shift == 3);
+
+    bool same = true;
+    for(unsigned i = 0; i != frames.frame_count; ++i) same = same && reader.read_frame(i).pixels == frames.frame(i).pixels;
+    CATCH_CHECK(same);
+}
+
+TEST_CASE("Delta container, frames are read back in any order across key frames")
+{
+    const SLIDING_FRAMES frames(3, 30);
+    std::istringstream in(delta_container(frames, 7));
+    imaging::DeltaReader reader(in);
+
+    //key frames are 0, 7, 14, 21 and 28: forwards over one, backwards over several, the same frame twice, the ends
+    for(unsigned index : { 6U, 8U, 29U, 13U, 13U, 14U, 0U, 27U, 21U, 20U, 1U })
+    {
+        CATCH_CHECK(reader.read_frame(index).pixels == frames.frame(index).pixels);
+    }
+}
+
+TEST_CASE("Delta container, a shift of the whole frame width or more stores key frames only")
+{
+    const SLIDING_FRAMES frames(FRAME_WIDTH, 5);
+    const auto container = delta_container(frames, 0);
+
+    std::istringstream in(container);
+    imaging::DeltaReader reader(in);
+    for(unsigned index : { 4U, 2U, 3U, 0U })
+    {
+        CATCH_CHECK(reader.read_frame(index).pixels == frames.frame(index).pixels);
+    }
+
+    //only the first frame is a key frame without an interval when the frames overlap, the rest are far smaller
+    const SLIDING_FRAMES overlapping(1, 5);
+    CATCH_CHECK(delta_container(overlapping, 0).size() < container.size() / 2);
+}
+
+#endif
@@ -0,0 +1,386 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/gif-format.h"
+#include "rendering/frame-pipeline.h"
+#include "rendering/frame-sink.h"
+#include "Catch.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unistd.h>
+
+
+namespace
+{
+    const unsigned CLEAR_CODE = 256;
+    const unsigned END_CODE = 257;
+    const unsigned MAX_CODES = 4096;
+
+    //6 x 7 x 6 colours of the global palette are used, the rest of its entries are black
+    const unsigned PALETTE_COLORS = 252;
+
+    uint16_t read_u16(const std::vector<uint8_t>& data, size_t offset)
+    {
+        return uint16_t(data[offset] | data[offset + 1] << 8);
+    }
+
+    void require(bool condition, const char* message)
+    {
+        if(!condition) throw std::runtime_error(message);
+    }
+
+    struct GIF_IMAGE
+    {
+        unsigned delay;
+        unsigned left, top, width, height;
+        std::vector<uint8_t> indices;
+        unsigned largest_code_size;
+        unsigned clear_codes;
+    };
+
+    struct DECODED_GIF
+    {
+        unsigned width, height;
+        std::vector<uint32_t> palette;
+        std::vector<GIF_IMAGE> images;
+    };
+
+    //concatenated data sub-blocks starting at position, which is moved past the block terminator
+    std::vector<uint8_t> read_sub_blocks(const std::vector<uint8_t>& data, size_t& position)
+    {
+        std::vector<uint8_t> bytes;
+        while(true)
+        {
+            require(position < data.size(), "sub-blocks run past the end");
+            const auto size = data[position++];
+            if(size == 0) return bytes;
+
+            require(position + size <= data.size(), "sub-block runs past the end");
+            bytes.insert(bytes.end(), data.begin() + position, data.begin() + position + size);
+            position += size;
+        }
+    }
+
+    //variable length codes, least significant bit first, with the table growing and starting over as a decoder does
+    void decode_lzw(const std::vector<uint8_t>& bytes, GIF_IMAGE& image)
+    {
+        size_t bit = 0;
+        auto read_code = [&bytes, &bit](unsigned size)
+        {
+            require(bit + size <= bytes.size() * 8, "no end code");
+            unsigned code = 0;
+            for(unsigned i = 0; i != size; ++i, ++bit) code |= unsigned(bytes[bit / 8] >> (bit % 8) & 1) << i;
+            return code;
+        };
+
+        std::vector<std::vector<uint8_t>> table;
+        unsigned code_size = 9;
+        int previous = -1;
+        image.largest_code_size = 0;
+        image.clear_codes = 0;
+
+        while(true)
+        {
+            const auto code = read_code(code_size);
+            image.largest_code_size = std::max(image.largest_code_size, code_size);
+
+            if(code == CLEAR_CODE)
+            {
+                table.resize(258);
+                for(unsigned i = 0; i != 256; ++i) table[i] = { uint8_t(i) };
+                code_size = 9;
+                previous = -1;
+                ++image.clear_codes;
+                continue;
+            }
+            if(code == END_CODE) break;
+
+            require(image.clear_codes != 0, "data before the first clear code");
+            if(previous < 0)
+            {
+                require(code < 256, "a string code right after a clear code");
+                image.indices.push_back(uint8_t(code));
+                previous = int(code);
+                continue;
+            }
+
+            require(code <= table.size(), "code not in the table yet");
+            auto string = code < table.size() ? table[code] : table[previous];
+            if(code == table.size()) string.push_back(string.front());
+            image.indices.insert(image.indices.end(), string.begin(), string.end());
+
+            if(table.size() < MAX_CODES)
+            {
+                auto entry = table[previous];
+                entry.push_back(string.front());
+                table.push_back(std::move(entry));
+            }
+            if(table.size() == (1U << code_size) && code_size < 12) ++code_size;
+            previous = int(code);
+        }
+
+        require(image.indices.size() == size_t(image.width) * image.height, "wrong pixel count");
+    }
+
+    //reads back what gif_header, encode_gif_frame and gif_trailer write
+    DECODED_GIF decode_gif(const std::vector<uint8_t>& data)
+    {
+        require(data.size() >= 13 + 768 && std::string(data.begin(), data.begin() + 6) == "GIF89a", "not a gif89a file");
+        require(data[10] == 0xF7, "no global color table of 256 entries");
+
+        DECODED_GIF gif{ read_u16(data, 6), read_u16(data, 8), {}, {} };
+        for(size_t i = 0; i != 256; ++i) gif.palette.push_back(0xFF000000U | uint32_t(data[13 + 3 * i]) << 16 | uint32_t(data[14 + 3 * i]) << 8 | data[15 + 3 * i]);
+
+        size_t position = 13 + 768;
+        unsigned delay = 0;
+        while(true)
+        {
+            require(position < data.size(), "no trailer");
+            const auto introducer = data[position++];
+            if(introducer == 0x3B)
+            {
+                require(position == data.size(), "bytes after the trailer");
+                return gif;
+            }
+
+            if(introducer == 0x21)
+            {
+                require(position < data.size(), "extension without a label");
+                if(data[position++] == 0xF9)
+                {
+                    require(position + 6 <= data.size() && data[position] == 4 && data[position + 5] == 0, "wrong graphic control extension");
+                    delay = read_u16(data, position + 2);
+                    position += 6;
+                }
+                else read_sub_blocks(data, position);
+                continue;
+            }
+
+            require(introducer == 0x2C && position + 10 <= data.size(), "neither an extension nor an image");
+            GIF_IMAGE image{ delay, read_u16(data, position), read_u16(data, position + 2), read_u16(data, position + 4), read_u16(data, position + 6), {}, 0, 0 };
+            require(data[position + 8] == 0 && data[position + 9] == 8, "local color table or wrong minimum code size");
+            require(image.left + image.width <= gif.width && image.top + image.height <= gif.height, "image outside the screen");
+            position += 10;
+
+            decode_lzw(read_sub_blocks(data, position), image);
+            gif.images.push_back(std::move(image));
+        }
+    }
+
+    //draws an image over what the previous ones left on screen
+    void draw(const DECODED_GIF& gif, const GIF_IMAGE& image, imaging::Frame& screen)
+    {
+        for(unsigned y = 0; y != image.height; ++y)
+        {
+            for(unsigned x = 0; x != image.width; ++x) screen[Position(image.left + x, image.top + y)] = gif.palette[image.indices[size_t(y) * image.width + x]];
+        }
+    }
+
+    std::vector<uint8_t> single_frame_gif(const imaging::Frame& frame)
+    {
+        auto data = imaging::gif_header(frame.width, frame.height);
+        const auto image = imaging::encode_gif_frame(frame, nullptr, 7);
+        const auto trailer = imaging::gif_trailer();
+        data.insert(data.end(), image.begin(), image.end());
+        data.insert(data.end(), trailer.begin(), trailer.end());
+
+        return data;
+    }
+
+    //pixels of palette colours only, so they survive the quantization exactly
+    imaging::Frame palette_frame(unsigned width, unsigned height, uint32_t seed)
+    {
+        const auto palette = decode_gif(single_frame_gif(imaging::Frame(1, 1))).palette;
+
+        imaging::Frame frame(width, height);
+        for(auto& pixel : frame.pixels)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            pixel = palette[(seed >> 16) % PALETTE_COLORS];
+        }
+
+        return frame;
+    }
+
+    //a fresh directory that is removed again at the end of a test
+    struct TEMPORARY_DIRECTORY
+    {
+        std::filesystem::path path;
+
+        explicit TEMPORARY_DIRECTORY(const std::string& name)
+            : path(std::filesystem::temp_directory_path() / (name + "-" + std::to_string(getpid())))
+        {
+            std::filesystem::remove_all(path);
+            std::filesystem::create_directories(path);
+        }
+
+        ~TEMPORARY_DIRECTORY()
+        {
+            std::filesystem::remove_all(path);
+        }
+    };
+
+    std::vector<uint8_t> read_file(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+TEST_CASE("GIF, a frame of palette colours round trips")
+{
+    const auto frame = palette_frame(37, 11, 1);
+    const auto gif = decode_gif(single_frame_gif(frame));
+
+    CATCH_CHECK(gif.width == 37);
+    CATCH_CHECK(gif.height == 11);
+    CATCH_REQUIRE(gif.images.size() == 1);
+    CATCH_CHECK(gif.images[0].delay == 7);
+    CATCH_CHECK(gif.images[0].width == 37);
+    CATCH_CHECK(gif.images[0].height == 11);
+
+    imaging::Frame screen(37, 11);
+    draw(gif, gif.images[0], screen);
+    CATCH_CHECK(screen.pixels == frame.pixels);
+}
+
+TEST_CASE("GIF, colours are mapped to the closest palette entry")
+{
+    imaging::Frame frame(3, 1);
+    frame.pixels = { 0xFF020301U, 0xFFFEFDFFU, 0xFF33FF00U };
+    const auto gif = decode_gif(single_frame_gif(frame));
+
+    imaging::Frame screen(3, 1);
+    draw(gif, gif.images[0], screen);
+    CATCH_CHECK(screen.pixels == std::vector<uint32_t>{ 0xFF000000U, 0xFFFFFFFFU, 0xFF33FF00U });
+}
+
+TEST_CASE("GIF, LZW codes grow to 12 bits and the table starts over when it is full")
+{
+    //noise needs a new string for almost every pixel: far more than 4096 codes
+    const auto noise = palette_frame(300, 200, 2);
+    const auto noise_gif = decode_gif(single_frame_gif(noise));
+
+    imaging::Frame screen(300, 200);
+    draw(noise_gif, noise_gif.images[0], screen);
+    CATCH_CHECK(screen.pixels == noise.pixels);
+    CATCH_CHECK(noise_gif.images[0].largest_code_size == 12);
+    //the first clear code, at least one for a full table and the one written before the end code
+    CATCH_CHECK(noise_gif.images[0].clear_codes >= 3);
+
+    //a single colour only needs ever longer runs of it, the codes stay at 9 bits
+    const imaging::Frame plain(64, 64);
+    const auto plain_gif = decode_gif(single_frame_gif(plain));
+    CATCH_CHECK(plain_gif.images[0].indices == std::vector<uint8_t>(64 * 64, 0));
+    CATCH_CHECK(plain_gif.images[0].largest_code_size == 9);
+    CATCH_CHECK(plain_gif.images[0].clear_codes == 2);
+}
+
+TEST_CASE("GIF, a frame after the first only stores the rectangle that changed")
+{
+    const auto previous = palette_frame(40, 20, 3);
+    auto frame = previous;
+    for(const auto& position : { Position(5, 9), Position(20, 3), Position(12, 6) })
+    {
+        frame[position] = previous[position] == 0xFF000000U ? 0xFFFFFFFFU : 0xFF000000U;
+    }
+
+    auto data = imaging::gif_header(40, 20);
+    for(const auto& image : { imaging::encode_gif_frame(previous, nullptr, 3), imaging::encode_gif_frame(frame, &previous, 4), imaging::encode_gif_frame(frame, &frame, 5) })
+    {
+        data.insert(data.end(), image.begin(), image.end());
+    }
+    data.push_back(0x3B);
+    const auto gif = decode_gif(data);
+    CATCH_REQUIRE(gif.images.size() == 3);
+
+    const auto& changed = gif.images[1];
+    CATCH_CHECK(changed.left == 5);
+    CATCH_CHECK(changed.top == 3);
+    CATCH_CHECK(changed.width == 16);
+    CATCH_CHECK(changed.height == 7);
+    CATCH_CHECK(changed.delay == 4);
+
+    //without a change a single pixel is stored, as a frame cannot be empty
+    const auto& unchanged = gif.images[2];
+    CATCH_CHECK(unchanged.width == 1);
+    CATCH_CHECK(unchanged.height == 1);
+
+    imaging::Frame screen(40, 20);
+    draw(gif, gif.images[0], screen);
+    CATCH_CHECK(screen.pixels != frame.pixels);
+    draw(gif, changed, screen);
+    draw(gif, unchanged, screen);
+    CATCH_CHECK(screen.pixels == frame.pixels);
+}
+
+TEST_CASE("GIF, frame delays add up to the exact duration")
+{
+    unsigned total = 0;
+    for(unsigned i = 0; i != 30; ++i) total += imaging::gif_frame_delay(i, 30);
+    CATCH_CHECK(total == 100);
+    CATCH_CHECK(imaging::gif_frame_delay(0, 30) + imaging::gif_frame_delay(1, 30) + imaging::gif_frame_delay(2, 30) == 10);
+}
+
+TEST_CASE("GIF sink, a repeated frame lengthens the delay of the image before it")
+{
+    TEMPORARY_DIRECTORY directory("midi-gif-tests");
+    const auto path = (directory.path / "out.gif").string();
+
+    const auto a = palette_frame(16, 8, 4);
+    const auto b = palette_frame(16, 8, 5);
+    const std::vector<const imaging::Frame*> frames = { &a, &a, &b, &b, &b, &a };
+
+    rendering::GifFileSink sink(path, 30);
+    sink.begin(16, 8, unsigned(frames.size()));
+    rendering::FramePipeline pipeline(rendering::PIPELINE_SETTINGS(2, 2, 1, 2, 4), sink);
+    pipeline.run(unsigned(frames.size()), [&frames](unsigned index) { return *frames[index]; });
+    sink.finish();
+
+    //delays at 30 frames per second are 3, 4, 3, 3, 4 and 3 centiseconds
+    const auto gif = decode_gif(read_file(path));
+    CATCH_REQUIRE(gif.images.size() == 3);
+    CATCH_CHECK(gif.images[0].delay == 7);
+    CATCH_CHECK(gif.images[1].delay == 10);
+    CATCH_CHECK(gif.images[2].delay == 3);
+
+    imaging::Frame screen(16, 8);
+    for(unsigned i : { 0U, 1U })
+    {
+        draw(gif, gif.images[i], screen);
+        CATCH_CHECK(screen.pixels == (i == 0 ? a : b).pixels);
+    }
+}
+
+TEST_CASE("GIF sink, a repeat before any image is written is stored as an image of its own")
+{
+    TEMPORARY_DIRECTORY directory("midi-gif-tests");
+    const auto path = (directory.path / "out.gif").string();
+    const auto frame = palette_frame(8, 8, 6);
+
+    rendering::GifFileSink sink(path, 25);
+    sink.begin(8, 8, 2);
+    CATCH_CHECK_THROWS_AS(sink.write_duplicate(1, 0, {}), std::runtime_error);
+    sink.write_duplicate(1, 0, sink.encode(0, frame));
+    sink.finish();
+
+    const auto gif = decode_gif(read_file(path));
+    CATCH_REQUIRE(gif.images.size() == 1);
+    imaging::Frame screen(8, 8);
+    draw(gif, gif.images[0], screen);
+    CATCH_CHECK(screen.pixels == frame.pixels);
+}
+
+TEST_CASE("Frame files, a frame that cannot be written is reported")
+{
+    TEMPORARY_DIRECTORY directory("midi-gif-tests");
+    rendering::BmpFileSink sink((directory.path / "missing" / "").string(), "f%d", imaging::BmpEncoding::RGB32);
+
+    CATCH_CHECK_THROWS_AS(sink.write(0, std::vector<uint8_t>(100, 1)), std::runtime_error);
+    CATCH_CHECK(!std::filesystem::exists(directory.path / "missing"));
+}
+
+#endif
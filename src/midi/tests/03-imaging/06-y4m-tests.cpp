@@ -0,0 +1,121 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/y4m-format.h"
+#include "Catch.h"
+#include <algorithm>
+#include <string>
+
+
+namespace
+{
+    int red(uint32_t pixel) { return (pixel >> 16) & 0xFF; }
+    int green(uint32_t pixel) { return (pixel >> 8) & 0xFF; }
+    int blue(uint32_t pixel) { return pixel & 0xFF; }
+
+    //the BT.601 formulas one sample at a time, with the last column and row repeated for odd sizes
+    imaging::YUV420_IMAGE reference_yuv420(const imaging::Frame& frame)
+    {
+        imaging::YUV420_IMAGE image(frame.width, frame.height);
+        for(unsigned y = 0; y != frame.height; ++y)
+        {
+            for(unsigned x = 0; x != frame.width; ++x)
+            {
+                const auto pixel = frame[Position(x, y)];
+                image.y[size_t(y) * frame.width + x] = uint8_t(((66 * red(pixel) + 129 * green(pixel) + 25 * blue(pixel) + 128) >> 8) + 16);
+            }
+        }
+
+        for(unsigned cy = 0; cy != image.chroma_height(); ++cy)
+        {
+            for(unsigned cx = 0; cx != image.chroma_width(); ++cx)
+            {
+                int r = 0, g = 0, b = 0;
+                for(unsigned dy = 0; dy != 2; ++dy)
+                {
+                    for(unsigned dx = 0; dx != 2; ++dx)
+                    {
+                        const auto pixel = frame[Position(std::min(cx * 2 + dx, frame.width - 1), std::min(cy * 2 + dy, frame.height - 1))];
+                        r += red(pixel);
+                        g += green(pixel);
+                        b += blue(pixel);
+                    }
+                }
+
+                const auto index = size_t(cy) * image.chroma_width() + cx;
+                image.u[index] = uint8_t(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+                image.v[index] = uint8_t(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+            }
+        }
+
+        return image;
+    }
+
+    //random colours with the extremes of every channel mixed in, alpha varies too and has to be ignored
+    imaging::Frame noise_frame(unsigned width, unsigned height, uint32_t seed)
+    {
+        imaging::Frame frame(width, height);
+        for(auto& pixel : frame.pixels)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            switch((seed >> 28) % 4)
+            {
+                case 0: pixel = 0xFFFFFFFFU; break;
+                case 1: pixel = 0x00000000U; break;
+                default: pixel = seed ^ (seed << 7); break;
+            }
+        }
+
+        return frame;
+    }
+
+    bool same_image(const imaging::YUV420_IMAGE& image, const imaging::YUV420_IMAGE& expected)
+    {
+        return image.width == expected.width && image.height == expected.height && image.y == expected.y && image.u == expected.u && image.v == expected.v;
+    }
+}
+
+TEST_CASE("Y4M, the converted planes match the formulas byte for byte")
+{
+    //widths below, at and between multiples of 4 and 8 go through the vector and the scalar loops, odd sizes repeat the edge pixels
+    bool same = true;
+    for(unsigned width = 1; width != 27; ++width)
+    {
+        for(unsigned height : { 1U, 2U, 3U, 4U, 7U })
+        {
+            const auto frame = noise_frame(width, height, width * 31 + height);
+            same = same && same_image(imaging::convert_to_yuv420(frame), reference_yuv420(frame));
+        }
+    }
+    CATCH_CHECK(same);
+}
+
+TEST_CASE("Y4M, every band thread count converts the same")
+{
+    const auto frame = noise_frame(101, 37, 7);
+    const auto expected = reference_yuv420(frame);
+
+    //more threads than chroma rows are capped
+    for(unsigned threads : { 1U, 2U, 3U, 5U, 19U, 64U })
+    {
+        CATCH_CHECK(same_image(imaging::convert_to_yuv420(frame, threads), expected));
+    }
+}
+
+TEST_CASE("Y4M, header and frame size")
+{
+    CATCH_CHECK(imaging::y4m_header(1280, 720, 30) == "YUV4MPEG2 W1280 H720 F30:1 Ip A1:1 C420jpeg\n");
+
+    //5 x 3 pixels: 15 luma samples and 3 x 2 samples in each chroma plane
+    const auto frame = noise_frame(5, 3, 1);
+    const auto data = imaging::encode_y4m_frame(frame, 2);
+    const auto image = reference_yuv420(frame);
+    CATCH_REQUIRE(data.size() == 6 + 15 + 2 * 6);
+    CATCH_CHECK(std::string(data.begin(), data.begin() + 6) == "FRAME\n");
+    CATCH_CHECK(std::vector<uint8_t>(data.begin() + 6, data.begin() + 21) == image.y);
+    CATCH_CHECK(std::vector<uint8_t>(data.begin() + 21, data.begin() + 27) == image.u);
+    CATCH_CHECK(std::vector<uint8_t>(data.begin() + 27, data.end()) == image.v);
+}
+
+#endif
@@ -0,0 +1,406 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "imaging/avi-format.h"
+#include "imaging/jpeg-format.h"
+#include "rendering/frame-sink.h"
+#include "Catch.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    const size_t MOVI_START = 220;
+
+    void require(bool condition, const char* message)
+    {
+        if(!condition) throw std::runtime_error(message);
+    }
+
+    uint32_t read_u32(const std::string& data, size_t offset)
+    {
+        uint32_t value = 0;
+        for(unsigned i = 0; i != 4; ++i) value |= uint32_t(uint8_t(data[offset + i])) << (8 * i);
+        return value;
+    }
+
+    uint16_t read_u16_big_endian(const std::vector<uint8_t>& data, size_t offset)
+    {
+        return uint16_t(data[offset] << 8 | data[offset + 1]);
+    }
+
+    std::vector<uint8_t> some_bytes(size_t size, uint8_t first)
+    {
+        std::vector<uint8_t> bytes(size);
+        for(size_t i = 0; i != size; ++i) bytes[i] = uint8_t(first + i);
+
+        return bytes;
+    }
+
+    struct HUFFMAN_TABLE
+    {
+        uint8_t bits[16];
+        std::vector<uint8_t> values;
+    };
+
+    //the segments of a baseline JPEG file as a decoder reads them, with the entropy coded data of the scan
+    struct JPEG_FILE
+    {
+        std::vector<uint8_t> markers;
+        unsigned width = 0, height = 0;
+        std::array<std::array<uint8_t, 64>, 2> quantization{};
+        std::array<HUFFMAN_TABLE, 2> dc{}, ac{};
+        std::vector<uint8_t> scan;
+    };
+
+    JPEG_FILE parse_jpeg(const std::vector<uint8_t>& data)
+    {
+        JPEG_FILE file;
+        require(data.size() >= 4 && data[0] == 0xFF && data[1] == 0xD8, "no SOI");
+        file.markers.push_back(0xD8);
+
+        size_t position = 2;
+        while(true)
+        {
+            require(position + 4 <= data.size() && data[position] == 0xFF, "no marker");
+            const auto marker = data[position + 1];
+            const auto length = read_u16_big_endian(data, position + 2);
+            const auto start = position + 4;
+            const auto end = position + 2 + length;
+            require(length >= 2 && end <= data.size(), "segment runs past the end");
+            file.markers.push_back(marker);
+
+            if(marker == 0xDB)
+            {
+                for(auto table = start; table < end; table += 65)
+                {
+                    require(data[table] < 2, "unexpected quantization table");
+                    std::copy(data.begin() + table + 1, data.begin() + table + 65, file.quantization[data[table]].begin());
+                }
+            }
+            else if(marker == 0xC0)
+            {
+                require(data[start] == 8 && data[start + 5] == 3, "not 8 bit YCbCr");
+                file.height = read_u16_big_endian(data, start + 1);
+                file.width = read_u16_big_endian(data, start + 3);
+            }
+            else if(marker == 0xC4)
+            {
+                for(auto table = start; table < end;)
+                {
+                    auto& huffman = (data[table] >> 4 == 0 ? file.dc : file.ac)[data[table] & 0x0F];
+                    size_t count = 0;
+                    for(unsigned i = 0; i != 16; ++i)
+                    {
+                        huffman.bits[i] = data[table + 1 + i];
+                        count += huffman.bits[i];
+                    }
+                    huffman.values.assign(data.begin() + table + 17, data.begin() + table + 17 + count);
+                    table += 17 + count;
+                }
+            }
+
+            position = end;
+            if(marker == 0xDA) break;
+        }
+
+        //the scan ends at the first marker which is not a stuffed zero, that has to be EOI at the very end
+        auto end = position;
+        while(end + 1 < data.size() && !(data[end] == 0xFF && data[end + 1] != 0x00)) ++end;
+        require(end + 2 == data.size() && data[end + 1] == 0xD9, "no EOI after the scan");
+        file.markers.push_back(0xD9);
+        file.scan.assign(data.begin() + position, data.begin() + end);
+
+        return file;
+    }
+
+    //reads the scan most significant bit first, dropping the zero stuffed after every 0xFF
+    class BitReader
+    {
+    private:
+        const std::vector<uint8_t>& data;
+        size_t position = 0;
+        unsigned bit = 8;
+
+    public:
+        unsigned stuffed_bytes = 0;
+
+        explicit BitReader(const std::vector<uint8_t>& data) : data(data) {}
+
+        unsigned read()
+        {
+            if(bit == 8)
+            {
+                require(position < data.size(), "the scan ends early");
+                if(position != 0 && data[position - 1] == 0xFF)
+                {
+                    require(data[position] == 0x00, "0xFF without a stuffed zero");
+                    ++stuffed_bytes;
+                    ++position;
+                    require(position < data.size(), "the scan ends early");
+                }
+                ++position;
+                bit = 0;
+            }
+
+            return data[position - 1] >> (7 - bit++) & 1;
+        }
+
+        int receive(unsigned length)
+        {
+            int value = 0;
+            for(unsigned i = 0; i != length; ++i) value = value << 1 | int(read());
+
+            //values with a leading 0 are negative
+            return length != 0 && value < 1 << (length - 1) ? value - (1 << length) + 1 : value;
+        }
+
+        uint8_t decode(const HUFFMAN_TABLE& table)
+        {
+            int code = 0, first = 0;
+            size_t index = 0;
+            for(unsigned length = 0; length != 16; ++length)
+            {
+                code |= int(read());
+                if(code - first < table.bits[length]) return table.values[index + code - first];
+                index += table.bits[length];
+                first = (first + table.bits[length]) << 1;
+                code <<= 1;
+            }
+            throw std::runtime_error("not a huffman code");
+        }
+
+        //only padding of 1 bits may be left, and the zero stuffed after it if it made a 0xFF
+        bool at_end()
+        {
+            while(bit != 8)
+            {
+                if(read() != 1) return false;
+            }
+            if(position < data.size() && data[position - 1] == 0xFF && data[position] == 0x00) ++position;
+
+            return position == data.size();
+        }
+    };
+
+    typedef std::array<int, 64> BLOCK;
+
+    //decodes the quantized coefficients in zigzag order, DC values with their prediction added back
+    std::array<std::vector<BLOCK>, 3> decode_blocks(const JPEG_FILE& file, unsigned& stuffed_bytes)
+    {
+        std::array<std::vector<BLOCK>, 3> components;
+        int previous_dc[3] = { 0, 0, 0 };
+        BitReader reader(file.scan);
+
+        const auto macroblocks = ((file.width + 15) / 16) * ((file.height + 15) / 16);
+        for(unsigned macroblock = 0; macroblock != macroblocks; ++macroblock)
+        {
+            for(unsigned i = 0; i != 6; ++i)
+            {
+                const auto component = i < 4 ? 0 : i - 3;
+                const auto table = component == 0 ? 0 : 1;
+
+                BLOCK block{};
+                previous_dc[component] += reader.receive(reader.decode(file.dc[table]));
+                block[0] = previous_dc[component];
+                for(unsigned k = 1; k < 64; ++k)
+                {
+                    const auto symbol = reader.decode(file.ac[table]);
+                    if(symbol == 0x00) break;
+                    k += symbol >> 4;
+                    require(k < 64, "run past the end of the block");
+                    block[k] = reader.receive(symbol & 0x0F);
+                }
+                components[component].push_back(block);
+            }
+        }
+
+        require(reader.at_end(), "data left after the last block");
+        stuffed_bytes = reader.stuffed_bytes;
+
+        return components;
+    }
+
+    imaging::Frame noise_frame(unsigned width, unsigned height, uint32_t seed)
+    {
+        imaging::Frame frame(width, height);
+        for(auto& pixel : frame.pixels)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            pixel = seed ^ (seed << 11);
+        }
+
+        return frame;
+    }
+}
+
+TEST_CASE("AVI, the headers and the index describe the frames")
+{
+    std::stringstream out;
+    imaging::AviWriter writer(out, 16, 8, 25, "MJPG");
+    //odd sizes are padded to whole words
+    writer.add_frame(some_bytes(5, 1).data(), 5);
+    writer.add_frame(some_bytes(8, 10).data(), 8);
+    writer.add_frame(some_bytes(3, 20).data(), 3);
+    writer.finish();
+    const auto data = out.str();
+
+    //RIFF, the hdrl list with the main and the stream header, the movi list of 3 chunks and the idx1 index of 16 bytes per frame
+    const size_t movi_size = 4 + (8 + 6) + (8 + 8) + (8 + 4);
+    CATCH_REQUIRE(data.size() == MOVI_START + movi_size + 8 + 3 * 16);
+    CATCH_CHECK(data.substr(0, 4) == "RIFF");
+    CATCH_CHECK(read_u32(data, 4) == data.size() - 8);
+    CATCH_CHECK(data.substr(8, 4) == "AVI ");
+    CATCH_CHECK(data.substr(12, 4) == "LIST");
+    CATCH_CHECK(data.substr(20, 8) == "hdrlavih");
+
+    //avih: 40000 microseconds per frame, the patched frame count, largest chunk and size
+    CATCH_CHECK(read_u32(data, 32) == 40000);
+    CATCH_CHECK(read_u32(data, 36) == movi_size * 25 / 3);
+    CATCH_CHECK(read_u32(data, 48) == 3);
+    CATCH_CHECK(read_u32(data, 60) == 8 + 8);
+    CATCH_CHECK(read_u32(data, 64) == 16);
+    CATCH_CHECK(read_u32(data, 68) == 8);
+
+    //strh of a video stream at 25 / 1 frames per second, strf with the same codec
+    CATCH_CHECK(data.substr(88, 4) == "LIST");
+    CATCH_CHECK(read_u32(data, 92) + 96 == 212);
+    CATCH_CHECK(data.substr(96, 8) == "strlstrh");
+    CATCH_CHECK(data.substr(108, 8) == "vidsMJPG");
+    CATCH_CHECK(read_u32(data, 128) == 1);
+    CATCH_CHECK(read_u32(data, 132) == 25);
+    CATCH_CHECK(read_u32(data, 140) == 3);
+    CATCH_CHECK(read_u32(data, 144) == 8 + 8);
+    CATCH_CHECK(data.substr(164, 4) == "strf");
+    CATCH_CHECK(data.substr(188, 4) == "MJPG");
+
+    CATCH_CHECK(data.substr(212, 4) == "LIST");
+    CATCH_CHECK(read_u32(data, 216) == movi_size);
+    CATCH_CHECK(data.substr(MOVI_START, 4) == "movi");
+
+    //every index entry points at its chunk, relative to "movi"
+    const auto index = MOVI_START + movi_size;
+    CATCH_REQUIRE(data.substr(index, 4) == "idx1");
+    CATCH_CHECK(read_u32(data, index + 4) == 3 * 16);
+
+    const uint32_t sizes[] = { 5, 8, 3 };
+    const uint8_t first_bytes[] = { 1, 10, 20 };
+    size_t chunk = MOVI_START + 4;
+    for(unsigned i = 0; i != 3; ++i)
+    {
+        const auto entry = index + 8 + 16 * i;
+        CATCH_CHECK(data.substr(entry, 4) == "00dc");
+        CATCH_CHECK(read_u32(data, entry + 4) == 0x10);
+        CATCH_CHECK(read_u32(data, entry + 8) == chunk - MOVI_START);
+        CATCH_CHECK(read_u32(data, entry + 12) == sizes[i]);
+
+        CATCH_CHECK(data.substr(chunk, 4) == "00dc");
+        CATCH_CHECK(read_u32(data, chunk + 4) == sizes[i]);
+        CATCH_CHECK(uint8_t(data[chunk + 8]) == first_bytes[i]);
+        CATCH_CHECK(uint8_t(data[chunk + 8 + sizes[i] - 1]) == uint8_t(first_bytes[i] + sizes[i] - 1));
+        if(sizes[i] % 2 == 1) CATCH_CHECK(data[chunk + 8 + sizes[i]] == 0);
+        chunk += 8 + (sizes[i] + 1) / 2 * 2;
+    }
+    CATCH_CHECK(chunk == index);
+}
+
+TEST_CASE("AVI, without frames the counts stay zero")
+{
+    std::stringstream out;
+    imaging::AviWriter writer(out, 4, 4, 0, "MJPG");
+    writer.finish();
+    const auto data = out.str();
+
+    CATCH_REQUIRE(data.size() == MOVI_START + 4 + 8);
+    CATCH_CHECK(read_u32(data, 4) == data.size() - 8);
+    //no frame rate counts as 1
+    CATCH_CHECK(read_u32(data, 32) == 1000000);
+    CATCH_CHECK(read_u32(data, 36) == 0);
+    CATCH_CHECK(read_u32(data, 48) == 0);
+    CATCH_CHECK(read_u32(data, 216) == 4);
+    CATCH_CHECK(data.substr(MOVI_START + 4, 4) == "idx1");
+    CATCH_CHECK(read_u32(data, MOVI_START + 8) == 0);
+}
+
+TEST_CASE("AVI sink, a frame that cannot be written is reported")
+{
+    //the device takes nothing, a frame larger than the stream buffer is written right away
+    if(!std::filesystem::exists("/dev/full")) return;
+
+    rendering::AviFileSink sink("/dev/full", 30, 85);
+    sink.begin(16, 16, 1);
+    CATCH_CHECK_THROWS_AS(sink.write(0, std::vector<uint8_t>(1 << 20, 1)), std::runtime_error);
+}
+
+TEST_CASE("JPEG, the markers and tables of a baseline file")
+{
+    const auto file = parse_jpeg(imaging::encode_jpeg(noise_frame(37, 21, 3), 50));
+
+    //SOI, JFIF APP0, DQT, SOF0, DHT, SOS, EOI
+    CATCH_CHECK(file.markers == std::vector<uint8_t>({ 0xD8, 0xE0, 0xDB, 0xC0, 0xC4, 0xDA, 0xD9 }));
+    CATCH_CHECK(file.width == 37);
+    CATCH_CHECK(file.height == 21);
+
+    //quality 50 uses the tables of Annex K as they are, stored in zigzag order
+    CATCH_CHECK(file.quantization[0][0] == 16);
+    CATCH_CHECK(file.quantization[0][1] == 11);
+    CATCH_CHECK(file.quantization[0][2] == 12);
+    CATCH_CHECK(file.quantization[0][63] == 99);
+    CATCH_CHECK(file.quantization[1][0] == 17);
+    CATCH_CHECK(file.quantization[1][63] == 99);
+    CATCH_CHECK(file.dc[0].values.size() == 12);
+    CATCH_CHECK(file.ac[0].values.size() == 162);
+    CATCH_CHECK(file.dc[1].values.size() == 12);
+    CATCH_CHECK(file.ac[1].values.size() == 162);
+
+    //3 x 2 macroblocks of 4 luma and 2 chroma blocks decode to the end of the scan
+    unsigned stuffed_bytes = 0;
+    const auto components = decode_blocks(file, stuffed_bytes);
+    CATCH_CHECK(components[0].size() == 3 * 2 * 4);
+    CATCH_CHECK(components[1].size() == 3 * 2);
+    CATCH_CHECK(components[2].size() == 3 * 2);
+}
+
+TEST_CASE("JPEG, a flat colour keeps its DC value and nothing else")
+{
+    //a grey of 144 has a luma of exactly 144, level shifted to 16: the DC coefficient is 8 * 16, quantized by 16 to 8
+    imaging::Frame frame(16, 16);
+    std::fill(frame.pixels.begin(), frame.pixels.end(), 0xFF909090U);
+    const auto file = parse_jpeg(imaging::encode_jpeg(frame, 50));
+
+    unsigned stuffed_bytes = 0;
+    const auto components = decode_blocks(file, stuffed_bytes);
+    CATCH_REQUIRE(components[0].size() == 4);
+    for(const auto& block : components[0])
+    {
+        CATCH_CHECK(block[0] == 8);
+        CATCH_CHECK(block[0] * file.quantization[0][0] / 8 + 128 == 144);
+        CATCH_CHECK(std::all_of(block.begin() + 1, block.end(), [](int value) { return value == 0; }));
+    }
+
+    //grey has no chroma
+    for(unsigned component = 1; component != 3; ++component)
+    {
+        CATCH_REQUIRE(components[component].size() == 1);
+        CATCH_CHECK(std::all_of(components[component][0].begin(), components[component][0].end(), [](int value) { return value == 0; }));
+    }
+}
+
+TEST_CASE("JPEG, every 0xFF in the scan is followed by a stuffed zero")
+{
+    //noise at full quality needs long codes and large values, 0xFF bytes are bound to come up
+    const auto file = parse_jpeg(imaging::encode_jpeg(noise_frame(64, 48, 11), 100));
+
+    unsigned stuffed_bytes = 0;
+    const auto components = decode_blocks(file, stuffed_bytes);
+    CATCH_CHECK(components[0].size() == 4 * 3 * 4);
+    CATCH_CHECK(stuffed_bytes > 0);
+}
+
+#endif
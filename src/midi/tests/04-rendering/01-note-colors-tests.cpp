@@ -0,0 +1,97 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/note-colors.h"
+#include "imaging/frame.h"
+#include "Catch.h"
+
+
+namespace
+{
+    midi::NOTE note(unsigned instrument, uint8_t velocity)
+    {
+        return midi::NOTE(midi::NoteNumber(60), midi::Time(0), midi::Duration(10), velocity, midi::Instrument(instrument));
+    }
+
+    unsigned component(uint32_t argb, unsigned shift)
+    {
+        return (argb >> shift) & 0xFFU;
+    }
+}
+
+TEST_CASE("Note colors, the instruments of a general midi family share a colour")
+{
+    const auto theme = rendering::theme_named("instruments");
+    const rendering::NoteColors colors(theme);
+
+    for(unsigned instrument = 0; instrument != 128; ++instrument)
+    {
+        const auto& family_color = theme.instrument_colors[instrument / 8];
+        CATCH_CHECK(colors.argb_of(note(instrument, 127)) == imaging::to_argb(family_color));
+    }
+
+    //every family gets a colour of its own
+    for(unsigned family = 1; family != 16; ++family)
+    {
+        CATCH_CHECK(colors.argb_of(note(family * 8, 127)) != colors.argb_of(note((family - 1) * 8, 127)));
+    }
+}
+
+TEST_CASE("Note colors, the mono theme")
+{
+    const rendering::NoteColors colors(rendering::theme_named("mono"));
+
+    CATCH_CHECK(colors.argb_of(note(0, 127)) == imaging::to_argb(imaging::colors::orange()));
+    CATCH_CHECK(colors.argb_of(note(127, 127)) == imaging::to_argb(imaging::colors::orange()));
+    CATCH_CHECK(colors.argb_of(note(40, 0)) == imaging::to_argb(imaging::colors::orange() * 0.3));
+}
+
+TEST_CASE("Note colors, louder notes are brighter")
+{
+    const auto theme = rendering::theme_named("instruments");
+    const rendering::NoteColors colors(theme);
+
+    for(unsigned instrument = 0; instrument != 128; instrument += 8)
+    {
+        CATCH_CHECK(colors.argb_of(note(instrument, 0)) == imaging::to_argb(theme.instrument_colors[instrument / 8] * theme.quietest_brightness));
+
+        bool brighter = true;
+        for(unsigned velocity = 1; velocity != 128; ++velocity)
+        {
+            const auto quieter = colors.argb_of(note(instrument, uint8_t(velocity - 1)));
+            const auto louder = colors.argb_of(note(instrument, uint8_t(velocity)));
+            for(unsigned shift : { 0U, 8U, 16U }) brighter = brighter && component(quieter, shift) <= component(louder, shift);
+        }
+        CATCH_CHECK(brighter);
+
+        const auto quietest = colors.argb_of(note(instrument, 0));
+        const auto loudest = colors.argb_of(note(instrument, 127));
+        CATCH_CHECK(component(quietest, 0) + component(quietest, 8) + component(quietest, 16) < component(loudest, 0) + component(loudest, 8) + component(loudest, 16));
+    }
+}
+
+TEST_CASE("Note colors, no component wraps around for instruments and velocities 0 to 127")
+{
+    //white at full brightness is the largest colour a theme may hold, 255 is the largest component that fits
+    const rendering::NoteColors colors(rendering::COLOR_THEME{ { imaging::colors::white(), imaging::colors::black() }, 0.0 });
+
+    bool opaque = true;
+    bool in_range = true;
+    for(unsigned instrument = 0; instrument != 128; ++instrument)
+    {
+        for(unsigned velocity = 0; velocity != 128; ++velocity)
+        {
+            const auto argb = colors.argb_of(note(instrument, uint8_t(velocity)));
+            const auto expected = instrument < 64 ? unsigned(velocity / 127.0 * 255) : 0U;
+            opaque = opaque && component(argb, 24) == 0xFF;
+            for(unsigned shift : { 0U, 8U, 16U }) in_range = in_range && component(argb, shift) == expected;
+        }
+    }
+    CATCH_CHECK(opaque);
+    CATCH_CHECK(in_range);
+    CATCH_CHECK(colors.argb_of(note(0, 127)) == 0xFFFFFFFFU);
+    CATCH_CHECK(colors.argb_of(note(0, 0)) == 0xFF000000U);
+}
+
+#endif
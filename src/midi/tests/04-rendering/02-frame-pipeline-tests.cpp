@@ -0,0 +1,219 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/frame-pipeline.h"
+#include "Catch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+
+namespace
+{
+    //every pixel of a frame holds its content, frames with the same content are duplicates
+    imaging::Frame frame_of(uint32_t content)
+    {
+        imaging::Frame frame(4, 2);
+        std::fill(frame.pixels.begin(), frame.pixels.end(), 0xFF000000U | content);
+
+        return frame;
+    }
+
+    struct WRITE
+    {
+        unsigned index;
+        bool duplicate;
+        unsigned original_index;
+        std::vector<uint8_t> data;
+    };
+
+    //remembers what reaches it, encoding takes longer for some frames so they finish out of order
+    struct RecordingSink : rendering::FrameSink
+    {
+        bool is_ordered;
+        bool encodes_differences;
+        std::mutex mutex;
+        std::vector<WRITE> writes;
+        std::map<unsigned, std::vector<uint8_t>> encoded;
+        std::map<unsigned, int> previous_contents;    //-1 without a previous frame
+        std::atomic<unsigned> encode_calls{0};
+
+        RecordingSink(bool is_ordered, bool encodes_differences = false) : is_ordered(is_ordered), encodes_differences(encodes_differences) {}
+
+        std::vector<uint8_t> encode(unsigned frame_index, const imaging::Frame& frame) override
+        {
+            ++encode_calls;
+            std::this_thread::sleep_for(std::chrono::microseconds((frame_index * 7) % 5 * 200));
+
+            //the content and the index, so the bytes of every original differ
+            std::vector<uint8_t> data = { uint8_t(frame.pixels[0]), uint8_t(frame_index), uint8_t(frame_index >> 8) };
+            std::lock_guard<std::mutex> lock(mutex);
+            encoded[frame_index] = data;
+            return data;
+        }
+
+        bool needs_previous_frame() const override { return encodes_differences; }
+
+        std::vector<uint8_t> encode_difference(unsigned frame_index, const imaging::Frame& frame, const imaging::Frame* previous_frame) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                previous_contents[frame_index] = previous_frame == nullptr ? -1 : int(previous_frame->pixels[0] & 0xFFFFFF);
+            }
+            return encode(frame_index, frame);
+        }
+
+        void write(unsigned frame_index, const std::vector<uint8_t>& data) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            writes.push_back(WRITE{ frame_index, false, frame_index, data });
+        }
+
+        void write_duplicate(unsigned frame_index, unsigned original_index, const std::vector<uint8_t>& original_data) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            writes.push_back(WRITE{ frame_index, true, original_index, original_data });
+        }
+
+        bool ordered() const override { return is_ordered; }
+    };
+
+    void run(RecordingSink& sink, const std::vector<uint32_t>& contents, unsigned deduplication_window)
+    {
+        rendering::FramePipeline pipeline(rendering::PIPELINE_SETTINGS(3, 4, 3, 2, deduplication_window), sink);
+        pipeline.run(unsigned(contents.size()), [&contents](unsigned index) { return frame_of(contents[index]); });
+    }
+
+    const WRITE* write_of(const RecordingSink& sink, unsigned index)
+    {
+        for(const auto& write : sink.writes)
+        {
+            if(write.index == index) return &write;
+        }
+
+        return nullptr;
+    }
+}
+
+TEST_CASE("Frame pipeline, an ordered sink receives every frame in order")
+{
+    std::vector<uint32_t> contents;
+    for(uint32_t i = 0; i != 200; ++i) contents.push_back(i);
+
+    RecordingSink sink(true);
+    run(sink, contents, 0);
+
+    CATCH_REQUIRE(sink.writes.size() == contents.size());
+    bool in_order = true;
+    for(unsigned i = 0; i != sink.writes.size(); ++i)
+    {
+        in_order = in_order && sink.writes[i].index == i && !sink.writes[i].duplicate && sink.writes[i].data == sink.encoded[i];
+    }
+    CATCH_CHECK(in_order);
+}
+
+TEST_CASE("Frame pipeline, an unordered sink receives every frame once")
+{
+    std::vector<uint32_t> contents;
+    for(uint32_t i = 0; i != 200; ++i) contents.push_back(i);
+
+    RecordingSink sink(false);
+    run(sink, contents, 0);
+
+    std::vector<unsigned> arrivals(contents.size(), 0);
+    for(const auto& write : sink.writes) ++arrivals[write.index];
+    CATCH_CHECK(arrivals == std::vector<unsigned>(contents.size(), 1));
+}
+
+TEST_CASE("Frame pipeline, duplicates within the window are not encoded again")
+{
+    //with a window of 2: frame 2 repeats frame 0, 4 repeats 3 and 7 repeats 6,
+    //frame 6 does not repeat frame 1 and frame 8 does not repeat frame 2, they are too far back
+    const std::vector<uint32_t> contents = { 0, 1, 0, 2, 2, 3, 1, 1, 0 };
+    const std::map<unsigned, unsigned> duplicates = { { 2, 0 }, { 4, 3 }, { 7, 6 } };
+
+    for(bool ordered : { true, false })
+    {
+        RecordingSink sink(ordered);
+        rendering::FramePipeline pipeline(rendering::PIPELINE_SETTINGS(3, 4, 3, 2, 2), sink);
+        pipeline.run(unsigned(contents.size()), [&contents](unsigned index) { return frame_of(contents[index]); });
+
+        CATCH_REQUIRE(sink.writes.size() == contents.size());
+        CATCH_CHECK(sink.encode_calls == contents.size() - duplicates.size());
+        CATCH_CHECK(pipeline.deduplication().duplicate_frames == duplicates.size());
+        CATCH_CHECK(pipeline.deduplication().bytes_saved == 3 * duplicates.size());
+
+        for(unsigned i = 0; i != contents.size(); ++i)
+        {
+            const auto* write = write_of(sink, i);
+            CATCH_REQUIRE(write != nullptr);
+
+            const auto duplicate = duplicates.find(i);
+            CATCH_CHECK(write->duplicate == (duplicate != duplicates.end()));
+            if(duplicate == duplicates.end())
+            {
+                CATCH_CHECK(sink.encoded.count(i) == 1);
+                continue;
+            }
+
+            CATCH_CHECK(write->original_index == duplicate->second);
+            CATCH_CHECK(sink.encoded.count(i) == 0);
+            //an ordered sink gets the bytes of the original to write again, an unordered one refers to a file written before
+            if(ordered) CATCH_CHECK(write->data == sink.encoded[duplicate->second]);
+            else CATCH_CHECK(write->data.empty());
+            CATCH_CHECK(write_of(sink, duplicate->second) < write);
+        }
+    }
+}
+
+TEST_CASE("Frame pipeline, a repeat of a repeat refers to the first original")
+{
+    const std::vector<uint32_t> contents = { 5, 5, 5, 5, 6, 5 };
+
+    RecordingSink sink(true);
+    run(sink, contents, 1);
+
+    for(unsigned i : { 1U, 2U, 3U })
+    {
+        CATCH_CHECK(sink.writes[i].duplicate);
+        CATCH_CHECK(sink.writes[i].original_index == 0);
+        CATCH_CHECK(sink.writes[i].data == sink.encoded[0]);
+    }
+    CATCH_CHECK(!sink.writes[4].duplicate);
+    CATCH_CHECK(!sink.writes[5].duplicate);
+}
+
+TEST_CASE("Frame pipeline, without a window every frame is encoded")
+{
+    const std::vector<uint32_t> contents = { 1, 1, 1, 2, 2 };
+
+    RecordingSink sink(true);
+    run(sink, contents, 0);
+
+    CATCH_CHECK(sink.encode_calls == contents.size());
+    for(const auto& write : sink.writes) CATCH_CHECK(!write.duplicate);
+}
+
+TEST_CASE("Frame pipeline, a sink encoding differences gets the previous frame and only skips its repeats")
+{
+    const std::vector<uint32_t> contents = { 7, 7, 8, 7, 9 };
+
+    RecordingSink sink(true, true);
+    run(sink, contents, 4);
+
+    //the window shrinks to the previous frame: frame 3 repeats frame 0 and 1 but is encoded again
+    CATCH_CHECK(sink.writes[1].duplicate);
+    CATCH_CHECK(!sink.writes[3].duplicate);
+    CATCH_CHECK(sink.encode_calls == 4);
+
+    CATCH_CHECK(sink.previous_contents[0] == -1);
+    CATCH_CHECK(sink.previous_contents[2] == 7);
+    CATCH_CHECK(sink.previous_contents[3] == 8);
+    CATCH_CHECK(sink.previous_contents[4] == 7);
+}
+
+#endif
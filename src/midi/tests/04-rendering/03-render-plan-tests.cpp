@@ -0,0 +1,146 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/render-plan.h"
+#include "Catch.h"
+#include <sstream>
+
+
+namespace
+{
+    using rendering::CanvasStrategy;
+
+    const uint64_t BASELINE = 1000;
+    const uint64_t MINIMUM_RESIDENT_CANVAS = uint64_t(64) << 20;
+
+    //2 raster, 2 encode and 1 write thread: with a queue capacity of 4 both queues and the threads hold 2 * 4 + 5 frames,
+    //with a capacity of 2 or 1 (rounded up to 2) they hold 2 * 2 + 5
+    const rendering::PIPELINE_SETTINGS SETTINGS(2, 2, 1, 4);
+    const uint64_t IN_FLIGHT_AT_4 = 13;
+    const uint64_t IN_FLIGHT_AT_2 = 9;
+
+    //a long piece made of many frames: a 10000 x 100 canvas, 200 pixel wide frames 10 pixels apart
+    const rendering::RENDER_REQUIREMENTS MANY_FRAMES{ 10000, 100, 200, 10, 981, BASELINE };
+    const uint64_t COLUMN_BYTES = 100 * 4;
+    const uint64_t FULL_CANVAS_BYTES = 10000 * COLUMN_BYTES;
+    const uint64_t FRAME_BYTES = 2 * 200 * 100 * 4;
+    //a window per raster thread and one more, each at least a frame wide
+    const uint64_t SMALLEST_WINDOWS_BYTES = 3 * 200 * COLUMN_BYTES;
+
+    //a single frame showing the whole piece cannot be drawn in windows
+    const rendering::RENDER_REQUIREMENTS SINGLE_FRAME{ 200000, 100, 200000, 0, 1, BASELINE };
+    const uint64_t SINGLE_CANVAS_BYTES = 200000 * COLUMN_BYTES;
+    const uint64_t SINGLE_FRAME_BYTES = 2 * 200000 * 100 * 4;
+}
+
+TEST_CASE("Render plan, a full canvas is kept when it fits, with fewer frames in flight if need be")
+{
+    const auto budget = BASELINE + FULL_CANVAS_BYTES + IN_FLIGHT_AT_4 * FRAME_BYTES;
+    const auto plan = rendering::plan_render(MANY_FRAMES, SETTINGS, budget);
+    CATCH_CHECK(plan.strategy == CanvasStrategy::FULL);
+    CATCH_CHECK(plan.queue_capacity == 4);
+    CATCH_CHECK(plan.frames_in_flight == IN_FLIGHT_AT_4);
+    CATCH_CHECK(plan.canvas_bytes == FULL_CANVAS_BYTES);
+    CATCH_CHECK(plan.frame_bytes == FRAME_BYTES);
+    CATCH_CHECK(plan.predicted_peak_bytes == budget);
+    CATCH_CHECK(plan.within_budget);
+
+    //without windows to fall back on, a smaller queue is the next best thing
+    const auto single_budget = BASELINE + SINGLE_CANVAS_BYTES + IN_FLIGHT_AT_2 * SINGLE_FRAME_BYTES;
+    const auto smaller_queue = rendering::plan_render(SINGLE_FRAME, SETTINGS, single_budget);
+    CATCH_CHECK(smaller_queue.strategy == CanvasStrategy::FULL);
+    CATCH_CHECK(smaller_queue.queue_capacity == 2);
+    CATCH_CHECK(smaller_queue.predicted_peak_bytes == single_budget);
+}
+
+TEST_CASE("Render plan, a byte short of a full canvas draws the frames in windows")
+{
+    const auto budget = BASELINE + FULL_CANVAS_BYTES + IN_FLIGHT_AT_4 * FRAME_BYTES - 1;
+    const auto plan = rendering::plan_render(MANY_FRAMES, SETTINGS, budget);
+    CATCH_CHECK(plan.strategy == CanvasStrategy::WINDOWED);
+    CATCH_CHECK(plan.queue_capacity == 4);
+    CATCH_CHECK(plan.within_budget);
+    CATCH_CHECK(plan.predicted_peak_bytes <= budget);
+
+    //3 windows in the 3999999 bytes left, 3333 columns each: 314 frames of 200 columns 10 apart
+    CATCH_CHECK(plan.frames_per_window == 314);
+    CATCH_CHECK(plan.canvas_bytes == 3 * (313 * 10 + 200) * COLUMN_BYTES);
+}
+
+TEST_CASE("Render plan, windows shrink to one frame and then give up queue capacity")
+{
+    const auto smallest_at_4 = BASELINE + IN_FLIGHT_AT_4 * FRAME_BYTES + SMALLEST_WINDOWS_BYTES;
+    const auto one_frame = rendering::plan_render(MANY_FRAMES, SETTINGS, smallest_at_4);
+    CATCH_CHECK(one_frame.strategy == CanvasStrategy::WINDOWED);
+    CATCH_CHECK(one_frame.queue_capacity == 4);
+    CATCH_CHECK(one_frame.frames_per_window == 1);
+    CATCH_CHECK(one_frame.predicted_peak_bytes == smallest_at_4);
+
+    const auto smaller_queue = rendering::plan_render(MANY_FRAMES, SETTINGS, smallest_at_4 - 1);
+    CATCH_CHECK(smaller_queue.strategy == CanvasStrategy::WINDOWED);
+    CATCH_CHECK(smaller_queue.queue_capacity == 2);
+    CATCH_CHECK(smaller_queue.frames_per_window > 1);
+    CATCH_CHECK(smaller_queue.within_budget);
+
+    const auto smallest_at_2 = BASELINE + IN_FLIGHT_AT_2 * FRAME_BYTES + SMALLEST_WINDOWS_BYTES;
+    const auto last_fitting = rendering::plan_render(MANY_FRAMES, SETTINGS, smallest_at_2);
+    CATCH_CHECK(last_fitting.strategy == CanvasStrategy::WINDOWED);
+    CATCH_CHECK(last_fitting.frames_per_window == 1);
+    CATCH_CHECK(last_fitting.within_budget);
+
+    //nothing fits any more: one frame windows still need the least, the plan says it is over budget
+    const auto too_small = rendering::plan_render(MANY_FRAMES, SETTINGS, smallest_at_2 - 1);
+    CATCH_CHECK(too_small.strategy == CanvasStrategy::WINDOWED);
+    CATCH_CHECK(too_small.frames_per_window == 1);
+    CATCH_CHECK(too_small.predicted_peak_bytes == smallest_at_2);
+    CATCH_CHECK(!too_small.within_budget);
+}
+
+TEST_CASE("Render plan, a canvas that does not fit in memory is tiled while enough of it can stay resident")
+{
+    const auto just_short = rendering::plan_render(SINGLE_FRAME, SETTINGS, BASELINE + SINGLE_CANVAS_BYTES + IN_FLIGHT_AT_2 * SINGLE_FRAME_BYTES - 1);
+    CATCH_CHECK(just_short.strategy == CanvasStrategy::TILED);
+    CATCH_CHECK(just_short.queue_capacity == 2);
+    CATCH_CHECK(just_short.canvas_bytes == SINGLE_CANVAS_BYTES - 1);
+    CATCH_CHECK(just_short.within_budget);
+
+    const auto smallest_resident = BASELINE + IN_FLIGHT_AT_2 * SINGLE_FRAME_BYTES + MINIMUM_RESIDENT_CANVAS;
+    const auto tiled = rendering::plan_render(SINGLE_FRAME, SETTINGS, smallest_resident);
+    CATCH_CHECK(tiled.strategy == CanvasStrategy::TILED);
+    CATCH_CHECK(tiled.canvas_bytes == MINIMUM_RESIDENT_CANVAS);
+    CATCH_CHECK(tiled.predicted_peak_bytes == smallest_resident);
+    CATCH_CHECK(tiled.within_budget);
+
+    //less than that thrashes, the smallest tiled plan is used anyway and reported over budget
+    const auto too_small = rendering::plan_render(SINGLE_FRAME, SETTINGS, smallest_resident - 1);
+    CATCH_CHECK(too_small.strategy == CanvasStrategy::TILED);
+    CATCH_CHECK(too_small.queue_capacity == 1);
+    CATCH_CHECK(too_small.canvas_bytes == MINIMUM_RESIDENT_CANVAS);
+    CATCH_CHECK(!too_small.within_budget);
+}
+
+TEST_CASE("Render plan, the deduplication window counts as frames in flight")
+{
+    rendering::PIPELINE_SETTINGS settings = SETTINGS;
+    settings.deduplication_window = 6;
+
+    const auto plan = rendering::plan_render(MANY_FRAMES, settings, UINT64_MAX);
+    CATCH_CHECK(plan.strategy == CanvasStrategy::FULL);
+    CATCH_CHECK(plan.frames_in_flight == IN_FLIGHT_AT_4 + 6);
+}
+
+TEST_CASE("Render plan, printing it leaves the stream formatting as it was")
+{
+    std::stringstream out;
+    out.precision(4);
+    rendering::print_plan(out, rendering::plan_render(MANY_FRAMES, SETTINGS, uint64_t(64) << 20), uint64_t(64) << 20);
+    CATCH_CHECK(out.str().find("Render plan: full canvas in memory (3.8 MB)") == 0);
+    CATCH_CHECK(out.str().find("MB of a 64.0 MB budget\n") != std::string::npos);
+
+    out.str("");
+    out << 2.0 / 3;
+    CATCH_CHECK(out.str() == "0.6667");
+}
+
+#endif
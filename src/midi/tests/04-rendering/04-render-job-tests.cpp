@@ -0,0 +1,372 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/batch.h"
+#include "rendering/render-job.h"
+#include "rendering/render-plan.h"
+#include "tests/tests-util.h"
+#include "Catch.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+
+namespace
+{
+    //a fresh directory that is removed again at the end of a test
+    struct TEMPORARY_DIRECTORY
+    {
+        std::filesystem::path path;
+
+        explicit TEMPORARY_DIRECTORY(const std::string& name)
+            : path(std::filesystem::temp_directory_path() / (name + "-" + std::to_string(getpid())))
+        {
+            std::filesystem::remove_all(path);
+            std::filesystem::create_directories(path);
+        }
+
+        ~TEMPORARY_DIRECTORY()
+        {
+            std::filesystem::remove_all(path);
+        }
+
+        std::string operator /(const std::string& name) const
+        {
+            return (path / name).string();
+        }
+    };
+
+    //notes ending at time 2000 make a canvas 100 pixels wide: 9 frames of 20 pixels, 10 pixels apart
+    std::vector<midi::NOTE> some_notes()
+    {
+        return {
+            midi::NOTE(midi::NoteNumber(60), midi::Time(0), midi::Duration(1000), 100, midi::Instrument(0)),
+            midi::NOTE(midi::NoteNumber(64), midi::Time(500), midi::Duration(1500), 40, midi::Instrument(40))
+        };
+    }
+
+    rendering::RENDER_OPTIONS small_options(const std::string& format)
+    {
+        rendering::RENDER_OPTIONS options;
+        options.format = format;
+        options.frame_width = 20;
+        options.horizontal_step = 10;
+        options.note_height = 2;
+        options.thread_count = 2;
+        options.memory_budget = uint64_t(256) << 20;
+
+        return options;
+    }
+
+    midi::TrackWriter long_note_track()
+    {
+        midi::TrackWriter track;
+        track.note_on(midi::Duration(0), midi::Channel(0), midi::NoteNumber(60), 100);
+        track.note_off(midi::Duration(2000), midi::Channel(0), midi::NoteNumber(60), 0);
+        track.end_of_track(midi::Duration(0));
+
+        return track;
+    }
+
+    void write_file(const std::string& path, const std::string& data)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << data;
+    }
+}
+
+TEST_CASE("Render job, sequence outputs")
+{
+    //single file formats number the file, frame files get a directory per sequence
+    CATCH_CHECK(rendering::sequence_output("out/patterns.avi", "avi", 2) == "out/patterns-2.avi");
+    CATCH_CHECK(rendering::sequence_output("patterns.mfd", "delta", 0) == "patterns-0.mfd");
+    CATCH_CHECK(rendering::sequence_output("patterns", "gif", 11) == "patterns-11");
+    CATCH_CHECK(rendering::sequence_output("frames/", "png", 1) == "frames/sequence-1/");
+    CATCH_CHECK(rendering::sequence_output("frames", "bmp", 3) == "frames-sequence-3/");
+    CATCH_CHECK(rendering::sequence_output("", "bmp", 0) == "sequence-0/");
+}
+
+TEST_CASE("Render job, jobs side by side share the threads and the memory budget")
+{
+    auto options = small_options("bmp");
+    options.thread_count = 8;
+    options.memory_budget = 900;
+    options.pipeline_settings = rendering::PIPELINE_SETTINGS(0, 3, 0, 0);
+
+    const auto three = rendering::shared_options(options, 3);
+    CATCH_CHECK(three.thread_count == 2);
+    CATCH_CHECK(three.memory_budget == 300);
+    CATCH_CHECK(three.pipeline_settings.encode_threads == 3);
+    CATCH_CHECK(three.pipeline_settings.raster_threads == 0);
+
+    //more jobs than threads still leaves every job a thread, no jobs counts as one
+    CATCH_CHECK(rendering::shared_options(options, 16).thread_count == 1);
+    CATCH_CHECK(rendering::shared_options(options, 0).thread_count == 8);
+    CATCH_CHECK(rendering::shared_options(options, 0).memory_budget == 900);
+
+    //without a budget, half of the physical memory is shared
+    options.memory_budget = 0;
+    CATCH_CHECK(rendering::shared_options(options, 4).memory_budget == rendering::physical_memory_bytes() / 2 / 4);
+}
+
+TEST_CASE("Render job, problems and outputs that cannot be written are returned")
+{
+    TEMPORARY_DIRECTORY directory("midi-render-job-tests");
+
+    const auto no_notes = rendering::render_notes({}, small_options("bmp"), directory / "", "f%d", nullptr);
+    CATCH_CHECK(no_notes.error == "no notes");
+    CATCH_CHECK(no_notes.frames == 0);
+
+    auto options = small_options("bmp");
+    options.theme = "sepia";
+    CATCH_CHECK(rendering::render_notes(some_notes(), options, directory / "", "f%d", nullptr).error == "unknown theme");
+
+    //frames 0 pixels apart would never reach the end
+    auto standing_still = small_options("bmp");
+    standing_still.horizontal_step = 0;
+    CATCH_CHECK(std::string(rendering::render_problem(some_notes(), standing_still)) == "the horizontal step has to be at least 1");
+    CATCH_CHECK(rendering::render_notes(some_notes(), standing_still, directory / "", "f%d", nullptr).error == "the horizontal step has to be at least 1");
+
+    CATCH_CHECK(rendering::render_notes(some_notes(), small_options("gif"), "-", "", nullptr).error == "--format gif needs an --output file");
+
+    const auto missing = directory / "missing/out.gif";
+    CATCH_CHECK(rendering::render_notes(some_notes(), small_options("gif"), missing, "", nullptr).error == "could not open " + missing);
+    CATCH_CHECK(rendering::render_notes(some_notes(), small_options("y4m"), missing, "", nullptr).error == "could not open " + missing);
+
+    //frame files fail while the pipeline runs
+    const auto failed = rendering::render_notes(some_notes(), small_options("bmp"), directory / "missing/", "f%d", nullptr);
+    CATCH_CHECK(failed.error.find("could not write") == 0);
+
+    const auto rendered = rendering::render_notes(some_notes(), small_options("bmp"), directory / "", "f%d", nullptr);
+    CATCH_CHECK(rendered.ok());
+    CATCH_CHECK(rendered.frames == 9);
+    CATCH_CHECK(std::filesystem::exists(directory / "f00008.bmp"));
+}
+
+TEST_CASE("Render job, sequences that are left out or fail are reported, the others rendered")
+{
+    TEMPORARY_DIRECTORY directory("midi-render-job-tests");
+    //an output that is a directory cannot be opened as a file
+    std::filesystem::create_directories(directory / "patterns-2.gif");
+
+    std::stringstream report;
+    const auto results = rendering::render_sequences({ some_notes(), {}, some_notes(), some_notes() }, small_options("gif"), directory / "patterns.gif", "", &report);
+    CATCH_REQUIRE(results.size() == 4);
+
+    CATCH_CHECK(results[0].problem == nullptr);
+    CATCH_CHECK(results[0].error.empty());
+    CATCH_CHECK(results[0].notes == 2);
+    CATCH_CHECK(results[0].frames == 9);
+    CATCH_CHECK(std::filesystem::is_regular_file(results[0].output));
+
+    CATCH_CHECK(std::string(results[1].problem) == "no notes");
+    CATCH_CHECK(results[1].frames == 0);
+    CATCH_CHECK(!std::filesystem::exists(results[1].output));
+
+    CATCH_CHECK(results[2].problem == nullptr);
+    CATCH_CHECK(results[2].error == "could not open " + (directory / "patterns-2.gif"));
+
+    CATCH_CHECK(results[3].error.empty());
+    CATCH_CHECK(results[3].frames == 9);
+
+    CATCH_CHECK(report.str() == "Sequence 0: 2 notes, 9 frames in " + results[0].output + "\n"
+                                "Sequence 1: left out, no notes\n"
+                                "Sequence 2: failed, could not open " + results[2].output + "\n"
+                                "Sequence 3: 2 notes, 9 frames in " + results[3].output + "\n");
+
+    //a file where the directory of the outputs should be
+    write_file(directory / "blocked", "");
+    const auto blocked = rendering::render_sequences({ some_notes() }, small_options("png"), directory / "blocked/frames/", "f%d", nullptr);
+    CATCH_CHECK(blocked[0].error == "could not create " + (directory / "blocked/frames/sequence-0/"));
+    CATCH_CHECK(blocked[0].frames == 0);
+
+    //stdout cannot hold the files of several sequences
+    const auto to_stdout = rendering::render_sequences({ some_notes(), {} }, small_options("delta"), "-", "", nullptr);
+    CATCH_CHECK(to_stdout[0].error == "the sequences of a type 2 file need an --output to name their files after");
+    CATCH_CHECK(to_stdout[1].error.empty());
+}
+
+TEST_CASE("Render job, a batch records why a file could not be rendered")
+{
+    TEMPORARY_DIRECTORY directory("midi-render-job-tests");
+    std::filesystem::create_directories(directory / "in");
+    write_file(directory / "in/good.mid", testutils::midi_file(0, { long_note_track() }));
+    write_file(directory / "in/blocked.mid", testutils::midi_file(0, { long_note_track() }));
+    write_file(directory / "in/sequences.mid", testutils::midi_file(2, { long_note_track(), long_note_track() }));
+    std::filesystem::create_directories(directory / "out/blocked.gif");
+    std::filesystem::create_directories(directory / "out/sequences-1.gif");
+
+    const auto inputs = rendering::collect_batch_inputs(directory / "in");
+    CATCH_REQUIRE(inputs.size() == 3);
+    const auto summary = rendering::render_batch(inputs, small_options("gif"), directory / "out", "", 2);
+
+    for(const auto& result : summary.results)
+    {
+        const auto name = std::filesystem::path(result.path).filename().string();
+        if(name == "good.mid")
+        {
+            CATCH_CHECK(result.ok());
+            CATCH_CHECK(result.frames > 0);
+        }
+        else if(name == "blocked.mid")
+        {
+            CATCH_CHECK(result.error == "could not open " + (directory / "out/blocked.gif"));
+        }
+        else
+        {
+            //one sequence rendered, but the file fails with the other one
+            CATCH_CHECK(result.sequences == 2);
+            CATCH_CHECK(result.frames > 0);
+            CATCH_CHECK(result.error == "sequence 1: could not open " + (directory / "out/sequences-1.gif"));
+        }
+    }
+}
+
+TEST_CASE("Batch, every midi file below a directory gets an output name of its own")
+{
+    TEMPORARY_DIRECTORY directory("midi-render-job-tests");
+    std::filesystem::create_directories(directory / "in/sub");
+    write_file(directory / "in/a.mid", "12345");
+    write_file(directory / "in/a.midi", "1");
+    write_file(directory / "in/sub/b.MIDI", "");
+    write_file(directory / "in/readme.txt", "");
+
+    //sorted by path, the second file named a loses its extension to the first and is numbered
+    const auto inputs = rendering::collect_batch_inputs(directory / "in");
+    CATCH_REQUIRE(inputs.size() == 3);
+    CATCH_CHECK(inputs[0].path == directory / "in/a.mid");
+    CATCH_CHECK(inputs[0].output_name == "a");
+    CATCH_CHECK(inputs[0].size == 5);
+    CATCH_CHECK(inputs[1].path == directory / "in/a.midi");
+    CATCH_CHECK(inputs[1].output_name == "a-2");
+    CATCH_CHECK(inputs[2].path == directory / "in/sub/b.MIDI");
+    CATCH_CHECK(inputs[2].output_name == "sub/b");
+}
+
+TEST_CASE("Batch, a manifest lists files relative to itself, with comments")
+{
+    TEMPORARY_DIRECTORY directory("midi-render-job-tests");
+    std::filesystem::create_directories(directory / "list");
+    write_file(directory / "list/manifest.txt", "# songs to render\n"
+                                                "song.mid\r\n"
+                                                "  sub/../other.mid   # trailing comment\n"
+                                                "\t\n"
+                                                "../outside/song.mid\n"
+                                                "/elsewhere/deep/x.midi\n");
+
+    //files outside of the manifest's directory keep only their name, which has to stay unique too
+    const auto inputs = rendering::collect_batch_inputs(directory / "list/manifest.txt");
+    CATCH_REQUIRE(inputs.size() == 4);
+    CATCH_CHECK(inputs[0].path == directory / "list/song.mid");
+    CATCH_CHECK(inputs[0].output_name == "song");
+    CATCH_CHECK(inputs[1].path == directory / "list/other.mid");
+    CATCH_CHECK(inputs[1].output_name == "other");
+    CATCH_CHECK(inputs[2].path == directory / "list/../outside/song.mid");
+    CATCH_CHECK(inputs[2].output_name == "song-2");
+    CATCH_CHECK(inputs[3].path == "/elsewhere/deep/x.midi");
+    CATCH_CHECK(inputs[3].output_name == "x");
+    //files that are not there yet count as empty
+    CATCH_CHECK(inputs[3].size == 0);
+}
+
+TEST_CASE("Batch, files that cannot be read or parsed fail on their own")
+{
+    TEMPORARY_DIRECTORY directory("midi-render-job-tests");
+    std::filesystem::create_directories(directory / "in/sub");
+    write_file(directory / "in/a.mid", testutils::midi_file(0, { long_note_track() }));
+    write_file(directory / "in/a.midi", testutils::midi_file(0, { long_note_track() }));
+    write_file(directory / "in/broken.mid", "MThd");
+    write_file(directory / "in/sub/b.mid", testutils::midi_file(0, { long_note_track() }));
+
+    auto inputs = rendering::collect_batch_inputs(directory / "in");
+    inputs.push_back(rendering::BATCH_INPUT{ directory / "in/missing.mid", "missing", 0 });
+    const auto summary = rendering::render_batch(inputs, small_options("gif"), directory / "out", "", 3);
+    CATCH_REQUIRE(summary.results.size() == 5);
+    CATCH_CHECK(summary.jobs == 3);
+
+    //results stay in the order of the inputs
+    for(const auto index : { 0, 1, 3 })
+    {
+        CATCH_CHECK(summary.results[index].ok());
+        CATCH_CHECK(summary.results[index].frames > 0);
+        CATCH_CHECK(summary.results[index].notes == 1);
+        CATCH_CHECK(std::filesystem::is_regular_file(summary.results[index].output));
+    }
+    CATCH_CHECK(summary.results[0].output == directory / "out/a.gif");
+    CATCH_CHECK(summary.results[1].output == directory / "out/a-2.gif");
+    CATCH_CHECK(summary.results[3].output == directory / "out/sub/b.gif");
+
+    CATCH_CHECK(summary.results[2].path == directory / "in/broken.mid");
+    CATCH_CHECK(summary.results[2].error.find("invalid midi file at byte ") == 0);
+    CATCH_CHECK(summary.results[2].frames == 0);
+    CATCH_CHECK(summary.results[4].error == "could not open the file");
+    CATCH_CHECK(!std::filesystem::exists(directory / "out/broken.gif"));
+}
+
+TEST_CASE("Batch, the summary as json and as text")
+{
+    rendering::BATCH_SUMMARY summary{ std::vector<rendering::BATCH_RESULT>(2), 2, 3, 2.125 };
+    summary.results[0].path = "in/a \"b\".mid";
+    summary.results[0].output = "out/a.gif";
+    summary.results[0].notes = 2;
+    summary.results[0].sequences = 1;
+    summary.results[0].frames = 9;
+    summary.results[0].parse_seconds = 0.25;
+    summary.results[0].render_seconds = 1.5;
+    summary.results[0].worker = 1;
+    summary.results[1].path = "in/c.mid";
+    summary.results[1].output = "out/c.gif";
+    summary.results[1].error = "invalid\tmidi";
+
+    //quotes are escaped and control characters blanked, the stream's formatting is left as it was
+    std::stringstream json;
+    json.precision(2);
+    rendering::write_batch_summary(json, summary);
+    CATCH_CHECK(json.str() == "{\n"
+                              "  \"files\": 2,\n"
+                              "  \"failed\": 1,\n"
+                              "  \"jobs\": 2,\n"
+                              "  \"steals\": 3,\n"
+                              "  \"seconds\": 2.125,\n"
+                              "  \"results\": [\n"
+                              "    {\n"
+                              "      \"path\": \"in/a \\\"b\\\".mid\",\n"
+                              "      \"output\": \"out/a.gif\",\n"
+                              "      \"status\": \"ok\",\n"
+                              "      \"error\": \"\",\n"
+                              "      \"notes\": 2,\n"
+                              "      \"sequences\": 1,\n"
+                              "      \"frames\": 9,\n"
+                              "      \"parse_seconds\": 0.25,\n"
+                              "      \"render_seconds\": 1.5,\n"
+                              "      \"worker\": 1\n"
+                              "    },\n"
+                              "    {\n"
+                              "      \"path\": \"in/c.mid\",\n"
+                              "      \"output\": \"out/c.gif\",\n"
+                              "      \"status\": \"failed\",\n"
+                              "      \"error\": \"invalid midi\",\n"
+                              "      \"notes\": 0,\n"
+                              "      \"sequences\": 0,\n"
+                              "      \"frames\": 0,\n"
+                              "      \"parse_seconds\": 0,\n"
+                              "      \"render_seconds\": 0,\n"
+                              "      \"worker\": 0\n"
+                              "    }\n"
+                              "  ]\n"
+                              "}\n");
+    CATCH_CHECK(json.precision() == 2);
+
+    std::stringstream text;
+    text.precision(2);
+    rendering::print_batch_summary(text, summary);
+    CATCH_CHECK(text.str() == "ok          0.250s parse     1.500s render       9 frames  in/a \"b\".mid\n"
+                              "failed  in/c.mid: invalid\tmidi\n"
+                              "1 of 2 files rendered in 2.125s by 2 jobs (3 steals)\n");
+    CATCH_CHECK(text.precision() == 2);
+    CATCH_CHECK((text.flags() & std::ios::floatfield) == std::ios::fmtflags());
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "rendering/frame-sink.h"
+#include "rendering/live.h"
+#include "Catch.h"
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <unistd.h>
+
+
+namespace
+{
+    //takes the given number of bytes, then fails like a full disk or a pipe whose reader went away
+    class LimitedBuffer : public std::streambuf
+    {
+    private:
+        size_t left;
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if(left == 0 || traits_type::eq_int_type(c, traits_type::eof())) return traits_type::eof();
+            --left;
+            return c;
+        }
+
+        std::streamsize xsputn(const char*, std::streamsize count) override
+        {
+            const auto taken = std::min<std::streamsize>(count, std::streamsize(left));
+            left -= size_t(taken);
+            return taken;
+        }
+
+    public:
+        explicit LimitedBuffer(size_t bytes) : left(bytes) {}
+    };
+
+    imaging::Frame small_frame()
+    {
+        imaging::Frame frame(8, 4);
+        for(size_t i = 0; i != frame.pixels.size(); ++i) frame.pixels[i] = 0xFF000000U | uint32_t(i * 0x050301U);
+
+        return frame;
+    }
+
+    //writes frames until the sink reports the failure, returns how many were written before it did
+    unsigned frames_until_failure(rendering::FrameSink& sink, unsigned frame_count)
+    {
+        const auto frame = small_frame();
+        sink.begin(frame.width, frame.height, frame_count);
+        for(unsigned i = 0; i != frame_count; ++i)
+        {
+            try
+            {
+                sink.write(i, sink.encode(i, frame));
+            }
+            catch(const std::runtime_error&)
+            {
+                return i;
+            }
+        }
+        CATCH_CHECK_THROWS_AS(sink.finish(), std::runtime_error);
+
+        return frame_count;
+    }
+}
+
+TEST_CASE("Stream sinks, raw frames that cannot be written are reported")
+{
+    //a bgra frame of 8 x 4 pixels takes 128 bytes, the third one does not fit
+    LimitedBuffer buffer(300);
+    std::ostream out(&buffer);
+    rendering::RawStreamSink sink(out, rendering::RawPixelFormat::BGRA);
+
+    CATCH_CHECK(frames_until_failure(sink, 5) == 2);
+}
+
+TEST_CASE("Stream sinks, y4m frames that cannot be written are reported")
+{
+    //the header takes 39 bytes and a frame of 8 x 4 pixels 6 + 32 + 2 * 8, the fourth frame does not fit
+    LimitedBuffer buffer(39 + 3 * 54 + 10);
+    std::ostream out(&buffer);
+    rendering::Y4mStreamSink sink(out, 30, 2);
+
+    CATCH_CHECK(frames_until_failure(sink, 5) == 3);
+
+    //when even the header does not fit, begin reports it
+    LimitedBuffer no_room(10);
+    std::ostream full(&no_room);
+    rendering::Y4mStreamSink full_sink(full, 30, 1);
+    CATCH_CHECK_THROWS_AS(full_sink.begin(8, 4, 1), std::runtime_error);
+}
+
+TEST_CASE("Stream sinks, a delta container whose frames or index cannot be written is reported")
+{
+    const auto frame = small_frame();
+    std::stringstream complete;
+    rendering::DeltaStreamSink complete_sink(complete, 2, 0);
+    complete_sink.begin(frame.width, frame.height, 3);
+    for(unsigned i = 0; i != 3; ++i) complete_sink.write(i, complete_sink.encode(i, frame));
+    complete_sink.finish();
+    const auto container_size = complete.str().size();
+
+    //every frame fits, the index after them does not
+    LimitedBuffer no_index(container_size - 1);
+    std::ostream out(&no_index);
+    rendering::DeltaStreamSink sink(out, 2, 0);
+    CATCH_CHECK(frames_until_failure(sink, 3) == 3);
+
+    LimitedBuffer one_frame(container_size / 2);
+    std::ostream short_out(&one_frame);
+    rendering::DeltaStreamSink short_sink(short_out, 2, 0);
+    CATCH_CHECK(frames_until_failure(short_sink, 3) < 3);
+}
+
+TEST_CASE("Stream sinks, a live session ends with the error when its consumer goes away")
+{
+    //the input stays open and quiet, only the sink can end the session: a frame of 8 x 128 pixels takes 4096 bytes
+    int input[2];
+    CATCH_REQUIRE(pipe(input) == 0);
+    LimitedBuffer buffer(3 * 4096 + 100);
+    std::ostream out(&buffer);
+    rendering::RawStreamSink sink(out, rendering::RawPixelFormat::BGRA);
+
+    rendering::LIVE_SETTINGS settings;
+    settings.frame_width = 8;
+    settings.note_height = 1;
+    settings.frames_per_second = 1000;
+    CATCH_CHECK_THROWS_AS(rendering::run_live(input[0], sink, settings), std::runtime_error);
+
+    close(input[0]);
+    close(input[1]);
+}
+
+#endif
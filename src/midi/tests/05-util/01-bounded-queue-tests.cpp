@@ -0,0 +1,118 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/bounded-queue.h"
+#include "Catch.h"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    const uint64_t DONE = UINT64_MAX;
+}
+
+TEST_CASE("Bounded queue, the capacity is a power of two of at least 2")
+{
+    CATCH_CHECK(BoundedQueue<int>(0).capacity() == 2);
+    CATCH_CHECK(BoundedQueue<int>(1).capacity() == 2);
+    CATCH_CHECK(BoundedQueue<int>(3).capacity() == 4);
+    CATCH_CHECK(BoundedQueue<int>(8).capacity() == 8);
+}
+
+TEST_CASE("Bounded queue, first in first out until full")
+{
+    BoundedQueue<int> queue(1);
+
+    int item = 0;
+    CATCH_CHECK(!queue.try_pop(item));
+
+    for(int i = 1; i != 3; ++i)
+    {
+        int pushed = i;
+        CATCH_CHECK(queue.try_push(pushed));
+    }
+    int overflow = 3;
+    CATCH_CHECK(!queue.try_push(overflow));
+    CATCH_CHECK(queue.size() == 2);
+
+    CATCH_CHECK(queue.pop() == 1);
+    int again = 3;
+    CATCH_CHECK(queue.try_push(again));
+    CATCH_CHECK(queue.pop() == 2);
+    CATCH_CHECK(queue.pop() == 3);
+    CATCH_CHECK(!queue.try_pop(item));
+    CATCH_CHECK(queue.size() == 0);
+}
+
+TEST_CASE("Bounded queue, one producer and several consumers at capacity 1")
+{
+    const uint64_t item_count = 100000;
+    const unsigned consumer_count = 4;
+    BoundedQueue<uint64_t> queue(1);
+
+    //every consumer keeps what it took, in the order it took it
+    std::vector<std::vector<uint64_t>> taken(consumer_count);
+    std::vector<std::thread> consumers;
+    for(unsigned c = 0; c != consumer_count; ++c)
+    {
+        consumers.emplace_back([&queue, &taken, c]()
+        {
+            for(auto item = queue.pop(); item != DONE; item = queue.pop()) taken[c].push_back(item);
+        });
+    }
+
+    for(uint64_t i = 0; i != item_count; ++i) queue.push(i);
+    for(unsigned c = 0; c != consumer_count; ++c) queue.push(DONE);
+    for(auto& consumer : consumers) consumer.join();
+
+    //every item arrives exactly once, and a consumer sees them in the order they were pushed
+    std::vector<unsigned> arrivals(item_count, 0);
+    bool in_order = true;
+    for(const auto& items : taken)
+    {
+        for(size_t i = 0; i != items.size(); ++i)
+        {
+            ++arrivals[items[i]];
+            in_order = in_order && (i == 0 || items[i - 1] < items[i]);
+        }
+    }
+    CATCH_CHECK(in_order);
+    CATCH_CHECK(std::all_of(arrivals.begin(), arrivals.end(), [](unsigned count) { return count == 1; }));
+    CATCH_CHECK(queue.size() == 0);
+}
+
+TEST_CASE("Bounded queue, several producers and one consumer")
+{
+    const uint64_t items_per_producer = 20000;
+    const unsigned producer_count = 3;
+    BoundedQueue<uint64_t> queue(2);
+
+    std::vector<std::thread> producers;
+    for(unsigned p = 0; p != producer_count; ++p)
+    {
+        producers.emplace_back([&queue, p]()
+        {
+            for(uint64_t i = 0; i != items_per_producer; ++i) queue.push(p * items_per_producer + i);
+        });
+    }
+
+    //the items of one producer keep their order
+    std::vector<uint64_t> next(producer_count, 0);
+    bool in_order = true;
+    for(uint64_t i = 0; i != producer_count * items_per_producer; ++i)
+    {
+        const auto item = queue.pop();
+        const auto producer = item / items_per_producer;
+        in_order = in_order && item % items_per_producer == next[producer]++;
+    }
+    for(auto& producer : producers) producer.join();
+
+    CATCH_CHECK(in_order);
+    CATCH_CHECK(next == std::vector<uint64_t>(producer_count, items_per_producer));
+}
+
+#endif
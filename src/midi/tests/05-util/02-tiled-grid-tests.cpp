@@ -0,0 +1,107 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/tiled-grid.h"
+#include "Catch.h"
+#include <filesystem>
+
+
+namespace
+{
+    std::string scratch_directory()
+    {
+        return std::filesystem::temp_directory_path().string();
+    }
+
+    //every element of both grids is equal, read without writing
+    template<typename T>
+    bool same_elements(const Grid<T>& grid, const Grid<T>& expected)
+    {
+        for(unsigned y = 0; y != expected.height(); ++y)
+        {
+            for(unsigned x = 0; x != expected.width(); ++x)
+            {
+                if(grid[Position(x, y)] != expected[Position(x, y)]) return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+TEST_CASE("Tiled grid, reads match a concrete grid after the same writes")
+{
+    //sizes which are not a multiple of the tile size, so the last row and column of tiles are partly outside
+    TiledGrid<uint32_t> tiled(300, 200, scratch_directory());
+    ConcreteGrid<uint32_t> concrete(300, 200, 0U);
+    CATCH_CHECK(tiled.width() == 300);
+    CATCH_CHECK(tiled.height() == 200);
+
+    uint32_t seed = 12345;
+    for(unsigned i = 0; i != 20000; ++i)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        const Position p((seed >> 8) % 300, (seed >> 20) % 200);
+        tiled[p] = seed;
+        concrete[p] = seed;
+    }
+    for(const auto& corner : { Position(0, 0), Position(299, 0), Position(0, 199), Position(299, 199) })
+    {
+        tiled[corner] = 0xFF0000FFU;
+        concrete[corner] = 0xFF0000FFU;
+    }
+
+    CATCH_CHECK(same_elements<uint32_t>(tiled, concrete));
+}
+
+TEST_CASE("Tiled grid, untouched tiles read zero and are never materialized")
+{
+    TiledGrid<uint32_t> tiled(1000, 1000, scratch_directory());
+    const auto& read_only = tiled;
+    CATCH_CHECK(tiled.touched_tiles() == 0);
+
+    tiled[Position(70, 10)] = 0xFF123456U;
+    tiled[Position(999, 999)] = 0xFF654321U;
+    tiled[Position(127, 63)] = 0xFF000001U;     //the same tile as (70, 10)
+    CATCH_CHECK(tiled.touched_tiles() == 2);
+
+    //reading every element, written tiles included, materializes nothing more
+    size_t nonzero = 0;
+    for(unsigned y = 0; y != 1000; ++y)
+    {
+        for(unsigned x = 0; x != 1000; ++x) nonzero += read_only[Position(x, y)] != 0;
+    }
+    CATCH_CHECK(nonzero == 3);
+    CATCH_CHECK(read_only[Position(128, 10)] == 0);
+    CATCH_CHECK(read_only[Position(999, 999)] == 0xFF654321U);
+    CATCH_CHECK(tiled.touched_tiles() == 2);
+}
+
+TEST_CASE("Tiled grid, released tiles keep their contents")
+{
+    TiledGrid<uint16_t> tiled(150, 90, scratch_directory());
+    ConcreteGrid<uint16_t> concrete(150, 90, [](const Position& p) { return uint16_t(p.x % 3 == 0 ? 0 : p.x * 7 + p.y * 131); });
+    for(unsigned y = 0; y != 90; ++y)
+    {
+        for(unsigned x = 0; x != 150; ++x)
+        {
+            if(x % 3 != 0) tiled[Position(x, y)] = concrete[Position(x, y)];
+        }
+    }
+
+    tiled.release();
+    CATCH_CHECK(same_elements<uint16_t>(tiled, concrete));
+    CATCH_CHECK(tiled.touched_tiles() == 3 * 2);
+}
+
+TEST_CASE("Tiled grid, an empty grid maps nothing")
+{
+    TiledGrid<uint32_t> tiled(0, 50, scratch_directory());
+    tiled.release();
+
+    CATCH_CHECK(tiled.width() == 0);
+    CATCH_CHECK(tiled.touched_tiles() == 0);
+}
+
+#endif
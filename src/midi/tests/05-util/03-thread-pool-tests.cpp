@@ -0,0 +1,89 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/thread-pool.h"
+#include "Catch.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+
+TEST_CASE("Thread pool, a single thread runs tasks in the order they were submitted")
+{
+    ThreadPool pool(1, 4);
+    CATCH_CHECK(pool.size() == 1);
+
+    std::vector<int> order;
+    for(int i = 0; i != 100; ++i) pool.submit([&order, i]() { order.push_back(i); });
+    pool.wait();
+
+    bool in_order = order.size() == 100;
+    for(int i = 0; in_order && i != 100; ++i) in_order = order[i] == i;
+    CATCH_CHECK(in_order);
+}
+
+TEST_CASE("Thread pool, wait returns once every task has finished")
+{
+    ThreadPool pool(4, 3);
+    std::atomic<unsigned> finished{0};
+    std::atomic<unsigned> running{0};
+    std::atomic<unsigned> most_running{0};
+
+    for(unsigned i = 0; i != 200; ++i)
+    {
+        pool.submit([&, i]()
+        {
+            const auto now_running = ++running;
+            auto most = most_running.load();
+            while(now_running > most && !most_running.compare_exchange_weak(most, now_running)) {}
+
+            std::this_thread::sleep_for(std::chrono::microseconds(i % 7 * 20));
+            --running;
+            ++finished;
+        });
+    }
+    pool.wait();
+
+    CATCH_CHECK(finished == 200);
+    //no more than max_in_flight tasks are queued or running at a time
+    CATCH_CHECK(most_running <= 3);
+    CATCH_CHECK(most_running >= 1);
+}
+
+TEST_CASE("Thread pool, wait rethrows the first exception once, the other tasks still run")
+{
+    ThreadPool pool(3, 8);
+    std::atomic<unsigned> finished{0};
+
+    for(unsigned i = 0; i != 50; ++i)
+    {
+        pool.submit([&finished, i]()
+        {
+            if(i == 10 || i == 30) throw std::runtime_error("task failed");
+            ++finished;
+        });
+    }
+    CATCH_CHECK_THROWS_AS(pool.wait(), std::runtime_error);
+    CATCH_CHECK(finished == 48);
+
+    //the error was handed over, the pool keeps working
+    pool.submit([&finished]() { ++finished; });
+    CATCH_CHECK_NOTHROW(pool.wait());
+    CATCH_CHECK(finished == 49);
+}
+
+TEST_CASE("Thread pool, queued tasks are finished before the pool is destroyed")
+{
+    std::atomic<unsigned> finished{0};
+    {
+        ThreadPool pool(0, 16);
+        CATCH_CHECK(pool.size() == 1);
+        for(unsigned i = 0; i != 16; ++i) pool.submit([&finished]() { std::this_thread::sleep_for(std::chrono::microseconds(100)); ++finished; });
+    }
+
+    CATCH_CHECK(finished == 16);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/trace.h"
+#include "Catch.h"
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    //the events written on a line of their own, recognised by the start of the line
+    std::vector<std::string> events(const std::string& trace, const std::string& start)
+    {
+        std::vector<std::string> lines;
+        std::istringstream in(trace);
+        for(std::string line; std::getline(in, line);)
+        {
+            if(line.compare(0, start.size(), start) == 0) lines.push_back(line);
+        }
+
+        return lines;
+    }
+
+    std::string field(const std::string& event, const std::string& name)
+    {
+        const auto start = event.find("\"" + name + "\":") + name.size() + 3;
+        return event.substr(start, event.find_first_of(",}", start) - start);
+    }
+
+    void record(const char* thread_name)
+    {
+        tracing::name_thread(thread_name);
+        tracing::Scope outer("trace test outer");
+        tracing::count(tracing::Counter::FRAMES, 2);
+        {
+            tracing::Scope inner("trace test inner");
+            tracing::count(tracing::Counter::BYTES_WRITTEN, 10);
+        }
+    }
+}
+
+TEST_CASE("Trace, spans of every thread and cumulative counters are written as chrome trace events")
+{
+    //tracing is off until it is enabled, nothing is recorded before
+    CATCH_REQUIRE(!tracing::enabled());
+    {
+        tracing::Scope ignored("trace test disabled");
+        tracing::count(tracing::Counter::FRAMES, 100);
+    }
+
+    tracing::enable();
+    CATCH_CHECK(tracing::enabled());
+    std::thread first(record, "trace test first");
+    std::thread second(record, "trace test second");
+    first.join();
+    second.join();
+    //a count after the last scope of a thread is written too
+    tracing::count(tracing::Counter::NOTES, 3);
+
+    std::ostringstream out;
+    out.precision(2);
+    tracing::write_chrome_trace(out);
+    const auto trace = out.str();
+    CATCH_CHECK(trace.compare(0, 16, "{\"traceEvents\":[") == 0);
+    CATCH_CHECK(trace.find("trace test disabled") == std::string::npos);
+    CATCH_CHECK(out.precision() == 2);
+
+    //one complete event per span, in the lane of the thread that recorded it
+    const auto outer = events(trace, "{\"name\":\"trace test outer\",\"cat\":\"midi\",\"ph\":\"X\"");
+    const auto inner = events(trace, "{\"name\":\"trace test inner\",\"cat\":\"midi\",\"ph\":\"X\"");
+    CATCH_REQUIRE(outer.size() == 2);
+    CATCH_REQUIRE(inner.size() == 2);
+    CATCH_CHECK(field(outer[0], "tid") != field(outer[1], "tid"));
+    CATCH_CHECK(std::set<std::string>{ field(inner[0], "tid"), field(inner[1], "tid") } == std::set<std::string>{ field(outer[0], "tid"), field(outer[1], "tid") });
+    CATCH_CHECK(std::stod(field(outer[0], "dur")) >= std::stod(field(inner[0], "dur")));
+    CATCH_CHECK(events(trace, "{\"name\":\"thread_name\",\"ph\":\"M\"").size() == 2);
+
+    //counter events carry the running total over all threads
+    const auto frames = events(trace, "{\"name\":\"frames\",\"ph\":\"C\"");
+    CATCH_REQUIRE(frames.size() == 2);
+    CATCH_CHECK(field(frames[0], "value") == "2");
+    CATCH_CHECK(field(frames[1], "value") == "4");
+    CATCH_CHECK(std::stod(field(frames[0], "ts")) <= std::stod(field(frames[1], "ts")));
+
+    const auto bytes = events(trace, "{\"name\":\"bytes written\",\"ph\":\"C\"");
+    CATCH_REQUIRE(bytes.size() == 2);
+    CATCH_CHECK(field(bytes[1], "value") == "20");
+
+    const auto notes = events(trace, "{\"name\":\"notes\",\"ph\":\"C\"");
+    CATCH_REQUIRE(notes.size() == 1);
+    CATCH_CHECK(field(notes[0], "value") == "3");
+
+    //and their totals in otherData
+    const auto other_data = trace.substr(trace.find("\"otherData\":"));
+    CATCH_CHECK(field(other_data, "frames") == "4");
+    CATCH_CHECK(field(other_data, "bytes written") == "20");
+    CATCH_CHECK(field(other_data, "notes") == "3");
+    CATCH_CHECK(field(other_data, "bytes read") == "0");
+    CATCH_CHECK(trace.substr(trace.size() - 3) == "}}\n");
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifdef TEST_BUILD
+#define CATCH_CONFIG_PREFIX_ALL
+#define TEST_CASE CATCH_TEST_CASE
+
+#include "util/work-stealing-pool.h"
+#include "Catch.h"
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+
+namespace
+{
+    //every task submits two more until the given depth, 2^(depth + 1) - 1 tasks in all
+    void submit_tree(WorkStealingPool& pool, std::atomic<unsigned>& finished, unsigned depth)
+    {
+        pool.submit([&pool, &finished, depth]()
+        {
+            if(depth != 0)
+            {
+                submit_tree(pool, finished, depth - 1);
+                submit_tree(pool, finished, depth - 1);
+            }
+            ++finished;
+        });
+    }
+}
+
+TEST_CASE("Work stealing pool, wait includes tasks submitted by tasks")
+{
+    WorkStealingPool pool(4);
+    CATCH_CHECK(pool.size() == 4);
+    CATCH_CHECK(pool.worker_index() == 4);
+
+    std::atomic<unsigned> finished{0};
+    submit_tree(pool, finished, 9);
+    pool.wait();
+    CATCH_CHECK(finished == 1023);
+
+    //tasks know which worker runs them
+    std::atomic<bool> inside{true};
+    for(unsigned i = 0; i != 32; ++i) pool.submit([&pool, &inside]() { if(pool.worker_index() >= pool.size()) inside = false; });
+    pool.wait();
+    CATCH_CHECK(inside);
+}
+
+TEST_CASE("Work stealing pool, a single worker runs the newest task of its own deque first")
+{
+    WorkStealingPool pool(0);
+    CATCH_CHECK(pool.size() == 1);
+
+    std::vector<int> order;
+    pool.submit([&pool, &order]()
+    {
+        for(int i = 0; i != 3; ++i) pool.submit([&order, i]() { order.push_back(i); });
+    });
+    pool.wait();
+
+    CATCH_CHECK(order == std::vector<int>({ 2, 1, 0 }));
+    CATCH_CHECK(pool.steals() == 0);
+}
+
+TEST_CASE("Work stealing pool, wait rethrows the first exception once, the other tasks still run")
+{
+    WorkStealingPool pool(3);
+    std::atomic<unsigned> finished{0};
+
+    for(unsigned i = 0; i != 20; ++i)
+    {
+        pool.submit([&pool, &finished, i]()
+        {
+            pool.submit([&finished, i]()
+            {
+                if(i == 5 || i == 15) throw std::runtime_error("nested task failed");
+                ++finished;
+            });
+            ++finished;
+        });
+    }
+    CATCH_CHECK_THROWS_AS(pool.wait(), std::runtime_error);
+    CATCH_CHECK(finished == 38);
+
+    //the error was handed over, the pool keeps working
+    pool.submit([&finished]() { ++finished; });
+    CATCH_CHECK_NOTHROW(pool.wait());
+    CATCH_CHECK(finished == 39);
+}
+
+#endif
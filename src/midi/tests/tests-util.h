@@ -3,12 +3,68 @@
 #define CATCH_CONFIG_PREFIX_ALL
 
 #include "Catch.h"
+#include "midi/events.h"
 #include "midi/midi.h"
+#include "midi/parse.h"
+#include "midi/writer.h"
 #include <cstdint>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 #include <list>
 
+//midi files built with TrackWriter, these come before the macros below, which take the name MTHD
+namespace testutils
+{
+    //chunk_before_tracks goes between the MThd chunk and the first track, e.g. an unknown chunk
+    inline std::string midi_file(uint16_t type, const std::vector<midi::TrackWriter>& tracks, const std::string& chunk_before_tracks = "")
+    {
+        midi::MTHD mthd{};
+        mthd.type = type;
+        mthd.ntracks = static_cast<uint16_t>(tracks.size());
+        mthd.division = 96;
+
+        std::stringstream ss;
+        midi::write_mthd(ss, mthd);
+        ss << chunk_before_tracks;
+        for(const auto& track : tracks) midi::write_mtrk(ss, track);
+
+        return ss.str();
+    }
+
+    //a note on channel 0 that starts after dt and lasts 10 ticks
+    inline midi::TrackWriter single_note_track(uint8_t note, midi::Duration dt = midi::Duration(0))
+    {
+        midi::TrackWriter track;
+        track.note_on(dt, midi::Channel(0), midi::NoteNumber(note), 100);
+        track.note_off(midi::Duration(10), midi::Channel(0), midi::NoteNumber(note), 0);
+        track.end_of_track(midi::Duration(0));
+
+        return track;
+    }
+
+    inline const uint8_t* bytes(const std::string& data)
+    {
+        return reinterpret_cast<const uint8_t*>(data.data());
+    }
+
+    inline midi::PARSE_RESULT parse_notes(const std::string& data, std::vector<midi::NOTE>* notes, midi::Automation* automation = nullptr)
+    {
+        return midi::parse_notes(bytes(data), data.size(), notes, automation);
+    }
+
+    inline midi::PARSE_RESULT parse_sequences(const std::string& data, std::vector<std::vector<midi::NOTE>>* sequences)
+    {
+        return midi::parse_sequences(bytes(data), data.size(), sequences);
+    }
+
+    inline midi::PARSE_RESULT decode_events(const std::string& data, midi::DECODED_EVENTS* events)
+    {
+        return midi::decode_events(bytes(data), data.size(), events);
+    }
+}
+
 #define MTHD                                    'M', 'T', 'h', 'd'
 #define MTRK                                    'M', 'T', 'r', 'k'
 
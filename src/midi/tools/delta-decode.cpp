@@ -0,0 +1,74 @@
+#include "imaging/bmp-format.h"
+#include "imaging/delta-format.h"
+#include "rendering/frame-sink.h"
+#include "shell/command-line-parser.h"
+#include "logging.h"
+#include <fstream>
+#include <iostream>
+
+//expands a column delta container written with --format delta back into frames
+//  midi-delta-decode [--format bmp|raw] [--first n] [--count n] [--output path] container.mfd [pattern]
+//bmp writes one file per frame into --output (default: the current directory) named after pattern,
+//raw writes the BGRA pixels of all frames back to back to --output or stdout
+int main(int argc, char** argv)
+{
+    std::string format = "bmp";
+    std::string output;
+    unsigned first_frame = 0;
+    unsigned frame_count = 0;
+
+    shell::CommandLineParser parser;
+    parser.add_argument("--format", &format);
+    parser.add_argument("--output", &output);
+    parser.add_argument("--first", &first_frame);
+    parser.add_argument("--count", &frame_count);
+    parser.process(argc, argv);
+
+    const auto arguments = parser.positional_arguments();
+    if(arguments.empty() || (format == "bmp" && arguments.size() < 2))
+    {
+        std::cerr << "\nPlease provide all needed arguments!";
+        exit(EXIT_FAILURE);
+    }
+    CHECK(format == "bmp" || format == "raw") << "Unknown format " << format;
+
+    std::ifstream input_file_stream(arguments[0], std::ios_base::binary);
+    CHECK(input_file_stream.is_open()) << "Could not open " << arguments[0];
+
+    imaging::DeltaReader reader(input_file_stream);
+    const auto& header = reader.header();
+
+    const auto last_frame = frame_count == 0 ? header.frame_count : std::min(header.frame_count, first_frame + frame_count);
+    std::cerr << header.width << "x" << header.height << ", " << header.frame_count << " frames, key frame every "
+              << header.key_frame_interval << " frames, shift " << header.shift << std::endl;
+
+    std::ofstream output_file_stream;
+    if(format == "raw" && !output.empty() && output != "-")
+    {
+        output_file_stream.open(output, std::ios_base::binary);
+        CHECK(output_file_stream.is_open()) << "Could not open " << output;
+    }
+    auto& out = output_file_stream.is_open() ? static_cast<std::ostream&>(output_file_stream) : std::cout;
+
+    for(unsigned i = first_frame; i < last_frame; ++i)
+    {
+        const auto frame = reader.read_frame(i);
+
+        if(format == "raw")
+        {
+            out.write(reinterpret_cast<const char*>(frame.pixels.data()), frame.pixels.size() * sizeof(uint32_t));
+            CHECK(out.good()) << "Could not write frame " << i;
+            continue;
+        }
+
+        const auto data = imaging::encode_bmp(frame);
+        const auto path = rendering::frame_file_path(output.empty() ? "./" : output, arguments[1], i, ".bmp");
+        std::ofstream file(path, std::ios_base::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        file.close();
+        CHECK(file.good()) << "Could not write " << path;
+    }
+
+    out.flush();
+    CHECK(out.good()) << "Could not write the frames";
+}
@@ -0,0 +1,50 @@
+#include "midi/synthetic.h"
+#include "shell/command-line-parser.h"
+#include "logging.h"
+#include <fstream>
+#include <iostream>
+
+//writes a synthetic standard midi file, the same options always give the same bytes
+//  midi-generate [--seed n] [--format 0|1|2] [--tracks n] [--events n] [--division n] [--chord-size n]
+//                [--control-changes %] [--pitch-wheel-changes %] [--pressure-events %] [--program-changes %]
+//                [--sysex-interval n] [--sysex-size n] [--tempo-interval n] [--explicit-status] [--output file.mid]
+//the percentages are of the channel events, the rest are notes, the file goes to --output or stdout
+int main(int argc, char** argv)
+{
+    midi::SYNTHETIC_SETTINGS settings;
+    bool explicit_status = false;
+    std::string output;
+
+    //64 bit values do not fit the unsigned arguments of the parser
+    auto large = [](uint64_t* target) { return std::function<void(const std::string&)>([target](const std::string& argument) { *target = std::stoull(argument); }); };
+
+    shell::CommandLineParser parser;
+    parser.add_argument("--seed", large(&settings.seed));
+    parser.add_argument("--format", &settings.format);
+    parser.add_argument("--tracks", &settings.tracks);
+    parser.add_argument("--events", large(&settings.events));
+    parser.add_argument("--division", &settings.division);
+    parser.add_argument("--chord-size", &settings.chord_size);
+    parser.add_argument("--control-changes", &settings.control_changes);
+    parser.add_argument("--pitch-wheel-changes", &settings.pitch_wheel_changes);
+    parser.add_argument("--pressure-events", &settings.pressure_events);
+    parser.add_argument("--program-changes", &settings.program_changes);
+    parser.add_argument("--sysex-interval", large(&settings.sysex_interval));
+    parser.add_argument("--sysex-size", &settings.sysex_size);
+    parser.add_argument("--tempo-interval", large(&settings.tempo_interval));
+    parser.add_argument("--explicit-status", &explicit_status);
+    parser.add_argument("--output", &output);
+    parser.process(argc, argv);
+
+    settings.running_status = !explicit_status;
+    CHECK(settings.control_changes + settings.pitch_wheel_changes + settings.pressure_events + settings.program_changes <= 100) << "The percentages of the event mix add up to more than 100";
+
+    std::ofstream output_file_stream;
+    if(!output.empty() && output != "-")
+    {
+        output_file_stream.open(output, std::ios_base::binary);
+        CHECK(output_file_stream.is_open()) << "Could not open " << output;
+    }
+
+    write_synthetic_midi(output_file_stream.is_open() ? output_file_stream : std::cout, settings);
+}
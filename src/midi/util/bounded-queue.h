@@ -0,0 +1,134 @@
+#ifndef MIDI_PROJECT_BOUNDED_QUEUE_H
+#define MIDI_PROJECT_BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+//bounded multi producer/multi consumer queue without locks (Dmitry Vyukov's array based design)
+//every cell carries a sequence number telling whether it is ready to be written or read for the current lap,
+//so producers and consumers only contend on their own position counter
+//capacity is rounded up to a power of two, and to at least 2: with a single cell a full queue and an empty one look alike
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : mask(round_up_to_power_of_two(std::max<size_t>(capacity, 2)) - 1), cells(std::make_unique<Cell[]>(mask + 1)), enqueue_position(0), dequeue_position(0)
+    {
+        for(size_t i = 0; i <= mask; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator =(const BoundedQueue&) = delete;
+
+    bool try_push(T& item)
+    {
+        Cell* cell;
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        while(true)
+        {
+            cell = &cells[position & mask];
+            const auto sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+            if(difference == 0)
+            {
+                if(enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            }
+            else if(difference < 0) return false; //full
+            else position = enqueue_position.load(std::memory_order_relaxed);
+        }
+
+        cell->item = std::move(item);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& item)
+    {
+        Cell* cell;
+        size_t position = dequeue_position.load(std::memory_order_relaxed);
+        while(true)
+        {
+            cell = &cells[position & mask];
+            const auto sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+
+            if(difference == 0)
+            {
+                if(dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            }
+            else if(difference < 0) return false; //empty
+            else position = dequeue_position.load(std::memory_order_relaxed);
+        }
+
+        item = std::move(cell->item);
+        cell->sequence.store(position + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    //spin briefly, then yield and finally sleep, the queues sit between pipeline stages that each take far longer than a context switch
+    void push(T item)
+    {
+        for(unsigned spins = 0; !try_push(item); ++spins) back_off(spins);
+    }
+
+    T pop()
+    {
+        T item;
+        for(unsigned spins = 0; !try_pop(item); ++spins) back_off(spins);
+
+        return item;
+    }
+
+    //only a snapshot, other threads may push or pop while this is computed
+    size_t size() const
+    {
+        const auto enqueued = enqueue_position.load(std::memory_order_relaxed);
+        const auto dequeued = dequeue_position.load(std::memory_order_relaxed);
+
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    static size_t round_up_to_power_of_two(size_t n)
+    {
+        size_t result = 1;
+        while(result < n) result <<= 1U;
+
+        return result;
+    }
+
+    static void back_off(unsigned spins)
+    {
+        if(spins > 1024) std::this_thread::sleep_for(std::chrono::microseconds(50));
+        else if(spins > 64) std::this_thread::yield();
+    }
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    //keep both counters on their own cache line so producers and consumers do not invalidate each other
+    alignas(64) std::atomic<size_t> enqueue_position;
+    alignas(64) std::atomic<size_t> dequeue_position;
+};
+
+#endif //MIDI_PROJECT_BOUNDED_QUEUE_H
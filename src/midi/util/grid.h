@@ -61,7 +61,7 @@ public:
     }
 
     ConcreteGrid(unsigned width, unsigned height)
-        : m_elts(std::make_unique<T[]>(width * height)), m_width(width), m_height(height)
+        : m_elts(std::make_unique<T[]>(size_t(width) * height)), m_width(width), m_height(height)
     {
         // NOP
     }
@@ -76,14 +76,14 @@ public:
     {
         assert(this->is_inside(p));
 
-        return m_elts[p.x + p.y * m_width];
+        return m_elts[p.x + size_t(p.y) * m_width];
     }
 
     const T& operator [](const Position& p) const override
     {
         assert(this->is_inside(p));
 
-        return m_elts[p.x + p.y * m_width];
+        return m_elts[p.x + size_t(p.y) * m_width];
     }
 
     unsigned width() const override
@@ -116,7 +116,8 @@ public:
 
     const T& operator[](const Position& p) const override
     {
-        return (*m_parent)[m_position + p];
+        // Read through the const overload, a parent may treat writes differently
+        return static_cast<const Grid<T>&>(*m_parent)[m_position + p];
     }
 
     unsigned width() const override
@@ -0,0 +1,112 @@
+#ifndef MIDI_PROJECT_HASH_H
+#define MIDI_PROJECT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//64 bit non cryptographic hash (the xxHash64 construction)
+//the bulk loop keeps four independent accumulators, so the multiplications of one 32 byte block
+//do not depend on each other and can run in parallel (or be vectorized by the compiler)
+namespace hashing
+{
+    namespace detail
+    {
+        constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+        constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+        constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+        inline uint64_t rotate_left(uint64_t value, unsigned bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline uint64_t read64(const uint8_t* data)
+        {
+            uint64_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t read32(const uint8_t* data)
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        inline uint64_t round(uint64_t accumulator, uint64_t input)
+        {
+            accumulator += input * PRIME_2;
+            return rotate_left(accumulator, 31) * PRIME_1;
+        }
+
+        inline uint64_t merge_round(uint64_t hash, uint64_t accumulator)
+        {
+            hash ^= round(0, accumulator);
+            return hash * PRIME_1 + PRIME_4;
+        }
+    }
+
+    inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0)
+    {
+        using namespace detail;
+
+        auto position = static_cast<const uint8_t*>(data);
+        const auto end = position + size;
+        uint64_t hash;
+
+        if(size >= 32)
+        {
+            uint64_t lanes[4] = { seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1 };
+
+            for(; position + 32 <= end; position += 32)
+            {
+                for(unsigned lane = 0; lane != 4; ++lane)
+                {
+                    lanes[lane] = round(lanes[lane], read64(position + 8 * lane));
+                }
+            }
+
+            hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+            for(auto lane : lanes) hash = merge_round(hash, lane);
+        }
+        else
+        {
+            hash = seed + PRIME_5;
+        }
+
+        hash += size;
+
+        for(; position + 8 <= end; position += 8)
+        {
+            hash ^= round(0, read64(position));
+            hash = rotate_left(hash, 27) * PRIME_1 + PRIME_4;
+        }
+
+        if(position + 4 <= end)
+        {
+            hash ^= read32(position) * PRIME_1;
+            hash = rotate_left(hash, 23) * PRIME_2 + PRIME_3;
+            position += 4;
+        }
+
+        for(; position != end; ++position)
+        {
+            hash ^= *position * PRIME_5;
+            hash = rotate_left(hash, 11) * PRIME_1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= PRIME_2;
+        hash ^= hash >> 29;
+        hash *= PRIME_3;
+        hash ^= hash >> 32;
+
+        return hash;
+    }
+}
+
+#endif //MIDI_PROJECT_HASH_H
@@ -0,0 +1,94 @@
+#ifndef MIDI_PROJECT_LATENCY_HISTOGRAM_H
+#define MIDI_PROJECT_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+//latencies in microseconds, counted in log-linear buckets: every power of two is split in 32 buckets of equal width,
+//so a percentile is off by at most 1/32 of its value however wide the range of latencies is
+class LatencyHistogram
+{
+public:
+    void record(uint64_t latency)
+    {
+        ++buckets[bucket_of(latency)];
+        ++total;
+        largest = std::max(largest, latency);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return largest; }
+
+    //the upper end of the bucket holding the given fraction (0 to 1) of the latencies, 0 when nothing was recorded
+    uint64_t percentile(double fraction) const
+    {
+        if(total == 0) return 0;
+
+        const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * double(total) + 0.5));
+        uint64_t seen = 0;
+        for(unsigned i = 0; i != BUCKET_COUNT; ++i)
+        {
+            seen += buckets[i];
+            if(seen >= rank) return std::min(upper_bound_of(i), largest);
+        }
+
+        return largest;
+    }
+
+    //only the buckets that counted something, every line after the first starts with indent so the object can be nested
+    void write_json(std::ostream& out, const std::string& indent = "") const
+    {
+        out << "{\n" << indent << "  \"unit\": \"us\",\n" << indent << "  \"count\": " << total << ",\n" << indent << "  \"p50\": " << percentile(0.5)
+            << ",\n" << indent << "  \"p90\": " << percentile(0.9) << ",\n" << indent << "  \"p99\": " << percentile(0.99)
+            << ",\n" << indent << "  \"max\": " << largest << ",\n" << indent << "  \"buckets\": [";
+
+        bool first = true;
+        for(unsigned i = 0; i != BUCKET_COUNT; ++i)
+        {
+            if(buckets[i] == 0) continue;
+
+            out << (first ? "\n" : ",\n") << indent << "    { \"from\": " << lower_bound_of(i) << ", \"to\": " << upper_bound_of(i) << ", \"count\": " << buckets[i] << " }";
+            first = false;
+        }
+        out << "\n" << indent << "  ]\n" << indent << "}";
+    }
+
+private:
+    static const unsigned SUB_BUCKET_BITS = 5;
+    static const unsigned SUB_BUCKETS = 1U << SUB_BUCKET_BITS;
+    static const unsigned BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::array<uint64_t, BUCKET_COUNT> buckets{};
+    uint64_t total = 0;
+    uint64_t largest = 0;
+
+    //below 32 every value has its own bucket, above that the 5 bits after the highest one pick the bucket
+    static unsigned bucket_of(uint64_t value)
+    {
+        if(value < SUB_BUCKETS) return static_cast<unsigned>(value);
+
+        unsigned exponent = 63;
+        while(!(value >> exponent)) --exponent;
+        const auto shift = exponent - SUB_BUCKET_BITS;
+
+        return (shift + 1) * SUB_BUCKETS + static_cast<unsigned>((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t lower_bound_of(unsigned bucket)
+    {
+        if(bucket < SUB_BUCKETS) return bucket;
+
+        const auto shift = bucket / SUB_BUCKETS - 1;
+        return (uint64_t(SUB_BUCKETS) + bucket % SUB_BUCKETS) << shift;
+    }
+
+    static uint64_t upper_bound_of(unsigned bucket)
+    {
+        return bucket + 1 == BUCKET_COUNT ? UINT64_MAX : lower_bound_of(bucket + 1) - 1;
+    }
+};
+
+#endif //MIDI_PROJECT_LATENCY_HISTOGRAM_H
@@ -0,0 +1,124 @@
+#ifndef MIDI_PROJECT_THREAD_POOL_H
+#define MIDI_PROJECT_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+//fixed size pool of worker threads
+//at most max_in_flight tasks are queued or running at the same time, submit blocks until a slot frees up
+//this keeps the memory held by pending tasks (e.g. frames waiting to be written) bounded
+class ThreadPool
+{
+public:
+    ThreadPool(unsigned thread_count, unsigned max_in_flight)
+        : max_in_flight(std::max(max_in_flight, 1U)), in_flight(0), stopping(false)
+    {
+        for(unsigned i = 0; i < std::max(thread_count, 1U); ++i)
+        {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator =(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        task_available.notify_all();
+
+        for(auto& worker : workers) worker.join();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot_available.wait(lock, [this]() { return in_flight < max_in_flight; });
+
+        ++in_flight;
+        tasks.push(std::move(task));
+        lock.unlock();
+
+        task_available.notify_one();
+    }
+
+    //blocks until every submitted task has finished, rethrows the first exception a task threw
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot_available.wait(lock, [this]() { return in_flight == 0; });
+
+        if(error)
+        {
+            auto e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    static unsigned default_thread_count()
+    {
+        return std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+private:
+    void work()
+    {
+        while(true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+                if(tasks.empty()) return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            try
+            {
+                task();
+            }
+            catch(...)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if(!error) error = std::current_exception();
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                --in_flight;
+            }
+            slot_available.notify_all();
+        }
+    }
+
+    const unsigned max_in_flight;
+    unsigned in_flight;
+    bool stopping;
+    std::exception_ptr error;
+
+    std::queue<std::function<void()>> tasks;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable slot_available;
+};
+
+#endif //MIDI_PROJECT_THREAD_POOL_H
@@ -0,0 +1,148 @@
+#ifndef TILED_GRID_H
+#define TILED_GRID_H
+
+#include "util/grid.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+/// <summary>
+/// Grid whose elements live in a sparse, memory mapped scratch file instead of on the heap,
+/// so it can be far larger than the available memory: the OS pages tiles in and out as needed.
+/// Elements are stored in square tiles, which keeps both rows and columns of neighbouring
+/// elements close together. All elements start out zero (e.g. black for colors).
+/// A tile that was never written is never materialized: it takes no disk space
+/// and reading from it returns zero without touching the mapping.
+/// </summary>
+template<typename T>
+class TiledGrid : public Grid<T>
+{
+    static_assert(std::is_trivially_copyable<T>::value, "elements are stored as raw bytes in a file");
+
+public:
+    static const unsigned TILE_SIZE = 64;
+
+    /// <summary>
+    /// Creates the scratch file in <paramref name="directory" />, which should be on a disk rather than
+    /// in memory (tmpfs) for the grid to be out of core. The file is removed right away,
+    /// its space is given back as soon as the grid is destroyed.
+    /// </summary>
+    TiledGrid(unsigned width, unsigned height, const std::string& directory)
+        : m_width(width), m_height(height),
+          m_tiles_per_row((width + TILE_SIZE - 1) / TILE_SIZE),
+          m_tile_bytes(round_up(uint64_t(TILE_SIZE) * TILE_SIZE * sizeof(T), uint64_t(sysconf(_SC_PAGESIZE)))),
+          m_size(uint64_t(m_tiles_per_row) * ((height + TILE_SIZE - 1) / TILE_SIZE) * m_tile_bytes),
+          m_touched(std::make_unique<std::atomic<bool>[]>(size_t(m_tiles_per_row) * ((height + TILE_SIZE - 1) / TILE_SIZE))),
+          m_data(nullptr)
+    {
+        if (m_size == 0) return;
+
+        std::string path = directory + "/midi-canvas-XXXXXX";
+        const int fd = mkstemp(&path[0]);
+        if (fd == -1) throw std::system_error(errno, std::generic_category(), "cannot create scratch file in " + directory);
+        unlink(path.c_str());
+
+        // ftruncate only sets the size: the file stays sparse until tiles are written
+        void* data = ftruncate(fd, off_t(m_size)) == 0
+            ? mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0)
+            : MAP_FAILED;
+        const int error = errno;
+        close(fd);
+
+        if (data == MAP_FAILED) throw std::system_error(error, std::generic_category(), "cannot map scratch file in " + directory);
+        m_data = static_cast<uint8_t*>(data);
+    }
+
+    TiledGrid(const TiledGrid&) = delete;
+    TiledGrid& operator =(const TiledGrid&) = delete;
+
+    ~TiledGrid()
+    {
+        if (m_data != nullptr) munmap(m_data, m_size);
+    }
+
+    T& operator [](const Position& p) override
+    {
+        assert(this->is_inside(p));
+
+        // Checked first so that writes to an already touched tile do not bounce its flag between caches
+        auto& touched = m_touched[tile_of(p)];
+        if (!touched.load(std::memory_order_relaxed)) touched.store(true, std::memory_order_relaxed);
+
+        return *element(p);
+    }
+
+    const T& operator [](const Position& p) const override
+    {
+        assert(this->is_inside(p));
+
+        static const T zero = T();
+        return m_touched[tile_of(p)].load(std::memory_order_relaxed) ? *element(p) : zero;
+    }
+
+    unsigned width() const override
+    {
+        return m_width;
+    }
+
+    unsigned height() const override
+    {
+        return m_height;
+    }
+
+    /// <summary>
+    /// Drops the mapped pages from the resident set. Their contents are kept in the file
+    /// (or the page cache) and are paged back in when accessed again.
+    /// Safe to call while other threads read from the grid.
+    /// </summary>
+    void release()
+    {
+        if (m_data != nullptr) madvise(m_data, m_size, MADV_DONTNEED);
+    }
+
+    /// <summary>
+    /// Number of tiles that have been written to and take up space.
+    /// </summary>
+    size_t touched_tiles() const
+    {
+        const size_t tile_count = m_tile_bytes == 0 ? 0 : m_size / m_tile_bytes;
+        size_t count = 0;
+        for (size_t i = 0; i != tile_count; ++i) count += m_touched[i].load(std::memory_order_relaxed);
+
+        return count;
+    }
+
+private:
+    static uint64_t round_up(uint64_t value, uint64_t multiple)
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    size_t tile_of(const Position& p) const
+    {
+        return size_t(p.y / TILE_SIZE) * m_tiles_per_row + p.x / TILE_SIZE;
+    }
+
+    T* element(const Position& p) const
+    {
+        const auto offset_in_tile = size_t(p.y % TILE_SIZE) * TILE_SIZE + p.x % TILE_SIZE;
+
+        return reinterpret_cast<T*>(m_data + tile_of(p) * m_tile_bytes) + offset_in_tile;
+    }
+
+    unsigned m_width;
+    unsigned m_height;
+    unsigned m_tiles_per_row;
+    uint64_t m_tile_bytes;
+    uint64_t m_size;
+    std::unique_ptr<std::atomic<bool>[]> m_touched;
+    uint8_t* m_data;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef MIDI_PROJECT_TRACE_H
+#define MIDI_PROJECT_TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+//scoped timers and counters for the hot paths, written out as chrome trace event json (chrome://tracing, ui.perfetto.dev)
+//every thread records into a buffer of its own, so recording never takes a lock after a thread's first event
+//while tracing is disabled a scope or count costs one relaxed load and a branch
+//names are expected to be string literals, they are stored as pointers and written without escaping
+namespace tracing
+{
+    enum class Counter : unsigned
+    {
+        BYTES_READ,
+        NOTE_OFF_EVENTS,
+        NOTE_ON_EVENTS,
+        POLYPHONIC_KEY_PRESSURE_EVENTS,
+        CONTROL_CHANGE_EVENTS,
+        PROGRAM_CHANGE_EVENTS,
+        CHANNEL_PRESSURE_EVENTS,
+        PITCH_WHEEL_CHANGE_EVENTS,
+        META_EVENTS,
+        SYSEX_EVENTS,
+        NOTES,
+        PIXELS_FILLED,
+        FRAMES,
+        BYTES_WRITTEN,
+        COUNT
+    };
+
+    inline const char* counter_name(Counter counter)
+    {
+        static const char* names[] = {
+            "bytes read", "note off events", "note on events", "polyphonic key pressure events", "control change events",
+            "program change events", "channel pressure events", "pitch wheel change events", "meta events", "sysex events",
+            "notes", "pixels filled", "frames", "bytes written"
+        };
+        static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(Counter::COUNT), "A counter has no name");
+
+        return names[static_cast<unsigned>(counter)];
+    }
+
+    namespace detail
+    {
+        using Clock = std::chrono::steady_clock;
+        constexpr unsigned COUNTER_COUNT = static_cast<unsigned>(Counter::COUNT);
+
+        struct SPAN
+        {
+            const char* name;
+            uint64_t start_ns;
+            uint64_t duration_ns;
+        };
+
+        //the growth of a counter since the previous sample of the same thread
+        struct SAMPLE
+        {
+            uint64_t time_ns;
+            unsigned counter;
+            uint64_t amount;
+        };
+
+        struct THREAD_BUFFER
+        {
+            unsigned id;
+            const char* name = nullptr;
+            std::vector<SPAN> spans;
+            std::vector<SAMPLE> samples;
+            uint64_t counters[COUNTER_COUNT] = {};
+            uint64_t sampled[COUNTER_COUNT] = {};
+
+            explicit THREAD_BUFFER(unsigned id) : id(id) {};
+        };
+
+        inline std::atomic<bool> enabled{false};
+        inline Clock::time_point epoch;
+
+        //buffers outlive their threads, so they can still be written once the threads of a stage have finished
+        inline std::mutex buffers_mutex;
+        inline std::vector<std::unique_ptr<THREAD_BUFFER>> buffers;
+
+        inline uint64_t now_ns()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count());
+        }
+
+        inline THREAD_BUFFER& thread_buffer()
+        {
+            thread_local THREAD_BUFFER* buffer = nullptr;
+            if(buffer == nullptr)
+            {
+                std::lock_guard<std::mutex> lock(buffers_mutex);
+                buffers.push_back(std::make_unique<THREAD_BUFFER>(static_cast<unsigned>(buffers.size() + 1)));
+                buffer = buffers.back().get();
+            }
+
+            return *buffer;
+        }
+
+        //counters are sampled when a scope ends, not on every count, so counting stays a plain addition
+        inline void sample_counters(THREAD_BUFFER& buffer, uint64_t time_ns)
+        {
+            for(unsigned i = 0; i != COUNTER_COUNT; ++i)
+            {
+                if(buffer.counters[i] == buffer.sampled[i]) continue;
+
+                buffer.samples.push_back(SAMPLE{time_ns, i, buffer.counters[i] - buffer.sampled[i]});
+                buffer.sampled[i] = buffer.counters[i];
+            }
+        }
+    }
+
+    inline bool enabled()
+    {
+        return detail::enabled.load(std::memory_order_relaxed);
+    }
+
+    //timestamps are relative to this call, which has to happen before any other thread records something
+    inline void enable()
+    {
+        detail::epoch = detail::Clock::now();
+        detail::enabled.store(true);
+    }
+
+    inline void count(Counter counter, uint64_t amount = 1)
+    {
+        if(!enabled()) return;
+
+        detail::thread_buffer().counters[static_cast<unsigned>(counter)] += amount;
+    }
+
+    //the name of the lane of the calling thread
+    inline void name_thread(const char* name)
+    {
+        if(!enabled()) return;
+
+        detail::thread_buffer().name = name;
+    }
+
+    class Scope
+    {
+        const char* name;
+        uint64_t start_ns;
+        bool active;
+
+    public:
+        explicit Scope(const char* name) : name(name), start_ns(0), active(enabled())
+        {
+            if(active) start_ns = detail::now_ns();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator =(const Scope&) = delete;
+
+        ~Scope()
+        {
+            if(!active) return;
+
+            const auto end_ns = detail::now_ns();
+            auto& buffer = detail::thread_buffer();
+            buffer.spans.push_back(detail::SPAN{name, start_ns, end_ns - start_ns});
+            detail::sample_counters(buffer, end_ns);
+        }
+    };
+
+    //writes every recorded span as a complete event in the lane of its thread, and the counters as counter tracks
+    //summed over all threads, with their totals in otherData
+    //every traced thread must have finished recording
+    inline void write_chrome_trace(std::ostream& out)
+    {
+        std::lock_guard<std::mutex> lock(detail::buffers_mutex);
+        const auto end_ns = detail::now_ns();
+
+        std::vector<detail::SAMPLE> samples;
+        for(auto& buffer : detail::buffers)
+        {
+            //counts made after the last scope of a thread ended
+            detail::sample_counters(*buffer, end_ns);
+            samples.insert(samples.end(), buffer->samples.begin(), buffer->samples.end());
+        }
+        std::stable_sort(samples.begin(), samples.end(), [](const detail::SAMPLE& l, const detail::SAMPLE& r) { return l.time_ns < r.time_ns; });
+
+        auto microseconds = [](uint64_t ns) { return static_cast<double>(ns) / 1000; };
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+        out << std::fixed;
+        out.precision(3);
+
+        out << "{\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"midi-visualizer\"}}";
+
+        for(const auto& buffer : detail::buffers)
+        {
+            if(buffer->name != nullptr)
+            {
+                out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            }
+
+            for(const auto& span : buffer->spans)
+            {
+                out << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"midi\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                    << ",\"ts\":" << microseconds(span.start_ns) << ",\"dur\":" << microseconds(span.duration_ns) << "}";
+            }
+        }
+
+        uint64_t totals[detail::COUNTER_COUNT] = {};
+        for(const auto& sample : samples)
+        {
+            totals[sample.counter] += sample.amount;
+            out << ",\n{\"name\":\"" << counter_name(static_cast<Counter>(sample.counter)) << "\",\"ph\":\"C\",\"pid\":1,\"tid\":0"
+                << ",\"ts\":" << microseconds(sample.time_ns) << ",\"args\":{\"value\":" << totals[sample.counter] << "}}";
+        }
+
+        out << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{";
+        for(unsigned i = 0; i != detail::COUNTER_COUNT; ++i)
+        {
+            out << (i == 0 ? "" : ",") << "\"" << counter_name(static_cast<Counter>(i)) << "\":" << totals[i];
+        }
+        out << "}}\n";
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+}
+
+#endif //MIDI_PROJECT_TRACE_H
@@ -0,0 +1,186 @@
+#ifndef MIDI_PROJECT_WORK_STEALING_POOL_H
+#define MIDI_PROJECT_WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//fixed size pool of worker threads that each have a deque of tasks of their own
+//a worker runs its own tasks newest first, so a task submitted by a task runs next on the same thread while its data is still warm
+//an idle worker steals the oldest task of another worker instead of sleeping, so uneven tasks still keep every thread busy
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned thread_count)
+        : next_queue(0), queued(0), pending(0), stolen(0), stopping(false)
+    {
+        const auto count = std::max(thread_count, 1U);
+        for(unsigned i = 0; i < count; ++i) queues.push_back(std::make_unique<QUEUE>());
+        for(unsigned i = 0; i < count; ++i) workers.emplace_back([this, i]() { work(i); });
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator =(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        task_available.notify_all();
+
+        for(auto& worker : workers) worker.join();
+    }
+
+    //from a worker of this pool the task goes to the deque of that worker, from any other thread the deques take turns
+    void submit(std::function<void()> task)
+    {
+        const auto index = current_pool == this ? current_index : next_queue.fetch_add(1, std::memory_order_relaxed) % size();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ++pending;
+        }
+        queued.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+
+        //taking the lock orders this wake up after a sleeping worker checked queued, so it cannot be lost
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+        }
+        task_available.notify_one();
+    }
+
+    //blocks until every submitted task has finished, tasks submitted by tasks included
+    //rethrows the first exception a task threw
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this]() { return pending == 0; });
+
+        if(error)
+        {
+            auto e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    //the worker running the calling task, or size() outside of the pool
+    unsigned worker_index() const
+    {
+        return current_pool == this ? current_index : size();
+    }
+
+    //tasks that were run by another worker than the one whose deque they were in
+    uint64_t steals() const
+    {
+        return stolen.load();
+    }
+
+private:
+    struct QUEUE
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool pop(unsigned index, std::function<void()>* task)
+    {
+        auto& queue = *queues[index];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if(queue.tasks.empty()) return false;
+
+        *task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thief, std::function<void()>* task)
+    {
+        for(unsigned i = 1; i < size(); ++i)
+        {
+            auto& queue = *queues[(thief + i) % size()];
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            if(queue.tasks.empty()) continue;
+
+            *task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        return false;
+    }
+
+    void work(unsigned index)
+    {
+        current_pool = this;
+        current_index = index;
+
+        while(true)
+        {
+            std::function<void()> task;
+            if(!pop(index, &task) && !steal(index, &task))
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_available.wait(lock, [this]() { return stopping || queued.load() != 0; });
+
+                if(queued.load() == 0) return;
+                continue;
+            }
+            queued.fetch_sub(1);
+
+            try
+            {
+                task();
+            }
+            catch(...)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if(!error) error = std::current_exception();
+            }
+
+            bool done;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done = --pending == 0;
+            }
+            if(done) all_done.notify_all();
+        }
+    }
+
+    inline static thread_local const WorkStealingPool* current_pool = nullptr;
+    inline static thread_local unsigned current_index = 0;
+
+    std::vector<std::unique_ptr<QUEUE>> queues;
+    std::atomic<unsigned> next_queue;
+    std::atomic<uint64_t> queued;   //tasks waiting in any deque, checked before a worker goes to sleep
+    uint64_t pending;               //tasks submitted and not finished yet
+    std::atomic<uint64_t> stolen;
+    bool stopping;
+    std::exception_ptr error;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable all_done;
+};
+
+#endif //MIDI_PROJECT_WORK_STEALING_POOL_H